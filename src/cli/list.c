@@ -87,6 +87,25 @@ static void print_crash(problem_data_t *problem_data, int detailed, int text_siz
  * @param only_unreported
  *   Do not skip entries marked as already reported.
  */
+static bool is_crash_listed(problem_data_t *crash, int only_not_reported, long since, long until)
+{
+    if (only_not_reported)
+    {
+        if (problem_data_get_content_or_NULL(crash, FILENAME_REPORTED_TO))
+            return false;
+    }
+    if (since || until)
+    {
+        char *s = problem_data_get_content_or_NULL(crash, FILENAME_LAST_OCCURRENCE);
+        long val = s ? atol(s) : 0;
+        if (since && val < since)
+            return false;
+        if (until && val > until)
+            return false;
+    }
+    return true;
+}
+
 static bool print_crash_list(vector_of_problem_data_t *crash_list, int detailed, int only_not_reported, long since, long until, int text_size)
 {
     bool output = false;
@@ -94,20 +113,8 @@ static bool print_crash_list(vector_of_problem_data_t *crash_list, int detailed,
     for (i = 0; i < crash_list->len; ++i)
     {
         problem_data_t *crash = get_problem_data(crash_list, i);
-        if (only_not_reported)
-        {
-            if (problem_data_get_content_or_NULL(crash, FILENAME_REPORTED_TO))
-                continue;
-        }
-        if (since || until)
-        {
-            char *s = problem_data_get_content_or_NULL(crash, FILENAME_LAST_OCCURRENCE);
-            long val = s ? atol(s) : 0;
-            if (since && val < since)
-                continue;
-            if (until && val > until)
-                continue;
-        }
+        if (!is_crash_listed(crash, only_not_reported, since, until))
+            continue;
 
         char hash_str[SHA1_RESULT_LEN*2 + 1];
         struct problem_item *item = g_hash_table_lookup(crash, CD_DUMPDIR);
@@ -121,6 +128,67 @@ static bool print_crash_list(vector_of_problem_data_t *crash_list, int detailed,
     return output;
 }
 
+/**
+ * Prints clusters of crashes in the same function of a shared library (see
+ * abrt-action-analyze-cluster) having at least two listed crashes.
+ */
+static bool print_cluster_list(vector_of_problem_data_t *crash_list, int only_not_reported, long since, long until)
+{
+    /* Keeps the order of the crash list */
+    GPtrArray *hashes = g_ptr_array_new();
+    GHashTable *clusters = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                 NULL, (GDestroyNotify)g_list_free);
+
+    for (unsigned i = 0; i < crash_list->len; ++i)
+    {
+        problem_data_t *crash = get_problem_data(crash_list, i);
+        if (!is_crash_listed(crash, only_not_reported, since, until))
+            continue;
+
+        char *hash = problem_data_get_content_or_NULL(crash, FILENAME_CLUSTER_HASH);
+        if (hash == NULL)
+            continue;
+
+        GList *members = g_hash_table_lookup(clusters, hash);
+        if (members == NULL)
+            g_ptr_array_add(hashes, hash);
+
+        g_hash_table_replace(clusters, hash, g_list_append(members, crash));
+    }
+
+    bool output = false;
+    for (unsigned i = 0; i < hashes->len; ++i)
+    {
+        const char *hash = g_ptr_array_index(hashes, i);
+        GList *members = g_hash_table_lookup(clusters, hash);
+        if (g_list_length(members) < 2)
+            continue;
+
+        if (output)
+            printf("\n");
+
+        const char *module = problem_data_get_content_or_NULL(members->data, FILENAME_CLUSTER_MODULE);
+        printf("cluster %s\n", hash);
+        printf("%-16s%s\n", _("module:"), module ? module : _("unknown"));
+        printf("%-16s%u\n", _("count:"), g_list_length(members));
+
+        for (GList *iter = members; iter; iter = g_list_next(iter))
+        {
+            char hash_str[SHA1_RESULT_LEN*2 + 1];
+            const char *dirname = problem_data_get_content_or_NULL(iter->data, CD_DUMPDIR);
+            const char *executable = problem_data_get_content_or_NULL(iter->data, FILENAME_EXECUTABLE);
+            printf("id %s %s\n", dirname ? str_to_sha1str(hash_str, dirname) : "-",
+                   executable ? executable : "");
+        }
+
+        output = true;
+    }
+
+    g_hash_table_destroy(clusters);
+    g_ptr_array_free(hashes, TRUE);
+    return output;
+}
+
 int cmd_list(int argc, const char **argv)
 {
     const char *program_usage_string = _(
@@ -131,6 +199,7 @@ int cmd_list(int argc, const char **argv)
     int opt_detailed = 0;
     int opt_since = 0;
     int opt_until = 0;
+    int opt_clusters = 0;
     struct options program_options[] = {
         OPT__VERBOSE(&g_verbose),
         OPT_BOOL('n', "not-reported"     , &opt_not_reported,      _("List only not-reported problems")),
@@ -138,6 +207,7 @@ int cmd_list(int argc, const char **argv)
         OPT_BOOL('d', "detailed" , &opt_detailed,  _("Show detailed report")),
         OPT_INTEGER('s', "since" , &opt_since,  _("List only the problems more recent than specified timestamp")),
         OPT_INTEGER('u', "until" , &opt_until,  _("List only the problems older than specified timestamp")),
+        OPT_BOOL('c', "clusters" , &opt_clusters,  _("List clusters of problems crashing in the same library function")),
         OPT_END()
     };
 
@@ -152,7 +222,9 @@ int cmd_list(int argc, const char **argv)
 #if SUGGEST_AUTOREPORTING != 0
     const bool output =
 #endif
-    print_crash_list(ci, opt_detailed, opt_not_reported, opt_since, opt_until, CD_TEXT_ATT_SIZE_BZ);
+    (opt_clusters
+        ? print_cluster_list(ci, opt_not_reported, opt_since, opt_until)
+        : print_crash_list(ci, opt_detailed, opt_not_reported, opt_since, opt_until, CD_TEXT_ATT_SIZE_BZ));
 
     free_vector_of_problem_data(ci);
 
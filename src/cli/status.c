@@ -26,6 +26,14 @@ static unsigned int count_problem_dirs(unsigned long since)
 {
     unsigned count = 0;
 
+    /* The counts published by abrtd are enough unless the user wants to see
+     * problems accessible after authentication */
+    if (!g_cli_authenticate && problem_status_count(NULL, getuid(), since, &count) == 0)
+        return count;
+
+    log_debug("Problem status not available, asking abrt-dbus");
+    count = 0;
+
     GList *problems = get_problems_over_dbus(g_cli_authenticate);
     if (problems == ERR_PTR)
         return count;
@@ -0,0 +1,344 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+#include "libabrt.h"
+#include "problem_api.h"
+
+#define HOST_FACTS_DIR VAR_STATE"/host-facts"
+#define HOST_FACTS_LOCK ".lock"
+
+#define MACHINE_ID_GENERATOR LIBEXEC_DIR"/abrt-action-generate-machine-id"
+
+/* Unreferenced generations younger than this are kept because post-create
+ * of a problem may be about to reference them */
+#define HOST_FACTS_GC_GRACE (60 * 60)
+
+/* The same commands post-create used to run for every problem */
+static const char *const host_facts_commands[][2] = {
+    { FILENAME_CPUINFO,  "command -v lscpu >/dev/null 2>&1 && lscpu || cat /proc/cpuinfo" },
+    { FILENAME_RUNLEVEL, "runlevel 2>&1" },
+    { FILENAME_MACHINEID, MACHINE_ID_GENERATOR" 2>/dev/null" },
+};
+
+static int save_fact(const char *dir, const char *name, const char *value, sha1_ctx_t *sha1ctx)
+{
+    char *path = concat_path_file(dir, name);
+    const int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        perror_msg("Can't create '%s'", path);
+        free(path);
+        return -1;
+    }
+
+    const bool written = full_write_str(fd, value) >= 0;
+    close(fd);
+
+    if (!written)
+        perror_msg("Can't write '%s'", path);
+
+    free(path);
+
+    /* Names are part of the generation because the set of facts may differ */
+    sha1_hash(sha1ctx, name, strlen(name) + 1);
+    sha1_hash(sha1ctx, value, strlen(value) + 1);
+
+    return written ? 0 : -1;
+}
+
+/*
+ * Collects host facts to a new generation directory
+ *
+ * Returns the generation on success, otherwise NULL
+ */
+static char *collect_host_facts(void)
+{
+    char *tmp_dir = xasprintf("%s/.new.%lu", host_facts_dir(), (unsigned long)getpid());
+    if (mkdir(tmp_dir, 0755) != 0)
+    {
+        perror_msg("Can't create directory '%s'", tmp_dir);
+        free(tmp_dir);
+        return NULL;
+    }
+
+    sha1_ctx_t sha1ctx;
+    sha1_begin(&sha1ctx);
+
+    int errors = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(host_facts_commands); ++i)
+    {
+        const char *const name = host_facts_commands[i][0];
+
+        /* The machine ID plugin is optional */
+        if (strcmp(name, FILENAME_MACHINEID) == 0 && access(MACHINE_ID_GENERATOR, X_OK) != 0)
+            continue;
+
+        log_debug("Collecting host fact '%s'", name);
+        char *value = run_in_shell_and_save_output(/*flags*/0, host_facts_commands[i][1],
+                                                   /*dir*/NULL, /*size_p*/NULL);
+        if (value == NULL || value[0] == '\0')
+        {
+            log_notice("Host fact '%s' is not available", name);
+            free(value);
+            continue;
+        }
+
+        errors += save_fact(tmp_dir, name, value, &sha1ctx) != 0;
+        free(value);
+    }
+
+    char hash_bytes[SHA1_RESULT_LEN];
+    sha1_end(&sha1ctx, hash_bytes);
+
+    char *generation = xmalloc(SHA1_RESULT_LEN * 2 + 1);
+    bin2hex(generation, hash_bytes, SHA1_RESULT_LEN)[0] = '\0';
+
+    char *generation_dir = host_facts_generation_dir(generation);
+    if (errors != 0)
+        goto fail;
+
+    /* The same facts have been already collected in one of the previous
+     * boots, problems referencing them are still valid */
+    if (access(generation_dir, F_OK) == 0)
+    {
+        delete_dump_dir(tmp_dir);
+        /* Protect it from the garbage collection */
+        if (utimes(generation_dir, NULL) != 0)
+            perror_msg("Can't touch '%s'", generation_dir);
+    }
+    else if (rename(tmp_dir, generation_dir) != 0)
+    {
+        perror_msg("Can't rename '%s' to '%s'", tmp_dir, generation_dir);
+        goto fail;
+    }
+
+    free(generation_dir);
+    free(tmp_dir);
+    return generation;
+
+fail:
+    delete_dump_dir(tmp_dir);
+    free(generation_dir);
+    free(generation);
+    free(tmp_dir);
+    return NULL;
+}
+
+static int add_referenced_generation(struct dump_dir *dd, void *arg)
+{
+    char *generation = dd_load_text_ext(dd, FILENAME_HOST_FACTS,
+            DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT);
+    if (generation != NULL)
+        g_hash_table_add(arg, generation);
+
+    return 0;
+}
+
+/*
+ * Removes generations not referenced by any problem directory, a new
+ * generation is collected whenever the facts change
+ */
+static void remove_unreferenced_generations(const char *current)
+{
+    load_abrt_conf();
+
+    GHashTable *referenced = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+    g_hash_table_add(referenced, xstrdup(current));
+    for_each_problem_in_dir(g_settings_dump_location, (uid_t)-1, add_referenced_generation, referenced);
+    if (g_settings_cold_dump_location != NULL)
+        for_each_problem_in_dir(g_settings_cold_dump_location, (uid_t)-1, add_referenced_generation, referenced);
+
+    DIR *dir = opendir(host_facts_dir());
+    if (dir != NULL)
+    {
+        const time_t now = time(NULL);
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+        {
+            /* Generations and leftovers of interrupted collections */
+            const bool leftover = prefixcmp(dent->d_name, ".new.") == 0;
+            char *path = leftover ? concat_path_file(host_facts_dir(), dent->d_name)
+                                  : host_facts_generation_dir(dent->d_name);
+            struct stat sb;
+            if (path != NULL
+                && !g_hash_table_contains(referenced, dent->d_name)
+                && fstatat(dirfd(dir), dent->d_name, &sb, AT_SYMLINK_NOFOLLOW) == 0
+                && S_ISDIR(sb.st_mode) && now - sb.st_mtime > HOST_FACTS_GC_GRACE)
+            {
+                log_info("Removing unreferenced host facts '%s'", dent->d_name);
+                delete_dump_dir(path);
+            }
+            free(path);
+        }
+        closedir(dir);
+    }
+
+    g_hash_table_destroy(referenced);
+    free_abrt_conf_data();
+}
+
+/*
+ * Returns the current generation, collects the host facts if the snapshot is
+ * missing or outdated
+ */
+static char *update_host_facts(void)
+{
+    char *generation = host_facts_current_generation();
+    if (generation != NULL)
+        return generation;
+
+    if (g_mkdir_with_parents(host_facts_dir(), 0755) != 0)
+    {
+        perror_msg("Can't create directory '%s'", host_facts_dir());
+        return NULL;
+    }
+
+    /* abrtd and post-create of the first problems may race */
+    char *lock_path = concat_path_file(host_facts_dir(), HOST_FACTS_LOCK);
+    const int lock_fd = open(lock_path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (lock_fd < 0)
+    {
+        perror_msg("Can't open '%s'", lock_path);
+        free(lock_path);
+        return NULL;
+    }
+
+    if (flock(lock_fd, LOCK_EX) != 0)
+        perror_msg("Can't lock '%s'", lock_path);
+    free(lock_path);
+
+    generation = host_facts_current_generation();
+    if (generation == NULL)
+    {
+        /* The fingerprint must be taken before collecting the facts, so
+         * a change in the mean time causes a refresh next time */
+        char *fingerprint = host_facts_fingerprint();
+        generation = collect_host_facts();
+
+        if (generation != NULL && host_facts_set_current_generation(generation, fingerprint) != 0)
+        {
+            free(generation);
+            generation = NULL;
+        }
+        else if (generation != NULL)
+        {
+            log_info("Host facts snapshot '%s' is current", generation);
+            remove_unreferenced_generations(generation);
+        }
+
+        free(fingerprint);
+    }
+
+    close(lock_fd);
+    return generation;
+}
+
+/* Stores the referenced facts directly in the problem directory */
+static void expand_host_facts(struct dump_dir *dd)
+{
+    for (const char *const *elem = host_facts_elements; *elem != NULL; ++elem)
+    {
+        if (dd_exist(dd, *elem))
+            continue;
+
+        char *value = host_facts_load_from_dump_dir(dd, *elem);
+        if (value == NULL)
+        {
+            log_notice("Host fact '%s' is not available", *elem);
+            continue;
+        }
+
+        dd_save_text(dd, *elem, value);
+        free(value);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-d DIR | -u | -x -d DIR]\n"
+        "\n"
+        "Reference the snapshot of host facts from a problem directory\n"
+        "\n"
+        "Host facts (cpuinfo, runlevel, machineid) are collected once per boot and\n"
+        "stored in "HOST_FACTS_DIR". The snapshot is refreshed when it becomes\n"
+        "outdated."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_u = 1 << 2,
+        OPT_x = 1 << 3,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_BOOL(  'u', NULL, NULL, _("Only refresh the snapshot of host facts")),
+        OPT_BOOL(  'x', NULL, NULL, _("Store the referenced host facts in the problem directory")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    if ((opts & OPT_u) && (opts & (OPT_d | OPT_x)))
+        show_usage_and_die(program_usage_string, program_options);
+
+    export_abrt_envvars(0);
+
+    if (opts & OPT_u)
+    {
+        char *generation = update_host_facts();
+        free(generation);
+        return generation == NULL;
+    }
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /* for writing */0);
+    if (dd == NULL)
+        xfunc_die();
+
+    int r = 0;
+    if (opts & OPT_x)
+        expand_host_facts(dd);
+    else
+    {
+        char *generation = update_host_facts();
+        if (generation == NULL)
+            r = 1;
+        else
+        {
+            dd_save_text(dd, FILENAME_HOST_FACTS, generation);
+            free(generation);
+        }
+    }
+
+    dd_close(dd);
+
+    return r;
+}
@@ -0,0 +1,351 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "libabrt.h"
+#include "problem_api.h"
+
+/* Cumulative statistics of all migrations */
+#define COLD_STORAGE_STATS_FILE VAR_STATE"/cold-storage"
+
+/* glibc does not provide a wrapper for ioprio_set() */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+
+static void load_stats(struct abrt_cold_storage_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    map_string_t *map = new_map_string();
+    if (load_conf_file(COLD_STORAGE_STATS_FILE, map, /*skip key w/o values:*/ false))
+    {
+        const char *value;
+        if ((value = get_map_string_item_or_NULL(map, "MigratedProblems")) != NULL)
+            stats->problems = strtoull(value, NULL, 10);
+        if ((value = get_map_string_item_or_NULL(map, "OriginalBytes")) != NULL)
+            stats->original_bytes = strtoull(value, NULL, 10);
+        if ((value = get_map_string_item_or_NULL(map, "StoredBytes")) != NULL)
+            stats->stored_bytes = strtoull(value, NULL, 10);
+    }
+    free_map_string(map);
+}
+
+static void save_stats(const struct abrt_cold_storage_stats *stats)
+{
+    map_string_t *map = new_map_string();
+    char buf[sizeof(unsigned long long) * 3 + 1];
+
+    snprintf(buf, sizeof(buf), "%llu", stats->problems);
+    replace_map_string_item(map, xstrdup("MigratedProblems"), xstrdup(buf));
+    snprintf(buf, sizeof(buf), "%llu", stats->original_bytes);
+    replace_map_string_item(map, xstrdup("OriginalBytes"), xstrdup(buf));
+    snprintf(buf, sizeof(buf), "%llu", stats->stored_bytes);
+    replace_map_string_item(map, xstrdup("StoredBytes"), xstrdup(buf));
+
+    if (!save_conf_file(COLD_STORAGE_STATS_FILE, map))
+        error_msg("Can't save '%s'", COLD_STORAGE_STATS_FILE);
+    free_map_string(map);
+}
+
+static void print_stats(const struct abrt_cold_storage_stats *stats)
+{
+    const long long saved = stats->original_bytes - stats->stored_bytes;
+    printf(_("Migrated problems: %llu\n"), stats->problems);
+    printf(_("Original size: %llu KiB\n"), stats->original_bytes / 1024);
+    printf(_("Stored size: %llu KiB\n"), stats->stored_bytes / 1024);
+    printf(_("Saved: %lld KiB\n"), saved / 1024);
+}
+
+/* Returns the time of the last occurrence of the problem or 0 */
+static time_t problem_last_occurrence(struct dump_dir *dd)
+{
+    char *value = dd_load_text_ext(dd, FILENAME_LAST_OCCURRENCE, DD_FAIL_QUIETLY_ENOENT);
+    time_t last = value ? (time_t)strtoll(value, NULL, 10) : 0;
+    free(value);
+
+    return last > 0 ? last : dd->dd_time;
+}
+
+/* Returns true if the problem was migrated */
+static bool migrate_problem(const char *name, time_t cutoff,
+                            struct abrt_cold_storage_throttle *throttle,
+                            struct abrt_cold_storage_stats *stats)
+{
+    char *hot_path = concat_path_file(g_settings_dump_location, name);
+    struct dump_dir *dd = dd_opendir(hot_path, DD_FAIL_QUIETLY_ENOENT
+                                             | DD_FAIL_QUIETLY_EACCES
+                                             | DD_DONT_WAIT_FOR_LOCK);
+    if (dd == NULL)
+    {
+        free(hot_path);
+        return false;
+    }
+
+    bool migrated = false;
+    char *cold_path = NULL;
+    char *tmp_path = NULL;
+
+    /* Not processed yet */
+    if (!problem_dump_dir_is_complete(dd) || dd_exist(dd, FILENAME_PENDING_ANALYSIS))
+        goto finito;
+
+    if (problem_last_occurrence(dd) > cutoff)
+        goto finito;
+
+    cold_path = concat_path_file(g_settings_cold_dump_location, name);
+    if (access(cold_path, F_OK) == 0)
+    {
+        log_warning("'%s' already exists, not migrating '%s'", cold_path, hot_path);
+        goto finito;
+    }
+
+    tmp_path = xasprintf("%s/.%s.new", g_settings_cold_dump_location, name);
+
+    const off_t min_size = g_settings_cold_compress_min_size * (off_t)1024;
+    struct abrt_cold_storage_stats problem_stats = { 0 };
+    if (cold_storage_copy_problem(hot_path, tmp_path, min_size, throttle, &problem_stats) != 0
+        || rename(tmp_path, cold_path) != 0)
+    {
+        error_msg("Can't migrate '%s' to '%s'", hot_path, cold_path);
+        cold_storage_remove_tree(tmp_path);
+        goto finito;
+    }
+
+    log_info("Migrated '%s' to '%s' (%llu KiB -> %llu KiB)", hot_path, cold_path,
+             problem_stats.original_bytes / 1024, problem_stats.stored_bytes / 1024);
+
+    stats->problems++;
+    stats->original_bytes += problem_stats.original_bytes;
+    stats->stored_bytes += problem_stats.stored_bytes;
+
+    dd_delete(dd);
+    dd = NULL;
+    pipeline_journal_append(hot_path, ABRT_PIPELINE_REMOVED, 0);
+    migrated = true;
+
+ finito:
+    if (dd != NULL)
+        dd_close(dd);
+    free(tmp_path);
+    free(cold_path);
+    free(hot_path);
+    return migrated;
+}
+
+/* Removes elements decompressed by -x whose compressed copy exists and which
+ * were decompressed before cutoff */
+static void drop_expanded_elements(const char *name, time_t cutoff)
+{
+    char *path = concat_path_file(g_settings_cold_dump_location, name);
+    struct dump_dir *dd = dd_opendir(path, DD_FAIL_QUIETLY_ENOENT
+                                         | DD_FAIL_QUIETLY_EACCES
+                                         | DD_DONT_WAIT_FOR_LOCK);
+    free(path);
+    if (dd == NULL)
+        return;
+
+    char *list = dd_load_text_ext(dd, FILENAME_COLD_COMPRESSED, DD_FAIL_QUIETLY_ENOENT);
+    for (char *element = list ? strtok(list, "\n") : NULL; element != NULL; element = strtok(NULL, "\n"))
+    {
+        if (!str_is_correct_filename(element))
+            continue;
+
+        char *compressed = xasprintf("%s"COLD_COMPRESSED_SUFFIX, element);
+        struct stat sb;
+        if (dd_exist(dd, compressed)
+            && fstatat(dd->dd_fd, element, &sb, AT_SYMLINK_NOFOLLOW) == 0
+            && S_ISREG(sb.st_mode) && sb.st_mtime <= cutoff)
+        {
+            log_info("Removing decompressed '%s/%s'", dd->dd_dirname, element);
+            dd_delete_item(dd, element);
+        }
+        free(compressed);
+    }
+    free(list);
+    dd_close(dd);
+}
+
+static int migrate_problems(void)
+{
+    /* Background work must not slow down the rest of the system */
+    if (setpriority(PRIO_PROCESS, 0, 19) != 0)
+        perror_msg("setpriority");
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0)
+        perror_msg("ioprio_set");
+
+    /* xz failures are detected by its exit status */
+    signal(SIGPIPE, SIG_IGN);
+
+    ensure_writable_dir_group(g_settings_cold_dump_location, DEFAULT_DUMP_LOCATION_MODE, "root", "abrt");
+
+    DIR *dir = opendir(g_settings_cold_dump_location);
+    if (dir == NULL)
+    {
+        perror_msg("Can't open '%s'", g_settings_cold_dump_location);
+        return 1;
+    }
+
+    const time_t cutoff = time(NULL) - g_settings_cold_after_days * (time_t)(24 * 60 * 60);
+
+    /* Leftovers of interrupted migrations and elements decompressed for
+     * reporting ColdAfterDays ago */
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dent->d_name[0] == '.' && !dot_or_dotdot(dent->d_name)
+            && suffixcmp(dent->d_name, ".new") == 0)
+        {
+            char *path = concat_path_file(g_settings_cold_dump_location, dent->d_name);
+            log_notice("Removing incomplete '%s'", path);
+            cold_storage_remove_tree(path);
+            free(path);
+        }
+        else if (!dot_or_dotdot(dent->d_name) && str_is_correct_filename(dent->d_name))
+            drop_expanded_elements(dent->d_name, cutoff);
+    }
+    closedir(dir);
+
+    dir = opendir(g_settings_dump_location);
+    if (dir == NULL)
+    {
+        perror_msg("Can't open '%s'", g_settings_dump_location);
+        return 1;
+    }
+
+    struct abrt_cold_storage_throttle throttle;
+    cold_storage_throttle_init(&throttle, g_settings_cold_migration_rate);
+    struct abrt_cold_storage_stats stats = { 0 };
+
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name) || !str_is_correct_filename(dent->d_name))
+            continue;
+
+        migrate_problem(dent->d_name, cutoff, &throttle, &stats);
+    }
+    closedir(dir);
+
+    if (stats.problems > 0)
+    {
+        log("Migrated %llu problems to '%s', saved %lld KiB", stats.problems,
+            g_settings_cold_dump_location,
+            (long long)(stats.original_bytes - stats.stored_bytes) / 1024);
+
+        struct abrt_cold_storage_stats total;
+        load_stats(&total);
+        total.problems += stats.problems;
+        total.original_bytes += stats.original_bytes;
+        total.stored_bytes += stats.stored_bytes;
+        save_stats(&total);
+    }
+
+    if (g_settings_cold_max_size > 0)
+        trim_problem_dirs(g_settings_cold_dump_location,
+                          g_settings_cold_max_size * (double)(1024*1024), /*exclude*/NULL);
+
+    return 0;
+}
+
+/* Decompresses the elements compressed by migration, so tools which need them
+ * (gdb, reporters uploading files) find them in the original form. The
+ * compressed copies stay, the migration drops the decompressed elements again
+ * once they are not needed.
+ */
+static int expand_problem(const char *dump_dir_name)
+{
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /* for writing */0);
+    if (dd == NULL)
+        return 1;
+
+    const int r = cold_storage_expand_problem(dd);
+    dd_close(dd);
+
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-s | -x [-d DIR]]\n"
+        "\n"
+        "Migrates processed problems older than ColdAfterDays to ColdDumpLocation\n"
+        "\n"
+        "Large elements of migrated problems are compressed, -x decompresses them\n"
+        "in the problem directory DIR."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_s = 1 << 1,
+        OPT_x = 1 << 2,
+        OPT_d = 1 << 3,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_BOOL(  's', NULL, NULL, _("Print statistics of migrated problems")),
+        OPT_BOOL(  'x', NULL, NULL, _("Decompress elements of a migrated problem")),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    if (((opts & OPT_s) && (opts & (OPT_x | OPT_d)))
+        || ((opts & OPT_d) && !(opts & OPT_x)))
+        show_usage_and_die(program_usage_string, program_options);
+
+    export_abrt_envvars(0);
+
+    if (opts & OPT_x)
+        return expand_problem(dump_dir_name);
+
+    if (opts & OPT_s)
+    {
+        struct abrt_cold_storage_stats stats;
+        load_stats(&stats);
+        print_stats(&stats);
+        return 0;
+    }
+
+    if (getuid() != 0)
+        error_msg_and_die("Must be run as root");
+
+    load_abrt_conf();
+    if (g_settings_cold_dump_location == NULL)
+    {
+        log_notice("ColdDumpLocation is not configured");
+        return 0;
+    }
+
+    const int r = migrate_problems();
+    free_abrt_conf_data();
+
+    return r;
+}
@@ -29,6 +29,7 @@
 
 static char *uid = NULL;
 static char *uuid = NULL;
+static char *legacy_uuid = NULL;
 static struct sr_stacktrace *corebt = NULL;
 static char *type = NULL;
 static char *executable = NULL;
@@ -107,6 +108,10 @@ static void dup_uuid_init(const struct dump_dir *dd)
     uuid = dd_load_text_ext(dd, FILENAME_UUID,
                             DD_FAIL_QUIETLY_ENOENT + DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE
     );
+    /* UUID of problems created before the way of hashing changed */
+    legacy_uuid = dd_load_text_ext(dd, FILENAME_LEGACY_DUPHASH,
+                            DD_FAIL_QUIETLY_ENOENT + DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE
+    );
 }
 
 static int dup_uuid_compare(const struct dump_dir *dd)
@@ -127,6 +132,8 @@ static int dup_uuid_compare(const struct dump_dir *dd)
 
     dd_uuid = dd_load_text_ext(dd, FILENAME_UUID, DD_FAIL_QUIETLY_ENOENT);
     different = strcmp(uuid, dd_uuid);
+    if (different && legacy_uuid && !dd_exist(dd, FILENAME_LEGACY_DUPHASH))
+        different = strcmp(legacy_uuid, dd_uuid);
     free(dd_uuid);
 
     if (!different)
@@ -139,6 +146,8 @@ static void dup_uuid_fini(void)
 {
     free(uuid);
     uuid = NULL;
+    free(legacy_uuid);
+    legacy_uuid = NULL;
 }
 
 static void dup_corebt_init(const struct dump_dir *dd)
@@ -196,49 +205,14 @@ static void dup_corebt_fini(void)
     corebt = NULL;
 }
 
-/* This function is run after each post-create event is finished (there may be
- * multiple such events).
- *
- * It first checks if there is CORE_BACKTRACE or UUID item in the dump dir
- * we are processing.
- *
- * If there is a CORE_BACKTRACE, it iterates over all other dump
- * directories and computes similarity to their core backtraces (if any).
- * If one of them is similar enough to be considered duplicate, the function
- * saves the path to the dump directory in question and returns 1 to indicate
- * that we have indeed found a duplicate of currently processed dump directory.
- * No more events are processed and program prints the path to the other
- * directory and returns failure.
- *
- * If there is an UUID item (and no core backtrace), the function again
- * iterates over all other dump directories and compares this UUID to their
- * UUID. If there is a match, the path to the duplicate is saved and 1 is returned.
- *
- * If duplicate is not found as described above, the function returns 0 and we
- * either process remaining events if there are any, or successfully terminate
- * processing of the current dump directory.
- */
-static int is_crash_a_dup(const char *dump_dir_name, void *param)
+/* Looks for a duplicate of dump_dir_name (an absolute path) in location */
+static int find_dup_in_location(const char *dump_dir_name, const char *location)
 {
-    int retval = 0; /* defaults to no dup found, "run_event, please continue iterating" */
-
-    struct dump_dir *dd = dd_opendir(dump_dir_name, DD_OPEN_READONLY);
-    if (!dd)
-        return 0; /* wtf? (error, but will be handled elsewhere later) */
-    free(type);
-    type = dd_load_text(dd, FILENAME_TYPE);
-    free(executable);
-    executable = dd_load_text_ext(dd, FILENAME_EXECUTABLE, DD_FAIL_QUIETLY_ENOENT);
-    dup_uuid_init(dd);
-    dup_corebt_init(dd);
-    dd_close(dd);
-
-    /* dump_dir_name can be relative */
-    dump_dir_name = realpath(dump_dir_name, NULL);
-
-    DIR *dir = opendir(g_settings_dump_location);
+    DIR *dir = opendir(location);
     if (dir == NULL)
-        goto end;
+        return 0;
+
+    int retval = 0;
 
     /* Scan crash dumps looking for a dup */
     //TODO: explain why this is safe wrt concurrent runs
@@ -251,9 +225,9 @@ static int is_crash_a_dup(const char *dump_dir_name, void *param)
         if (ext && strcmp(ext, ".new") == 0)
             continue; /* skip anything named "<dirname>.new" */
 
-        dd = NULL;
+        struct dump_dir *dd = NULL;
 
-        char *tmp_concat_path = concat_path_file(g_settings_dump_location, dent->d_name);
+        char *tmp_concat_path = concat_path_file(location, dent->d_name);
 
         char *dump_dir_name2 = realpath(tmp_concat_path, NULL);
         if (g_verbose > 1 && !dump_dir_name2)
@@ -319,11 +293,68 @@ next:
     }
     closedir(dir);
 
-end:
+    return retval;
+}
+
+/* This function is run after each post-create event is finished (there may be
+ * multiple such events).
+ *
+ * It first checks if there is CORE_BACKTRACE or UUID item in the dump dir
+ * we are processing.
+ *
+ * If there is a CORE_BACKTRACE, it iterates over all other dump
+ * directories and computes similarity to their core backtraces (if any).
+ * If one of them is similar enough to be considered duplicate, the function
+ * saves the path to the dump directory in question and returns 1 to indicate
+ * that we have indeed found a duplicate of currently processed dump directory.
+ * No more events are processed and program prints the path to the other
+ * directory and returns failure.
+ *
+ * If there is an UUID item (and no core backtrace), the function again
+ * iterates over all other dump directories and compares this UUID to their
+ * UUID. If there is a match, the path to the duplicate is saved and 1 is returned.
+ *
+ * If duplicate is not found as described above, the function returns 0 and we
+ * either process remaining events if there are any, or successfully terminate
+ * processing of the current dump directory.
+ */
+static int is_crash_a_dup(const char *dump_dir_name, void *param)
+{
+    int retval = 0; /* defaults to no dup found, "run_event, please continue iterating" */
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, DD_OPEN_READONLY);
+    if (!dd)
+        return 0; /* wtf? (error, but will be handled elsewhere later) */
+    free(type);
+    type = dd_load_text(dd, FILENAME_TYPE);
+    free(executable);
+    executable = dd_load_text_ext(dd, FILENAME_EXECUTABLE, DD_FAIL_QUIETLY_ENOENT);
+    dup_uuid_init(dd);
+    dup_corebt_init(dd);
+    dd_close(dd);
+
+    /* dump_dir_name can be relative */
+    dump_dir_name = realpath(dump_dir_name, NULL);
+
+    /* Problems migrated to the cold storage are still duplicates */
+    retval = find_dup_in_location(dump_dir_name, g_settings_dump_location);
+    if (retval == 0 && g_settings_cold_dump_location != NULL)
+        retval = find_dup_in_location(dump_dir_name, g_settings_cold_dump_location);
+
     free((char*)dump_dir_name);
     return retval;
 }
 
+/* Records finished post-create rules in the pipeline journal, so abrtd can
+ * tell where the processing stopped after it was interrupted. */
+static int post_create_step_done(const char *dump_dir_name, void *param)
+{
+    unsigned *step = param;
+    pipeline_journal_append(dump_dir_name, ABRT_PIPELINE_STEP, ++*step);
+
+    return is_crash_a_dup(dump_dir_name, NULL);
+}
+
 static char *do_log(char *log_line, void *param)
 {
     /* We pipe output of events to our log.
@@ -405,8 +436,12 @@ int main(int argc, char **argv)
         if (!interactive)
             make_run_event_state_forwarding(run_state);
         run_state->logging_callback = do_log;
+        unsigned step = 0;
         if (post_create)
-            run_state->post_run_callback = is_crash_a_dup;
+        {
+            run_state->post_run_callback = post_create_step_done;
+            run_state->post_run_param = &step;
+        }
 
         int r = run_event_on_dir_name(run_state, dump_dir_name, event_name);
 
@@ -18,6 +18,7 @@
 #include "problem_api.h"
 #include "abrt_glib.h"
 #include "libabrt.h"
+#include "json-submission.h"
 
 /* Maximal length of backtrace. */
 #define MAX_BACKTRACE_SIZE (1024*1024)
@@ -25,6 +26,8 @@
 #define MAX_MESSAGE_SIZE (4*MAX_BACKTRACE_SIZE)
 /* Maximal number of characters read from socket at once. */
 #define INPUT_BUFFER_SIZE (8*1024)
+/* Larger elements are dropped from problems over the spool quota. */
+#define QUOTA_DEGRADED_ELEMENT_SIZE (4*1024)
 /* We exit after this many seconds */
 #define TIMEOUT 10
 
@@ -211,11 +214,23 @@ static pid_t spawn_event_handler_child(const char *dump_dir_name, const char *ev
     int flags = EXECFLG_INPUT_NUL | EXECFLG_OUTPUT | EXECFLG_QUIET | EXECFLG_ERR2OUT;
     VERB1 flags &= ~EXECFLG_QUIET;
 
-    char *env_vec[3];
+    char *env_vec[5];
+    unsigned env_count = 0;
     /* Intercept ASK_* messages in Client API -> don't wait for user response */
-    env_vec[0] = xstrdup("REPORT_CLIENT_NONINTERACTIVE=1");
-    env_vec[1] = xasprintf("%s=%d", ABRT_SERVER_EVENT_ENV, getpid());
-    env_vec[2] = NULL;
+    env_vec[env_count++] = xstrdup("REPORT_CLIENT_NONINTERACTIVE=1");
+    env_vec[env_count++] = xasprintf("%s=%d", ABRT_SERVER_EVENT_ENV, getpid());
+    /* Let post-create rules leave expensive steps for abrtd's idle time */
+    if (g_settings_deferred_analysis)
+        env_vec[env_count++] = xstrdup("ABRT_DEFERRED_ANALYSIS=1");
+    /* Steps with time budgets are cut short after the deadline */
+    if (g_settings_post_create_budget != 0 && strcmp(event_name, "post-create") == 0)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        env_vec[env_count++] = xasprintf("%s=%lld", ABRT_POST_CREATE_DEADLINE_ENV,
+                                         (long long)now.tv_sec + g_settings_post_create_budget);
+    }
+    env_vec[env_count] = NULL;
 
     pid_t child = fork_execv_on_steroids(flags, args, pipeout,
                                          env_vec, /*dir:*/ NULL,
@@ -242,6 +257,23 @@ static int problem_dump_dir_was_provoked_by_abrt_event(struct dump_dir *dd, char
     return env_var != NULL;
 }
 
+/* Marks the problem as waiting for deferred analysis if there is a rule for
+ * DEFERRED_ANALYSIS_EVENT applicable to the problem.
+ *
+ * Returns true if abrtd should be told about the pending work.
+ */
+static bool mark_pending_deferred_analysis(struct dump_dir *dd)
+{
+    char *events = list_possible_events(dd, /*dump_dir_name*/NULL, DEFERRED_ANALYSIS_EVENT);
+    const bool pending = events != NULL && events[0] != '\0';
+    free(events);
+
+    if (pending)
+        dd_save_text(dd, FILENAME_PENDING_ANALYSIS, DEFERRED_ANALYSIS_EVENT);
+
+    return pending;
+}
+
 static int
 emit_new_problem_signal(gpointer data)
 {
@@ -301,6 +333,7 @@ static int run_post_create(const char *dirname, struct response *resp)
             {
                 error_msg("Removing problem provoked by ABRT(pid:%s): '%s'", provoker, dirname);
                 dd_delete(dd);
+                pipeline_journal_append(dirname, ABRT_PIPELINE_REMOVED, 0);
             }
             else
             {
@@ -515,11 +548,28 @@ static int run_post_create(const char *dirname, struct response *resp)
         }
     }
 
+    /* Steps cut short by their time budget are finished in idle time */
+    const bool deferred = !dup_of_dir
+                          && (g_settings_deferred_analysis || dd_exist(dd, FILENAME_DEGRADED_STEPS))
+                          && mark_pending_deferred_analysis(dd);
+
     /* Reset mode/uig/gid to correct values for all files created by event run */
     dd_sanitize_mode_and_owner(dd);
 
     dd_close(dd);
 
+    if (deferred)
+        pipeline_journal_append(work_dir, ABRT_PIPELINE_ANALYSIS, 0);
+    if (!dup_of_dir)
+        pipeline_journal_append(dirname, ABRT_PIPELINE_DONE, 0);
+
+    if (deferred)
+    {
+        /* abrtd runs DEFERRED_ANALYSIS_EVENT once the system is idle */
+        fprintf(stderr, "DEFERRED_ANALYSIS: %s\n", work_dir);
+        fflush(stderr);
+    }
+
     if (!dup_of_dir)
         log_notice("New problem directory %s, processing", work_dir);
     else
@@ -528,6 +578,11 @@ static int run_post_create(const char *dirname, struct response *resp)
                     strrchr(dirname, '/') + 1,
                     strrchr(dup_of_dir, '/') + 1);
         delete_dump_dir(dirname);
+        pipeline_journal_append(dirname, ABRT_PIPELINE_REMOVED, 0);
+
+        /* abrtd counts the new occurrence for the login notification */
+        fprintf(stderr, "PROBLEM_UPDATED: %s\n", dup_of_dir);
+        fflush(stderr);
     }
 
     /* Run "notify[-dup]" event */
@@ -554,6 +609,7 @@ static int run_post_create(const char *dirname, struct response *resp)
  delete_bad_dir:
     log_warning("Deleting problem directory '%s'", dirname);
     delete_dump_dir(dirname);
+    pipeline_journal_append(dirname, ABRT_PIPELINE_REMOVED, 0);
     /* TODO - better code to allow detection on client's side */
     RESPONSE_SETTER(resp, 403, NULL);
 
@@ -564,6 +620,63 @@ static int run_post_create(const char *dirname, struct response *resp)
     return 0;
 }
 
+/* Asks abrtd to run deferred analysis of the problem immediately. */
+static int promote_pending_analysis(const char *dirname)
+{
+    if (!dir_is_in_dump_location(dirname))
+    {
+        error_msg("Bad problem directory name '%s', should start with: '%s'", dirname, g_settings_dump_location);
+        return 400; /* Bad Request */
+    }
+
+    struct dump_dir *dd = dd_opendir(dirname, DD_OPEN_READONLY | DD_FAIL_QUIETLY_ENOENT);
+    if (dd == NULL)
+        return 404; /* Not Found */
+
+    const bool pending = dd_exist(dd, FILENAME_PENDING_ANALYSIS);
+    dd_close(dd);
+
+    if (!pending)
+    {
+        log_notice("Problem directory '%s' has no pending analysis", dirname);
+        return 200;
+    }
+
+    if (fprintf(stderr, "DEFERRED_ANALYSIS_NOW: %s\n", dirname) <= 0)
+    {
+        error_msg("Failed to communicate with the daemon");
+        return 503; /* Service Unavailable */
+    }
+    fflush(stderr);
+
+    return 202; /* Accepted */
+}
+
+/* Tells abrtd to forget the problem deleted by a client of abrt-dbus. */
+static int forget_deleted_problem(const char *dirname)
+{
+    if (!dir_is_in_dump_location(dirname))
+    {
+        error_msg("Bad problem directory name '%s', should start with: '%s'", dirname, g_settings_dump_location);
+        return 400; /* Bad Request */
+    }
+
+    if (access(dirname, F_OK) == 0 || errno != ENOENT)
+    {
+        error_msg("Problem directory '%s' has not been deleted", dirname);
+        return 409; /* Conflict */
+    }
+
+    if (fprintf(stderr, "PROBLEM_DELETED: %s\n", dirname) <= 0)
+    {
+        error_msg("Failed to communicate with the daemon");
+        return 503; /* Service Unavailable */
+    }
+    fflush(stderr);
+
+    return 200;
+}
+
 /* Create a new problem directory from client session.
  * Caller must ensure that all fields in struct client
  * are properly filled.
@@ -830,6 +943,117 @@ static void process_message(GHashTable *problem_info, char *message)
     }
 }
 
+/* Handles a problem submitted in the structured JSON format. The analysis
+ * results are computed here, no analyzer needs to be run in post-create. */
+static int process_json_message(GHashTable *problem_info, const char *message)
+{
+    char *error = NULL;
+    if (abrt_json_submission_parse(message, problem_info, &error) != 0)
+    {
+        error_msg("Invalid JSON submission: %s", error);
+        free(error);
+        return -1;
+    }
+
+    GHashTableIter iter;
+    gchar *key, *value;
+    g_hash_table_iter_init(&iter, problem_info);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&key, (gpointer *)&value))
+    {
+        if (!key_value_ok(key, value))
+        {
+            error_msg("Invalid key or value format: %s", key);
+            return -1;
+        }
+
+        if (strcmp(key, FILENAME_UID) == 0)
+        {
+            error_msg("Ignoring value of %s, will be determined later",
+                      FILENAME_UID);
+            g_hash_table_iter_remove(&iter);
+        }
+    }
+
+    return 0;
+}
+
+/* Elements deduplication and reporting of a degraded problem need, they are
+ * kept up to MAX_BACKTRACE_SIZE */
+static const char *const degraded_analysis_elements[] = {
+    FILENAME_BACKTRACE,
+    FILENAME_CORE_BACKTRACE,
+    FILENAME_CRASH_FUNCTION,
+    FILENAME_REASON,
+    FILENAME_CMDLINE,
+    NULL
+};
+
+/*
+ * Checks the spool quotas of the client
+ *
+ * Over quota problems are either rejected or only their small elements are
+ * saved. Returns true if the problem must not be saved.
+ *
+ * The keys come from the socket peer credentials, not from the PID the client
+ * declared in the problem data, so a client can't charge another container.
+ */
+static bool apply_spool_quota(GHashTable *problem_info)
+{
+    if (!quota_enabled())
+        return false;
+
+    char *cgroup_path = xasprintf("/proc/%d/cgroup", (int)client_pid);
+    char *cgroup = xmalloc_open_read_close(cgroup_path, /*maxsize:*/ NULL);
+    free(cgroup_path);
+
+    char uid_key[sizeof(long) * 3 + 2];
+    sprintf(uid_key, "%lu", (unsigned long)client_uid);
+    char *container_key = cgroup ? quota_container_id(cgroup) : NULL;
+    const char *quota_keys[ABRT_QUOTA_CLASS_COUNT] = {
+        [ABRT_QUOTA_UID]       = uid_key,
+        [ABRT_QUOTA_CONTAINER] = container_key,
+        [ABRT_QUOTA_TYPE]      = g_hash_table_lookup(problem_info, FILENAME_TYPE),
+    };
+
+    char *exceeded = NULL;
+    const enum abrt_quota_verdict verdict = quota_check(quota_keys, &exceeded);
+
+    free(container_key);
+    free(cgroup);
+
+    if (verdict == ABRT_QUOTA_REJECT)
+    {
+        error_msg("Not saving the problem: %s", exceeded);
+        free(exceeded);
+        return true;
+    }
+
+    if (verdict == ABRT_QUOTA_DEGRADE)
+    {
+        log_warning("%s, saving only small elements", exceeded);
+        free(exceeded);
+
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, problem_info);
+        while (g_hash_table_iter_next(&iter, &key, &value))
+        {
+            size_t limit = QUOTA_DEGRADED_ELEMENT_SIZE;
+            for (const char *const *kept = degraded_analysis_elements; *kept != NULL; ++kept)
+                if (strcmp(key, *kept) == 0)
+                    limit = MAX_BACKTRACE_SIZE;
+
+            if (strlen(value) > limit)
+            {
+                log_notice("Dropping element '%s'", (const char *)key);
+                g_hash_table_iter_remove(&iter);
+            }
+        }
+    }
+
+    return false;
+}
+
 static void die_if_data_is_missing(GHashTable *problem_info)
 {
     gboolean missing_data = FALSE;
@@ -969,13 +1193,22 @@ static int perform_http_xact(struct response *rsp)
     enum {
         CREATION_NOTIFICATION,
         CREATION_REQUEST,
+        JSON_CREATION_REQUEST,
+        DEFERRED_ANALYSIS_REQUEST,
+        DELETION_NOTIFICATION,
     };
     int url_type;
     char *url = skip_non_whitespace(messagebuf_data) + 1; /* skip "POST " */
     if (prefixcmp(url, "/creation_notification ") == 0)
         url_type = CREATION_NOTIFICATION;
+    else if (prefixcmp(url, "/deferred_analysis ") == 0)
+        url_type = DEFERRED_ANALYSIS_REQUEST;
+    else if (prefixcmp(url, "/problem_deleted ") == 0)
+        url_type = DELETION_NOTIFICATION;
     else if (prefixcmp(url, "/ ") == 0)
         url_type = CREATION_REQUEST;
+    else if (prefixcmp(url, "/json ") == 0)
+        url_type = JSON_CREATION_REQUEST;
     else
         return 400; /* Bad Request */
 
@@ -1042,6 +1275,42 @@ static int perform_http_xact(struct response *rsp)
         return run_post_create(messagebuf_data, rsp);
     }
 
+    if (url_type == DEFERRED_ANALYSIS_REQUEST)
+    {
+        if (client_uid != 0)
+        {
+            error_msg("UID=%ld is not authorized to trigger deferred analysis", (long)client_uid);
+            ret = 403; /* Forbidden */
+            goto out;
+        }
+
+        messagebuf_data[messagebuf_len] = '\0';
+        return promote_pending_analysis(messagebuf_data);
+    }
+
+    if (url_type == DELETION_NOTIFICATION)
+    {
+        if (client_uid != 0)
+        {
+            error_msg("UID=%ld is not authorized to notify about deleted problems", (long)client_uid);
+            ret = 403; /* Forbidden */
+            goto out;
+        }
+
+        messagebuf_data[messagebuf_len] = '\0';
+        return forget_deleted_problem(messagebuf_data);
+    }
+
+    if (url_type == JSON_CREATION_REQUEST)
+    {
+        messagebuf_data[messagebuf_len] = '\0';
+        if (process_json_message(problem_info, messagebuf_data) != 0)
+        {
+            ret = 400; /* Bad Request */
+            goto out;
+        }
+    }
+
     die_if_data_is_missing(problem_info);
 
     /* Save problem dir */
@@ -1075,6 +1344,9 @@ static int perform_http_xact(struct response *rsp)
         pid = client_pid;
     }
 
+    if (apply_spool_quota(problem_info)) /* Only pretend that we saved it */
+        goto out; /* ret is 0: "success" */
+
     create_problem_dir(problem_info, pid);
     /* does not return */
 
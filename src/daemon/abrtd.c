@@ -46,6 +46,31 @@
 
 #define ABRTD_DBUS_NAME ABRT_DBUS_NAME".daemon"
 
+/* How often abrtd checks whether the system is idle enough for deferred
+ * analysis. */
+#define DEFERRED_ANALYSIS_PERIOD 30
+
+/* How often abrtd refreshes the spool quota usage the hooks check. */
+#define QUOTA_USAGE_PERIOD (5 * 60)
+
+/* How often abrtd checks the dump location for the login notification, it
+ * picks up problems reported or deleted by users. */
+#define PROBLEM_STATUS_PERIOD (5 * 60)
+
+/* How often abrtd compacts the pipeline journal if it grows over the size. */
+#define PIPELINE_JOURNAL_PERIOD (10 * 60)
+#define PIPELINE_JOURNAL_COMPACT_SIZE (64 * 1024)
+
+/* How often abrtd migrates aged problems to ColdDumpLocation. */
+#define COLD_STORAGE_PERIOD (60 * 60)
+
+/* Changes of these files in /etc make the host facts snapshot outdated */
+#define IN_HOST_FACTS_FLAGS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+/* abrt-hook-ccpp renames a staged crash to its final name when it is
+ * complete */
+#define IN_STAGING_RING_FLAGS (IN_MOVED_TO)
+
 /* Daemon initializes, then sits in glib main loop, waiting for events.
  * Events can be:
  * - inotify: something new appeared under /var/tmp/abrt or /var/spool/abrt-upload
@@ -66,6 +91,35 @@ static GIOChannel *channel_socket = NULL;
 static guint channel_id_socket = 0;
 static int child_count = 0;
 
+/* Problem directories waiting for DEFERRED_ANALYSIS_EVENT. The urgent ones
+ * were opened or reported by a user and do not wait for idle time. */
+static GList *s_deferred_queue;
+static GList *s_deferred_urgent_queue;
+static char *s_deferred_dirname;
+static pid_t s_deferred_pid;
+static guint s_deferred_timer;
+
+static guint s_quota_timer;
+
+static struct abrt_problem_status *s_problem_status;
+static struct abrt_quota_usage *s_quota_usage;
+static guint s_problem_status_timer;
+
+/* Problems whose post-create was interrupted by previous abrtd and crashes
+ * imported from the staging ring */
+static GList *s_resume_dirs;
+static pid_t s_resume_pid;
+static void resume_unfinished_dump_dirs(void);
+static guint s_pipeline_timer;
+
+/* The snapshot of host facts shared by all problems */
+static pid_t s_host_facts_pid;
+static bool s_host_facts_outdated;
+
+/* abrt-cold-storage migrating aged problems */
+static pid_t s_cold_storage_pid;
+static guint s_cold_storage_timer;
+
 struct abrt_server_proc
 {
     pid_t pid;
@@ -138,6 +192,7 @@ static void notify_next_post_create_process(struct abrt_server_proc *finished)
         if (kill(n->pid, SIGUSR1) >= 0)
         {
             n->type = AS_POST_CREATE;
+            pipeline_journal_append(n->dirname, ABRT_PIPELINE_POST_CREATE, 0);
             break;
         }
 
@@ -153,6 +208,394 @@ static void notify_next_post_create_process(struct abrt_server_proc *finished)
     }
 }
 
+/* Deferred analysis */
+
+static gint compare_dirname(const char *a, const char *b)
+{
+    return g_strcmp0(a, b);
+}
+
+static GList *deferred_analysis_remove_from(GList *queue, const char *dirname)
+{
+    GList *item = g_list_find_custom(queue, dirname, (GCompareFunc)compare_dirname);
+    if (item == NULL)
+        return queue;
+
+    free(item->data);
+    return g_list_delete_link(queue, item);
+}
+
+static void deferred_analysis_stop_timer(void)
+{
+    if (s_deferred_timer == 0)
+        return;
+
+    g_source_remove(s_deferred_timer);
+    s_deferred_timer = 0;
+}
+
+static gboolean deferred_analysis_tick(gpointer user_data);
+
+static void deferred_analysis_start_timer(void)
+{
+    if (s_deferred_timer != 0)
+        return;
+
+    s_deferred_timer = g_timeout_add_seconds(DEFERRED_ANALYSIS_PERIOD, deferred_analysis_tick, NULL);
+}
+
+static void deferred_analysis_try_start(bool force)
+{
+    if (s_deferred_pid > 0)
+        return;
+
+    bool urgent = s_deferred_urgent_queue != NULL;
+    if (!urgent && s_deferred_queue == NULL)
+    {
+        deferred_analysis_stop_timer();
+        return;
+    }
+
+    if (!urgent && !force && !system_is_idle_for_deferred_analysis(time(NULL), "/proc/pressure"))
+        return;
+
+    GList **queue = urgent ? &s_deferred_urgent_queue : &s_deferred_queue;
+    char *dirname = (*queue)->data;
+    *queue = g_list_delete_link(*queue, *queue);
+
+    struct stat sb;
+    if (stat(dirname, &sb) != 0)
+    {
+        log_info("Problem directory '%s' disappeared, cancelling its deferred analysis", dirname);
+        free(dirname);
+        /* Try the next one */
+        deferred_analysis_try_start(force);
+        return;
+    }
+
+    char *args[8];
+    args[0] = (char *) LIBEXEC_DIR"/abrt-handle-event";
+    args[1] = (char *) "--nice";
+    args[2] = (char *) "19";
+    args[3] = (char *) "-e";
+    args[4] = (char *) DEFERRED_ANALYSIS_EVENT;
+    args[5] = (char *) "--";
+    args[6] = dirname;
+    args[7] = NULL;
+
+    /* New session to be able to kill the whole process group */
+    s_deferred_pid = fork_execv_on_steroids(EXECFLG_INPUT_NUL | EXECFLG_SETSID,
+                                            args, /*pipe*/NULL, /*env*/NULL,
+                                            /*dir*/NULL, /*uid*/0);
+    s_deferred_dirname = dirname;
+
+    log_notice("Started deferred analysis of '%s' (pid %d)%s", dirname,
+               s_deferred_pid, urgent ? " on user's request" : "");
+    deferred_analysis_start_timer();
+}
+
+static void deferred_analysis_finished(int status)
+{
+    if (WIFSIGNALED(status))
+        log_warning("Deferred analysis of '%s' killed by signal %d",
+                    s_deferred_dirname, WTERMSIG(status));
+    else if (WEXITSTATUS(status) != 0)
+        log_warning("Deferred analysis of '%s' exited with %d",
+                    s_deferred_dirname, WEXITSTATUS(status));
+    else
+        log_info("Deferred analysis of '%s' finished", s_deferred_dirname);
+
+    /* Do not retry failed analysis to avoid burning CPU on broken problems */
+    struct dump_dir *dd = dd_opendir(s_deferred_dirname, DD_FAIL_QUIETLY_ENOENT);
+    if (dd != NULL)
+    {
+        dd_delete_item(dd, FILENAME_PENDING_ANALYSIS);
+        /* The steps cut short in post-create were run without time limits */
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            dd_delete_item(dd, FILENAME_DEGRADED_STEPS);
+        dd_close(dd);
+    }
+    pipeline_journal_append(s_deferred_dirname, ABRT_PIPELINE_ANALYZED, 0);
+
+    free(s_deferred_dirname);
+    s_deferred_dirname = NULL;
+    s_deferred_pid = 0;
+
+    deferred_analysis_try_start(/*force*/false);
+}
+
+static gboolean deferred_analysis_tick(gpointer user_data)
+{
+    if (s_deferred_pid > 0)
+    {
+        struct stat sb;
+        if (stat(s_deferred_dirname, &sb) != 0 && errno == ENOENT)
+        {
+            log_notice("Problem directory '%s' was deleted, killing its deferred analysis", s_deferred_dirname);
+            kill(-s_deferred_pid, SIGTERM);
+        }
+        return TRUE;
+    }
+
+    deferred_analysis_try_start(/*force*/false);
+
+    if (s_deferred_pid == 0 && s_deferred_queue == NULL && s_deferred_urgent_queue == NULL)
+    {
+        s_deferred_timer = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void deferred_analysis_enqueue(const char *dirname, bool urgent)
+{
+    if (g_strcmp0(s_deferred_dirname, dirname) == 0)
+        return;
+
+    if (g_list_find_custom(s_deferred_urgent_queue, dirname, (GCompareFunc)compare_dirname))
+        return;
+
+    if (g_list_find_custom(s_deferred_queue, dirname, (GCompareFunc)compare_dirname))
+    {
+        if (!urgent)
+            return;
+
+        s_deferred_queue = deferred_analysis_remove_from(s_deferred_queue, dirname);
+    }
+
+    if (urgent)
+    {
+        s_deferred_urgent_queue = g_list_append(s_deferred_urgent_queue, xstrdup(dirname));
+        deferred_analysis_try_start(/*force*/true);
+    }
+    else
+    {
+        s_deferred_queue = g_list_append(s_deferred_queue, xstrdup(dirname));
+        deferred_analysis_start_timer();
+    }
+}
+
+static void deferred_analysis_cancel(const char *dirname)
+{
+    s_deferred_queue = deferred_analysis_remove_from(s_deferred_queue, dirname);
+    s_deferred_urgent_queue = deferred_analysis_remove_from(s_deferred_urgent_queue, dirname);
+
+    if (s_deferred_pid > 0 && strcmp(s_deferred_dirname, dirname) == 0)
+    {
+        log_notice("Killing deferred analysis of deleted '%s'", dirname);
+        kill(-s_deferred_pid, SIGTERM);
+    }
+}
+
+/* Host facts snapshot */
+
+static void host_facts_refresh(void)
+{
+    if (s_host_facts_pid > 0)
+    {
+        /* Refresh again when the running collection finishes */
+        s_host_facts_outdated = true;
+        return;
+    }
+
+    s_host_facts_outdated = false;
+
+    char *args[3];
+    args[0] = (char *) "abrt-action-save-host-facts";
+    args[1] = (char *) "-u";
+    args[2] = NULL;
+
+    s_host_facts_pid = fork_execv_on_steroids(EXECFLG_INPUT_NUL | EXECFLG_SETSID,
+                                              args, /*pipe*/NULL, /*env*/NULL,
+                                              /*dir*/NULL, /*uid*/0);
+    log_debug("Refreshing host facts snapshot (pid %d)", s_host_facts_pid);
+}
+
+static void host_facts_refresh_finished(int status)
+{
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        log_warning("Failed to refresh host facts snapshot");
+
+    s_host_facts_pid = 0;
+
+    if (s_host_facts_outdated)
+        host_facts_refresh();
+}
+
+static void handle_host_facts_inotify_cb(struct abrt_inotify_watch *watch, struct inotify_event *event, gpointer ptr_unused)
+{
+    if (event->len == 0)
+        return;
+
+    if (strcmp(event->name, "os-release") == 0
+        || strcmp(event->name, "hostname") == 0
+        || strcmp(event->name, "machine-id") == 0)
+    {
+        log_info("'/etc/%s' changed, refreshing host facts", event->name);
+        host_facts_refresh();
+    }
+}
+
+/* Cold storage */
+
+static gboolean cold_storage_tick(gpointer user_data)
+{
+    if (s_cold_storage_pid > 0)
+    {
+        log_debug("Previous migration to cold storage is still running");
+        return TRUE;
+    }
+
+    char *args[2];
+    args[0] = (char *) "abrt-cold-storage";
+    args[1] = NULL;
+
+    /* The tool throttles itself and runs with idle I/O priority */
+    s_cold_storage_pid = fork_execv_on_steroids(EXECFLG_INPUT_NUL | EXECFLG_SETSID,
+                                                args, /*pipe*/NULL, /*env*/NULL,
+                                                /*dir*/NULL, /*uid*/0);
+    log_debug("Migrating aged problems to cold storage (pid %d)", s_cold_storage_pid);
+    return TRUE;
+}
+
+static void cold_storage_finished(int status)
+{
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        log_warning("Failed to migrate problems to cold storage");
+
+    s_cold_storage_pid = 0;
+}
+
+static void deferred_analysis_shutdown(void)
+{
+    deferred_analysis_stop_timer();
+
+    /* The pending element is still there, the analysis restarts with
+     * next abrtd */
+    if (s_deferred_pid > 0)
+        kill(-s_deferred_pid, SIGTERM);
+
+    list_free_with_free(s_deferred_queue);
+    s_deferred_queue = NULL;
+    list_free_with_free(s_deferred_urgent_queue);
+    s_deferred_urgent_queue = NULL;
+}
+
+/* Re-reads the problem (or forgets it if it was deleted) and saves the counts
+ * the login notification reads. */
+static void refresh_problem_status(const char *dirname)
+{
+    if (s_problem_status == NULL)
+        return;
+
+    problem_status_update(s_problem_status, dirname);
+    problem_status_save(s_problem_status, /*default dir*/NULL);
+}
+
+/* Only new and changed problems are read again, the files are written only
+ * if something changed */
+static gboolean problem_status_tick(gpointer user_data)
+{
+    if (s_problem_status == NULL)
+        s_problem_status = problem_status_scan(g_settings_dump_location);
+    else if (problem_status_refresh(s_problem_status, g_settings_dump_location) == 0)
+        return TRUE;
+
+    problem_status_save(s_problem_status, /*default dir*/NULL);
+    return TRUE;
+}
+
+/* Re-reads the problem (or forgets it if it was deleted) and saves the usage
+ * the hooks check. */
+static void refresh_quota_usage(const char *dirname)
+{
+    /* Duplicates may be found in the cold storage which has no quotas */
+    if (s_quota_usage == NULL || !dir_is_in_dump_location(dirname))
+        return;
+
+    quota_usage_update(s_quota_usage, dirname);
+    quota_usage_save(s_quota_usage);
+}
+
+/* Deletes the oldest problems of the quota classes the new problem belongs to
+ * until none of them exceeds its size or count quota. The problem being
+ * processed by post-create is never deleted.
+ */
+static void delete_over_quota_problems(struct abrt_server_proc *proc, const char *running_dirname)
+{
+    if (s_quota_usage == NULL)
+        s_quota_usage = quota_usage_scan(g_settings_dump_location);
+
+    quota_usage_admit(s_quota_usage, proc->dirname);
+
+    const char *new_basename = strrchr(proc->dirname, '/');
+    new_basename = new_basename ? new_basename + 1 : proc->dirname;
+
+    /* Post-create is running in this directory, it must stay */
+    const char *running_basename = NULL;
+    if (running_dirname != NULL)
+    {
+        running_basename = strrchr(running_dirname, '/');
+        running_basename = running_basename ? running_basename + 1 : running_dirname;
+    }
+
+    char *victim;
+    while ((victim = quota_usage_find_victim(s_quota_usage, new_basename, running_basename)) != NULL)
+    {
+        char *deleted = concat_path_file(g_settings_dump_location, victim);
+
+        const char *kind = "old";
+        GList *proc_of_deleted_item = g_list_find_custom(s_dir_queue, deleted, (GCompareFunc)abrt_server_compare_dirname);
+        if (proc_of_deleted_item != NULL)
+        {
+            kind = "unprocessed";
+            struct abrt_server_proc *removed_proc = (struct abrt_server_proc *)proc_of_deleted_item->data;
+            s_dir_queue = g_list_delete_link(s_dir_queue, proc_of_deleted_item);
+            stop_abrt_server(removed_proc);
+        }
+
+        log("Quota of '%s' exceeded, deleting %s directory '%s'", proc->dirname, kind, deleted);
+
+        deferred_analysis_cancel(deleted);
+
+        struct dump_dir *dd = dd_opendir(deleted, DD_FAIL_QUIETLY_ENOENT);
+        const bool gone = dd != NULL ? dd_delete(dd) == 0 : errno == ENOENT;
+        if (gone)
+        {
+            quota_usage_remove(s_quota_usage, victim);
+            pipeline_journal_append(deleted, ABRT_PIPELINE_REMOVED, 0);
+            refresh_problem_status(deleted);
+        }
+
+        free(deleted);
+        free(victim);
+
+        /* The same victim would be found again */
+        if (!gone)
+            break;
+    }
+
+    quota_usage_save(s_quota_usage);
+}
+
+/* Recounts the usage from the dump location, so it reflects problems deleted
+ * behind abrtd's back. abrtd updates the usage as problems are admitted and
+ * deleted, so the rescan is only a safety net. */
+static gboolean quota_usage_tick(gpointer user_data)
+{
+    if (!quota_enabled())
+        return TRUE;
+
+    if (s_quota_usage == NULL)
+        s_quota_usage = quota_usage_scan(g_settings_dump_location);
+    else
+        quota_usage_rescan(s_quota_usage, g_settings_dump_location);
+    quota_usage_save(s_quota_usage);
+
+    return TRUE;
+}
+
 /* Queueing the process will also lead to cleaning up the dump location.
  */
 static void queue_post_craete_process(struct abrt_server_proc *proc)
@@ -175,7 +618,7 @@ static void queue_post_craete_process(struct abrt_server_proc *proc)
 
     char *worst_dir = NULL;
     const double max_size = 1024 * 1024 * g_settings_nMaxCrashReportsSize;
-    while (get_dirsize_find_largest_dir(g_settings_dump_location, &worst_dir, ignored) >= max_size
+    while (dump_location_size(g_settings_dump_location, &worst_dir, ignored) >= max_size
            && worst_dir)
     {
         const char *kind = "old";
@@ -203,19 +646,30 @@ static void queue_post_craete_process(struct abrt_server_proc *proc)
         free(worst_dir);
         worst_dir = NULL;
 
+        deferred_analysis_cancel(deleted);
+
         struct dump_dir *dd = dd_opendir(deleted, DD_FAIL_QUIETLY_ENOENT);
         if (dd != NULL)
             dd_delete(dd);
+        pipeline_journal_append(deleted, ABRT_PIPELINE_REMOVED, 0);
+        refresh_problem_status(deleted);
+        refresh_quota_usage(deleted);
 
         free(deleted);
     }
 
 consider_processing:
+    if (proc != NULL && quota_enabled())
+        delete_over_quota_problems(proc, running != NULL ? running->dirname : NULL);
+
     /* If the process survived cleaning up the dump location, append it to the
      * post-create queue.
      */
     if (proc != NULL)
+    {
         s_dir_queue = g_list_append(s_dir_queue, proc);
+        pipeline_journal_append(proc->dirname, ABRT_PIPELINE_QUEUED, 0);
+    }
 
     /* If there were no running post-crate process before we added the
      * currently handled process to the post-create queue, start processing of
@@ -225,6 +679,92 @@ consider_processing:
         notify_next_post_create_process(NULL/*finished*/);
 }
 
+/* Returns true if the line was a deferred analysis message */
+static bool handle_deferred_analysis_message(struct abrt_server_proc *proc, char *line)
+{
+    bool urgent;
+    const char *dirname;
+    if (g_str_has_prefix(line, "DEFERRED_ANALYSIS: "))
+    {
+        dirname = line + strlen("DEFERRED_ANALYSIS: ");
+        urgent = false;
+    }
+    else if (g_str_has_prefix(line, "DEFERRED_ANALYSIS_NOW: "))
+    {
+        dirname = line + strlen("DEFERRED_ANALYSIS_NOW: ");
+        urgent = true;
+    }
+    else
+        return false;
+
+    log_notice("abrt-server(%d): %s analysis of '%s'", proc->pid,
+               urgent ? "promoting" : "deferring", dirname);
+    deferred_analysis_enqueue(dirname, urgent);
+    return true;
+}
+
+/* Returns true if the line was a problem update message (a duplicate
+ * updated the last occurrence of the original problem) */
+static bool handle_problem_updated_message(struct abrt_server_proc *proc, char *line)
+{
+    if (!g_str_has_prefix(line, "PROBLEM_UPDATED: "))
+        return false;
+
+    const char *dirname = line + strlen("PROBLEM_UPDATED: ");
+    log_debug("abrt-server(%d): updated '%s'", proc->pid, dirname);
+    refresh_problem_status(dirname);
+    refresh_quota_usage(dirname);
+    return true;
+}
+
+/* Returns true if the line was a message about a problem deleted by a
+ * client of abrt-dbus */
+static bool handle_problem_deleted_message(struct abrt_server_proc *proc, char *line)
+{
+    if (!g_str_has_prefix(line, "PROBLEM_DELETED: "))
+        return false;
+
+    const char *dirname = line + strlen("PROBLEM_DELETED: ");
+    log_notice("abrt-server(%d): '%s' was deleted", proc->pid, dirname);
+    deferred_analysis_cancel(dirname);
+    pipeline_journal_append(dirname, ABRT_PIPELINE_REMOVED, 0);
+    refresh_quota_usage(dirname);
+    return true;
+}
+
+/* Returns true if the line was one of the messages above */
+static bool handle_problem_message(struct abrt_server_proc *proc, char *line)
+{
+    return handle_deferred_analysis_message(proc, line)
+           || handle_problem_updated_message(proc, line)
+           || handle_problem_deleted_message(proc, line);
+}
+
+/* abrt-server processes answering requests for promotion of deferred
+ * analysis or notifications about deleted problems exit right after printing
+ * the message, hence the message must be read before the pipe gets closed.
+ */
+static void drain_abrt_server_output(struct abrt_server_proc *proc)
+{
+    if (proc->channel == NULL)
+        return;
+
+    for (;;)
+    {
+        gchar *line;
+        gsize len = 0;
+        gsize pos = 0;
+
+        GIOStatus stat = g_io_channel_read_line(proc->channel, &line, &len, &pos, NULL);
+        if (stat != G_IO_STATUS_NORMAL)
+            break;
+
+        line[pos] = '\0';
+        handle_problem_message(proc, line);
+        g_free(line);
+    }
+}
+
 static gboolean abrt_server_output_cb(GIOChannel *channel, GIOCondition condition, gpointer user_data)
 {
     int fdout = g_io_channel_unix_get_fd(channel);
@@ -282,7 +822,7 @@ static gboolean abrt_server_output_cb(GIOChannel *channel, GIOCondition conditio
             log_notice("abrt-server(%d): handling new problem: %s", proc->pid, proc->dirname);
             queue_post_craete_process(proc);
         }
-        else
+        else if (!handle_problem_message(proc, line))
             log("abrt-server(%d): not recognized message: '%s'", proc->pid, line);
 
         g_free(line);
@@ -355,8 +895,18 @@ static void remove_abrt_server_proc(pid_t pid, int status)
     item->data = NULL;
     s_processes = g_list_delete_link(s_processes, item);
 
+    drain_abrt_server_output(proc);
+
     if (proc->type == AS_POST_CREATE)
+    {
         notify_next_post_create_process(proc);
+        if (proc->dirname != NULL)
+        {
+            /* post-create might have deleted a duplicate or added elements */
+            refresh_problem_status(proc->dirname);
+            refresh_quota_usage(proc->dirname);
+        }
+    }
     else
     {   /* Make sure out-of-order exited abrt-server post-create processes do
          * not stay in the post-create queue.
@@ -460,7 +1010,20 @@ static gboolean handle_signal_cb(GIOChannel *gio, GIOCondition condition, gpoint
                     continue;
                 }
 
-                remove_abrt_server_proc(cpid, status);
+                if (cpid == s_deferred_pid)
+                    deferred_analysis_finished(status);
+                else if (cpid == s_host_facts_pid)
+                    host_facts_refresh_finished(status);
+                else if (cpid == s_cold_storage_pid)
+                    cold_storage_finished(status);
+                else if (cpid == s_resume_pid)
+                {
+                    s_resume_pid = 0;
+                    /* Crashes imported in the meantime */
+                    resume_unfinished_dump_dirs();
+                }
+                else
+                    remove_abrt_server_proc(cpid, status);
             }
         }
     }
@@ -477,6 +1040,8 @@ static void sanitize_dump_dir_rights(void)
     ensure_writable_dir_group(g_settings_dump_location, DEFAULT_DUMP_LOCATION_MODE, "root", "abrt");
     /* temp dir */
     ensure_writable_dir(VAR_RUN"/abrt", 0755, "root");
+    /* watched for crashes staged while abrtd is starting or stopping */
+    ensure_writable_dir(ABRT_STAGING_RING_DIR, 0700, "root");
 }
 
 /* Inotify handler */
@@ -625,6 +1190,9 @@ static void start_logging(void)
  * FILENAME_COUNT element doesn't exist abrtd can consider the dump directory
  * as unprocessed.
  *
+ * Processed dump directories with FILENAME_PENDING_ANALYSIS element are put
+ * in the deferred analysis queue.
+ *
  * Relying on content of dump directory has one problem. If a hook provides
  * FILENAME_COUNT abrtd will consider the dump directory as processed.
  */
@@ -675,6 +1243,11 @@ static void mark_unprocessed_dump_dirs_not_reportable(const char *path)
                             "sort out this problem, please contact them directly."));
 
             }
+            else if (dd_exist(dd, FILENAME_PENDING_ANALYSIS))
+            {
+                deferred_analysis_enqueue(full_name, /*urgent*/false);
+                pipeline_journal_append(full_name, ABRT_PIPELINE_ANALYSIS, 0);
+            }
             dd_close(dd);
         }
 
@@ -684,6 +1257,156 @@ static void mark_unprocessed_dump_dirs_not_reportable(const char *path)
     closedir(dp);
 }
 
+/* Replays the pipeline journal and collects the problems whose post-create
+ * was interrupted, so the startup costs only the unfinished problems instead
+ * of the whole dump location. Returns false if there is no usable journal.
+ */
+static bool find_unfinished_dump_dirs(void)
+{
+    log_notice("Searching for unfinished dump directories");
+
+    GList *unfinished = NULL;
+    if (pipeline_journal_compact(/*min_size*/0, &unfinished) != 0)
+        return false;
+
+    for (GList *iter = unfinished; iter != NULL; iter = g_list_next(iter))
+    {
+        const struct abrt_pipeline_entry *entry = iter->data;
+
+        struct dump_dir *dd = dd_opendir(entry->dirname, DD_OPEN_READONLY | DD_FAIL_QUIETLY_ENOENT);
+        if (dd == NULL)
+        {
+            pipeline_journal_append(entry->dirname, ABRT_PIPELINE_REMOVED, 0);
+            continue;
+        }
+
+        if (entry->stage != ABRT_PIPELINE_DONE && !problem_dump_dir_is_complete(dd))
+        {
+            if (entry->stage == ABRT_PIPELINE_STEP)
+                log_warning("Resuming post-create of '%s' interrupted after step %u",
+                            entry->dirname, entry->step);
+            else
+                log_warning("Resuming post-create of '%s' interrupted in stage '%s'",
+                            entry->dirname, pipeline_stage_name(entry->stage));
+
+            s_resume_dirs = g_list_append(s_resume_dirs, xstrdup(entry->dirname));
+        }
+        else
+        {
+            /* post-create finished but abrtd was stopped before it got the
+             * message */
+            if (entry->stage != ABRT_PIPELINE_DONE)
+                pipeline_journal_append(entry->dirname, ABRT_PIPELINE_DONE, 0);
+
+            if (dd_exist(dd, FILENAME_PENDING_ANALYSIS))
+                deferred_analysis_enqueue(entry->dirname, /*urgent*/false);
+            else if (entry->analysis_pending)
+                pipeline_journal_append(entry->dirname, ABRT_PIPELINE_ANALYZED, 0);
+        }
+
+        dd_close(dd);
+    }
+
+    g_list_free_full(unfinished, (GDestroyNotify)pipeline_entry_free);
+    return true;
+}
+
+/* Moves crashes saved by abrt-hook-ccpp while abrtd was not running to the
+ * dump location. They are processed together with the unfinished problems.
+ */
+static void import_staged_crashes(void)
+{
+    GList *imported = NULL;
+    const unsigned dropped = staging_ring_import(ABRT_STAGING_RING_DIR, g_settings_dump_location, &imported);
+    if (dropped != 0)
+        log_warning("%u crashes were dropped because the staging ring was full", dropped);
+
+    for (GList *iter = imported; iter != NULL; iter = g_list_next(iter))
+        pipeline_journal_append(iter->data, ABRT_PIPELINE_QUEUED, 0);
+
+    if (imported != NULL)
+        log_info("Imported %u staged crashes", g_list_length(imported));
+    s_resume_dirs = g_list_concat(s_resume_dirs, imported);
+}
+
+/* Removes reference cores of delta cores (DeltaCores in CCpp.conf) which no
+ * problem uses anymore. abrt-hook-ccpp does the same whenever it saves a new
+ * reference.
+ */
+static void collect_core_references(void)
+{
+    char *ref_dir = delta_core_reference_dir();
+    const unsigned removed = delta_core_collect_references(ref_dir);
+    if (removed != 0)
+        log_info("Removed %u unused reference cores", removed);
+    free(ref_dir);
+}
+
+/* Sends the unfinished problems to abrtd the same way hooks notify new
+ * problems, hence they go through the post-create queue again. The post-create
+ * rules are run from the first one because the event engine cannot start
+ * in the middle of an event.
+ */
+static void resume_unfinished_dump_dirs(void)
+{
+    /* The running child sends the next ones when it is done */
+    if (s_resume_dirs == NULL || s_resume_pid != 0)
+        return;
+
+    s_resume_pid = fork();
+    if (s_resume_pid < 0)
+    {
+        perror_msg("fork");
+        s_resume_pid = 0;
+        return;
+    }
+
+    if (s_resume_pid == 0)
+    {
+        /* Child: must not report signals to abrtd's main loop */
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT,  SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        close(s_signal_pipe[0]);
+        close(s_signal_pipe[1]);
+
+        for (GList *iter = s_resume_dirs; iter != NULL; iter = g_list_next(iter))
+        {
+            char *message = NULL;
+            const int r = notify_new_path_with_response(iter->data, &message);
+            if (r < 0 || r >= 400)
+                log_warning("Failed to resume post-create of '%s' (%d)", (char *)iter->data, r);
+            free(message);
+        }
+
+        _exit(0);
+    }
+
+    log_debug("Resuming post-create of %u problems (pid %d)", g_list_length(s_resume_dirs), s_resume_pid);
+    list_free_with_free(s_resume_dirs);
+    s_resume_dirs = NULL;
+}
+
+/* The hook stages crashes whenever it thinks abrtd is not running, e.g.
+ * while abrtd is starting or stopping. They are imported as soon as they are
+ * complete, not at the next start of abrtd. */
+static void handle_staging_ring_inotify_cb(struct abrt_inotify_watch *watch, struct inotify_event *event, gpointer ptr_unused)
+{
+    if (!(event->mask & IN_Q_OVERFLOW)
+        && (event->len == 0 || event->name[0] == '.' || suffixcmp(event->name, ".new") == 0))
+        return;
+
+    log_info("A crash was staged while abrtd is running, importing it");
+    import_staged_crashes();
+    resume_unfinished_dump_dirs();
+}
+
+static gboolean pipeline_journal_tick(gpointer user_data)
+{
+    pipeline_journal_compact(PIPELINE_JOURNAL_COMPACT_SIZE, /*unfinished*/NULL);
+    return TRUE;
+}
+
 static void on_bus_acquired(GDBusConnection *connection,
                  const gchar     *name,
                  gpointer         user_data)
@@ -775,6 +1498,8 @@ int main(int argc, char** argv)
     guint channel_id_signal_event = 0;
     bool pidfile_created = false;
     struct abrt_inotify_watch *aiw = NULL;
+    struct abrt_inotify_watch *etc_aiw = NULL;
+    struct abrt_inotify_watch *staging_aiw = NULL;
     int ret = 1;
 
     /* Initialization */
@@ -785,9 +1510,16 @@ int main(int argc, char** argv)
     /* Moved before daemonization because parent waits for signal from daemon
      * only for short period and time consumed by
      * mark_unprocessed_dump_dirs_not_reportable() is slightly unpredictable.
+     *
+     * The whole dump location is scanned only if there is no pipeline
+     * journal yet (e.g. the first start after upgrade).
      */
     sanitize_dump_dir_rights();
-    mark_unprocessed_dump_dirs_not_reportable(g_settings_dump_location);
+    if (!find_unfinished_dump_dirs())
+        mark_unprocessed_dump_dirs_not_reportable(g_settings_dump_location);
+    /* After the scan, the staged crashes have not been processed yet */
+    import_staged_crashes();
+    collect_core_references();
 
     /* Daemonize unless -d */
     if (!(opts & OPT_d))
@@ -834,6 +1566,16 @@ int main(int argc, char** argv)
     aiw = abrt_inotify_watch_init(g_settings_dump_location,
             IN_DUMP_LOCATION_FLAGS, handle_inotify_cb, /*user data*/NULL);
 
+    /* Host facts are collected once per boot and when they change */
+    etc_aiw = abrt_inotify_watch_init("/etc",
+            IN_HOST_FACTS_FLAGS, handle_host_facts_inotify_cb, /*user data*/NULL);
+
+    /* Crashes staged from now on are imported by the watch, the ones staged
+     * since the first import are imported now */
+    staging_aiw = abrt_inotify_watch_init(ABRT_STAGING_RING_DIR,
+            IN_STAGING_RING_FLAGS, handle_staging_ring_inotify_cb, /*user data*/NULL);
+    import_staged_crashes();
+
     /* Add an event source which waits for INT/TERM signal */
     log_notice("Adding signal pipe watch to glib main loop");
     channel_signal = abrt_gio_channel_unix_new(s_signal_pipe[0]);
@@ -864,6 +1606,20 @@ int main(int argc, char** argv)
     /* Only now we want signal pipe to work */
     s_signal_pipe_write = s_signal_pipe[1];
 
+    host_facts_refresh();
+
+    quota_usage_tick(NULL);
+    s_quota_timer = g_timeout_add_seconds(QUOTA_USAGE_PERIOD, quota_usage_tick, NULL);
+
+    problem_status_tick(NULL);
+    s_problem_status_timer = g_timeout_add_seconds(PROBLEM_STATUS_PERIOD, problem_status_tick, NULL);
+
+    resume_unfinished_dump_dirs();
+    s_pipeline_timer = g_timeout_add_seconds(PIPELINE_JOURNAL_PERIOD, pipeline_journal_tick, NULL);
+
+    if (g_settings_cold_dump_location != NULL)
+        s_cold_storage_timer = g_timeout_add_seconds(COLD_STORAGE_PERIOD, cold_storage_tick, NULL);
+
     /* Own a name on D-Bus */
     name_id = g_bus_own_name(G_BUS_TYPE_SYSTEM,
                              ABRTD_DBUS_NAME,
@@ -900,6 +1656,18 @@ int main(int argc, char** argv)
      * Take care to not undo things we did not do.
      */
     dumpsocket_shutdown();
+    deferred_analysis_shutdown();
+    if (s_quota_timer != 0)
+        g_source_remove(s_quota_timer);
+    if (s_problem_status_timer != 0)
+        g_source_remove(s_problem_status_timer);
+    problem_status_free(s_problem_status);
+    quota_usage_free(s_quota_usage);
+    if (s_pipeline_timer != 0)
+        g_source_remove(s_pipeline_timer);
+    if (s_cold_storage_timer != 0)
+        g_source_remove(s_cold_storage_timer);
+    list_free_with_free(s_resume_dirs);
     if (pidfile_created)
         unlink(VAR_RUN_PIDFILE);
 
@@ -908,6 +1676,8 @@ int main(int argc, char** argv)
     if (channel_signal)
         g_io_channel_unref(channel_signal);
 
+    abrt_inotify_watch_destroy(staging_aiw);
+    abrt_inotify_watch_destroy(etc_aiw);
     abrt_inotify_watch_destroy(aiw);
 
     if (s_main_loop)
@@ -0,0 +1,384 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <json.h>
+#include "libabrt.h"
+#include "json-submission.h"
+
+/* Frame attributes are optional, missing values are printed as "??" */
+#define UNKNOWN_VALUE "??"
+
+struct frame
+{
+    const char *function;
+    const char *file;
+    const char *module;
+    int line;
+};
+
+/* Elements computed from the frames can't be submitted */
+static const char *const computed_elements[] = {
+    FILENAME_TYPE,
+    FILENAME_ANALYZER,
+    FILENAME_PID,
+    FILENAME_BACKTRACE,
+    FILENAME_DUPHASH,
+    FILENAME_UUID,
+    FILENAME_CRASH_FUNCTION,
+    FILENAME_RATING,
+    ABRT_JSON_SUBMISSION_RUNTIME,
+    ABRT_JSON_SUBMISSION_EXCEPTION_TYPE,
+    NULL
+};
+
+/*
+ * Returns the string member or NULL
+ *
+ * Fails if the member is present but it is not a string or if it is required
+ * and missing.
+ */
+static int get_string_member(json_object *object, const char *name, bool required,
+        const char **value, char **error_msg)
+{
+    *value = NULL;
+
+    json_object *member = NULL;
+    if (!json_object_object_get_ex(object, name, &member) || member == NULL)
+    {
+        if (!required)
+            return 0;
+
+        *error_msg = xasprintf("Member '%s' is missing", name);
+        return -EINVAL;
+    }
+
+    if (!json_object_is_type(member, json_type_string))
+    {
+        *error_msg = xasprintf("Member '%s' is not a string", name);
+        return -EINVAL;
+    }
+
+    *value = json_object_get_string(member);
+    return 0;
+}
+
+static int get_int_member(json_object *object, const char *name, bool required,
+        int min, int *value, char **error_msg)
+{
+    json_object *member = NULL;
+    if (!json_object_object_get_ex(object, name, &member) || member == NULL)
+    {
+        if (!required)
+            return 0;
+
+        *error_msg = xasprintf("Member '%s' is missing", name);
+        return -EINVAL;
+    }
+
+    if (!json_object_is_type(member, json_type_int))
+    {
+        *error_msg = xasprintf("Member '%s' is not an integer", name);
+        return -EINVAL;
+    }
+
+    errno = 0;
+    const int64_t v = json_object_get_int64(member);
+    if (errno != 0 || v < min || v > INT_MAX)
+    {
+        *error_msg = xasprintf("Member '%s' is out of range", name);
+        return -EINVAL;
+    }
+
+    *value = (int)v;
+    return 0;
+}
+
+static int get_object_member(json_object *object, const char *name, bool required,
+        json_type type, json_object **value, char **error_msg)
+{
+    *value = NULL;
+    if (!json_object_object_get_ex(object, name, value) || *value == NULL)
+    {
+        if (!required)
+            return 0;
+
+        *error_msg = xasprintf("Member '%s' is missing", name);
+        return -EINVAL;
+    }
+
+    if (!json_object_is_type(*value, type))
+    {
+        *error_msg = xasprintf("Member '%s' has invalid type", name);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int parse_frames(json_object *array, struct frame **frames, size_t *frames_cnt, char **error_msg)
+{
+    const size_t cnt = json_object_array_length(array);
+    if (cnt == 0)
+    {
+        *error_msg = xstrdup("Member 'frames' is empty");
+        return -EINVAL;
+    }
+
+    *frames = xzalloc(sizeof(**frames) * cnt);
+    *frames_cnt = cnt;
+
+    for (size_t i = 0; i < cnt; ++i)
+    {
+        json_object *item = json_object_array_get_idx(array, i);
+        if (item == NULL || !json_object_is_type(item, json_type_object))
+        {
+            *error_msg = xasprintf("Frame #%zu is not an object", i);
+            return -EINVAL;
+        }
+
+        struct frame *frame = &(*frames)[i];
+        frame->line = -1;
+
+        if (   get_string_member(item, "function", false, &frame->function, error_msg) != 0
+            || get_string_member(item, "file", false, &frame->file, error_msg) != 0
+            || get_string_member(item, "module", false, &frame->module, error_msg) != 0
+            || get_int_member(item, "line", false, 0, &frame->line, error_msg) != 0)
+        {
+            char *frame_error = xasprintf("Frame #%zu: %s", i, *error_msg);
+            free(*error_msg);
+            *error_msg = frame_error;
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+#define OR_UNKNOWN(value) ((value) != NULL ? (value) : UNKNOWN_VALUE)
+
+/* Hash of the exception type and the innermost functions, the line numbers
+ * are left out to detect the same problem in slightly different versions */
+static char *compute_duphash(const char *type, const char *exception_type,
+        const struct frame *frames, size_t frames_cnt)
+{
+    GString *input = g_string_new(NULL);
+    g_string_append_printf(input, "%s\n%s\n", type, exception_type);
+
+    for (size_t i = 0; i < frames_cnt && i < ABRT_JSON_SUBMISSION_DUPHASH_FRAMES; ++i)
+        g_string_append_printf(input, "%s %s %s\n", OR_UNKNOWN(frames[i].module),
+                OR_UNKNOWN(frames[i].file), OR_UNKNOWN(frames[i].function));
+
+    char hash_str[SHA1_RESULT_LEN*2 + 1];
+    str_to_sha1str(hash_str, input->str);
+    g_string_free(input, TRUE);
+
+    return xstrdup(hash_str);
+}
+
+/* The whole stack trace identifies the problem locally */
+static char *compute_uuid(const char *type, const char *exception_type,
+        const struct frame *frames, size_t frames_cnt)
+{
+    GString *input = g_string_new(NULL);
+    g_string_append_printf(input, "%s\n%s\n", type, exception_type);
+
+    for (size_t i = 0; i < frames_cnt; ++i)
+        g_string_append_printf(input, "%s %s:%d %s\n", OR_UNKNOWN(frames[i].module),
+                OR_UNKNOWN(frames[i].file), frames[i].line, OR_UNKNOWN(frames[i].function));
+
+    char hash_str[SHA1_RESULT_LEN*2 + 1];
+    str_to_sha1str(hash_str, input->str);
+    g_string_free(input, TRUE);
+
+    return xstrdup(hash_str);
+}
+
+/* The same scale as abrt-action-analyze-backtrace uses (0 - 4) */
+static unsigned compute_rating(const struct frame *frames, size_t frames_cnt)
+{
+    size_t complete = 0;
+    for (size_t i = 0; i < frames_cnt; ++i)
+        complete += frames[i].function != NULL && frames[i].file != NULL && frames[i].line >= 0;
+
+    if (complete == frames_cnt)
+        return 4;
+    if (complete * 4 >= frames_cnt * 3)
+        return 3;
+    if (complete * 2 >= frames_cnt)
+        return 2;
+    return complete != 0;
+}
+
+static char *format_backtrace(const char *exception_type, const char *message,
+        const struct frame *frames, size_t frames_cnt)
+{
+    GString *bt = g_string_new(exception_type);
+    if (message != NULL)
+        g_string_append_printf(bt, ": %s", message);
+    g_string_append_c(bt, '\n');
+
+    for (size_t i = 0; i < frames_cnt; ++i)
+    {
+        g_string_append_printf(bt, "\tat %s (%s", OR_UNKNOWN(frames[i].function),
+                OR_UNKNOWN(frames[i].file));
+        if (frames[i].line >= 0)
+            g_string_append_printf(bt, ":%d", frames[i].line);
+        g_string_append_c(bt, ')');
+        if (frames[i].module != NULL)
+            g_string_append_printf(bt, " [%s]", frames[i].module);
+        g_string_append_c(bt, '\n');
+    }
+
+    return g_string_free(bt, FALSE);
+}
+
+static void insert(GHashTable *problem_info, const char *name, char *value)
+{
+    g_hash_table_insert(problem_info, xstrdup(name), value);
+}
+
+static int add_submitted_elements(json_object *elements, GHashTable *problem_info, char **error_msg)
+{
+    json_object_object_foreach(elements, submitted_name, value)
+    {
+        if (!json_object_is_type(value, json_type_string))
+        {
+            *error_msg = xasprintf("Element '%s' is not a string", submitted_name);
+            return -EINVAL;
+        }
+
+        /* Element names are lower case, the same as in the key=value
+         * protocol, otherwise "DUPHASH" would pass the check below */
+        gchar *name = g_ascii_strdown(submitted_name, -1);
+        for (const char *const *computed = computed_elements; *computed != NULL; ++computed)
+        {
+            if (strcmp(name, *computed) == 0)
+            {
+                *error_msg = xasprintf("Element '%s' can't be submitted", submitted_name);
+                g_free(name);
+                return -EINVAL;
+            }
+        }
+
+        insert(problem_info, name, xstrdup(json_object_get_string(value)));
+        g_free(name);
+    }
+
+    return 0;
+}
+
+int abrt_json_submission_parse(const char *json, GHashTable *problem_info, char **error_msg)
+{
+    *error_msg = NULL;
+
+    enum json_tokener_error parse_error = json_tokener_success;
+    json_object *root = json_tokener_parse_verbose(json, &parse_error);
+    if (root == NULL)
+    {
+        *error_msg = xasprintf("Invalid JSON: %s", json_tokener_error_desc(parse_error));
+        return -EINVAL;
+    }
+
+    int r = -EINVAL;
+    struct frame *frames = NULL;
+    size_t frames_cnt = 0;
+
+    if (!json_object_is_type(root, json_type_object))
+    {
+        *error_msg = xstrdup("The submission is not an object");
+        goto finito;
+    }
+
+    int version = 0;
+    if (get_int_member(root, "version", true, 0, &version, error_msg) != 0)
+        goto finito;
+
+    if (version != ABRT_JSON_SUBMISSION_VERSION)
+    {
+        *error_msg = xasprintf("Unsupported version %d", version);
+        goto finito;
+    }
+
+    const char *type, *executable, *cmdline, *reason;
+    int pid = 0;
+    if (   get_string_member(root, "type", true, &type, error_msg) != 0
+        || get_int_member(root, "pid", true, 1, &pid, error_msg) != 0
+        || get_string_member(root, "executable", false, &executable, error_msg) != 0
+        || get_string_member(root, "cmdline", false, &cmdline, error_msg) != 0
+        || get_string_member(root, "reason", false, &reason, error_msg) != 0)
+        goto finito;
+
+    json_object *runtime, *exception, *frames_array, *elements;
+    if (   get_object_member(root, "runtime", true, json_type_object, &runtime, error_msg) != 0
+        || get_object_member(root, "exception", true, json_type_object, &exception, error_msg) != 0
+        || get_object_member(root, "frames", true, json_type_array, &frames_array, error_msg) != 0
+        || get_object_member(root, "elements", false, json_type_object, &elements, error_msg) != 0)
+        goto finito;
+
+    const char *runtime_name, *runtime_version, *exception_type, *message;
+    if (   get_string_member(runtime, "name", true, &runtime_name, error_msg) != 0
+        || get_string_member(runtime, "version", false, &runtime_version, error_msg) != 0
+        || get_string_member(exception, "type", true, &exception_type, error_msg) != 0
+        || get_string_member(exception, "message", false, &message, error_msg) != 0)
+        goto finito;
+
+    if (parse_frames(frames_array, &frames, &frames_cnt, error_msg) != 0)
+        goto finito;
+
+    if (elements != NULL && add_submitted_elements(elements, problem_info, error_msg) != 0)
+        goto finito;
+
+    insert(problem_info, FILENAME_TYPE, xstrdup(type));
+    insert(problem_info, FILENAME_ANALYZER, xstrdup(type));
+    insert(problem_info, FILENAME_PID, xasprintf("%d", pid));
+    if (executable != NULL)
+        insert(problem_info, FILENAME_EXECUTABLE, xstrdup(executable));
+    if (cmdline != NULL)
+        insert(problem_info, FILENAME_CMDLINE, xstrdup(cmdline));
+
+    insert(problem_info, ABRT_JSON_SUBMISSION_RUNTIME, runtime_version == NULL
+                ? xstrdup(runtime_name) : xasprintf("%s %s", runtime_name, runtime_version));
+    insert(problem_info, ABRT_JSON_SUBMISSION_EXCEPTION_TYPE, xstrdup(exception_type));
+
+    const char *const crash_function = OR_UNKNOWN(frames[0].function);
+    insert(problem_info, FILENAME_CRASH_FUNCTION, xstrdup(crash_function));
+
+    if (reason != NULL)
+        insert(problem_info, FILENAME_REASON, xstrdup(reason));
+    else if (message != NULL)
+        insert(problem_info, FILENAME_REASON,
+               xasprintf("%s: %s in %s", exception_type, message, crash_function));
+    else
+        insert(problem_info, FILENAME_REASON,
+               xasprintf("%s in %s", exception_type, crash_function));
+
+    insert(problem_info, FILENAME_BACKTRACE,
+           format_backtrace(exception_type, message, frames, frames_cnt));
+    insert(problem_info, FILENAME_DUPHASH,
+           compute_duphash(type, exception_type, frames, frames_cnt));
+    insert(problem_info, FILENAME_UUID,
+           compute_uuid(type, exception_type, frames, frames_cnt));
+    insert(problem_info, FILENAME_RATING,
+           xasprintf("%u", compute_rating(frames, frames_cnt)));
+
+    r = 0;
+
+finito:
+    free(frames);
+    json_object_put(root);
+    return r;
+}
@@ -0,0 +1,67 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef ABRT_JSON_SUBMISSION_H
+#define ABRT_JSON_SUBMISSION_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The only supported version of the structured submission format */
+#define ABRT_JSON_SUBMISSION_VERSION 1
+
+/* Number of the innermost frames used to compute duphash */
+#define ABRT_JSON_SUBMISSION_DUPHASH_FRAMES 3
+
+#define ABRT_JSON_SUBMISSION_RUNTIME "runtime"
+#define ABRT_JSON_SUBMISSION_EXCEPTION_TYPE "exception_type"
+
+/*
+ * Parses a problem submitted as a JSON document
+ *
+ * {
+ *   "version": 1,
+ *   "type": "Java",
+ *   "pid": 1234,
+ *   "executable": "/usr/bin/app",                           (optional)
+ *   "cmdline": "app --arg",                                 (optional)
+ *   "reason": "...",                                        (optional)
+ *   "runtime": { "name": "OpenJDK", "version": "1.8.0" },
+ *   "exception": { "type": "java.lang.NullPointerException",
+ *                  "message": "..." },                      (message optional)
+ *   "frames": [ { "function": "main", "file": "App.java",
+ *                 "line": 12, "module": "app.jar" }, ... ], (innermost first)
+ *   "elements": { "name": "value", ... }                    (optional)
+ * }
+ *
+ * Fills problem_info (malloced keys and values) with the submitted data and
+ * with backtrace, duphash, uuid, crash_function and rating computed from
+ * the frames.
+ *
+ * Returns 0 on success. Otherwise returns -EINVAL and sets malloced
+ * description of the problem to *error_msg.
+ */
+int abrt_json_submission_parse(const char *json, GHashTable *problem_info, char **error_msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*ABRT_JSON_SUBMISSION_H*/
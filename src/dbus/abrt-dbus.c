@@ -79,6 +79,9 @@ static const gchar introspection_xml[] =
   "      <arg type='b' name='all_users' direction='in'/>"
   "      <arg type='as' name='response' direction='out'/>"
   "    </method>"
+  "    <method name='GetQuotaUsage'>"
+  "      <arg type='a(ssttu)' name='response' direction='out'/>"
+  "    </method>"
   "    <method name='Quit' />"
   "  </interface>"
   "</node>";
@@ -111,7 +114,7 @@ static void run_timeout(void)
 
 bool allowed_problem_dir(const char *dir_name)
 {
-    if (!dir_is_in_dump_location(dir_name))
+    if (!dir_is_in_problem_storage(dir_name))
     {
         error_msg("Bad problem directory name '%s', should start with: '%s'", dir_name, g_settings_dump_location);
         return false;
@@ -252,6 +255,12 @@ static struct dump_dir *open_dump_directory(GDBusMethodInvocation *invocation,
                                 "org.freedesktop.problems.Failure",
                                 _("Can't open the problem"));
     }
+    else if (dd_exist(dd, FILENAME_PENDING_ANALYSIS))
+    {
+        /* A user is interested in the problem, do not wait for idle time */
+        if (promote_deferred_analysis(problem_dir) != 0)
+            log_notice("Can't promote deferred analysis of '%s'", problem_dir);
+    }
     return dd;
 }
 
@@ -328,6 +337,19 @@ static int add_dirname_to_GList_if_matches(struct dump_dir *dd, void *arg)
     return 0;
 }
 
+/* Problems migrated to ColdDumpLocation are listed as well */
+static GList *get_problem_dirs_in_storages(uid_t uid, bool accessible)
+{
+    GList *(*get_dirs)(uid_t, const char *) = accessible ? get_problem_dirs_for_uid
+                                                         : get_problem_dirs_not_accessible_by_uid;
+
+    GList *dirs = get_dirs(uid, g_settings_dump_location);
+    if (g_settings_cold_dump_location != NULL)
+        dirs = g_list_concat(dirs, get_dirs(uid, g_settings_cold_dump_location));
+
+    return dirs;
+}
+
 static GList *get_problem_dirs_for_element_in_time(uid_t uid,
                 const char *element,
                 const char *value,
@@ -346,6 +368,8 @@ static GList *get_problem_dirs_for_element_in_time(uid_t uid,
     };
 
     for_each_problem_in_dir(g_settings_dump_location, uid, add_dirname_to_GList_if_matches, &me);
+    if (g_settings_cold_dump_location != NULL)
+        for_each_problem_in_dir(g_settings_cold_dump_location, uid, add_dirname_to_GList_if_matches, &me);
 
     return g_list_reverse(me.list);
 }
@@ -396,7 +420,7 @@ static void handle_method_call(GDBusConnection *connection,
 
     if (g_strcmp0(method_name, "GetProblems") == 0)
     {
-        GList *dirs = get_problem_dirs_for_uid(caller_uid, g_settings_dump_location);
+        GList *dirs = get_problem_dirs_in_storages(caller_uid, /*accessible*/true);
         response = variant_from_string_list(dirs);
         list_free_with_free(dirs);
 
@@ -419,7 +443,7 @@ static void handle_method_call(GDBusConnection *connection,
                 caller_uid = 0;
         }
 
-        GList * dirs = get_problem_dirs_for_uid(caller_uid, g_settings_dump_location);
+        GList * dirs = get_problem_dirs_in_storages(caller_uid, /*accessible*/true);
         response = variant_from_string_list(dirs);
 
         list_free_with_free(dirs);
@@ -430,7 +454,7 @@ static void handle_method_call(GDBusConnection *connection,
 
     if (g_strcmp0(method_name, "GetForeignProblems") == 0)
     {
-        GList * dirs = get_problem_dirs_not_accessible_by_uid(caller_uid, g_settings_dump_location);
+        GList * dirs = get_problem_dirs_in_storages(caller_uid, /*accessible*/false);
         response = variant_from_string_list(dirs);
         list_free_with_free(dirs);
 
@@ -538,6 +562,8 @@ static void handle_method_call(GDBusConnection *connection,
                                                 | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE
                                                 | DD_FAIL_QUIETLY_ENOENT
                                                 | DD_FAIL_QUIETLY_EACCES);
+            if (!value)
+                value = host_facts_load_from_dump_dir(dd, element_name);
             log_notice("element '%s' %s", element_name, value ? "fetched" : "not found");
             if (value)
             {
@@ -576,6 +602,16 @@ static void handle_method_call(GDBusConnection *connection,
             return;
 
         problem_data_t *pd = create_problem_data_from_dump_dir(dd);
+
+        for (const char *const *elem = host_facts_elements; *elem != NULL; ++elem)
+        {
+            char *value = host_facts_load_from_dump_dir(dd, *elem);
+            if (value)
+            {
+                problem_data_add_text_noteditable(pd, *elem, value);
+                free(value);
+            }
+        }
         dd_close(dd);
 
         GVariantBuilder *response_builder = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
@@ -642,7 +678,7 @@ static void handle_method_call(GDBusConnection *connection,
         const double requested_size = (double)strlen(value) - item_size;
         /* Don't want to check the size limit in case of reducing of size */
         if (requested_size > 0
-            && requested_size > (max_dir_size - get_dirsize(g_settings_dump_location)))
+            && requested_size > (max_dir_size - dump_location_size(g_settings_dump_location, NULL, NULL)))
         {
             log_notice("No problem space left in '%s' (requested Bytes %f)", problem_id, requested_size);
             g_dbus_method_invocation_return_dbus_error(invocation,
@@ -754,6 +790,8 @@ static void handle_method_call(GDBusConnection *connection,
                     error_msg("Failed to delete problem directory '%s'", dir_name);
                     dd_close(dd);
                 }
+                else if (notify_problem_deleted(dir_name) != 0)
+                    log_notice("Can't notify abrtd about deleted '%s'", dir_name);
             }
         }
 
@@ -792,6 +830,40 @@ static void handle_method_call(GDBusConnection *connection,
         return;
     }
 
+    if (g_strcmp0(method_name, "GetQuotaUsage") == 0)
+    {
+        if (caller_uid != 0)
+        {
+            if (polkit_check_authorization_dname(caller, "org.freedesktop.problems.getall") == PolkitYes)
+                caller_uid = 0;
+        }
+
+        char caller_uid_str[sizeof(long) * 3 + 2];
+        sprintf(caller_uid_str, "%lu", (long)caller_uid);
+
+        GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE("a(ssttu)"));
+        GList *usages = quota_load_usage();
+        for (GList *iter = usages; iter != NULL; iter = g_list_next(iter))
+        {
+            const struct abrt_quota_class_usage *usage = iter->data;
+
+            /* Users can see only usage of their own problems */
+            if (caller_uid != 0
+                && (usage->class != ABRT_QUOTA_UID || strcmp(usage->key, caller_uid_str) != 0))
+                continue;
+
+            g_variant_builder_add(builder, "(ssttu)", quota_class_name(usage->class), usage->key,
+                                  (guint64)usage->size, (guint64)usage->count, usage->recent);
+        }
+        g_list_free_full(usages, (GDestroyNotify)quota_class_usage_free);
+
+        response = g_variant_new("(a(ssttu))", builder);
+        g_variant_builder_unref(builder);
+
+        g_dbus_method_invocation_return_value(invocation, response);
+        return;
+    }
+
     if (g_strcmp0(method_name, "Quit") == 0)
     {
         g_dbus_method_invocation_return_value(invocation, NULL);
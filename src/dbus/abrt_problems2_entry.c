@@ -150,6 +150,10 @@ int abrt_p2_entry_delete(AbrtP2Entry *entry, uid_t caller_uid, GError **error)
 
     abrt_p2_entry_set_state(entry, ABRT_P2_ENTRY_STATE_DELETED);
 
+    /* Don't let abrtd wait for deferred analysis of the problem */
+    if (notify_problem_deleted(entry->pv->p2e_dirname) != 0)
+        log_notice("Can't notify abrtd about deleted '%s'", entry->pv->p2e_dirname);
+
     return ret;
 }
 
@@ -249,6 +253,11 @@ GVariant *abrt_p2_entry_read_elements(AbrtP2Entry *entry,
     if (dd == NULL)
         return NULL;
 
+    /* Someone wants to see the data, do not wait for idle time */
+    if (dd_exist(dd, FILENAME_PENDING_ANALYSIS)
+        && promote_deferred_analysis(entry->pv->p2e_dirname) != 0)
+        log_notice("Can't promote deferred analysis of '%s'", entry->pv->p2e_dirname);
+
     GVariantBuilder builder;
     g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
 
@@ -271,7 +280,13 @@ GVariant *abrt_p2_entry_read_elements(AbrtP2Entry *entry,
                                                          &data,
                                                          &elem_type,
                                                          &fd);
-        if (r < 0)
+        if (r == -ENOENT && !(flags & ABRT_P2_ENTRY_READ_ALL_FD)
+            && (data = host_facts_load_from_dump_dir(dd, name)) != NULL)
+        {
+            log_debug("Element loaded from host facts snapshot: %s", name);
+            elem_type = CD_FLAG_TXT | CD_FLAG_ISNOTEDITABLE;
+        }
+        else if (r < 0)
         {
             if (r == -ENOENT)
                 log_debug("Element does not exist: %s", name);
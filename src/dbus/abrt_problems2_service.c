@@ -170,6 +170,8 @@ typedef struct
     unsigned p2srv_limit_new_problems_batch;
 
     AbrtP2Object *p2srv_p2_object;
+
+    struct abrt_problem_index *p2srv_index;
 } AbrtP2ServicePrivate;
 
 struct _AbrtP2Service
@@ -195,6 +197,9 @@ static struct user_info *abrt_p2_service_user_new(AbrtP2Service *service,
 
 static GDBusConnection *abrt_p2_service_dbus(AbrtP2Service *service);
 
+static void abrt_p2_service_index_entry(AbrtP2Service *service,
+            AbrtP2Entry *entry);
+
 /*
  * DBus object
  */
@@ -684,6 +689,9 @@ void abrt_p2_service_notify_entry_object(AbrtP2Service *service,
     AbrtP2Entry *entry = abrt_p2_object_get_node(obj);
     uid_t owner_uid = abrt_p2_entry_get_owner(entry, error);
 
+    /* Post-create has just finished */
+    abrt_p2_service_index_entry(service, entry);
+
     if (owner_uid >= 0)
     {
         GList *session_objects = problems2_object_type_get_all_objects(
@@ -724,6 +732,7 @@ void abrt_p2_service_notify_entry_object(AbrtP2Service *service,
 
 struct entry_object_save_elements_context
 {
+    AbrtP2Service *service;
     GDBusMethodInvocation *invocation;
     GVariant *elements;
 };
@@ -744,6 +753,7 @@ static void entry_object_save_elements_cb(GObject *source_object,
 
     if (error == NULL)
     {
+        abrt_p2_service_index_entry(context->service, entry);
         g_dbus_method_invocation_return_value(context->invocation, response);
     }
     else
@@ -855,6 +865,7 @@ static void entry_object_dbus_method_call(GDBusConnection *connection,
 
         struct entry_object_save_elements_context *context = xmalloc(sizeof(*context));
 
+        context->service = service;
         context->invocation = g_object_ref(invocation);
         context->elements = g_variant_get_child_value(parameters, 0);
 
@@ -889,6 +900,9 @@ static void entry_object_dbus_method_call(GDBusConnection *connection,
                                                  &error);
 
         g_variant_unref(elements);
+
+        if (error == NULL)
+            abrt_p2_service_index_entry(service, entry);
     }
     else
     {
@@ -1293,6 +1307,17 @@ static char *entry_object_dir_name_to_path(const char *dd_dirname)
     return xasprintf(ABRT_P2_PATH"/Entry/%s", hash_str);
 }
 
+/* Problems being processed are indexed once they are complete */
+static void abrt_p2_service_index_entry(AbrtP2Service *service,
+            AbrtP2Entry *entry)
+{
+    if (abrt_p2_entry_state(entry) != ABRT_P2_ENTRY_STATE_COMPLETE)
+        return;
+
+    problem_index_update(service->pv->p2srv_index,
+                         abrt_p2_entry_problem_id(entry));
+}
+
 static AbrtP2Object *entry_object_register_dump_dir(AbrtP2Service *service,
                 const char *dd_dirname,
                 GError **error)
@@ -1343,6 +1368,8 @@ AbrtP2Object *abrt_p2_service_register_entry(AbrtP2Service *service,
 
     user->problems++;
 
+    abrt_p2_service_index_entry(service, entry);
+
     return obj;
 }
 
@@ -1593,6 +1620,7 @@ int abrt_p2_service_remove_problem(AbrtP2Service *service,
         return ret;
     }
 
+    problem_index_remove(service->pv->p2srv_index, abrt_p2_entry_problem_id(entry));
     abrt_p2_object_destroy(obj);
     return 0;
 }
@@ -2079,6 +2107,101 @@ GVariant *abrt_p2_service_get_problems(AbrtP2Service *service,
     return  g_variant_new_tuple(retval_body, ARRAY_SIZE(retval_body));
 }
 
+GVariant *abrt_p2_service_search_problems(AbrtP2Service *service,
+                uid_t caller_uid,
+                const char *query,
+                GVariant *options,
+                GError **error)
+{
+    GList *dirnames = NULL;
+    if (problem_index_search(service->pv->p2srv_index, query, caller_uid, &dirnames) != 0)
+    {
+        g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                    "Invalid search query: '%s'", query);
+        return NULL;
+    }
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("ao"));
+
+    for (GList *iter = dirnames; iter != NULL; iter = g_list_next(iter))
+    {
+        /* The index can remember problems removed behind our back */
+        char *entry_path = entry_object_dir_name_to_path(iter->data);
+        AbrtP2Object *entry_obj = problems2_object_type_get_object(&(service->pv->p2srv_p2_entry_type),
+                                                                   entry_path);
+        AbrtP2Entry *entry = entry_obj != NULL ? abrt_p2_object_get_node(entry_obj) : NULL;
+        /* The index may be stale, the same rules as GetProblems apply */
+        if (entry != NULL
+            && abrt_p2_entry_state(entry) == ABRT_P2_ENTRY_STATE_COMPLETE
+            && abrt_p2_entry_accessible_by_uid(entry, caller_uid, NULL) == 0)
+        {
+            log_debug("Adding entry: %s", entry_path);
+            g_variant_builder_add(&builder, "o", entry_path);
+        }
+
+        free(entry_path);
+    }
+
+    list_free_with_free(dirnames);
+
+    GVariant *retval_body[1];
+    retval_body[0] = g_variant_builder_end(&builder);
+    return  g_variant_new_tuple(retval_body, ARRAY_SIZE(retval_body));
+}
+
+GVariant *abrt_p2_service_get_clusters(AbrtP2Service *service,
+                uid_t caller_uid,
+                GVariant *options,
+                GError **error)
+{
+    GHashTable *clusters = problem_index_get_clusters(service->pv->p2srv_index, caller_uid);
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sao}"));
+
+    GHashTableIter iter;
+    const char *hash;
+    GList *dirnames;
+    g_hash_table_iter_init(&iter, clusters);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&hash, (gpointer *)&dirnames))
+    {
+        GVariantBuilder entries;
+        g_variant_builder_init(&entries, G_VARIANT_TYPE("ao"));
+
+        unsigned count = 0;
+        for (GList *dn = dirnames; dn != NULL; dn = g_list_next(dn))
+        {
+            char *entry_path = entry_object_dir_name_to_path(dn->data);
+            AbrtP2Object *entry_obj = problems2_object_type_get_object(&(service->pv->p2srv_p2_entry_type),
+                                                                       entry_path);
+            if (entry_obj != NULL
+                && abrt_p2_entry_state(abrt_p2_object_get_node(entry_obj)) == ABRT_P2_ENTRY_STATE_COMPLETE)
+            {
+                g_variant_builder_add(&entries, "o", entry_path);
+                ++count;
+            }
+
+            free(entry_path);
+        }
+
+        /* The index can remember problems removed behind our back */
+        if (count < 2)
+        {
+            g_variant_builder_clear(&entries);
+            continue;
+        }
+
+        log_debug("Adding cluster: %s (%u problems)", hash, count);
+        g_variant_builder_add(&builder, "{sao}", hash, &entries);
+    }
+
+    g_hash_table_destroy(clusters);
+
+    GVariant *retval_body[1];
+    retval_body[0] = g_variant_builder_end(&builder);
+    return  g_variant_new_tuple(retval_body, ARRAY_SIZE(retval_body));
+}
 
 GVariant *abrt_p2_service_delete_problems(AbrtP2Service *service,
                 GVariant *entries,
@@ -2181,6 +2304,31 @@ static void p2_object_dbus_method_call(GDBusConnection *connection,
         g_variant_unref(options_param);
         g_variant_unref(flags_param);
     }
+    else if (strcmp("SearchProblems", method_name) == 0)
+    {
+        const char *query;
+        g_variant_get_child(parameters, 0, "&s", &query);
+        GVariant *options_param = g_variant_get_child_value(parameters, 1);
+
+        response = abrt_p2_service_search_problems(service,
+                                                   caller_uid,
+                                                   query,
+                                                   options_param,
+                                                   &error);
+
+        g_variant_unref(options_param);
+    }
+    else if (strcmp("GetClusters", method_name) == 0)
+    {
+        GVariant *options_param = g_variant_get_child_value(parameters, 0);
+
+        response = abrt_p2_service_get_clusters(service,
+                                                caller_uid,
+                                                options_param,
+                                                &error);
+
+        g_variant_unref(options_param);
+    }
     else if (strcmp("GetProblemData", method_name) == 0)
     {
         /* Parameter tuple is (0) */
@@ -2231,6 +2379,16 @@ static void abrt_p2_service_private_destroy(AbrtP2ServicePrivate *pv)
         pv->p2srv_connected_users = NULL;
     }
 
+    if (pv->p2srv_index != NULL)
+    {
+        /* Problems indexed since start up are re-read next time otherwise */
+        if (pv->p2srv_dbus != NULL)
+            problem_index_save(pv->p2srv_index, NULL);
+
+        problem_index_free(pv->p2srv_index);
+        pv->p2srv_index = NULL;
+    }
+
     problems2_object_type_destroy(&(pv->p2srv_p2_type));
     problems2_object_type_destroy(&(pv->p2srv_p2_session_type));
     problems2_object_type_destroy(&(pv->p2srv_p2_entry_type));
@@ -2348,6 +2506,8 @@ static int abrt_p2_service_private_init(AbrtP2ServicePrivate *pv,
                                                       NULL,
                                                       (GDestroyNotify)user_info_free);
 
+    pv->p2srv_index = problem_index_new();
+
     if (g_polkit_authority != NULL)
     {
         ++g_polkit_authority_refs;
@@ -2562,7 +2722,14 @@ int abrt_p2_service_register_objects(AbrtP2Service *service, GDBusConnection *co
     args.service = service;
     args.error = error;
 
+    /* Registering of entries updates the index, problems which were not
+     * registered no longer exist */
+    problem_index_load(service->pv->p2srv_index, NULL);
+    problem_index_begin_sync(service->pv->p2srv_index);
+
     for_each_problem_in_dir(g_settings_dump_location, (uid_t)-1, bridge_register_dump_dir_entry_node, &args);
+    if (*args.error == NULL && g_settings_cold_dump_location != NULL)
+        for_each_problem_in_dir(g_settings_cold_dump_location, (uid_t)-1, bridge_register_dump_dir_entry_node, &args);
 
     if (*args.error != NULL)
     {
@@ -2570,6 +2737,11 @@ int abrt_p2_service_register_objects(AbrtP2Service *service, GDBusConnection *co
         return -1;
     }
 
+    const unsigned removed = problem_index_end_sync(service->pv->p2srv_index);
+    log_info("Search index: %u problems, %u removed",
+             problem_index_size(service->pv->p2srv_index), removed);
+    problem_index_save(service->pv->p2srv_index, NULL);
+
     GError *local_error = NULL;
     service->pv->p2srv_proxy_dbus = g_dbus_proxy_new_sync(connection,
                                                           G_DBUS_PROXY_FLAGS_NONE,
@@ -149,6 +149,17 @@ GVariant *abrt_p2_service_get_problems(AbrtP2Service *service,
             GVariant *options,
             GError **error);
 
+GVariant *abrt_p2_service_search_problems(AbrtP2Service *service,
+            uid_t caller_uid,
+            const char *query,
+            GVariant *options,
+            GError **error);
+
+GVariant *abrt_p2_service_get_clusters(AbrtP2Service *service,
+            uid_t caller_uid,
+            GVariant *options,
+            GError **error);
+
 GVariant *abrt_p2_service_delete_problems(AbrtP2Service *service,
             GVariant *entries,
             uid_t caller_uid,
@@ -0,0 +1,302 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    libabrt-crash is loaded into arbitrary programs, it must not depend on
+    anything but libc. The crash handler must use only async-signal-safe
+    functions: the heap, the stdio locks and the dynamic linker can be in
+    any state when the process crashes.
+*/
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "abrt-crash.h"
+
+#define HOOK_PATH LIBEXEC_DIR"/abrt-hook-inprocess"
+/* Overrides HOOK_PATH, the tests need it */
+#define HOOK_PATH_ENV "ABRT_CRASH_HOOK"
+
+/* Exit codes of abrt-hook-inprocess */
+#define HOOK_SUBMITTED           0
+#define HOOK_SUBMITTED_KEEP_CORE 2
+
+/* Enough for the handler, it doesn't call anything deep */
+#define ALT_STACK_SIZE (64 * 1024)
+
+static const int s_signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+#define SIGNAL_COUNT (sizeof(s_signals) / sizeof(s_signals[0]))
+
+static struct sigaction s_old_actions[SIGNAL_COUNT];
+static stack_t s_alt_stack;
+static stack_t s_old_alt_stack;
+static const char *s_hook_path = HOOK_PATH;
+static bool s_installed;
+static int s_crashing;
+/* The last reported fault, a handler of the program that returns from it
+ * gets it again */
+static int s_reported_signal;
+static pid_t s_reported_tid;
+static void *s_reported_addr;
+
+/* snprintf is not async-signal-safe */
+static char *format_number(char *buf, size_t size, unsigned long value)
+{
+    char *p = buf + size;
+    *--p = '\0';
+    do
+        *--p = '0' + value % 10;
+    while ((value /= 10) != 0 && p > buf);
+    return p;
+}
+
+/* glibc's fork() runs the atfork handlers, which take the malloc locks. The
+ * process might have crashed while holding them. */
+static pid_t raw_fork(void)
+{
+#ifdef SYS_fork
+    return syscall(SYS_fork);
+#else
+    return syscall(SYS_clone, SIGCHLD, 0, 0, 0, 0);
+#endif
+}
+
+/* Runs abrt-hook-inprocess and returns its exit code, -1 on errors */
+static int run_hook(int signal_no, pid_t tid)
+{
+    char pid_buf[sizeof(long)*3 + 1];
+    char tid_buf[sizeof(long)*3 + 1];
+    char signal_buf[sizeof(int)*3 + 1];
+    char *argv[] = {
+        (char *)s_hook_path,
+        format_number(pid_buf, sizeof(pid_buf), getpid()),
+        format_number(tid_buf, sizeof(tid_buf), tid),
+        format_number(signal_buf, sizeof(signal_buf), signal_no),
+        NULL
+    };
+    /* Don't pass LD_PRELOAD and the like to the hook */
+    char *envp[] = { NULL };
+
+    /* The hook may trace us only after PR_SET_PTRACER (Yama), it waits until
+     * the pipe is closed */
+    int sync_fds[2];
+    if (pipe(sync_fds) != 0)
+        return -1;
+
+    const pid_t hook = raw_fork();
+    if (hook == 0)
+    {
+        close(sync_fds[1]);
+        char c;
+        while (read(sync_fds[0], &c, 1) < 0 && errno == EINTR)
+            continue;
+        close(sync_fds[0]);
+
+        sigset_t set;
+        sigemptyset(&set);
+        sigprocmask(SIG_SETMASK, &set, NULL);
+
+        execve(s_hook_path, argv, envp);
+        _exit(127);
+    }
+
+    if (hook > 0)
+        prctl(PR_SET_PTRACER, hook, 0, 0, 0);
+    close(sync_fds[0]);
+    close(sync_fds[1]);
+    if (hook < 0)
+        return -1;
+
+    int status;
+    while (waitpid(hook, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static const struct sigaction *old_action(int signal_no)
+{
+    for (unsigned i = 0; i < SIGNAL_COUNT; ++i)
+        if (s_signals[i] == signal_no)
+            return &s_old_actions[i];
+    return NULL;
+}
+
+/* Faults happen again when the handler returns, signals sent by kill() or
+ * abort() must be sent again with the same information. The signal is
+ * blocked until the handler returns. */
+static void resend_signal(int signal_no, pid_t tid, siginfo_t *info)
+{
+    if (info->si_code <= 0
+        && syscall(SYS_rt_tgsigqueueinfo, getpid(), tid, signal_no, info) != 0)
+        syscall(SYS_tgkill, getpid(), tid, signal_no);
+}
+
+static void set_default_action(int signal_no)
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(signal_no, &action, NULL);
+}
+
+/* Calls the program's handler with the signal mask the kernel would set */
+static void call_old_handler(const struct sigaction *old, int signal_no, siginfo_t *info, void *context)
+{
+    if (old->sa_flags & SA_RESETHAND)
+        set_default_action(signal_no);
+
+    sigset_t mask = ((ucontext_t *)context)->uc_sigmask;
+    sigorset(&mask, &mask, &old->sa_mask);
+    if (!(old->sa_flags & SA_NODEFER))
+        sigaddset(&mask, signal_no);
+
+    sigset_t saved_mask;
+    sigprocmask(SIG_SETMASK, &mask, &saved_mask);
+    if (old->sa_flags & SA_SIGINFO)
+        old->sa_sigaction(signal_no, info, context);
+    else
+        old->sa_handler(signal_no);
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+}
+
+static void crash_handler(int signal_no, siginfo_t *info, void *context)
+{
+    const int saved_errno = errno;
+    const pid_t tid = syscall(SYS_gettid);
+
+    /* The first crashed thread reports the crash, the others wait until it
+     * is done and get their signals again then */
+    if (__atomic_exchange_n(&s_crashing, 1, __ATOMIC_SEQ_CST) != 0)
+    {
+        const struct timespec delay = { 0, 10 * 1000 * 1000 };
+        while (__atomic_load_n(&s_crashing, __ATOMIC_SEQ_CST) != 0)
+            nanosleep(&delay, NULL);
+        resend_signal(signal_no, tid, info);
+        errno = saved_errno;
+        return;
+    }
+
+    /* The kernel kills the process on ignored faults and abort() resets
+     * SIG_IGN, an ignored signal is handled as the default one */
+    const struct sigaction *old = old_action(signal_no);
+    const bool chained = old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN;
+
+    if (signal_no != s_reported_signal || tid != s_reported_tid || info->si_addr != s_reported_addr)
+    {
+        const int r = run_hook(signal_no, tid);
+        /* Reported, the core would be a duplicate. A handler of the program
+         * may still let the process live. */
+        if (r == HOOK_SUBMITTED && !chained)
+            prctl(PR_SET_DUMPABLE, 0, 0, 0, 0);
+
+        s_reported_signal = signal_no;
+        s_reported_tid = tid;
+        s_reported_addr = info->si_addr;
+    }
+
+    if (!chained)
+    {
+        /* The default action kills the process when we return */
+        set_default_action(signal_no);
+        resend_signal(signal_no, tid, info);
+        __atomic_store_n(&s_crashing, 0, __ATOMIC_SEQ_CST);
+        errno = saved_errno;
+        return;
+    }
+
+    /* The program's handler may leave by longjmp() or crash itself. Our
+     * handler stays installed for the next crashes. */
+    __atomic_store_n(&s_crashing, 0, __ATOMIC_SEQ_CST);
+    errno = saved_errno;
+    call_old_handler(old, signal_no, info, context);
+}
+
+int abrt_crash_install(void)
+{
+    if (s_installed)
+        return 0;
+
+    /* Not in the handler, getenv() is not async-signal-safe */
+    const char *hook_path = secure_getenv(HOOK_PATH_ENV);
+    if (hook_path != NULL && hook_path[0] == '/')
+        s_hook_path = hook_path;
+
+    /* The handler must run on stack overflows too */
+    void *stack = mmap(NULL, ALT_STACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED)
+        return -errno;
+
+    s_alt_stack.ss_sp = stack;
+    s_alt_stack.ss_size = ALT_STACK_SIZE;
+    s_alt_stack.ss_flags = 0;
+    if (sigaltstack(&s_alt_stack, &s_old_alt_stack) != 0)
+    {
+        const int err = errno;
+        munmap(stack, ALT_STACK_SIZE);
+        return -err;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = crash_handler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    /* A crash in the handler kills the process */
+    for (unsigned i = 0; i < SIGNAL_COUNT; ++i)
+        sigaddset(&action.sa_mask, s_signals[i]);
+
+    for (unsigned i = 0; i < SIGNAL_COUNT; ++i)
+        sigaction(s_signals[i], &action, &s_old_actions[i]);
+
+    s_installed = true;
+    return 0;
+}
+
+void abrt_crash_uninstall(void)
+{
+    if (!s_installed)
+        return;
+
+    for (unsigned i = 0; i < SIGNAL_COUNT; ++i)
+        sigaction(s_signals[i], &s_old_actions[i], NULL);
+
+    sigaltstack(&s_old_alt_stack, NULL);
+    munmap(s_alt_stack.ss_sp, s_alt_stack.ss_size);
+    s_installed = false;
+}
+
+/* LD_PRELOAD=libabrt-crash.so installs the handlers to any program */
+static void __attribute__((constructor)) install_preloaded(void)
+{
+    const char *preload = getenv("LD_PRELOAD");
+    if (preload != NULL && strstr(preload, "libabrt-crash.so") != NULL)
+        abrt_crash_install();
+}
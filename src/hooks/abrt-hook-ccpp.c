@@ -28,8 +28,13 @@ typedef char *security_context_t;
 #endif
 
 #include <sys/resource.h>
+#include <poll.h>
 
 #include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
 
 /* capabilities */
 #include <sys/capability.h>
@@ -325,8 +330,12 @@ static int close_user_core(int user_core_fd, off_t core_size)
     return 0;
 }
 
+/* The core is written behind, a large core doesn't fill the page cache */
 static ssize_t splice_entire_per_partes(int in_fd, int out_fd, size_t size_limit)
 {
+    struct abrt_write_behind wb;
+    write_behind_init(&wb, out_fd);
+
     size_t bytes = 0;
     size_t soft_limit = KERNEL_PIPE_BUFFER_SIZE;
     while (bytes < size_limit)
@@ -340,12 +349,14 @@ static ssize_t splice_entire_per_partes(int in_fd, int out_fd, size_t size_limit
             return copied;
 
         bytes += copied;
+        write_behind_wrote(&wb, copied);
 
         /* Check EOF. */
         if (copied == 0)
             break;
     }
 
+    write_behind_finish(&wb);
     return bytes;
 }
 
@@ -443,6 +454,427 @@ static int test_configuration(bool setting_SaveFullCore, bool setting_CreateCore
     return 0;
 }
 
+/* Kernel coredump socket mode
+ *
+ * Since Linux 6.16 core_pattern can be "@/path/to/socket". The kernel
+ * connects to the socket and streams the core file through it. The peer of
+ * the connection is the crashing process, thus SO_PEERPIDFD gives us a pidfd
+ * which allows race-free access to /proc/<pid> and PIDFD_GET_INFO returns
+ * the signal which caused the dump.
+ *
+ * In this mode abrt-hook-ccpp is a long-lived collector: configuration is
+ * loaded once and every connection is handled in a forked child which then
+ * continues through the usual code path as if it was spawned by the kernel
+ * with the core_pattern arguments.
+ */
+#ifndef SO_PEERPIDFD
+#define SO_PEERPIDFD 77
+#endif
+
+#define ABRT_PIDFD_INFO_COREDUMP            (1UL << 4)
+#define ABRT_PIDFD_INFO_SUPPORTED_MASK      (1UL << 5)
+#define ABRT_PIDFD_INFO_COREDUMP_SIGNAL     (1UL << 6)
+#define ABRT_PIDFD_COREDUMPED               (1U << 0)
+
+/* struct pidfd_info from <linux/pidfd.h>, kernel headers on build machines
+ * are often older than the running kernel */
+struct abrt_pidfd_info {
+    uint64_t mask;
+    uint64_t cgroupid;
+    uint32_t pid;
+    uint32_t tgid;
+    uint32_t ppid;
+    uint32_t ruid;
+    uint32_t rgid;
+    uint32_t euid;
+    uint32_t egid;
+    uint32_t suid;
+    uint32_t sgid;
+    uint32_t fsuid;
+    uint32_t fsgid;
+    int32_t  exit_code;
+    uint32_t coredump_mask;
+    uint32_t coredump_signal;
+    uint64_t supported_mask;
+};
+
+#define ABRT_PIDFD_GET_INFO _IOWR(0xFF, 11, struct abrt_pidfd_info)
+
+/* /proc/<pid> of the crashing process opened by the socket collector */
+static int s_socket_pid_proc_fd = -1;
+
+static int pidfd_get_info(int pidfd, uint64_t mask, struct abrt_pidfd_info *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->mask = mask;
+    return ioctl(pidfd, ABRT_PIDFD_GET_INFO, info);
+}
+
+/* Returns true if the running kernel supports everything the socket mode
+ * needs. The PIDFD_INFO_COREDUMP_SIGNAL flag was added after the coredump
+ * socket, so it is sufficient to check it.
+ */
+static bool kernel_supports_coredump_socket(void)
+{
+#ifdef SYS_pidfd_open
+    const int pidfd = syscall(SYS_pidfd_open, getpid(), 0);
+    if (pidfd < 0)
+        return false;
+
+    struct abrt_pidfd_info info;
+    const int r = pidfd_get_info(pidfd, ABRT_PIDFD_INFO_SUPPORTED_MASK, &info);
+    close(pidfd);
+
+    return r == 0
+        && (info.mask & ABRT_PIDFD_INFO_SUPPORTED_MASK)
+        && (info.supported_mask & ABRT_PIDFD_INFO_COREDUMP_SIGNAL);
+#else
+    return false;
+#endif
+}
+
+/* Implements '--socket-mode' used by abrt-install-ccpp-hook to select
+ * core_pattern. Returns 0 if the socket mode should be used.
+ */
+static int test_socket_mode(const char *setting_KernelCoredumpSocket,
+                            bool setting_SaveFullCore, bool setting_CreateCoreBacktrace)
+{
+    if (strcmp(setting_KernelCoredumpSocket, "auto") != 0
+        && !string_to_bool(setting_KernelCoredumpSocket))
+        return 1;
+
+    if (!kernel_supports_coredump_socket())
+    {
+        if (strcmp(setting_KernelCoredumpSocket, "auto") != 0)
+            error_msg("The kernel does not support coredump socket, falling back to the usermode helper");
+        return 1;
+    }
+
+    /* Without the core file the dump time core backtrace is all we get */
+    if (!setting_SaveFullCore)
+    {
+#ifdef ENABLE_DUMP_TIME_UNWIND
+        if (!setting_CreateCoreBacktrace)
+#endif
+        {
+            if (strcmp(setting_KernelCoredumpSocket, "auto") != 0)
+                error_msg("SaveFullCore is disabled and core backtrace can't be generated at dump time, falling back to the usermode helper");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Returns the last value of the NSpid: line, i.e. PID in the process's own
+ * PID namespace (%p). */
+static char *get_ns_pid(const char *proc_pid_status)
+{
+    const char *line = strstr(proc_pid_status, "\nNSpid:");
+    if (line == NULL)
+        return NULL;
+
+    line += strlen("\nNSpid:");
+    const char *end = strchrnul(line, '\n');
+    const char *last = end;
+    while (last > line && isspace(last[-1]))
+        --last;
+    const char *first = last;
+    while (first > line && isdigit(first[-1]))
+        --first;
+
+    return first == last ? NULL : xstrndup(first, last - first);
+}
+
+/* PF_DUMPCORE from <linux/sched.h>, set on the thread writing the core */
+#define ABRT_PF_DUMPCORE 0x00000200
+
+/* The kernel doesn't tell us the crash thread in the socket mode. The thread
+ * which received the fatal signal is the one dumping the core, the others
+ * wait for it to finish. Returns the thread group leader if the dumping
+ * thread can't be found.
+ */
+static pid_t find_dumping_thread(int pid_proc_fd, pid_t pid)
+{
+    const int task_fd = openat(pid_proc_fd, "task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = task_fd < 0 ? NULL : fdopendir(task_fd);
+    if (dir == NULL)
+    {
+        perror_msg("Can't list threads of %d", (int)pid);
+        if (task_fd >= 0)
+            close(task_fd);
+        return pid;
+    }
+
+    pid_t tid = pid;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        char path[sizeof("/stat") + sizeof(long)*3];
+        if (snprintf(path, sizeof(path), "%s/stat", dent->d_name) >= sizeof(path))
+            continue;
+
+        const int fd = openat(dirfd(dir), path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        char buf[1024];
+        const ssize_t r = full_read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (r <= 0)
+            continue;
+        buf[r] = '\0';
+
+        /* comm may contain spaces and parentheses, the fields state, ppid,
+         * pgrp, session, tty_nr, tpgid and flags follow the last ')' */
+        const char *fields = strrchr(buf, ')');
+        unsigned long flags;
+        if (fields != NULL
+            && sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %lu", &flags) == 1
+            && (flags & ABRT_PF_DUMPCORE))
+        {
+            tid = (pid_t)strtol(dent->d_name, NULL, 10);
+            break;
+        }
+    }
+    closedir(dir);
+
+    log_debug("Crash thread of %d is %d", (int)pid, (int)tid);
+    return tid;
+}
+
+/* Pumps the core from the socket into a pipe because the rest of the hook
+ * uses tee() and splice() which require a pipe on STDIN.
+ *
+ * The child keeps the socket open until it exits, because the kernel does
+ * not wipe out the crashing process until the connection is closed and the
+ * hook reads /proc/<pid> after the core is written.
+ */
+static void pipe_core_from_socket(int sock_fd)
+{
+    int pfds[2];
+    xpipe(pfds);
+
+    pid_t pid = xfork();
+    if (pid == 0)
+    {
+        close(pfds[0]);
+        for (;;)
+        {
+            const ssize_t r = splice(sock_fd, NULL, pfds[1], NULL, KERNEL_PIPE_BUFFER_SIZE, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (r == 0)
+                break;
+            if (r < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                perror_msg("Failed to read core dump from socket");
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+
+    close(pfds[1]);
+    xmove_fd(pfds[0], STDIN_FILENO);
+}
+
+/* Opens /proc/<pid> of the process dumping its core through the pidfd.
+ * Returns the PID or -1 if the pidfd does not belong to a dumping process. */
+static pid_t open_dumping_process(int pidfd, struct abrt_pidfd_info *info)
+{
+    if (pidfd_get_info(pidfd, ABRT_PIDFD_INFO_COREDUMP | ABRT_PIDFD_INFO_COREDUMP_SIGNAL, info) != 0)
+    {
+        perror_msg("Can't get information about the crashing process");
+        return -1;
+    }
+
+    /* Only the kernel connects on behalf of a dumping process */
+    if (!(info->mask & ABRT_PIDFD_INFO_COREDUMP)
+        || !(info->coredump_mask & ABRT_PIDFD_COREDUMPED)
+        || !(info->mask & ABRT_PIDFD_INFO_COREDUMP_SIGNAL))
+    {
+        error_msg("Process %d is not dumping its core", (int)info->tgid);
+        return -1;
+    }
+
+    const pid_t pid = info->tgid;
+    s_socket_pid_proc_fd = open_proc_pid_dir(pid);
+    if (s_socket_pid_proc_fd < 0)
+    {
+        perror_msg("Can't open /proc/%d", (int)pid);
+        return -1;
+    }
+
+    /* The pidfd pins the process's struct pid, so if the process is still
+     * alive, the opened /proc/<pid> directory belongs to it and not to
+     * a process which re-used the PID. */
+    if (syscall(SYS_pidfd_send_signal, pidfd, 0, NULL, 0) != 0)
+    {
+        perror_msg("Process %d is gone", (int)pid);
+        return -1;
+    }
+
+    return pid;
+}
+
+/* Runs in the forked child. Returns NULL if the connection is not a core
+ * dump we can process. */
+static char **prepare_socket_crash(int sock_fd)
+{
+    int pidfd = -1;
+    socklen_t len = sizeof(pidfd);
+    if (getsockopt(sock_fd, SOL_SOCKET, SO_PEERPIDFD, &pidfd, &len) != 0)
+    {
+        perror_msg("Can't get pidfd of the crashing process");
+        return NULL;
+    }
+
+    struct abrt_pidfd_info info;
+    const pid_t pid = open_dumping_process(pidfd, &info);
+    close(pidfd);
+    if (pid < 0)
+        return NULL;
+
+    const int status_fd = openat(s_socket_pid_proc_fd, "status", O_RDONLY | O_CLOEXEC);
+    char *proc_pid_status = status_fd < 0 ? NULL : xmalloc_read(status_fd, /*maxsz:*/ NULL);
+    if (status_fd >= 0)
+        close(status_fd);
+    char *ns_pid = proc_pid_status ? get_ns_pid(proc_pid_status) : NULL;
+    free(proc_pid_status);
+
+    struct rlimit rl = { .rlim_cur = RLIM_INFINITY };
+    if (prlimit(pid, RLIMIT_CORE, NULL, &rl) != 0)
+        perror_msg("Can't get RLIMIT_CORE of %d", (int)pid);
+
+    pipe_core_from_socket(sock_fd);
+
+    const pid_t tid = find_dumping_thread(s_socket_pid_proc_fd, pid);
+
+    /* Same order as percent_specifiers[] */
+    static char *percent_values[10];
+    percent_values[1] = xasprintf("%u", info.coredump_signal);
+    percent_values[2] = rl.rlim_cur == RLIM_INFINITY ? xstrdup("-1") : xasprintf("%llu", (unsigned long long)rl.rlim_cur);
+    percent_values[3] = ns_pid ? ns_pid : xasprintf("%d", (int)pid);
+    percent_values[4] = xasprintf("%u", info.ruid);
+    percent_values[5] = xasprintf("%u", info.rgid);
+    percent_values[6] = xasprintf("%lld", (long long)time(NULL));
+    percent_values[7] = xasprintf("%d", (int)pid);
+    percent_values[8] = xasprintf("%d", (int)tid);
+
+    return percent_values;
+}
+
+static const char *s_socket_path;
+/* Number of running connection handlers */
+static volatile sig_atomic_t s_socket_children;
+
+static void socket_collector_exit(int signo)
+{
+    /* Let abrt-install-ccpp-hook fall back to the usermode helper */
+    unlink(s_socket_path);
+    _exit(0);
+}
+
+/* Reaps handlers as soon as they exit, not only when the next core comes */
+static void socket_collector_reap(int signo)
+{
+    const int saved_errno = errno;
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+        --s_socket_children;
+    errno = saved_errno;
+}
+
+/* Accepts connections from the kernel and forks a child for each of them.
+ * Returns in the child only, with argv for the rest of the hook.
+ */
+static char **serve_coredump_socket(const char *socket_path, unsigned max_connections)
+{
+    int sock_fd = xsocket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+        error_msg_and_die("Socket path '%s' is too long", socket_path);
+    strcpy(addr.sun_path, socket_path);
+
+    unlink(socket_path);
+    /* Only the kernel (root) connects to the socket */
+    const mode_t old_umask = umask(0077);
+    xbind(sock_fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_umask);
+    xlisten(sock_fd, MAX(max_connections, 16));
+
+    s_socket_path = socket_path;
+
+    signal(SIGTERM, socket_collector_exit);
+    signal(SIGINT, socket_collector_exit);
+
+    log_notice("Listening for core dumps on '%s'", socket_path);
+
+    /* SIGCHLD is delivered only while waiting for a connection or for
+     * a free handler slot; no SA_RESTART, accept() returns on EINTR */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = socket_collector_reap;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+
+    sigset_t chld_set, orig_set;
+    sigemptyset(&chld_set);
+    sigaddset(&chld_set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld_set, &orig_set);
+
+    for (;;)
+    {
+        /* Bounded concurrency: a crash storm must not fork-bomb the system,
+         * waiting connections stay in the listen queue */
+        while ((unsigned)s_socket_children >= max_connections)
+            sigsuspend(&orig_set);
+
+        sigprocmask(SIG_SETMASK, &orig_set, NULL);
+        const int conn_fd = accept4(sock_fd, NULL, NULL, SOCK_CLOEXEC);
+        const int accept_errno = errno;
+        sigprocmask(SIG_BLOCK, &chld_set, NULL);
+        if (conn_fd < 0)
+        {
+            if (accept_errno != EINTR)
+                perror_msg("accept");
+            continue;
+        }
+
+        const pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror_msg("fork");
+            close(conn_fd);
+            continue;
+        }
+
+        if (pid == 0)
+        {
+            close(sock_fd);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGCHLD, SIG_DFL);
+            sigprocmask(SIG_SETMASK, &orig_set, NULL);
+
+            char **percent_values = prepare_socket_crash(conn_fd);
+            if (percent_values == NULL)
+                _exit(1);
+
+            return percent_values;
+        }
+
+        close(conn_fd);
+        ++s_socket_children;
+    }
+}
+
 static int save_crashing_binary(pid_t pid, struct dump_dir *dd)
 {
     char buf[sizeof("/proc/%lu/exe") + sizeof(long)*3];
@@ -531,174 +963,293 @@ static void dump_abrt_process(pid_t pid, const char *executable)
     free(path);
 }
 
-static ssize_t splice_full(int in_fd, int out_fd, size_t size)
+/* Creation of the compat core
+ *
+ * The core is read from the kernel and written only once. The ABRT core
+ * file gets at most the ABRT limit, the part of the core over the limit the
+ * user core may have is written straight to the user core: the kernel waits
+ * until the whole core is read, it can't be left for later. The beginning
+ * of the user core is then made from the ABRT core: if both files are on a
+ * file system supporting reflinks (btrfs, XFS), the user core shares the
+ * data blocks with the ABRT core and nothing is written. Otherwise the data
+ * are copied after the crashed process is released.
+ *
+ * The user core fd was opened by open_user_core() with the right owner and
+ * SELinux context. We must not read from it because that operation might be
+ * refused by OS.
+ */
+static int clone_user_core(int abrt_core_fd, int user_core_fd, off_t prefix_size, off_t user_core_size)
 {
-    ssize_t total = 0;
-    while (size != 0)
+    /* The ABRT core is whole MiBs long if the user core has more */
+    if (clone_core_prefix(abrt_core_fd, user_core_fd, prefix_size, user_core_size) != 0)
     {
-        const ssize_t b = splice(in_fd, NULL, out_fd, NULL, size, 0);
-        if (b < 0)
-            return b;
-
-        if (b == 0)
-            break;
-
-        total += b;
-        size -= b;
+        log_notice("Can't clone the core to '%s' at '%s': %s", core_basename, user_pwd, strerror(errno));
+        return -1;
     }
 
-    return total;
+    return 0;
 }
 
-static size_t xsplice_full(int in_fd, int out_fd, size_t size)
+/* Returns the size of the user core or -1 */
+static off_t copy_user_core(int abrt_core_fd, int user_core_fd, off_t prefix_size, off_t user_core_size)
 {
-    const ssize_t r = splice_full(in_fd, out_fd, size);
+    const off_t r = copy_core_prefix(abrt_core_fd, user_core_fd, prefix_size, user_core_size);
     if (r < 0)
-        perror_msg_and_die("Failed to write core dump to file");
-    return (size_t)r;
+        perror_msg("Can't copy the core to '%s' at '%s'", core_basename, user_pwd);
+    return r;
 }
 
-static void pipe_close(int *pfds)
+enum create_core_backtrace_status
 {
-    close(pfds[0]);
-    close(pfds[1]);
-    pfds[0] = pfds[1] = -1;
-}
+    CB_DISABLED     = 0x1,
+    CB_STDIN_CLOSED = 0x2,
+    CB_SUCCESSFUL   = 0x4,
+};
 
-enum dump_core_files_ret_flags {
-    DUMP_ABRT_CORE_FAILED  = 0x0001,
-    DUMP_USER_CORE_FAILED  = 0x0100,
+/* Limits of CoreBacktraceAllThreads */
+struct core_backtrace_threads
+{
+    unsigned max_threads;
+    unsigned max_frames;
+    unsigned workers;
 };
 
-/* Optimized creation of two core files - ABRT and CWD
- *
- * The simplest optimization is to avoid the need to copy data to user space.
- * In that case we cannot read data once and write them twice as we do with
- * read/write approach because there is no syscall forwarding data from a
- * single source fd to several destination fds (one might claim that there is
- * tee() function but such a solution is suboptimal from our perspective).
- *
- * So the function first create ABRT core file and then creates user core file.
- * If ABRT limit made the ABRT core to be smaller than allowed user core size,
- * then the function reads more data from STDIN and appends them to the user
- * core file.
- *
- * We must not read from the user core fd because that operation might be
- * refused by OS.
+#ifdef ENABLE_DUMP_TIME_UNWIND
+static void drop_unwinder_privileges(uid_t uid, uid_t fsuid, gid_t gid, gid_t fsgid)
+{
+    const gid_t g = gid == 0 ? fsgid : gid;
+    if (setresgid(g, g, g) == -1)
+        perror_msg_and_die("Can't change process group id of '%d' user", gid);
+
+    const uid_t u = uid == 0 ? fsuid : uid;
+    if (setresuid(u, u, u) == -1)
+        perror_msg_and_die("Can't change process user id of '%d' user", uid);
+
+    log_debug("Running core_backtrace under %d:%d", u, g);
+
+    /* Get capability state of the calling process  */
+    cap_t caps = cap_get_proc();
+    if (!caps)
+        perror_msg_and_die("Can't get capability state of process PID: %d", getpid());
+
+    /* Array must be filled with CAP_* constants */
+    cap_value_t cap_list[CAP_LAST_CAP+1];
+    for (cap_value_t cap = CAP_CHOWN; cap <= CAP_LAST_CAP; cap++)
+        cap_list[cap] = cap;
+
+    if (cap_set_flag(caps, CAP_PERMITTED, CAP_LAST_CAP, cap_list, CAP_CLEAR) == -1)
+        perror_msg_and_die("Failed to clear all capabilities in permitted set");
+
+    if (cap_set_flag(caps, CAP_EFFECTIVE, CAP_LAST_CAP, cap_list, CAP_CLEAR) == -1)
+        perror_msg_and_die("Failed to clear all capabilities in effective set");
+
+    if (cap_set_flag(caps, CAP_INHERITABLE, CAP_LAST_CAP, cap_list, CAP_CLEAR) == -1)
+        perror_msg_and_die("Failed to clear all capabilities in inherited set");
+
+    if (cap_set_proc(caps) == -1)
+        perror_msg_and_die("Failed to assign cleared capabilities to process");
+
+    if (cap_free(caps) == -1)
+        perror_msg_and_die("Error releasing capability state resource! PID: %d", getpid());
+}
+
+/* Returns malloced array of at most max_threads thread ids of the crashed
+ * process, the crash thread is the first one */
+static pid_t *list_crashed_threads(pid_t tid, unsigned max_threads, unsigned *count)
+{
+    pid_t *tids = xmalloc(sizeof(*tids) * max_threads);
+    tids[0] = tid;
+    *count = 1;
+
+    /* In the socket mode /proc/<pid> was opened while the pidfd pinned
+     * the process */
+    char task_dir[sizeof("/proc/%lu/task") + sizeof(long)*3];
+    sprintf(task_dir, "/proc/%lu/task", (long)tid);
+    DIR *dir = NULL;
+    if (s_socket_pid_proc_fd >= 0)
+    {
+        const int task_fd = openat(s_socket_pid_proc_fd, "task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        dir = task_fd < 0 ? NULL : fdopendir(task_fd);
+        if (dir == NULL && task_fd >= 0)
+            close(task_fd);
+    }
+    else
+        dir = opendir(task_dir);
+
+    if (dir == NULL)
+    {
+        perror_msg("Can't list threads in '%s'", task_dir);
+        return tids;
+    }
+
+    struct dirent *dent;
+    while (*count < max_threads && (dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        const pid_t thread = (pid_t)strtol(dent->d_name, NULL, 10);
+        if (thread > 0 && thread != tid)
+            tids[(*count)++] = thread;
+    }
+    closedir(dir);
+
+    if (*count == max_threads)
+        log_notice("Unwinding only %u threads of the crashed process", max_threads);
+
+    return tids;
+}
+
+/* Unwinds the threads tids[worker], tids[worker + workers], ... and writes
+ * their '\0' terminated JSON core stacktraces to fd, an empty string for
+ * threads which could not be unwound. Runs in a forked worker process.
  */
-static int dump_two_core_files(int abrt_core_fd, size_t *abrt_limit, int user_core_fd, size_t *user_limit)
+static void unwind_threads_worker(int fd, const pid_t *tids, unsigned count,
+                                  unsigned worker, unsigned workers,
+                                  const char *executable, int signal_no,
+                                  uid_t uid, uid_t fsuid, gid_t gid, gid_t fsgid)
 {
-   /* tee() does not move the in_fd, thus you need to call splice to be
-    * get next chunk of data loaded into the in_fd buffer.
-    * So, calling tee() without splice() would be looping on the same
-    * data. Hence, we must ensure that after tee() we call splice() and
-    * that would be problematic if tee core limit is greater than splice
-    * core limit. Therefore, we swap the out fds based on their limits.
-    */
-    int    spliced_fd          = *abrt_limit > *user_limit ? abrt_core_fd    : user_core_fd;
-    size_t spliced_core_limit  = *abrt_limit > *user_limit ? *abrt_limit     : *user_limit;
-    int    teed_fd             = *abrt_limit > *user_limit ? user_core_fd    : abrt_core_fd;
-    size_t teed_core_limit     = *abrt_limit > *user_limit ? *user_limit     : *abrt_limit;
-
-    size_t *spliced_core_size  = *abrt_limit > *user_limit ? abrt_limit : user_limit;
-    size_t *teed_core_size     = *abrt_limit > *user_limit ? user_limit : abrt_limit;
-
-    *spliced_core_size = *teed_core_size = 0;
-
-    int cp[2] = { -1, -1 };
-    if (pipe(cp) < 0)
-    {
-        perror_msg("Failed to create temporary pipe for core file");
-        cp[0] = cp[1] = -1;
-    }
-
-    /* tee() can copy duplicate up to size of the pipe buffer bytes.
-     * It should not be problem to ask for more (in that case, tee would simply
-     * duplicate up to the limit bytes) but I would rather not to exceed
-     * the pipe buffer limit.
-     */
-    int copy_buffer_size = fcntl(STDIN_FILENO, F_GETPIPE_SZ);
-    if (copy_buffer_size < 0)
-        copy_buffer_size = KERNEL_PIPE_BUFFER_SIZE;
+    struct sr_core_stracetrace_unwind_state **states = xzalloc(sizeof(*states) * count);
 
-    ssize_t to_write = copy_buffer_size;
-    for (;;)
+    /* Preparation reads /proc/PID/maps and must be done before dropping
+     * privileges */
+    for (unsigned i = worker; i < count; i += workers)
     {
-        if (cp[1] >= 0)
+        char *error_message = NULL;
+        states[i] = sr_abrt_get_core_stacktrace_from_core_hook_prepare(tids[i], &error_message);
+        if (error_message)
         {
-            to_write = tee(STDIN_FILENO, cp[1], copy_buffer_size, 0);
+            log_notice("Can't prepare for unwinding of thread %d: %s", tids[i], error_message);
+            free(error_message);
+            states[i] = NULL;
+        }
+    }
 
-            /* Check EOF. */
-            if (to_write == 0)
-                break;
+    drop_unwinder_privileges(uid, fsuid, gid, fsgid);
 
-            if (to_write < 0)
+    for (unsigned i = worker; i < count; i += workers)
+    {
+        char *json = NULL;
+        if (states[i] != NULL)
+        {
+            char *error_message = NULL;
+            json = sr_abrt_get_core_stacktrace_from_core_hook_generate(tids[i], executable,
+                                                                       signal_no, states[i],
+                                                                       &error_message);
+            if (!json)
             {
-                perror_msg("Cannot duplicate stdin buffer for core file");
-                pipe_close(cp);
-                to_write = copy_buffer_size;
+                log_notice("Can't unwind thread %d: %s", tids[i], error_message);
+                free(error_message);
             }
         }
 
-        size_t to_splice = to_write;
-        if (*spliced_core_size + to_splice > spliced_core_limit)
-            to_splice = spliced_core_limit - *spliced_core_size;
+        if (full_write(fd, json ? json : "", json ? strlen(json) + 1 : 1) < 0)
+            perror_msg_and_die("Can't pass core backtrace of thread %d", tids[i]);
+        free(json);
+    }
 
-        const size_t spliced = xsplice_full(STDIN_FILENO, spliced_fd, to_splice);
-        *spliced_core_size += spliced;
+    free(states);
+}
 
-        if (cp[0] >= 0)
+/* Unwinds all threads of the crashed process in a small pool of worker
+ * processes and returns the malloced JSON core stacktrace of all of them.
+ * The crash thread must be unwound, the others are skipped on errors.
+ */
+static char *create_all_threads_core_backtrace(pid_t tid, const char *executable, int signal_no,
+                                               const struct core_backtrace_threads *limits,
+                                               uid_t uid, uid_t fsuid, gid_t gid, gid_t fsgid)
+{
+    unsigned count = 0;
+    pid_t *tids = list_crashed_threads(tid, limits->max_threads, &count);
+
+    const unsigned workers = count < limits->workers ? count : limits->workers;
+    int *fds = xmalloc(sizeof(*fds) * workers);
+    pid_t *pids = xmalloc(sizeof(*pids) * workers);
+    for (unsigned w = 0; w < workers; ++w)
+    {
+        int pipefds[2];
+        xpipe(pipefds);
+        pids[w] = xfork();
+        if (pids[w] == 0)
         {
-            size_t to_tee = to_write;
-            if (*teed_core_size + to_tee > teed_core_limit)
-                to_tee = teed_core_limit - *teed_core_size;
+            close(pipefds[0]);
+            unwind_threads_worker(pipefds[1], tids, count, w, workers,
+                                  executable, signal_no, uid, fsuid, gid, fsgid);
+            exit(0);
+        }
 
-            const ssize_t teed = splice_full(cp[0], teed_fd, to_tee);
-            if (teed < 0)
-            {
-                perror_msg("Cannot splice teed data to core file");
-                pipe_close(cp);
-                to_write = copy_buffer_size;
-            }
-            else
-                *teed_core_size += teed;
+        close(pipefds[1]);
+        fds[w] = pipefds[0];
+    }
 
-            if (*teed_core_size >= teed_core_limit)
-            {
-                pipe_close(cp);
-                to_write = copy_buffer_size;
-            }
-        }
+    /* The results are parsed with privileges of the crashed process too */
+    drop_unwinder_privileges(uid, fsuid, gid, fsgid);
 
-        /* Check EOF. */
-        if (spliced == 0 || *spliced_core_size >= spliced_core_limit)
-            break;
+    /* Read the workers concurrently, they would block on full pipes */
+    GString **results = xmalloc(sizeof(*results) * workers);
+    struct pollfd *pfds = xmalloc(sizeof(*pfds) * workers);
+    for (unsigned w = 0; w < workers; ++w)
+    {
+        results[w] = g_string_new(NULL);
+        pfds[w].fd = fds[w];
+        pfds[w].events = POLLIN;
     }
 
-    int r = 0;
-    if (cp[0] < 0)
+    for (unsigned running = workers; running > 0; )
     {
-        if (abrt_limit < user_limit)
-            r |= DUMP_ABRT_CORE_FAILED;
-        else
-            r |= DUMP_USER_CORE_FAILED;
+        if (poll(pfds, workers, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror_msg_and_die("poll");
+        }
+
+        for (unsigned w = 0; w < workers; ++w)
+        {
+            if (pfds[w].fd < 0 || pfds[w].revents == 0)
+                continue;
+
+            char buf[KERNEL_PIPE_BUFFER_SIZE / 4];
+            const ssize_t r = safe_read(pfds[w].fd, buf, sizeof(buf));
+            if (r > 0)
+            {
+                g_string_append_len(results[w], buf, r);
+                continue;
+            }
+
+            close(pfds[w].fd);
+            pfds[w].fd = -1;
+            safe_waitpid(pids[w], NULL, 0);
+            --running;
+        }
     }
-    else
-        pipe_close(cp);
 
-    return r;
-}
+    /* Workers terminate each result, the missing ones were not unwound
+     * because the worker died */
+    const char **jsons = xzalloc(sizeof(*jsons) * count);
+    for (unsigned w = 0; w < workers; ++w)
+        core_backtrace_split_worker_output(results[w]->str, results[w]->len, w, workers, jsons, count);
 
-enum create_core_backtrace_status
-{
-    CB_DISABLED     = 0x1,
-    CB_STDIN_CLOSED = 0x2,
-    CB_SUCCESSFUL   = 0x4,
-};
+    char *json = core_backtrace_join_threads(jsons, tids, count, limits->max_frames);
+
+    free(jsons);
+    for (unsigned w = 0; w < workers; ++w)
+        g_string_free(results[w], TRUE);
+    free(results);
+    free(pfds);
+    free(pids);
+    free(fds);
+    free(tids);
+
+    return json;
+}
+#endif /*ENABLE_DUMP_TIME_UNWIND*/
 
+/* Unwinds only the crash thread if all_threads is NULL */
 static enum create_core_backtrace_status
 create_core_backtrace(struct dump_dir *dd, uid_t uid, uid_t fsuid, gid_t gid,
-                      gid_t fsgid, pid_t tid, const char *executable, int signal_no)
+                      gid_t fsgid, pid_t tid, const char *executable, int signal_no,
+                      const struct core_backtrace_threads *all_threads)
 {
 #ifndef ENABLE_DUMP_TIME_UNWIND
     return CB_DISABLED;
@@ -720,54 +1271,32 @@ create_core_backtrace(struct dump_dir *dd, uid_t uid, uid_t fsuid, gid_t gid,
         if (corebtfd < 0)
             perror_msg_and_die("Cannot open %s", FILENAME_CORE_BACKTRACE);
 
-        char *error_message = NULL;
-        struct sr_core_stracetrace_unwind_state *state = NULL;
-        state = sr_abrt_get_core_stacktrace_from_core_hook_prepare(tid, &error_message);
-
-        if (error_message)
-            perror_msg_and_die("Can't prepare for core backtrace generation: %s", error_message);
-
-        const gid_t g = gid == 0 ? fsgid : gid;
-        if (setresgid(g, g, g) == -1)
-            perror_msg_and_die("Can't change process group id of '%d' user", gid);
-
-        const uid_t u = uid == 0 ? fsuid : uid;
-        if (setresuid(u, u, u) == -1)
-            perror_msg_and_die("Can't change process user id of '%d' user", uid);
-
-        log_debug("Running core_backtrace under %d:%d", u, g);
-
-        /* Get capability state of the calling process  */
-        cap_t caps = cap_get_proc();
-        if (!caps)
-            perror_msg_and_die("Can't get capability state of process PID: %d", getpid());
-
-        /* Array must be filled with CAP_* constants */
-        cap_value_t cap_list[CAP_LAST_CAP+1];
-        for (cap_value_t cap = CAP_CHOWN; cap <= CAP_LAST_CAP; cap++)
-            cap_list[cap] = cap;
-
-        if (cap_set_flag(caps, CAP_PERMITTED, CAP_LAST_CAP, cap_list, CAP_CLEAR) == -1)
-            perror_msg_and_die("Failed to clear all capabilities in permitted set");
-
-        if (cap_set_flag(caps, CAP_EFFECTIVE, CAP_LAST_CAP, cap_list, CAP_CLEAR) == -1)
-            perror_msg_and_die("Failed to clear all capabilities in effective set");
-
-        if (cap_set_flag(caps, CAP_INHERITABLE, CAP_LAST_CAP, cap_list, CAP_CLEAR) == -1)
-            perror_msg_and_die("Failed to clear all capabilities in inherited set");
+        char *json = NULL;
+        if (all_threads != NULL)
+        {
+            json = create_all_threads_core_backtrace(tid, executable, signal_no, all_threads,
+                                                     uid, fsuid, gid, fsgid);
+            if (!json)
+                error_msg_and_die("Can't generate core backtrace of the crash thread");
+        }
+        else
+        {
+            char *error_message = NULL;
+            struct sr_core_stracetrace_unwind_state *state = NULL;
+            state = sr_abrt_get_core_stacktrace_from_core_hook_prepare(tid, &error_message);
 
-        if (cap_set_proc(caps) == -1)
-            perror_msg_and_die("Failed to assign cleared capabilities to process");
+            if (error_message)
+                perror_msg_and_die("Can't prepare for core backtrace generation: %s", error_message);
 
-        if (cap_free(caps) == -1)
-            perror_msg_and_die("Error releasing capability state resource! PID: %d", getpid());
+            drop_unwinder_privileges(uid, fsuid, gid, fsgid);
 
-        char *json = sr_abrt_get_core_stacktrace_from_core_hook_generate(tid, executable,
-                                                                         signal_no, state,
-                                                                         &error_message);
-        state = NULL;
-        if (!json)
-            error_msg_and_die("Can't generate core backtrace: %s", error_message);
+            json = sr_abrt_get_core_stacktrace_from_core_hook_generate(tid, executable,
+                                                                       signal_no, state,
+                                                                       &error_message);
+            state = NULL;
+            if (!json)
+                error_msg_and_die("Can't generate core backtrace: %s", error_message);
+        }
 
         full_write_str(corebtfd, json);
         free(json);
@@ -858,10 +1387,21 @@ int main(int argc, char** argv)
     bool setting_MakeCompatCore;
     bool setting_SaveBinaryImage;
     bool setting_SaveFullCore;
+    bool setting_DeltaCores;
     bool setting_CreateCoreBacktrace;
+    bool setting_CoreBacktraceAllThreads;
+    struct core_backtrace_threads setting_core_backtrace_threads = {
+        .max_threads = 64,
+        .max_frames = 64,
+        .workers = 4,
+    };
     bool setting_SaveContainerizedPackageData;
     bool setting_StandaloneHook;
+    unsigned int setting_StagingRingSize = 8;
+    unsigned int setting_StagingMaxCoreSize = 0;
     unsigned int setting_MaxCoreFileSize = g_settings_nMaxCrashReportsSize;
+    char *setting_KernelCoredumpSocket = NULL;
+    unsigned int setting_KernelCoredumpSocketMaxConnections = 4;
 
     GList *setting_ignored_paths = NULL;
     GList *setting_allowed_users = NULL;
@@ -876,8 +1416,33 @@ int main(int argc, char** argv)
         setting_SaveBinaryImage = value && string_to_bool(value);
         value = get_map_string_item_or_NULL(settings, "SaveFullCore");
         setting_SaveFullCore = value ? string_to_bool(value) : true;
+        value = get_map_string_item_or_NULL(settings, "DeltaCores");
+        setting_DeltaCores = value && string_to_bool(value);
         value = get_map_string_item_or_NULL(settings, "CreateCoreBacktrace");
         setting_CreateCoreBacktrace = value ? string_to_bool(value) : true;
+        value = get_map_string_item_or_NULL(settings, "CoreBacktraceAllThreads");
+        setting_CoreBacktraceAllThreads = value && string_to_bool(value);
+        value = get_map_string_item_or_NULL(settings, "CoreBacktraceMaxThreads");
+        if (value && (!try_get_map_string_item_as_uint(settings, "CoreBacktraceMaxThreads", &setting_core_backtrace_threads.max_threads)
+                      || setting_core_backtrace_threads.max_threads == 0))
+        {
+            log_warning("The CoreBacktraceMaxThreads option in the CCpp.conf file holds an invalid value");
+            setting_core_backtrace_threads.max_threads = 64;
+        }
+        value = get_map_string_item_or_NULL(settings, "CoreBacktraceMaxFrames");
+        if (value && (!try_get_map_string_item_as_uint(settings, "CoreBacktraceMaxFrames", &setting_core_backtrace_threads.max_frames)
+                      || setting_core_backtrace_threads.max_frames == 0))
+        {
+            log_warning("The CoreBacktraceMaxFrames option in the CCpp.conf file holds an invalid value");
+            setting_core_backtrace_threads.max_frames = 64;
+        }
+        value = get_map_string_item_or_NULL(settings, "CoreBacktraceWorkers");
+        if (value && (!try_get_map_string_item_as_uint(settings, "CoreBacktraceWorkers", &setting_core_backtrace_threads.workers)
+                      || setting_core_backtrace_threads.workers == 0))
+        {
+            log_warning("The CoreBacktraceWorkers option in the CCpp.conf file holds an invalid value");
+            setting_core_backtrace_threads.workers = 4;
+        }
         value = get_map_string_item_or_NULL(settings, "IgnoredPaths");
         if (value)
             setting_ignored_paths = parse_list(value);
@@ -906,15 +1471,47 @@ int main(int argc, char** argv)
 
         value = get_map_string_item_or_NULL(settings, "StandaloneHook");
         setting_StandaloneHook = value && string_to_bool(value);
+        value = get_map_string_item_or_NULL(settings, "StagingRingSize");
+        if (value && !try_get_map_string_item_as_uint(settings, "StagingRingSize", &setting_StagingRingSize))
+            log_warning("The StagingRingSize option in the CCpp.conf file holds an invalid value");
+        value = get_map_string_item_or_NULL(settings, "StagingMaxCoreSize");
+        if (value && !try_get_map_string_item_as_uint(settings, "StagingMaxCoreSize", &setting_StagingMaxCoreSize))
+            log_warning("The StagingMaxCoreSize option in the CCpp.conf file holds an invalid value");
         value = get_map_string_item_or_NULL(settings, "VerboseLog");
         if (value)
             g_verbose = xatoi_positive(value);
+
+        value = get_map_string_item_or_NULL(settings, "KernelCoredumpSocket");
+        setting_KernelCoredumpSocket = xstrdup(value ? value : "auto");
+        value = get_map_string_item_or_NULL(settings, "KernelCoredumpSocketMaxConnections");
+        if (value && (!try_get_map_string_item_as_uint(settings, "KernelCoredumpSocketMaxConnections", &setting_KernelCoredumpSocketMaxConnections)
+                      || setting_KernelCoredumpSocketMaxConnections == 0))
+        {
+            log_warning("The KernelCoredumpSocketMaxConnections option in the CCpp.conf file holds an invalid value");
+            setting_KernelCoredumpSocketMaxConnections = 4;
+        }
         free_map_string(settings);
     }
 
     if (argc == 2 && !strcmp(argv[1], "--test-config"))
         return test_configuration(setting_SaveFullCore, setting_CreateCoreBacktrace);
 
+    if (argc == 2 && !strcmp(argv[1], "--socket-mode"))
+        return test_socket_mode(setting_KernelCoredumpSocket, setting_SaveFullCore, setting_CreateCoreBacktrace);
+
+    if (argc == 3 && !strcmp(argv[1], "--socket"))
+    {
+        if (test_socket_mode(setting_KernelCoredumpSocket, setting_SaveFullCore, setting_CreateCoreBacktrace) != 0)
+            error_msg_and_die("Coredump socket mode is disabled or not supported");
+
+        char **percent_values = serve_coredump_socket(argv[2], setting_KernelCoredumpSocketMaxConnections);
+        /* We are in the forked child now */
+        percent_values[0] = argv[0];
+        argv = percent_values;
+        argc = 9;
+    }
+    free(setting_KernelCoredumpSocket);
+
     if (argc < 8)
     {
         /* percent specifier:         %s   %c              %p  %u  %g  %t   %P         %T        */
@@ -963,7 +1560,7 @@ int main(int argc, char** argv)
     }
     const char *global_pid_str = argv[7];
     pid_t pid = xatoi_positive(argv[7]);
-    const int pid_proc_fd = open_proc_pid_dir(pid);
+    const int pid_proc_fd = s_socket_pid_proc_fd >= 0 ? s_socket_pid_proc_fd : open_proc_pid_dir(pid);
 
     user_pwd = get_cwd_at(pid_proc_fd); /* may be NULL on error */
     log_notice("user_pwd:'%s'", user_pwd);
@@ -1091,7 +1688,11 @@ int main(int argc, char** argv)
 
     }
     const int abrtd_running = daemon_is_ok();
-    if (!setting_StandaloneHook && !abrtd_running)
+    /* Crashes during boot and shutdown go to the staging ring on tmpfs,
+     * abrtd imports them when it starts */
+    const bool staging = !setting_StandaloneHook && !abrtd_running && setting_StagingRingSize != 0;
+    const char *dump_location = staging ? ABRT_STAGING_RING_DIR : g_settings_dump_location;
+    if (!setting_StandaloneHook && !abrtd_running && !staging)
     {
         error_msg_ignore_crash(pid_str, last_slash, (long unsigned)uid, signal_no,
                 signame, "abrtd is not running");
@@ -1120,8 +1721,8 @@ int main(int argc, char** argv)
         }
     }
 
-    /* low free space */
-    if (g_settings_nMaxCrashReportsSize > 0)
+    /* low free space, the staging ring is bounded by StagingRingSize */
+    if (!staging && g_settings_nMaxCrashReportsSize > 0)
     {
         /* If free space is less than 1/4 of MaxCrashReportsSize... */
         if (low_free_space(g_settings_nMaxCrashReportsSize, g_settings_dump_location))
@@ -1132,6 +1733,47 @@ int main(int argc, char** argv)
         }
     }
 
+    /* spool quotas, abrtd keeps the usage up to date */
+    if (quota_enabled())
+    {
+        const int cgroup_fd = openat(pid_proc_fd, "cgroup", O_RDONLY | O_CLOEXEC);
+        char *cgroup = cgroup_fd < 0 ? NULL : xmalloc_read(cgroup_fd, /*maxsz:*/ NULL);
+        if (cgroup_fd >= 0)
+            close(cgroup_fd);
+
+        char *uid_key = xasprintf("%lu", (long unsigned)uid);
+        char *container_key = cgroup ? quota_container_id(cgroup) : NULL;
+        const char *quota_keys[ABRT_QUOTA_CLASS_COUNT] = {
+            [ABRT_QUOTA_UID]       = uid_key,
+            [ABRT_QUOTA_CONTAINER] = container_key,
+            [ABRT_QUOTA_TYPE]      = "CCpp",
+        };
+
+        char *exceeded = NULL;
+        const enum abrt_quota_verdict verdict = quota_check(quota_keys, &exceeded);
+
+        free(container_key);
+        free(uid_key);
+        free(cgroup);
+
+        if (verdict == ABRT_QUOTA_REJECT)
+        {
+            error_msg_ignore_crash(pid_str, last_slash, (long unsigned)uid, signal_no,
+                                    signame, exceeded);
+            free(exceeded);
+            return create_user_core(user_core_fd, pid, ulimit_c);
+        }
+
+        if (verdict == ABRT_QUOTA_DEGRADE)
+        {
+            /* Metadata and the crash-time backtrace only */
+            log_warning("%s, not saving the core dump", exceeded);
+            setting_SaveFullCore = false;
+            setting_SaveBinaryImage = false;
+            free(exceeded);
+        }
+    }
+
     // processing crash - inform user about it
     error_msg_process_crash(pid_str, last_slash, (long unsigned)uid,
                 signal_no, signame, "dumping core");
@@ -1146,6 +1788,22 @@ int main(int argc, char** argv)
     if (setting_StandaloneHook)
         ensure_writable_dir(g_settings_dump_location, DEFAULT_DUMP_LOCATION_MODE, "abrt");
 
+    if (staging)
+    {
+        ensure_writable_dir(VAR_RUN"/abrt", 0755, "root");
+        ensure_writable_dir(ABRT_STAGING_RING_DIR, 0700, "root");
+        staging_ring_reserve(ABRT_STAGING_RING_DIR, setting_StagingRingSize);
+
+        /* tmpfs is memory, keep the captures compact */
+        setting_SaveBinaryImage = false;
+        /* references live next to DumpLocation */
+        setting_DeltaCores = false;
+        if (setting_StagingMaxCoreSize == 0)
+            setting_SaveFullCore = false;
+        else
+            setting_MaxCoreFileSize = setting_StagingMaxCoreSize;
+    }
+
     if (abrt_crash)
     {
         dump_abrt_process(pid, executable);
@@ -1154,7 +1812,7 @@ int main(int argc, char** argv)
     }
 
     unsigned path_len = snprintf(path, sizeof(path), "%s/ccpp-%s-%lu.new",
-            g_settings_dump_location, iso_date_string(NULL), (long)pid);
+            dump_location, iso_date_string(NULL), (long)pid);
     if (path_len >= (sizeof(path) - sizeof("/"FILENAME_COREDUMP)))
     {
         return create_user_core(user_core_fd, pid, ulimit_c);
@@ -1313,60 +1971,147 @@ int main(int argc, char** argv)
         }
 
         size_t core_size = 0;
+        /* User core copied after the crashed process is released */
+        int deferred_user_core_fd = -1;
+        int deferred_abrt_core_fd = -1;
+        off_t user_core_size = 0;
+        off_t user_core_prefix = 0;
+
         if (setting_SaveFullCore)
         {
-            int abrt_core_fd = dd_open_item(dd, FILENAME_COREDUMP, O_RDWR);
-            if (abrt_core_fd < 0)
+            size_t abrt_limit = 0;
+            if (   (g_settings_nMaxCrashReportsSize != 0 && setting_MaxCoreFileSize == 0)
+                || (g_settings_nMaxCrashReportsSize != 0 && g_settings_nMaxCrashReportsSize < setting_MaxCoreFileSize))
+                abrt_limit = g_settings_nMaxCrashReportsSize;
+            else
+                abrt_limit = setting_MaxCoreFileSize;
+
+            if (abrt_limit != 0)
+            {
+                const size_t abrt_limit_bytes = 1024 * 1024 * abrt_limit;
+                /* Overflow protection. */
+                if (abrt_limit_bytes > abrt_limit)
+                    abrt_limit = abrt_limit_bytes;
+                else
+                {
+                    error_msg("ABRT core file size limit (MaxCrashReportsSize|MaxCoreFileSize) does not fit into runtime type. Using maximal possible size.");
+                    abrt_limit = SIZE_MAX;
+                }
+            }
+            else
+                abrt_limit = SIZE_MAX;
+
+            /* The delta needs the whole input, it is not used together with
+             * the user core. */
+            char *delta_ref_dir = NULL;
+            char *delta_key = NULL;
+            ssize_t delta_size = -ENOENT;
+            if (setting_DeltaCores && user_core_fd < 0)
+            {
+                char *build_id = NULL;
+                const int exe_fd = openat(pid_proc_fd, "exe", O_RDONLY | O_CLOEXEC);
+                if (exe_fd >= 0)
+                {
+                    build_id = delta_core_build_id(exe_fd);
+                    close(exe_fd);
+                }
+
+                char *maps = dd_load_text_ext(dd, FILENAME_MAPS, DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+                if (build_id != NULL && maps != NULL)
+                {
+                    delta_ref_dir = delta_core_reference_dir();
+                    delta_key = delta_core_key(fsuid, build_id, maps);
+                    delta_size = delta_core_encode(delta_ref_dir, delta_key, dd, STDIN_FILENO, abrt_limit);
+                }
+                else
+                    log_notice("No build-id or maps of the executable, not using delta cores");
+
+                free(maps);
+                free(build_id);
+            }
+
+            int abrt_core_fd = -1;
+            if (delta_size >= 0)
+            {
+                log_notice("Saved the core as a delta against a reference");
+                core_size = delta_size;
+            }
+            else if (delta_size != -ENOENT)
+                /* The input has been consumed */
+                error_msg("Failed to save the delta core");
+            else if ((abrt_core_fd = dd_open_item(dd, FILENAME_COREDUMP, O_RDWR)) < 0)
             {   /* Avoid the need to deal with two destinations. */
                 perror_msg("Failed to create ABRT core file in '%s'", dd->dd_dirname);
                 create_user_core(user_core_fd, pid, ulimit_c);
             }
             else
             {
-                size_t abrt_limit = 0;
-                if (   (g_settings_nMaxCrashReportsSize != 0 && setting_MaxCoreFileSize == 0)
-                    || (g_settings_nMaxCrashReportsSize != 0 && g_settings_nMaxCrashReportsSize < setting_MaxCoreFileSize))
-                    abrt_limit = g_settings_nMaxCrashReportsSize;
-                else
-                    abrt_limit = setting_MaxCoreFileSize;
-
-                if (abrt_limit != 0)
+                /* The core is written once, the ABRT core never gets more
+                 * than its limit, see clone_user_core() */
+                const ssize_t r = splice_entire_per_partes(STDIN_FILENO, abrt_core_fd, abrt_limit);
+                ssize_t tail = 0;
+                if (r >= 0 && user_core_fd >= 0 && (size_t)r == abrt_limit && ulimit_c > r)
                 {
-                    const size_t abrt_limit_bytes = 1024 * 1024 * abrt_limit;
-                    /* Overflow protection. */
-                    if (abrt_limit_bytes > abrt_limit)
-                        abrt_limit = abrt_limit_bytes;
-                    else
+                    /* The rest of the user core goes behind the beginning
+                     * cloned from the ABRT core */
+                    tail = lseek(user_core_fd, r, SEEK_SET) == r
+                           ? splice_entire_per_partes(STDIN_FILENO, user_core_fd, ulimit_c - r)
+                           : -1;
+                    if (tail < 0)
                     {
-                        error_msg("ABRT core file size limit (MaxCrashReportsSize|MaxCoreFileSize) does not fit into runtime type. Using maximal possible size.");
-                        abrt_limit = SIZE_MAX;
+                        perror_msg("Failed to create user core '%s' in '%s'", core_basename, user_pwd);
+                        close_user_core(user_core_fd, -1);
+                        user_core_fd = -1;
                     }
                 }
-                else
-                    abrt_limit = SIZE_MAX;
 
-                if (user_core_fd < 0)
+                if (r < 0)
                 {
-                    const ssize_t r = splice_entire_per_partes(STDIN_FILENO, abrt_core_fd, abrt_limit);
-                    if (r < 0)
-                        perror_msg("Failed to write ABRT core file");
-                    else
-                        core_size = r;
+                    perror_msg("Failed to write ABRT core file");
+                    close_user_core(user_core_fd, -1);
                 }
                 else
                 {
-                    size_t user_limit = ulimit_c;
-                    const int r = dump_two_core_files(abrt_core_fd, &abrt_limit, user_core_fd, &user_limit);
+                    core_size = r;
 
-                    close_user_core(user_core_fd, (r & DUMP_USER_CORE_FAILED) ? -1 : user_limit);
-
-                    if (!(r & DUMP_ABRT_CORE_FAILED))
-                        core_size = abrt_limit;
+                    if (user_core_fd >= 0)
+                    {
+                        user_core_prefix = r < ulimit_c ? r : ulimit_c;
+                        user_core_size = user_core_prefix + tail;
+                        if (clone_user_core(abrt_core_fd, user_core_fd, user_core_prefix, user_core_size) == 0)
+                        {
+                            if (close_user_core(user_core_fd, user_core_size) == 0)
+                                log_notice("Cloned core dump of pid %lu to '%s' at '%s' (%llu bytes)",
+                                           (long)pid, core_basename, user_pwd, (long long)user_core_size);
+                        }
+                        else
+                        {   /* Don't keep the crashed process waiting */
+                            deferred_user_core_fd = user_core_fd;
+                            deferred_abrt_core_fd = dup(abrt_core_fd);
+                            if (deferred_abrt_core_fd < 0)
+                            {
+                                perror_msg("Can't copy the core to '%s' at '%s'", core_basename, user_pwd);
+                                close_user_core(user_core_fd, -1);
+                                deferred_user_core_fd = -1;
+                            }
+                        }
+                    }
                 }
 
                 if (fsync(abrt_core_fd) != 0 || close(abrt_core_fd) != 0)
                     perror_msg("Failed to close ABRT core file");
+                else if (delta_key != NULL && core_size != 0)
+                {   /* The first core of the build becomes the reference */
+                    delta_core_collect_references(delta_ref_dir);
+                    char *core_path = concat_path_file(dd->dd_dirname, FILENAME_COREDUMP);
+                    if (delta_core_register_reference(delta_ref_dir, delta_key, core_path) != 0)
+                        log_notice("Failed to make '%s' a reference core", core_path);
+                    free(core_path);
+                }
             }
+
+            free(delta_key);
+            free(delta_ref_dir);
         }
         else
         {
@@ -1374,7 +2119,7 @@ int main(int argc, char** argv)
             create_user_core(user_core_fd, pid, ulimit_c);
         }
 
-        /* User core is either written or closed */
+        /* User core is either written, closed or waits for the copy */
         user_core_fd = -1;
 
         /*
@@ -1436,11 +2181,12 @@ int main(int argc, char** argv)
         }
 
         enum create_core_backtrace_status cbr = 0;
-        /* Perform crash-time unwind of the guilty thread. */
+        /* Perform crash-time unwind of the guilty thread (or of all threads). */
         if (tid > 0 && setting_CreateCoreBacktrace)
         {
             log_debug("Creating core_backtrace\n");
-            cbr = create_core_backtrace(dd, uid, fsuid, gid, fsgid, tid, executable, signal_no);
+            cbr = create_core_backtrace(dd, uid, fsuid, gid, fsgid, tid, executable, signal_no,
+                                        setting_CoreBacktraceAllThreads ? &setting_core_backtrace_threads : NULL);
             if (cbr & CB_DISABLED)
                 log_warning("CreateCoreBacktrace is enabled but dump time unwinding is not supported");
         }
@@ -1449,6 +2195,16 @@ int main(int argc, char** argv)
         if (!(cbr & CB_STDIN_CLOSED))
             close(STDIN_FILENO);
 
+        if (deferred_user_core_fd >= 0)
+        {
+            const off_t copied = copy_user_core(deferred_abrt_core_fd, deferred_user_core_fd,
+                                                user_core_prefix, user_core_size);
+            if (close_user_core(deferred_user_core_fd, copied) == 0)
+                log_notice("Saved core dump of pid %lu to '%s' at '%s' (%llu bytes)",
+                           (long)pid, core_basename, user_pwd, (long long)copied);
+            close(deferred_abrt_core_fd);
+        }
+
         /* We close dumpdir before we start catering for crash storm case.
          * Otherwise, delete_dump_dir's from other concurrent
          * CCpp's won't be able to delete our dump (their delete_dump_dir
@@ -1472,8 +2228,11 @@ int main(int argc, char** argv)
         if (abrtd_running)
             notify_new_path(path);
 
+        if (staging)
+            log_notice("abrtd is not running, staged the crash in %s", path);
+
         /* rhbz#539551: "abrt going crazy when crashing process is respawned" */
-        if (g_settings_nMaxCrashReportsSize > 0)
+        if (!staging && g_settings_nMaxCrashReportsSize > 0)
         {
             /* x1.25 and round up to 64m: go a bit up, so that usual in-daemon trimming
              * kicks in first, and we don't "fight" with it:
@@ -0,0 +1,447 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    Started by the crash handler of libabrt-crash in a child of the crashed
+    process: abrt-hook-inprocess PID TID SIGNAL. The crash thread waits in
+    the handler until the problem is submitted.
+*/
+#include "libabrt.h"
+#include "abrt-crash.h"
+
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#ifdef ENABLE_DUMP_TIME_UNWIND
+#include <satyr/abrt.h>
+#include <satyr/utils.h>
+#include <satyr/core/unwind.h>
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/thread.h>
+#include <satyr/core/frame.h>
+#endif /* ENABLE_DUMP_TIME_UNWIND */
+
+/* Exit codes understood by the crash handler */
+#define EXIT_SUBMITTED           0
+#define EXIT_FAILED              1
+#define EXIT_SUBMITTED_KEEP_CORE 2
+
+#define ABRT_SOCKET_FILE VAR_RUN"/abrt/abrt.socket"
+
+#ifdef ENABLE_DUMP_TIME_UNWIND
+/* Returns malloced array of at most max_threads thread ids of the process,
+ * the crash thread is the first one */
+static pid_t *list_threads(pid_t pid, pid_t tid, unsigned max_threads, unsigned *count)
+{
+    pid_t *tids = xmalloc(sizeof(*tids) * max_threads);
+    tids[0] = tid;
+    *count = 1;
+
+    char task_dir[sizeof("/proc/%lu/task") + sizeof(long)*3];
+    sprintf(task_dir, "/proc/%lu/task", (long)pid);
+    DIR *dir = opendir(task_dir);
+    if (dir == NULL)
+    {
+        perror_msg("Can't list threads in '%s'", task_dir);
+        return tids;
+    }
+
+    struct dirent *dent;
+    while (*count < max_threads && (dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        const pid_t thread = (pid_t)strtol(dent->d_name, NULL, 10);
+        if (thread > 0 && thread != tid)
+            tids[(*count)++] = thread;
+    }
+    closedir(dir);
+
+    return tids;
+}
+
+/* The unwinder expects threads stopped by the tracer. The crash thread
+ * waits for us in the handler, the others are still running. */
+static bool stop_thread(pid_t tid)
+{
+    if (ptrace(PTRACE_SEIZE, tid, NULL, NULL) != 0
+        || ptrace(PTRACE_INTERRUPT, tid, NULL, NULL) != 0)
+    {
+        perror_msg("Can't stop thread %d", tid);
+        return false;
+    }
+
+    int status;
+    if (safe_waitpid(tid, &status, __WALL) < 0)
+    {
+        perror_msg("Can't stop thread %d", tid);
+        ptrace(PTRACE_DETACH, tid, NULL, NULL);
+        return false;
+    }
+
+    return true;
+}
+
+static struct sr_core_thread *unwind_thread(pid_t tid, const char *executable, int signal_no)
+{
+    char *error_message = NULL;
+    struct sr_core_stracetrace_unwind_state *state;
+    state = sr_abrt_get_core_stacktrace_from_core_hook_prepare(tid, &error_message);
+    if (error_message)
+    {
+        log_notice("Can't prepare for unwinding of thread %d: %s", tid, error_message);
+        free(error_message);
+        return NULL;
+    }
+
+    char *json = sr_abrt_get_core_stacktrace_from_core_hook_generate(tid, executable,
+                                                                     signal_no, state,
+                                                                     &error_message);
+    if (json == NULL)
+    {
+        log_notice("Can't unwind thread %d: %s", tid, error_message);
+        free(error_message);
+        return NULL;
+    }
+
+    struct sr_core_stacktrace *stacktrace = sr_core_stacktrace_from_json_text(json, &error_message);
+    free(json);
+    if (stacktrace == NULL || stacktrace->threads == NULL)
+    {
+        log_notice("Can't parse core backtrace of thread %d: %s", tid, error_message);
+        free(error_message);
+        sr_core_stacktrace_free(stacktrace);
+        return NULL;
+    }
+
+    struct sr_core_thread *thread = stacktrace->threads;
+    stacktrace->threads = thread->next;
+    stacktrace->crash_thread = NULL;
+    thread->next = NULL;
+    sr_core_stacktrace_free(stacktrace);
+    return thread;
+}
+
+static void free_frames(struct sr_core_frame *frame)
+{
+    while (frame != NULL)
+    {
+        struct sr_core_frame *next = frame->next;
+        sr_core_frame_free(frame);
+        frame = next;
+    }
+}
+
+/* Drops the frames of the crash handler and of the signal trampoline which
+ * called it, the crash thread then starts where the signal was received */
+static void drop_handler_frames(struct sr_core_thread *thread)
+{
+    struct sr_core_frame *last_handler_frame = NULL;
+    for (struct sr_core_frame *frame = thread->frames; frame != NULL; frame = frame->next)
+        if (frame->file_name != NULL && strstr(frame->file_name, "/libabrt-crash.so") != NULL)
+            last_handler_frame = frame;
+
+    if (last_handler_frame == NULL || last_handler_frame->next == NULL)
+        return;
+
+    struct sr_core_frame *trampoline = last_handler_frame->next;
+    struct sr_core_frame *first = thread->frames;
+    thread->frames = trampoline->next;
+    trampoline->next = NULL;
+    free_frames(first);
+}
+
+static void limit_frames(struct sr_core_thread *thread, unsigned max_frames)
+{
+    struct sr_core_frame **frame = &thread->frames;
+    for (unsigned i = 0; *frame != NULL && i < max_frames; ++i)
+        frame = &(*frame)->next;
+
+    free_frames(*frame);
+    *frame = NULL;
+}
+
+/* Returns malloced JSON core stacktrace of all threads of the process, the
+ * crash thread must be unwound, the others are skipped on errors */
+static char *create_core_backtrace(pid_t pid, pid_t tid, const char *executable, int signal_no,
+                                   unsigned max_threads, unsigned max_frames)
+{
+    unsigned count = 0;
+    pid_t *tids = list_threads(pid, tid, max_threads, &count);
+    bool *stopped = xzalloc(sizeof(*stopped) * count);
+
+    /* Stop all of them first, they must not change the memory of the
+     * others while we unwind */
+    for (unsigned i = 0; i < count; ++i)
+        stopped[i] = stop_thread(tids[i]);
+
+    struct sr_core_stacktrace *stacktrace = NULL;
+    struct sr_core_thread *last_thread = NULL;
+    for (unsigned i = 0; i < count && (i == 0 || stacktrace != NULL); ++i)
+    {
+        if (!stopped[i])
+            continue;
+
+        struct sr_core_thread *thread = unwind_thread(tids[i], executable, signal_no);
+        if (thread == NULL)
+            continue;
+
+        if (i == 0)
+            drop_handler_frames(thread);
+        limit_frames(thread, max_frames);
+
+        if (stacktrace == NULL)
+        {
+            stacktrace = sr_core_stacktrace_new();
+            stacktrace->signal = signal_no;
+            stacktrace->executable = xstrdup(executable);
+            stacktrace->only_crash_thread = false;
+            stacktrace->threads = thread;
+            stacktrace->crash_thread = thread;
+        }
+        else
+            last_thread->next = thread;
+        last_thread = thread;
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+        if (stopped[i])
+            ptrace(PTRACE_DETACH, tids[i], NULL, NULL);
+
+    char *json = NULL;
+    if (stacktrace != NULL)
+    {
+        json = sr_core_stacktrace_to_json(stacktrace);
+        sr_core_stacktrace_free(stacktrace);
+    }
+
+    free(stopped);
+    free(tids);
+    return json;
+}
+#endif /*ENABLE_DUMP_TIME_UNWIND*/
+
+/* Returns malloced list of build-ids of the ELF files mapped by the
+ * process, one per line */
+static char *build_ids_from_maps(const char *maps)
+{
+    GHashTable *seen = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+    struct strbuf *build_ids = strbuf_new();
+
+    char *copy = xstrdup(maps);
+    char *saveptr = NULL;
+    for (char *line = strtok_r(copy, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr))
+    {
+        /* address perms offset dev inode path */
+        const char *path = strchr(line, '/');
+        if (path == NULL || g_hash_table_contains(seen, path))
+            continue;
+        g_hash_table_add(seen, xstrdup(path));
+
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        char *build_id = delta_core_build_id(fd);
+        close(fd);
+        if (build_id != NULL)
+            strbuf_append_strf(build_ids, "%s\n", build_id);
+        free(build_id);
+    }
+    free(copy);
+    g_hash_table_destroy(seen);
+
+    return strbuf_free_nobuf(build_ids);
+}
+
+static void append_element(struct strbuf *message, const char *name, const char *value)
+{
+    /* The elements are separated by NUL */
+    strbuf_append_strf(message, "%s=%s", name, value);
+    strbuf_append_char(message, '\0');
+}
+
+/* Returns true if abrtd accepted the problem */
+static bool submit_problem(const char *message, size_t size)
+{
+    const int sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        perror_msg("socket");
+        return false;
+    }
+
+    struct sockaddr_un sunx;
+    memset(&sunx, 0, sizeof(sunx));
+    sunx.sun_family = AF_UNIX;
+    strcpy(sunx.sun_path, ABRT_SOCKET_FILE);
+
+    bool accepted = false;
+    if (connect(sockfd, (struct sockaddr *)&sunx, sizeof(sunx)) != 0)
+    {
+        perror_msg("Can't connect to '%s'", ABRT_SOCKET_FILE);
+        goto finito;
+    }
+
+    if (full_write_str(sockfd, "POST / HTTP/1.1\r\n\r\n") < 0
+        || full_write(sockfd, message, size) != (ssize_t)size)
+    {
+        perror_msg("Can't send the problem to abrtd");
+        goto finito;
+    }
+    shutdown(sockfd, SHUT_WR);
+
+    char response[256];
+    const ssize_t r = full_read(sockfd, response, sizeof(response) - 1);
+    response[r > 0 ? r : 0] = '\0';
+    /* "HTTP/1.1 201 Created" */
+    const char *code = strchr(response, ' ');
+    accepted = prefixcmp(response, "HTTP/") == 0 && code != NULL && atoi(code + 1) == 201;
+    if (!accepted)
+        error_msg("abrtd did not accept the problem: '%s'", response);
+
+ finito:
+    close(sockfd);
+    return accepted;
+}
+
+int main(int argc, char **argv)
+{
+    /* The crashed process might have closed them */
+    int fd = xopen("/dev/null", O_RDWR);
+    while (fd < 2)
+        fd = xdup(fd);
+    if (fd > 2)
+        close(fd);
+
+    logmode = LOGMODE_JOURNAL;
+
+    if (argc != 4)
+        error_msg_and_die("Usage: %s PID TID SIGNAL", argv[0]);
+
+    const pid_t pid = xatoi_positive(argv[1]);
+    const pid_t tid = xatoi_positive(argv[2]);
+    const int signal_no = xatoi_positive(argv[3]);
+
+    /* The signal is blocked in the handler which started us */
+    sigset_t set;
+    sigemptyset(&set);
+    sigprocmask(SIG_SETMASK, &set, NULL);
+
+    unsigned max_threads = 64;
+    unsigned max_frames = 64;
+    unsigned core_size = 0;
+    {
+        map_string_t *settings = new_map_string();
+        load_abrt_plugin_conf_file("CCpp.conf", settings);
+        const char *value;
+        value = get_map_string_item_or_NULL(settings, "CoreBacktraceMaxThreads");
+        if (value && (!try_get_map_string_item_as_uint(settings, "CoreBacktraceMaxThreads", &max_threads)
+                      || max_threads == 0))
+            max_threads = 64;
+        value = get_map_string_item_or_NULL(settings, "CoreBacktraceMaxFrames");
+        if (value && (!try_get_map_string_item_as_uint(settings, "CoreBacktraceMaxFrames", &max_frames)
+                      || max_frames == 0))
+            max_frames = 64;
+        value = get_map_string_item_or_NULL(settings, "InProcessCoreSize");
+        if (value && !try_get_map_string_item_as_uint(settings, "InProcessCoreSize", &core_size))
+            log_warning("The InProcessCoreSize option in the CCpp.conf file holds an invalid value");
+        free_map_string(settings);
+    }
+
+    const int pid_proc_fd = open_proc_pid_dir(pid);
+    if (pid_proc_fd < 0)
+        perror_msg_and_die("Can't open /proc/%d", pid);
+
+    char *executable = get_executable_at(pid_proc_fd);
+    if (executable == NULL)
+        error_msg_and_die("Can't read executable of process %d", pid);
+
+#ifdef ENABLE_DUMP_TIME_UNWIND
+    char *core_backtrace = create_core_backtrace(pid, tid, executable, signal_no,
+                                                 max_threads, max_frames);
+#else
+    char *core_backtrace = NULL;
+#endif
+    /* Without the backtrace the kernel core is more useful */
+    if (core_backtrace == NULL)
+        error_msg_and_die("Can't generate core backtrace of process %d", pid);
+
+    char proc_maps[sizeof("/proc/%lu/maps") + sizeof(long)*3];
+    sprintf(proc_maps, "/proc/%lu/maps", (long)pid);
+    char *maps = xmalloc_open_read_close(proc_maps, /*maxsize:*/ NULL);
+    char *build_ids = maps ? build_ids_from_maps(maps) : NULL;
+    char *cmdline = get_cmdline_at(pid_proc_fd);
+
+    const char *signame = NULL;
+    signal_is_fatal(signal_no, &signame);
+    char *reason = signame ? xasprintf("%s killed by SIG%s", strrchr(executable, '/') + 1, signame)
+                           : xasprintf("%s killed by signal %d", strrchr(executable, '/') + 1, signal_no);
+
+    char number[sizeof(long)*3 + 2];
+    struct strbuf *message = strbuf_new();
+    append_element(message, FILENAME_TYPE, ABRT_CRASH_PROBLEM_TYPE);
+    append_element(message, FILENAME_ANALYZER, "libabrt-crash");
+    sprintf(number, "%lu", (long)pid);
+    append_element(message, FILENAME_PID, number);
+    sprintf(number, "%lu", (long)tid);
+    append_element(message, FILENAME_TID, number);
+    append_element(message, FILENAME_EXECUTABLE, executable);
+    append_element(message, FILENAME_REASON, reason);
+    append_element(message, FILENAME_CORE_BACKTRACE, core_backtrace);
+    if (cmdline)
+        append_element(message, FILENAME_CMDLINE, cmdline);
+    if (maps)
+        append_element(message, FILENAME_MAPS, maps);
+    if (build_ids && build_ids[0] != '\0')
+        append_element(message, "build_ids", build_ids);
+
+    const bool submitted = submit_problem(message->buf, message->len);
+
+    int retval = EXIT_FAILED;
+    if (submitted && core_size == 0)
+        retval = EXIT_SUBMITTED;
+    else if (submitted)
+    {
+        /* The kernel writes at most this much after the handler returns */
+        const rlim_t limit = (rlim_t)core_size * 1024 * 1024;
+        struct rlimit rlim;
+        if (prlimit(pid, RLIMIT_CORE, NULL, &rlim) != 0)
+            perror_msg("Can't get the core limit of process %d", pid);
+        else if (rlim.rlim_cur == RLIM_INFINITY || rlim.rlim_cur > limit)
+        {
+            rlim.rlim_cur = limit;
+            if (prlimit(pid, RLIMIT_CORE, &rlim, NULL) != 0)
+                perror_msg("Can't limit the core of process %d", pid);
+        }
+        retval = EXIT_SUBMITTED_KEEP_CORE;
+    }
+
+    strbuf_free(message);
+    free(reason);
+    free(cmdline);
+    free(build_ids);
+    free(maps);
+    free(core_backtrace);
+    free(executable);
+    close(pid_proc_fd);
+
+    return retval;
+}
@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/** @file abrt-crash.h */
+
+#ifndef ABRT_CRASH_H
+#define ABRT_CRASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Type of problems reported by libabrt-crash */
+#define ABRT_CRASH_PROBLEM_TYPE "CCppInProcess"
+
+/**
+ @brief Reports crashes of the calling process to ABRT from the process
+
+ Installs handlers of SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT. The
+ handler runs on an alternate signal stack, uses only async-signal-safe
+ functions and starts abrt-hook-inprocess which unwinds all threads of the
+ process, collects its maps and build-ids and submits the problem to abrtd.
+ The process then dies of the signal without a core dump (or with a core
+ limited by InProcessCoreSize in CCpp.conf). If the problem can't be
+ submitted, the process dies as if there were no handler.
+
+ If the program had its own handler of the signal, the handler is called
+ after abrt-hook-inprocess, the process is not made non-dumpable and the
+ crash handler stays installed. A fault the program's handler returns from
+ is reported once.
+
+ Alternate signal stacks are per thread and only the calling thread gets
+ one. Stack overflows of other threads are left to the kernel unless they
+ set up their own stacks with sigaltstack().
+
+ Loading the library with LD_PRELOAD installs the handlers too.
+
+ @return 0 on success; otherwise negative errno value
+ */
+int abrt_crash_install(void);
+
+/**
+ @brief Restores the signal handlers replaced by abrt_crash_install()
+ */
+void abrt_crash_uninstall(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*ABRT_CRASH_H*/
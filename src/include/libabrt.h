@@ -55,6 +55,12 @@ char *get_backtrace(const char *dump_dir_name, unsigned timeout_sec, const char
 
 #define dir_is_in_dump_location abrt_dir_is_in_dump_location
 bool dir_is_in_dump_location(const char *dir_name);
+/* Accepts also problems migrated to ColdDumpLocation */
+#define dir_is_in_problem_storage abrt_dir_is_in_problem_storage
+bool dir_is_in_problem_storage(const char *dir_name);
+/* Elements compressed by abrt-cold-storage, a name per line */
+#define FILENAME_COLD_COMPRESSED "cold_compressed"
+#define COLD_COMPRESSED_SUFFIX ".xz"
 
 enum {
     DD_PERM_EVENTS  = 1 << 0,
@@ -83,6 +89,60 @@ extern bool          g_settings_shortenedreporting;
 extern bool          g_settings_explorechroots;
 #define g_settings_debug_level abrt_g_settings_debug_level
 extern unsigned int  g_settings_debug_level;
+#define g_settings_deferred_analysis abrt_g_settings_deferred_analysis
+extern bool          g_settings_deferred_analysis;
+#define g_settings_deferred_analysis_max_load abrt_g_settings_deferred_analysis_max_load
+extern unsigned int  g_settings_deferred_analysis_max_load;
+#define g_settings_deferred_analysis_max_pressure abrt_g_settings_deferred_analysis_max_pressure
+extern unsigned int  g_settings_deferred_analysis_max_pressure;
+/* Minutes since midnight, -1 if DeferredAnalysisWindow is not configured */
+#define g_settings_deferred_analysis_window_from abrt_g_settings_deferred_analysis_window_from
+extern int           g_settings_deferred_analysis_window_from;
+#define g_settings_deferred_analysis_window_to abrt_g_settings_deferred_analysis_window_to
+extern int           g_settings_deferred_analysis_window_to;
+
+/* Spool quotas (UserQuota, ContainerQuota, TypeQuota) */
+enum abrt_quota_class
+{
+    ABRT_QUOTA_UID,
+    ABRT_QUOTA_CONTAINER,
+    ABRT_QUOTA_TYPE,
+    ABRT_QUOTA_CLASS_COUNT,
+};
+struct abrt_quota_limit
+{
+    unsigned size;      /* MiB, 0 for unlimited */
+    unsigned count;     /* 0 for unlimited */
+    unsigned rate;      /* problems per hour, 0 for unlimited */
+};
+#define g_settings_quota abrt_g_settings_quota
+extern struct abrt_quota_limit g_settings_quota[ABRT_QUOTA_CLASS_COUNT];
+/* OverQuotaAction = reject, otherwise over quota problems are degraded */
+#define g_settings_over_quota_reject abrt_g_settings_over_quota_reject
+extern bool          g_settings_over_quota_reject;
+/* NULL if ColdDumpLocation is not configured */
+#define g_settings_cold_dump_location abrt_g_settings_cold_dump_location
+extern char *        g_settings_cold_dump_location;
+#define g_settings_cold_after_days abrt_g_settings_cold_after_days
+extern unsigned int  g_settings_cold_after_days;
+/* KiB */
+#define g_settings_cold_compress_min_size abrt_g_settings_cold_compress_min_size
+extern unsigned int  g_settings_cold_compress_min_size;
+/* KiB/s, 0 for unlimited */
+#define g_settings_cold_migration_rate abrt_g_settings_cold_migration_rate
+extern unsigned int  g_settings_cold_migration_rate;
+/* MiB, 0 for unlimited */
+#define g_settings_cold_max_size abrt_g_settings_cold_max_size
+extern unsigned int  g_settings_cold_max_size;
+/* Seconds, 0 for no deadline */
+#define g_settings_post_create_budget abrt_g_settings_post_create_budget
+extern unsigned int  g_settings_post_create_budget;
+/* NULL if AnalysisCacheLocation is not configured */
+#define g_settings_analysis_cache_location abrt_g_settings_analysis_cache_location
+extern char *        g_settings_analysis_cache_location;
+/* MiB, 0 for unlimited */
+#define g_settings_analysis_cache_max_size abrt_g_settings_analysis_cache_max_size
+extern unsigned int  g_settings_analysis_cache_max_size;
 
 
 #define load_abrt_conf abrt_load_abrt_conf
@@ -130,6 +190,559 @@ wait for the reply
 #define notify_new_path_with_response abrt_notify_new_path_with_response
 int notify_new_path_with_response(const char *path, char **message);
 
+/* The event abrtd runs on a problem when the system is idle. Post-create
+ * rules skip their expensive steps if ABRT_DEFERRED_ANALYSIS=1 is set in
+ * their environment and the same steps are declared under this event.
+ */
+#define DEFERRED_ANALYSIS_EVENT "post-create-deferred"
+/* The element holds the name of the event waiting for idle time. */
+#define FILENAME_PENDING_ANALYSIS "pending_analysis"
+/* Post-create steps run by abrt-action-run-with-budget must finish before
+ * this CLOCK_MONOTONIC time in seconds (see PostCreateBudget). */
+#define ABRT_POST_CREATE_DEADLINE_ENV "ABRT_POST_CREATE_DEADLINE"
+/* A line per post-create step cut short: STEP overrun|skipped SECONDS. The
+ * problem is analysed again by DEFERRED_ANALYSIS_EVENT. */
+#define FILENAME_DEGRADED_STEPS "degraded_steps"
+
+/**
+@brief Asks abrtd to run the pending deferred analysis of the problem now
+
+@param path Path to the problem directory
+@return -errno on error otherwise return value of abrtd
+*/
+#define promote_deferred_analysis abrt_promote_deferred_analysis
+int promote_deferred_analysis(const char *path);
+
+/**
+@brief Tells abrtd that the problem was deleted, so it stops waiting for its
+deferred analysis
+
+@param path Path to the deleted problem directory
+@return -errno on error otherwise 0
+*/
+#define notify_problem_deleted abrt_notify_problem_deleted
+int notify_problem_deleted(const char *path);
+
+/* Returns true if the time NOW falls into DeferredAnalysisWindow or the
+ * window is not configured. */
+#define deferred_analysis_in_window abrt_deferred_analysis_in_window
+bool deferred_analysis_in_window(time_t now);
+/* Returns true if abrtd may start a deferred analysis at the time NOW: it is
+ * inside DeferredAnalysisWindow and neither the load average nor the pressure
+ * stall information in PRESSURE_DIR (/proc/pressure) exceeds the limits. */
+#define system_is_idle_for_deferred_analysis abrt_system_is_idle_for_deferred_analysis
+bool system_is_idle_for_deferred_analysis(time_t now, const char *pressure_dir);
+
+/* Spool quotas
+ *
+ * abrtd keeps usage of all quota classes in a small file, hooks check it
+ * before creating a new problem. Keys are the uid, the container ID and
+ * the problem type; NULL keys are not checked.
+ */
+enum abrt_quota_verdict
+{
+    ABRT_QUOTA_OK,
+    ABRT_QUOTA_DEGRADE,     /* save only metadata of the problem */
+    ABRT_QUOTA_REJECT,
+};
+#define quota_class_name abrt_quota_class_name
+const char *quota_class_name(enum abrt_quota_class class);
+#define quota_enabled abrt_quota_enabled
+bool quota_enabled(void);
+/* Returns malloced ID of the container the cgroup belongs to or NULL */
+#define quota_container_id abrt_quota_container_id
+char *quota_container_id(const char *cgroup);
+/* Returns malloced description of the exceeded limit in *exceeded */
+#define quota_check abrt_quota_check
+enum abrt_quota_verdict quota_check(const char *const keys[ABRT_QUOTA_CLASS_COUNT], char **exceeded);
+
+/* abrtd keeps the usage in memory and updates it as problems are admitted,
+ * changed and deleted, it rescans the dump location only periodically */
+struct abrt_quota_usage;
+#define quota_usage_scan abrt_quota_usage_scan
+struct abrt_quota_usage *quota_usage_scan(const char *dump_location);
+/* Recounts sizes and counts, keeps the admissions for the rate quota */
+#define quota_usage_rescan abrt_quota_usage_rescan
+void quota_usage_rescan(struct abrt_quota_usage *usage, const char *dump_location);
+/* Counts the new problem 'dirname' towards the rate quota of its keys */
+#define quota_usage_admit abrt_quota_usage_admit
+void quota_usage_admit(struct abrt_quota_usage *usage, const char *dirname);
+/* Re-reads the problem or forgets it if it was deleted */
+#define quota_usage_update abrt_quota_usage_update
+void quota_usage_update(struct abrt_quota_usage *usage, const char *dirname);
+/* Returns malloced basename of the oldest problem sharing a class with the
+ * problem 'basename' whose size or count limit is exceeded, otherwise NULL.
+ * The problem 'busy' (may be NULL) is never returned. */
+#define quota_usage_find_victim abrt_quota_usage_find_victim
+char *quota_usage_find_victim(struct abrt_quota_usage *usage, const char *basename, const char *busy);
+#define quota_usage_remove abrt_quota_usage_remove
+void quota_usage_remove(struct abrt_quota_usage *usage, const char *basename);
+#define quota_usage_save abrt_quota_usage_save
+int quota_usage_save(struct abrt_quota_usage *usage);
+#define quota_usage_free abrt_quota_usage_free
+void quota_usage_free(struct abrt_quota_usage *usage);
+
+struct abrt_quota_class_usage
+{
+    enum abrt_quota_class class;
+    char *key;
+    unsigned long long size;
+    unsigned count;
+    unsigned recent;    /* problems admitted in the last hour */
+};
+/* Returns a list of malloced struct abrt_quota_class_usage saved by abrtd */
+#define quota_load_usage abrt_quota_load_usage
+GList *quota_load_usage(void);
+#define quota_class_usage_free abrt_quota_class_usage_free
+void quota_class_usage_free(struct abrt_quota_class_usage *usage);
+
+/* Problem pipeline journal
+ *
+ * Hooks, abrt-server and abrtd append the stages the problems reach to an
+ * append-only journal, so abrtd resumes only the unfinished problems after
+ * a restart instead of scanning the whole dump location.
+ */
+enum abrt_pipeline_stage
+{
+    ABRT_PIPELINE_CREATED,      /* the hook notified abrtd */
+    ABRT_PIPELINE_QUEUED,       /* waiting for post-create */
+    ABRT_PIPELINE_POST_CREATE,  /* post-create is running */
+    ABRT_PIPELINE_STEP,         /* a post-create rule finished */
+    ABRT_PIPELINE_DONE,         /* post-create finished */
+    ABRT_PIPELINE_ANALYSIS,     /* deferred analysis is pending */
+    ABRT_PIPELINE_ANALYZED,     /* deferred analysis finished */
+    ABRT_PIPELINE_REMOVED,      /* the problem was deleted */
+    ABRT_PIPELINE_STAGE_COUNT,
+};
+
+struct abrt_pipeline_entry
+{
+    char *dirname;
+    enum abrt_pipeline_stage stage;
+    unsigned step;              /* finished post-create rules */
+    bool analysis_pending;
+};
+
+#define pipeline_stage_name abrt_pipeline_stage_name
+const char *pipeline_stage_name(enum abrt_pipeline_stage stage);
+#define pipeline_journal_append abrt_pipeline_journal_append
+int pipeline_journal_append(const char *dirname, enum abrt_pipeline_stage stage, unsigned step);
+/* Rewrites the journal with the unfinished problems only if it is larger
+ * than min_size and returns list of malloced struct abrt_pipeline_entry of
+ * them in *unfinished. Returns -ENOENT if there was no journal. */
+#define pipeline_journal_compact abrt_pipeline_journal_compact
+int pipeline_journal_compact(off_t min_size, GList **unfinished);
+#define pipeline_entry_free abrt_pipeline_entry_free
+void pipeline_entry_free(struct abrt_pipeline_entry *entry);
+/* Note: should be public since unit tests need to call it, NULL restores
+ * the default journal file */
+#define pipeline_journal_set_file abrt_pipeline_journal_set_file
+void pipeline_journal_set_file(const char *path);
+
+/* All-thread core backtraces
+ *
+ * abrt-hook-ccpp unwinds the threads of the crashed process in a pool of
+ * worker processes and joins their results into one core backtrace.
+ */
+/* Points jsons[worker], jsons[worker + workers], ... to the '\0' terminated
+ * results in the output of the worker, the results the worker did not finish
+ * are left untouched */
+#define core_backtrace_split_worker_output abrt_core_backtrace_split_worker_output
+void core_backtrace_split_worker_output(const char *output, size_t len,
+                                        unsigned worker, unsigned workers,
+                                        const char **jsons, unsigned count);
+/* Returns malloced JSON core backtrace of the threads with at most max_frames
+ * frames each or NULL if the crash thread jsons[0] is missing or invalid.
+ * The other missing or invalid threads are skipped. */
+#define core_backtrace_join_threads abrt_core_backtrace_join_threads
+char *core_backtrace_join_threads(const char *const *jsons, const pid_t *tids,
+                                  unsigned count, unsigned max_frames);
+
+/* Python exception duphashes
+ *
+ * The hash of the exception type and the file, function and line of every
+ * frame. The exception message with parts matching message masks replaced
+ * by '*' is hashed only if asked for.
+ */
+/* UUID and DUPHASH of older versions computed from the first line of the
+ * backtrace, duplicates of problems created by them are found by it */
+#define FILENAME_LEGACY_DUPHASH "legacy_duphash"
+/* Splits the comma separated list of POSIX extended regular expressions,
+ * commas inside brackets and braces are a part of the expression. Returns
+ * GList of malloced strings. */
+#define python_duphash_parse_masks abrt_python_duphash_parse_masks
+GList *python_duphash_parse_masks(const char *value);
+/* Returns malloced message with parts matching any of the NULL terminated
+ * masks replaced by '*', NULL means the default masks */
+#define python_duphash_mask_message abrt_python_duphash_mask_message
+char *python_duphash_mask_message(const char *message, const char *const *masks);
+/* Returns 0 or -1 if the backtrace has no parseable frames */
+#define python_duphash_str abrt_python_duphash_str
+int python_duphash_str(char hash_str[SHA1_RESULT_LEN*2 + 1], const char *backtrace,
+                       bool include_message, const char *const *message_masks);
+#define python_legacy_duphash_str abrt_python_legacy_duphash_str
+void python_legacy_duphash_str(char hash_str[SHA1_RESULT_LEN*2 + 1], const char *backtrace);
+
+/* Symbolization service
+ *
+ * abrt-symbolizer keeps symbol and line tables of recently seen build-ids in
+ * memory and resolves frames of core backtraces without running gdb.
+ */
+#define SYMBOLIZER_SOCKET_FILE VAR_RUN"/abrt/symbolizer.socket"
+#define FILENAME_SYMBOLIZED_BACKTRACE "symbolized_backtrace"
+/* Sends the core backtrace in the JSON format to abrt-symbolizer and returns
+ * malloced human readable backtrace or NULL if the service is not running or
+ * cannot parse the core backtrace. */
+#define symbolize_core_backtrace abrt_symbolize_core_backtrace
+char *symbolize_core_backtrace(const char *core_backtrace, unsigned timeout_sec);
+
+/* Cold storage
+ *
+ * abrt-cold-storage copies aged problems to ColdDumpLocation and compresses
+ * their core dumps on the way.
+ */
+struct abrt_cold_storage_stats
+{
+    unsigned long long problems;
+    unsigned long long original_bytes;  /* sizes of migrated problems */
+    unsigned long long stored_bytes;    /* sizes of them in the cold storage */
+};
+/* Limits the data read from the hot storage */
+struct abrt_cold_storage_throttle
+{
+    unsigned long long rate;    /* bytes per second, 0 for unlimited */
+    unsigned long long bytes;
+    struct timespec start;
+};
+#define cold_storage_throttle_init abrt_cold_storage_throttle_init
+void cold_storage_throttle_init(struct abrt_cold_storage_throttle *throttle, unsigned rate_kib);
+/* Copies the problem directory to dst_dir keeping owners and modes. Core dumps
+ * of min_size bytes and bigger are compressed by xz and listed in
+ * FILENAME_COLD_COMPRESSED. Adds the sizes to stats, returns 0 on success. */
+#define cold_storage_copy_problem abrt_cold_storage_copy_problem
+int cold_storage_copy_problem(const char *src_dir, const char *dst_dir, off_t min_size,
+                              struct abrt_cold_storage_throttle *throttle,
+                              struct abrt_cold_storage_stats *stats);
+/* Decompresses the elements listed in FILENAME_COLD_COMPRESSED next to their
+ * compressed copies. Returns 0 on success. */
+#define cold_storage_expand_problem abrt_cold_storage_expand_problem
+int cold_storage_expand_problem(struct dump_dir *dd);
+/* Removes a partially migrated problem directory */
+#define cold_storage_remove_tree abrt_cold_storage_remove_tree
+void cold_storage_remove_tree(const char *path);
+
+/* Crash clusters
+ *
+ * Problems of different executables crashing in the same function of the same
+ * shared library form a cluster. The cluster is identified by a hash of the
+ * build-id of the library and names (or offsets) of the top frames within it.
+ * The first problem of a cluster is its leader.
+ */
+#define FILENAME_CLUSTER_HASH   "cluster_hash"
+#define FILENAME_CLUSTER_MODULE "cluster_module"
+/* Directory of the cluster leader, saved only in the other problems */
+#define FILENAME_CLUSTER_LEADER "cluster_leader"
+/* Returns malloced cluster hash of the core backtrace in the JSON format or
+ * NULL if the crash is not in a shared library. Stores malloced path of the
+ * library in *module if module is not NULL. */
+#define crash_cluster_hash abrt_crash_cluster_hash
+char *crash_cluster_hash(const char *core_backtrace, const char *executable, char **module);
+/* Adds the problem to the cluster registry in VAR_STATE. Stores malloced
+ * directory name of the cluster leader in *leader, it is dirname if the
+ * problem is the first existing problem of the cluster. */
+#define crash_cluster_register abrt_crash_cluster_register
+int crash_cluster_register(const char *hash, const char *dirname, char **leader);
+
+/* Analysis cache
+ *
+ * Results of expensive analyses (debuginfo installation and gdb backtrace,
+ * exploitability rating) shared by problems with the same crash. The key is
+ * made of the analyzer name and version, the sorted set of build-ids of the
+ * mapped modules and build-id offsets of the crash thread frames. The caller
+ * must compute the key from data abrt produced itself, elements sent by
+ * clients would let them store results for other crashes.
+ *
+ * The cache directory is created with mode 0700. All functions refuse to use
+ * a cache directory not owned by the effective user or accessible to others
+ * (-EPERM) and don't follow symbolic links in it.
+ */
+/* A line per cache hit: the key followed by names of host specific elements */
+#define FILENAME_ANALYSIS_CACHE "analysis_cache"
+struct analysis_cache_stats
+{
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long stores;
+    unsigned long long evictions;
+    /* Current state, filled only by analysis_cache_get_stats() */
+    unsigned long long entries;
+    unsigned long long size;
+};
+/* Returns malloced key or NULL if the core backtrace cannot be parsed or
+ * does not have a crash thread. build_ids is the content of the build_ids
+ * element (a build-id per line), NULL means build-ids of all frames of the
+ * core backtrace. */
+#define analysis_cache_key abrt_analysis_cache_key
+char *analysis_cache_key(const char *analyzer, const char *build_ids, const char *core_backtrace);
+/* Copies the cached elements to the problem and saves FILENAME_ANALYSIS_CACHE.
+ * Returns 1 on hit, 0 on miss and negative errno if the cache is unusable. */
+#define analysis_cache_lookup abrt_analysis_cache_lookup
+int analysis_cache_lookup(const char *cache_dir, const char *key, struct dump_dir *dd);
+/* Stores the elements of the problem, the host_specific ones (a subset of
+ * elements, may be NULL) are stored stripped of data of the crashed process.
+ * Both lists are NULL terminated. Elements the problem does not have are
+ * removed on hit. The least recently used entries are evicted while the cache
+ * is bigger than max_size bytes, 0 means unlimited. Returns 0 on success
+ * or if the entry already exists, negative errno otherwise. */
+#define analysis_cache_store abrt_analysis_cache_store
+int analysis_cache_store(const char *cache_dir, const char *key, struct dump_dir *dd,
+                         const char *const *elements, const char *const *host_specific,
+                         unsigned long long max_size);
+/* Returns malloced gdb backtrace without values of arguments, local
+ * variables, registers and other data of the crashed process */
+#define analysis_cache_strip_host_specific abrt_analysis_cache_strip_host_specific
+char *analysis_cache_strip_host_specific(const char *backtrace);
+/* Returns 0 or negative errno if the cache is unusable */
+#define analysis_cache_get_stats abrt_analysis_cache_get_stats
+int analysis_cache_get_stats(const char *cache_dir, struct analysis_cache_stats *stats);
+
+/* Crash staging ring
+ *
+ * A bounded directory on tmpfs where abrt-hook-ccpp saves crashes while abrtd
+ * is not running (early boot, shutdown). abrtd moves them to the dump
+ * location when it starts, before processing anything else, and watches the
+ * ring for crashes staged while it is starting or stopping.
+ */
+#define ABRT_STAGING_RING_DIR VAR_RUN"/abrt/staging"
+/* Makes room for a new crash by removing the oldest staged crashes, so at
+ * most slots - 1 of them are left. Returns the number of removed crashes, they
+ * are counted as dropped. */
+#define staging_ring_reserve abrt_staging_ring_reserve
+unsigned staging_ring_reserve(const char *ring_dir, unsigned slots);
+/* Moves the staged crashes to dump_location and appends malloced paths of
+ * the new problem directories to *imported. Returns the number of crashes
+ * dropped since the last import. */
+#define staging_ring_import abrt_staging_ring_import
+unsigned staging_ring_import(const char *ring_dir, const char *dump_location, GList **imported);
+
+/* Delta-encoded cores
+ *
+ * The first core of an executable build with the same layout of mappings
+ * is a reference, later cores are stored as differences against it. The
+ * reference is hard linked to the problems using it and removed when none
+ * of them exists.
+ */
+#define FILENAME_COREDUMP_DELTA     "coredump_delta"
+#define FILENAME_COREDUMP_REFERENCE "coredump_reference"
+/* Returns malloced hex build-id of the ELF file or NULL */
+#define delta_core_build_id abrt_delta_core_build_id
+char *delta_core_build_id(int elf_fd);
+/* Returns malloced key of cores of the user's process of the executable with
+ * the build-id and the content of /proc/PID/maps */
+#define delta_core_key abrt_delta_core_key
+char *delta_core_key(uid_t uid, const char *build_id, const char *maps);
+/* Returns malloced path of the directory of references next to DumpLocation */
+#define delta_core_reference_dir abrt_delta_core_reference_dir
+char *delta_core_reference_dir(void);
+/* Makes the core a reference for the key. Returns 0 on success. */
+#define delta_core_register_reference abrt_delta_core_register_reference
+int delta_core_register_reference(const char *ref_dir, const char *key, const char *core_path);
+/* Saves at most limit bytes of the core read from in_fd as
+ * FILENAME_COREDUMP_DELTA and links the reference as
+ * FILENAME_COREDUMP_REFERENCE. Returns the size of the core, -ENOENT if there
+ * is no reference and nothing was read, other negative values on errors. */
+#define delta_core_encode abrt_delta_core_encode
+ssize_t delta_core_encode(const char *ref_dir, const char *key, struct dump_dir *dd,
+                          int in_fd, size_t limit);
+/* Writes the core of the problem with a delta core to out_fd */
+#define delta_core_restore abrt_delta_core_restore
+int delta_core_restore(const char *problem_dir, int out_fd);
+/* Removes references not used by any problem, returns their number */
+#define delta_core_collect_references abrt_delta_core_collect_references
+unsigned delta_core_collect_references(const char *ref_dir);
+/* Size of the problem directory, a reference core is shared by the problems
+ * linking it and each of them counts only its part */
+#define problem_dir_size abrt_problem_dir_size
+double problem_dir_size(const char *dirname);
+/* get_dirsize_find_largest_dir() counting problems by problem_dir_size() */
+#define dump_location_size abrt_dump_location_size
+double dump_location_size(const char *dirname, char **worst_dir, const char *excluded);
+
+/* Compat cores made from the ABRT core
+ *
+ * The first prefix_size bytes of the destination of size bytes are made from
+ * the beginning of the source, the rest has been written already. The
+ * prefix must be a multiple of the block size unless it is the whole
+ * source.
+ */
+/* Shares the data blocks with the source, fails on file systems without
+ * reflinks (btrfs and XFS have them). Returns 0 or -1 with errno set. */
+#define clone_core_prefix abrt_clone_core_prefix
+int clone_core_prefix(int src_fd, int dst_fd, off_t prefix_size, off_t size);
+/* Copies the data, returns size or -1 with errno set */
+#define copy_core_prefix abrt_copy_core_prefix
+off_t copy_core_prefix(int src_fd, int dst_fd, off_t prefix_size, off_t size);
+
+/* Page cache neutral I/O of cores
+ *
+ * Cores can be larger than the free memory. Writing or reading them through
+ * the page cache would evict the working set of the surviving services.
+ * Writers of cores start the writeback of every ABRT_WRITE_BEHIND_WINDOW
+ * bytes and drop the pages of the window written before, readers hint the
+ * kernel to read the core once and drop its pages when they are done.
+ */
+#define ABRT_WRITE_BEHIND_WINDOW (8 * 1024 * 1024)
+struct abrt_write_behind
+{
+    int fd;
+    off_t window;
+    off_t flushing;     /* window under writeback */
+    off_t unflushed;    /* window being written */
+    off_t written;
+    off_t max_cached;   /* the most written bytes whose pages were not dropped */
+};
+/* Starts at the current offset of fd */
+#define write_behind_init abrt_write_behind_init
+void write_behind_init(struct abrt_write_behind *wb, int fd);
+/* The same with windows of another size than ABRT_WRITE_BEHIND_WINDOW */
+#define write_behind_init_window abrt_write_behind_init_window
+void write_behind_init_window(struct abrt_write_behind *wb, int fd, off_t window);
+/* Call after writing (or seeking over) size bytes */
+#define write_behind_wrote abrt_write_behind_wrote
+void write_behind_wrote(struct abrt_write_behind *wb, off_t size);
+/* Waits for the writeback of the rest and drops its pages */
+#define write_behind_finish abrt_write_behind_finish
+void write_behind_finish(struct abrt_write_behind *wb);
+#define advise_read_once abrt_advise_read_once
+void advise_read_once(int fd);
+/* Drops clean pages of the file, e.g. after an analyzer read the core */
+#define drop_page_cache abrt_drop_page_cache
+void drop_page_cache(int fd);
+#define drop_file_page_cache abrt_drop_file_page_cache
+void drop_file_page_cache(const char *path);
+
+/* Problem search index
+ *
+ * An inverted index of words of selected elements (reason, executable,
+ * component, package, cmdline, crash thread frames or backtrace text and
+ * cluster hash) remembering also owner and mode of problem directories, so
+ * searches neither read elements nor touch the directories.
+ */
+struct abrt_problem_index;
+#define problem_index_new abrt_problem_index_new
+struct abrt_problem_index *problem_index_new(void);
+#define problem_index_free abrt_problem_index_free
+void problem_index_free(struct abrt_problem_index *index);
+#define problem_index_size abrt_problem_index_size
+unsigned problem_index_size(struct abrt_problem_index *index);
+/* Path NULL means the default index file in VAR_STATE. Load returns -ENOENT
+ * if there is no index file yet. Save writes the file only if the index was
+ * changed since load or the last save. */
+#define problem_index_load abrt_problem_index_load
+int problem_index_load(struct abrt_problem_index *index, const char *path);
+#define problem_index_save abrt_problem_index_save
+int problem_index_save(struct abrt_problem_index *index, const char *path);
+/* Indexes the problem unless none of the indexed elements and access rights
+ * of the directory has changed since it was indexed. Returns 1 if the problem
+ * was indexed, 0 if it was up to date and negative errno if the directory
+ * cannot be opened (the problem is removed from the index then). */
+#define problem_index_update abrt_problem_index_update
+int problem_index_update(struct abrt_problem_index *index, const char *dirname);
+#define problem_index_remove abrt_problem_index_remove
+void problem_index_remove(struct abrt_problem_index *index, const char *dirname);
+/* Problems which were not updated between these calls are removed from the
+ * index. Returns the number of removed problems. */
+#define problem_index_begin_sync abrt_problem_index_begin_sync
+void problem_index_begin_sync(struct abrt_problem_index *index);
+#define problem_index_end_sync abrt_problem_index_end_sync
+unsigned problem_index_end_sync(struct abrt_problem_index *index);
+/* The query is a list of words separated by white space, all of them must
+ * match. A word can be restricted to a field ("executable:firefox") and can
+ * end with '*' to match all words with the prefix ("libxul*"). Stores
+ * malloced directory names of matching problems accessible by caller_uid in
+ * *dirnames. Returns -EINVAL if the query is not valid or has no word to
+ * search for. */
+#define problem_index_search abrt_problem_index_search
+int problem_index_search(struct abrt_problem_index *index, const char *query,
+                         uid_t caller_uid, GList **dirnames);
+/* Returns a table of clusters (see crash_cluster_hash()) having at least two
+ * problems accessible by caller_uid. Keys are cluster hashes, values are
+ * GLists of malloced directory names. Free it with g_hash_table_destroy(). */
+#define problem_index_get_clusters abrt_problem_index_get_clusters
+GHashTable *problem_index_get_clusters(struct abrt_problem_index *index, uid_t caller_uid);
+
+/* Problem status
+ *
+ * Counts of problems of every user for the login notification. abrtd keeps
+ * them in memory and saves a small file per user whenever a problem is
+ * created, updated or deleted, so 'abrt-cli status' reads one or two files
+ * instead of loading all problems.
+ */
+struct abrt_problem_status;
+#define problem_status_new abrt_problem_status_new
+struct abrt_problem_status *problem_status_new(void);
+#define problem_status_free abrt_problem_status_free
+void problem_status_free(struct abrt_problem_status *status);
+#define problem_status_scan abrt_problem_status_scan
+struct abrt_problem_status *problem_status_scan(const char *dump_location);
+/* Re-reads the problem, removes it if the directory cannot be opened */
+#define problem_status_update abrt_problem_status_update
+void problem_status_update(struct abrt_problem_status *status, const char *dirname);
+#define problem_status_remove abrt_problem_status_remove
+void problem_status_remove(struct abrt_problem_status *status, const char *dirname);
+/* Re-reads only new problems and problems whose uid, last_occurrence or
+ * reported_to changed since they were read, forgets the deleted ones.
+ * Returns the number of changes. */
+#define problem_status_refresh abrt_problem_status_refresh
+unsigned problem_status_refresh(struct abrt_problem_status *status, const char *dump_location);
+/* Dir NULL means the default status directory in VAR_RUN */
+#define problem_status_save abrt_problem_status_save
+int problem_status_save(struct abrt_problem_status *status, const char *dir);
+/* Stores the number of not reported problems of the user (all problems for
+ * root) which occurred at 'since' or later in *count. Returns -ENOENT if
+ * abrtd doesn't publish the status. */
+#define problem_status_count abrt_problem_status_count
+int problem_status_count(const char *dir, uid_t uid, time_t since, unsigned *count);
+
+/* Host facts snapshot
+ *
+ * Facts which are the same for all problems of a boot (see
+ * host_facts_elements) are collected once and stored in a snapshot
+ * directory named by the hash of its contents (generation). Problems refer
+ * to the snapshot by the generation saved in FILENAME_HOST_FACTS instead of
+ * holding copies of the facts.
+ */
+#define FILENAME_HOST_FACTS "host_facts"
+#ifndef FILENAME_MACHINEID
+#define FILENAME_MACHINEID "machineid"
+#endif
+
+/* The directory of the snapshots, $ABRT_HOST_FACTS_DIR overrides it */
+#define host_facts_dir abrt_host_facts_dir
+const char *host_facts_dir(void);
+#define host_facts_elements abrt_host_facts_elements
+extern const char *const host_facts_elements[];
+#define host_facts_is_element abrt_host_facts_is_element
+bool host_facts_is_element(const char *name);
+/* Returns malloced path or NULL if the generation is not valid */
+#define host_facts_generation_dir abrt_host_facts_generation_dir
+char *host_facts_generation_dir(const char *generation);
+/* Returns malloced string which changes whenever the facts may change */
+#define host_facts_fingerprint abrt_host_facts_fingerprint
+char *host_facts_fingerprint(void);
+/* Returns malloced generation or NULL if there is no up-to-date snapshot */
+#define host_facts_current_generation abrt_host_facts_current_generation
+char *host_facts_current_generation(void);
+#define host_facts_set_current_generation abrt_host_facts_set_current_generation
+int host_facts_set_current_generation(const char *generation, const char *fingerprint);
+/* Returns malloced value of the fact or NULL */
+#define host_facts_load abrt_host_facts_load
+char *host_facts_load(const char *generation, const char *name);
+/* Returns malloced value of the fact if the problem directory refers to
+ * a snapshot instead of holding the element */
+#define host_facts_load_from_dump_dir abrt_host_facts_load_from_dump_dir
+char *host_facts_load_from_dump_dir(struct dump_dir *dd, const char *name);
+
 /* Note: should be public since unit tests need to call it */
 #define koops_extract_version abrt_koops_extract_version
 char *koops_extract_version(const char *line);
@@ -160,6 +773,113 @@ struct abrt_koops_line_info {
 void koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_koops_line_info *lines_info, int lines_info_size);
 #define koops_extract_oopses abrt_koops_extract_oopses
 void koops_extract_oopses(GList **oops_list, char *buffer, size_t buflen);
+/**
+ * Extracts reports of the kernel OOM killer
+ *
+ * A report starts with the "invoked oom-killer:" line and ends with the
+ * "Killed process" line. Reports without a killed process (e.g. panic_on_oom)
+ * are ignored. Appends malloced reports to oom_list.
+ */
+#define KOOPS_OOM_START_STRING "invoked oom-killer:"
+#define koops_extract_oom_kills_from_lines abrt_koops_extract_oom_kills_from_lines
+void koops_extract_oom_kills_from_lines(GList **oom_list, const struct abrt_koops_line_info *lines_info, int lines_info_size);
+
+struct abrt_koops_oom
+{
+    char *constraint;       /* CONSTRAINT_NONE, CONSTRAINT_MEMCG, ... */
+    char *memcg;            /* cgroup whose limit was hit, "/" for global OOM */
+    char *task_memcg;       /* cgroup of the victim, NULL if unknown */
+    char *victim;           /* name of the killed process */
+    unsigned long victim_pid;
+    long victim_uid;        /* -1 if unknown */
+    char *trace;            /* the report without memory summary and task table */
+    char *meminfo;          /* memory summary, NULL if missing */
+    char *tasks;            /* task table, NULL if missing */
+};
+/**
+ * Parses an OOM report extracted by koops_extract_oom_kills_from_lines()
+ *
+ * @returns 0 on success, -1 if the report has no killed process
+ */
+#define koops_oom_parse abrt_koops_oom_parse
+int koops_oom_parse(const char *report, struct abrt_koops_oom *oom);
+#define koops_oom_free abrt_koops_oom_free
+void koops_oom_free(struct abrt_koops_oom *oom);
+/* Returns malloced systemd unit of the victim's cgroup or the cgroup itself */
+#define koops_oom_cgroup_key abrt_koops_oom_cgroup_key
+char *koops_oom_cgroup_key(const struct abrt_koops_oom *oom);
+/* Duplicates have the same cgroup key, victim and constraint */
+#define koops_oom_hash_str abrt_koops_oom_hash_str
+void koops_oom_hash_str(char hash_str[SHA1_RESULT_LEN*2 + 1], const struct abrt_koops_oom *oom);
+/**
+ * Extracts reports of kernel latency stalls
+ *
+ * Hung task, soft lockup and RCU stall reports are extracted together with
+ * all task and CPU stacks dumped with them. Consecutive reports of the same
+ * kind (e.g. several blocked tasks or several locked up CPUs) are extracted
+ * as a single report. Appends malloced reports to stall_list.
+ */
+#define koops_extract_stalls_from_lines abrt_koops_extract_stalls_from_lines
+void koops_extract_stalls_from_lines(GList **stall_list, const struct abrt_koops_line_info *lines_info, int lines_info_size);
+/* Removes oopses which are beginnings of stall reports (soft lockups) */
+#define koops_drop_stall_oopses abrt_koops_drop_stall_oopses
+void koops_drop_stall_oopses(GList **oops_list);
+/* Returns list of static strings starting stall reports, free only the list */
+#define koops_stall_strings_list abrt_koops_stall_strings_list
+GList *koops_stall_strings_list(void);
+
+enum abrt_koops_stall_kind
+{
+    ABRT_KOOPS_STALL_HUNG_TASK,
+    ABRT_KOOPS_STALL_SOFT_LOCKUP,
+    ABRT_KOOPS_STALL_RCU,
+};
+
+struct abrt_koops_stall
+{
+    enum abrt_koops_stall_kind kind;
+    unsigned long duration; /* the longest one, seconds or jiffies for RCU stalls */
+    char *cpus;             /* comma separated stalled CPUs, NULL if unknown */
+    char *tasks;            /* blocked or running tasks, "comm:pid" per line, NULL if unknown */
+    char *stacks;           /* sorted normalized stacks, a stack per line, NULL if none */
+    char *crash_function;   /* innermost interesting frame of the first stack */
+    char *kernel;           /* kernel version, NULL if not in the report */
+};
+/**
+ * Parses a stall report extracted by koops_extract_stalls_from_lines()
+ *
+ * @returns 0 on success, -1 if the report does not start with a stall
+ */
+#define koops_stall_parse abrt_koops_stall_parse
+int koops_stall_parse(const char *report, struct abrt_koops_stall *stall);
+#define koops_stall_free abrt_koops_stall_free
+void koops_stall_free(struct abrt_koops_stall *stall);
+/* Returns "hung_task", "soft_lockup" or "rcu_stall" */
+#define koops_stall_kind_name abrt_koops_stall_kind_name
+const char *koops_stall_kind_name(enum abrt_koops_stall_kind kind);
+/* Duplicates are stalls of the same kind with the same set of stacks */
+#define koops_stall_hash_str abrt_koops_stall_hash_str
+void koops_stall_hash_str(char hash_str[SHA1_RESULT_LEN*2 + 1], const struct abrt_koops_stall *stall);
+/**
+ * Extracts oopses from /dev/kmsg records
+ *
+ * The buffer holds records in the format returned by read(2) of /dev/kmsg
+ * ("PRIO,SEQ,TIMESTAMP,FLAGS;MESSAGE\n" followed by optional " KEY=VALUE\n"
+ * lines), i.e. 'cat /dev/kmsg' output can be replayed.
+ *
+ * Records with the sequence number lower than *next_seq and records not
+ * logged by kernel are ignored. *next_seq is updated to the sequence number
+ * following the last parsed record.
+ *
+ * OOM kill reports are extracted to oom_list if it is not NULL. Stall
+ * reports are extracted to stall_list if it is not NULL and soft lockups
+ * are not reported as oopses then.
+ *
+ * @returns the number of processed records
+ */
+#define koops_extract_oopses_from_kmsg abrt_koops_extract_oopses_from_kmsg
+int koops_extract_oopses_from_kmsg(GList **oops_list, GList **oom_list, GList **stall_list,
+                                   const char *buffer, size_t buflen, unsigned long long *next_seq);
 #define koops_suspicious_strings_list abrt_koops_suspicious_strings_list
 GList *koops_suspicious_strings_list(void);
 #define koops_print_suspicious_strings abrt_koops_print_suspicious_strings
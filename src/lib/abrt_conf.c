@@ -29,6 +29,21 @@ char *        g_settings_autoreporting_event = NULL;
 bool          g_settings_shortenedreporting = 0;
 bool          g_settings_explorechroots = 0;
 unsigned int  g_settings_debug_level = 0;
+bool          g_settings_deferred_analysis = 0;
+unsigned int  g_settings_deferred_analysis_max_load = 50;
+unsigned int  g_settings_deferred_analysis_max_pressure = 10;
+int           g_settings_deferred_analysis_window_from = -1;
+int           g_settings_deferred_analysis_window_to = -1;
+struct abrt_quota_limit g_settings_quota[ABRT_QUOTA_CLASS_COUNT];
+bool          g_settings_over_quota_reject = 0;
+char *        g_settings_cold_dump_location = NULL;
+unsigned int  g_settings_cold_after_days = 7;
+unsigned int  g_settings_cold_compress_min_size = 1024;
+unsigned int  g_settings_cold_migration_rate = 10240;
+unsigned int  g_settings_cold_max_size = 0;
+unsigned int  g_settings_post_create_budget = 0;
+char *        g_settings_analysis_cache_location = NULL;
+unsigned int  g_settings_analysis_cache_max_size = 1024;
 
 void free_abrt_conf_data()
 {
@@ -40,6 +55,12 @@ void free_abrt_conf_data()
 
     free(g_settings_autoreporting_event);
     g_settings_autoreporting_event = NULL;
+
+    free(g_settings_cold_dump_location);
+    g_settings_cold_dump_location = NULL;
+
+    free(g_settings_analysis_cache_location);
+    g_settings_analysis_cache_location = NULL;
 }
 
 /* Beware - the function normalizes only slashes - that's the most often
@@ -65,6 +86,40 @@ static char *xstrdup_normalized_path(const char *path)
     return res;
 }
 
+/* Parses "HH:MM-HH:MM" into minutes since midnight.
+ * Returns 0 on success.
+ */
+static int parse_time_window(const char *value, int *from, int *to)
+{
+    unsigned from_h, from_m, to_h, to_m;
+    int consumed = 0;
+    if (sscanf(value, "%u:%u-%u:%u%n", &from_h, &from_m, &to_h, &to_m, &consumed) != 4
+        || value[consumed] != '\0'
+        || from_h > 23 || to_h > 23 || from_m > 59 || to_m > 59)
+        return -1;
+
+    *from = from_h * 60 + from_m;
+    *to = to_h * 60 + to_m;
+    return 0;
+}
+
+/* Parses "SIZE COUNT RATE" of a quota class, 0 means unlimited.
+ * Returns 0 on success.
+ */
+static int parse_quota(const char *value, struct abrt_quota_limit *limit)
+{
+    unsigned size, count, rate;
+    int consumed = 0;
+    if (sscanf(value, "%u %u %u %n", &size, &count, &rate, &consumed) != 3
+        || value[consumed] != '\0')
+        return -1;
+
+    limit->size = size;
+    limit->count = count;
+    limit->rate = rate;
+    return 0;
+}
+
 static void ParseCommon(map_string_t *settings, const char *conf_filename)
 {
     const char *value;
@@ -121,6 +176,9 @@ static void ParseCommon(map_string_t *settings, const char *conf_filename)
     else
         g_settings_autoreporting_event = xstrdup("report_uReport");
 
+    /* Read by abrt-action-notify */
+    remove_map_string_item(settings, "AutoreportingOncePerCluster");
+
     value = get_map_string_item_or_NULL(settings, "ShortenedReporting");
     if (value)
     {
@@ -156,6 +214,151 @@ static void ParseCommon(map_string_t *settings, const char *conf_filename)
         remove_map_string_item(settings, "DebugLevel");
     }
 
+    value = get_map_string_item_or_NULL(settings, "DeferredAnalysis");
+    if (value)
+    {
+        g_settings_deferred_analysis = string_to_bool(value);
+        remove_map_string_item(settings, "DeferredAnalysis");
+    }
+    else
+        g_settings_deferred_analysis = false;
+
+    value = get_map_string_item_or_NULL(settings, "DeferredAnalysisMaxLoad");
+    if (value)
+    {
+        char *end;
+        errno = 0;
+        unsigned long ul = strtoul(value, &end, 10);
+        if (errno || end == value || *end != '\0' || ul > INT_MAX)
+            error_msg("Error parsing %s setting: '%s'", "DeferredAnalysisMaxLoad", value);
+        else
+            g_settings_deferred_analysis_max_load = ul;
+        remove_map_string_item(settings, "DeferredAnalysisMaxLoad");
+    }
+
+    value = get_map_string_item_or_NULL(settings, "DeferredAnalysisMaxPressure");
+    if (value)
+    {
+        char *end;
+        errno = 0;
+        unsigned long ul = strtoul(value, &end, 10);
+        if (errno || end == value || *end != '\0' || ul > 100)
+            error_msg("Error parsing %s setting: '%s'", "DeferredAnalysisMaxPressure", value);
+        else
+            g_settings_deferred_analysis_max_pressure = ul;
+        remove_map_string_item(settings, "DeferredAnalysisMaxPressure");
+    }
+
+    g_settings_deferred_analysis_window_from = -1;
+    g_settings_deferred_analysis_window_to = -1;
+    value = get_map_string_item_or_NULL(settings, "DeferredAnalysisWindow");
+    if (value)
+    {
+        if (value[0] != '\0'
+            && parse_time_window(value, &g_settings_deferred_analysis_window_from,
+                                        &g_settings_deferred_analysis_window_to) != 0)
+            error_msg("Error parsing %s setting: '%s'", "DeferredAnalysisWindow", value);
+        remove_map_string_item(settings, "DeferredAnalysisWindow");
+    }
+
+    static const char *const quota_options[ABRT_QUOTA_CLASS_COUNT] = {
+        [ABRT_QUOTA_UID]       = "UserQuota",
+        [ABRT_QUOTA_CONTAINER] = "ContainerQuota",
+        [ABRT_QUOTA_TYPE]      = "TypeQuota",
+    };
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+    {
+        memset(&g_settings_quota[class], 0, sizeof(g_settings_quota[class]));
+        value = get_map_string_item_or_NULL(settings, quota_options[class]);
+        if (value)
+        {
+            if (parse_quota(value, &g_settings_quota[class]) != 0)
+                error_msg("Error parsing %s setting: '%s'", quota_options[class], value);
+            remove_map_string_item(settings, quota_options[class]);
+        }
+    }
+
+    value = get_map_string_item_or_NULL(settings, "OverQuotaAction");
+    if (value)
+    {
+        if (strcmp(value, "reject") == 0)
+            g_settings_over_quota_reject = true;
+        else if (strcmp(value, "degrade") == 0)
+            g_settings_over_quota_reject = false;
+        else
+            error_msg("Error parsing %s setting: '%s'", "OverQuotaAction", value);
+        remove_map_string_item(settings, "OverQuotaAction");
+    }
+    else
+        g_settings_over_quota_reject = false;
+
+    value = get_map_string_item_or_NULL(settings, "ColdDumpLocation");
+    if (value)
+    {
+        if (value[0] != '\0')
+            g_settings_cold_dump_location = xstrdup_normalized_path(value);
+        remove_map_string_item(settings, "ColdDumpLocation");
+    }
+
+    static const struct {
+        const char *name;
+        unsigned int *setting;
+    } cold_options[] = {
+        { "ColdAfterDays",           &g_settings_cold_after_days },
+        { "ColdCompressMinSize",     &g_settings_cold_compress_min_size },
+        { "ColdMigrationRate",       &g_settings_cold_migration_rate },
+        { "ColdMaxCrashReportsSize", &g_settings_cold_max_size },
+    };
+    for (unsigned i = 0; i < ARRAY_SIZE(cold_options); ++i)
+    {
+        value = get_map_string_item_or_NULL(settings, cold_options[i].name);
+        if (!value)
+            continue;
+
+        char *end;
+        errno = 0;
+        unsigned long ul = strtoul(value, &end, 10);
+        if (errno || end == value || *end != '\0' || ul > INT_MAX)
+            error_msg("Error parsing %s setting: '%s'", cold_options[i].name, value);
+        else
+            *cold_options[i].setting = ul;
+        remove_map_string_item(settings, cold_options[i].name);
+    }
+
+    value = get_map_string_item_or_NULL(settings, "PostCreateBudget");
+    if (value)
+    {
+        char *end;
+        errno = 0;
+        unsigned long ul = strtoul(value, &end, 10);
+        if (errno || end == value || *end != '\0' || ul > INT_MAX)
+            error_msg("Error parsing %s setting: '%s'", "PostCreateBudget", value);
+        else
+            g_settings_post_create_budget = ul;
+        remove_map_string_item(settings, "PostCreateBudget");
+    }
+
+    value = get_map_string_item_or_NULL(settings, "AnalysisCacheLocation");
+    if (value)
+    {
+        if (value[0] != '\0')
+            g_settings_analysis_cache_location = xstrdup_normalized_path(value);
+        remove_map_string_item(settings, "AnalysisCacheLocation");
+    }
+
+    value = get_map_string_item_or_NULL(settings, "AnalysisCacheMaxSize");
+    if (value)
+    {
+        char *end;
+        errno = 0;
+        unsigned long ul = strtoul(value, &end, 10);
+        if (errno || end == value || *end != '\0' || ul > INT_MAX)
+            error_msg("Error parsing %s setting: '%s'", "AnalysisCacheMaxSize", value);
+        else
+            g_settings_analysis_cache_max_size = ul;
+        remove_map_string_item(settings, "AnalysisCacheMaxSize");
+    }
+
     GHashTableIter iter;
     const char *name;
     /*char *value; - already declared */
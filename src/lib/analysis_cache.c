@@ -0,0 +1,696 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/thread.h>
+#include <satyr/core/frame.h>
+#include "libabrt.h"
+
+/*
+ * The cache is a directory with an entry directory per key. An entry holds
+ * copies of the cached elements and a manifest with a line per element:
+ *
+ *   NAME present|absent|host
+ *
+ * Absent elements were not created by the analyzer and are removed from the
+ * problem on hit. Host specific elements are stored without data of the
+ * crashed process (see analysis_cache_strip_host_specific()).
+ *
+ * Entries are created in a temporary directory and renamed, so readers never
+ * see incomplete entries. A hit touches the entry directory, the least
+ * recently used entries are evicted when the cache is larger than its limit.
+ *
+ * Cached backtraces come from crashes of all users. The cache directory must
+ * be accessible only to its owner, the effective user, and no symbolic links
+ * are followed in it.
+ */
+#define ANALYSIS_CACHE_KEY_VERSION "ABRT-ANALYSIS-CACHE 1"
+#define ANALYSIS_CACHE_MANIFEST "manifest"
+#define ANALYSIS_CACHE_STATS    "stats"
+#define ANALYSIS_CACHE_TMP_PREFIX ".tmp-"
+
+static int compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Returns the content of the regular file name in the entry or NULL */
+static char *read_entry_file(int entry_fd, const char *name)
+{
+    const int fd = openat(entry_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct stat sb;
+    char *content = NULL;
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode))
+        content = xmalloc_read(fd, NULL);
+    close(fd);
+
+    return content;
+}
+
+static bool is_cacheable_element_name(const char *name)
+{
+    return name[0] != '\0' && name[0] != '.' && strchr(name, '/') == NULL
+        && strpbrk(name, " \t\n") == NULL
+        && strcmp(name, ANALYSIS_CACHE_MANIFEST) != 0;
+}
+
+char *analysis_cache_key(const char *analyzer, const char *build_ids, const char *core_backtrace)
+{
+    char *error_message = NULL;
+    struct sr_core_stacktrace *stacktrace = sr_core_stacktrace_from_json_text(core_backtrace, &error_message);
+    if (stacktrace == NULL)
+    {
+        log_notice("Can't parse core backtrace: %s", error_message);
+        free(error_message);
+        return NULL;
+    }
+
+    struct sr_core_thread *crash_thread = sr_core_stacktrace_find_crash_thread(stacktrace);
+    if (crash_thread == NULL || crash_thread->frames == NULL)
+    {
+        log_notice("Core backtrace has no crash thread");
+        sr_core_stacktrace_free(stacktrace);
+        return NULL;
+    }
+
+    /* The set of build-ids of mapped modules or of modules in the backtrace
+     * if the set was not saved */
+    GPtrArray *ids = g_ptr_array_new_with_free_func(free);
+    if (build_ids != NULL)
+    {
+        char *copy = xstrdup(build_ids);
+        char *saveptr = NULL;
+        for (char *id = strtok_r(copy, " \t\n", &saveptr); id != NULL; id = strtok_r(NULL, " \t\n", &saveptr))
+            g_ptr_array_add(ids, xstrdup(id));
+        free(copy);
+    }
+    else
+    {
+        for (struct sr_core_thread *thread = stacktrace->threads; thread != NULL; thread = thread->next)
+            for (struct sr_core_frame *frame = thread->frames; frame != NULL; frame = frame->next)
+                if (frame->build_id != NULL)
+                    g_ptr_array_add(ids, xstrdup(frame->build_id));
+    }
+
+    struct strbuf *key = strbuf_new();
+    strbuf_append_strf(key, ANALYSIS_CACHE_KEY_VERSION"\n%s\n", analyzer);
+
+    g_ptr_array_sort(ids, compare_strings);
+    for (unsigned i = 0; i < ids->len; ++i)
+    {
+        const char *id = g_ptr_array_index(ids, i);
+        if (i == 0 || strcmp(id, g_ptr_array_index(ids, i - 1)) != 0)
+            strbuf_append_strf(key, "%s\n", id);
+    }
+    g_ptr_array_free(ids, TRUE);
+
+    /* Offsets within build-ids identify the crash thread frames */
+    strbuf_append_str(key, "-\n");
+    for (struct sr_core_frame *frame = crash_thread->frames; frame != NULL; frame = frame->next)
+    {
+        if (frame->build_id != NULL)
+            strbuf_append_strf(key, "%s+0x%"PRIx64"\n", frame->build_id, frame->build_id_offset);
+        else
+            strbuf_append_strf(key, "%s %s\n",
+                               frame->file_name ? frame->file_name : "-",
+                               frame->function_name ? frame->function_name : "-");
+    }
+
+    sr_core_stacktrace_free(stacktrace);
+
+    log_debug("Analysis cache key: '%s'", key->buf);
+
+    char hash_str[SHA1_RESULT_LEN*2 + 1];
+    char *hash = xstrdup(str_to_sha1str(hash_str, key->buf));
+    strbuf_free(key);
+    return hash;
+}
+
+/* Finds the end of the parenthesized text starting at p, returns NULL if the
+ * parentheses are not balanced */
+static const char *skip_parenthesized(const char *p)
+{
+    unsigned depth = 0;
+    char quote = '\0';
+
+    for (; *p != '\0'; ++p)
+    {
+        if (quote != '\0')
+        {
+            if (*p == '\\' && p[1] != '\0')
+                ++p;
+            else if (*p == quote)
+                quote = '\0';
+        }
+        else if (*p == '"' || *p == '\'')
+            quote = *p;
+        else if (*p == '(')
+            ++depth;
+        else if (*p == ')' && --depth == 0)
+            return p + 1;
+    }
+
+    return NULL;
+}
+
+/* Appends the gdb frame line without values of function arguments */
+static void append_frame_without_args(struct strbuf *result, const char *line)
+{
+    const char *p = line;
+    while ((p = strstr(p, " (")) != NULL)
+    {
+        const char *end = skip_parenthesized(p + 1);
+        if (end == NULL)
+            break;
+
+        /* The argument list is followed by the source file or the library,
+         * other parentheses are a part of the function name, e.g.
+         * '(anonymous namespace)::foo' */
+        if (*end == '\0' || prefixcmp(end, " at ") == 0 || prefixcmp(end, " from ") == 0)
+        {
+            strbuf_append_strf(result, "%.*s ()%s\n", (int)(p - line), line, end);
+            return;
+        }
+
+        p = end;
+    }
+
+    strbuf_append_strf(result, "%s\n", line);
+}
+
+char *analysis_cache_strip_host_specific(const char *backtrace)
+{
+    struct strbuf *result = strbuf_new();
+
+    const char *line = backtrace;
+    while (*line != '\0')
+    {
+        const char *eol = strchrnul(line, '\n');
+        char *text = xstrndup(line, eol - line);
+
+        /* Local variables, registers, disassembly and messages of gdb are
+         * dropped, only threads and frames are kept */
+        if (text[0] == '#' && isdigit((unsigned char)text[1]))
+            append_frame_without_args(result, text);
+        else if (prefixcmp(text, "Thread ") == 0 || text[0] == '\0')
+            strbuf_append_strf(result, "%s\n", text);
+
+        free(text);
+        if (*eol == '\0')
+            break;
+        line = eol + 1;
+    }
+
+    return strbuf_free_nobuf(result);
+}
+
+/*
+ * Statistics
+ */
+static void update_stats(const char *cache_dir, const struct analysis_cache_stats *delta)
+{
+    char *path = concat_path_file(cache_dir, ANALYSIS_CACHE_STATS);
+    const int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        /* Unprivileged users can use a readable cache */
+        log_notice("Can't update statistics '%s': %s", path, strerror(errno));
+        free(path);
+        return;
+    }
+
+    struct analysis_cache_stats stats = { 0 };
+    if (flock(fd, LOCK_EX) == 0)
+    {
+        char *content = xmalloc_read(fd, NULL);
+        if (content != NULL)
+            sscanf(content, "hits %llu misses %llu stores %llu evictions %llu",
+                   &stats.hits, &stats.misses, &stats.stores, &stats.evictions);
+        free(content);
+
+        stats.hits += delta->hits;
+        stats.misses += delta->misses;
+        stats.stores += delta->stores;
+        stats.evictions += delta->evictions;
+
+        char *text = xasprintf("hits %llu\nmisses %llu\nstores %llu\nevictions %llu\n",
+                               stats.hits, stats.misses, stats.stores, stats.evictions);
+        if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0
+            || full_write_str(fd, text) != strlen(text))
+            perror_msg("Can't write '%s'", path);
+        free(text);
+    }
+    else
+        perror_msg("Can't lock '%s'", path);
+
+    close(fd);
+    free(path);
+}
+
+/* Removes all files in a flat entry directory and the directory itself */
+static int remove_entry(const char *entry_path)
+{
+    const int dir_fd = open(entry_path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    DIR *dir = dir_fd >= 0 ? fdopendir(dir_fd) : NULL;
+    if (dir == NULL && dir_fd >= 0)
+        close(dir_fd);
+    if (dir != NULL)
+    {
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+            if (!dot_or_dotdot(dent->d_name))
+                unlinkat(dirfd(dir), dent->d_name, 0);
+        closedir(dir);
+    }
+
+    if (rmdir(entry_path) != 0 && errno != ENOENT)
+    {
+        perror_msg("Can't remove '%s'", entry_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Returns the size of the entry in bytes */
+static unsigned long long entry_size(const char *entry_path)
+{
+    DIR *dir = opendir(entry_path);
+    if (dir == NULL)
+        return 0;
+
+    unsigned long long size = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        struct stat sb;
+        if (fstatat(dirfd(dir), dent->d_name, &sb, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(sb.st_mode))
+            size += sb.st_size;
+    }
+
+    closedir(dir);
+    return size;
+}
+
+struct cache_entry
+{
+    char *name;
+    time_t mtime;
+    unsigned long long size;
+};
+
+static int compare_entries_by_age(const void *a, const void *b)
+{
+    const struct cache_entry *ea = *(const struct cache_entry *const *)a;
+    const struct cache_entry *eb = *(const struct cache_entry *const *)b;
+    return ea->mtime < eb->mtime ? -1 : ea->mtime > eb->mtime;
+}
+
+static void free_entry(struct cache_entry *entry)
+{
+    free(entry->name);
+    free(entry);
+}
+
+/* Returns the entries of the cache, temporary directories are skipped */
+static GPtrArray *list_entries(const char *cache_dir)
+{
+    GPtrArray *entries = g_ptr_array_new_with_free_func((GDestroyNotify)free_entry);
+
+    DIR *dir = opendir(cache_dir);
+    if (dir == NULL)
+        return entries;
+
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dent->d_name[0] == '.')
+            continue;
+
+        struct stat sb;
+        if (fstatat(dirfd(dir), dent->d_name, &sb, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(sb.st_mode))
+            continue;
+
+        struct cache_entry *entry = xmalloc(sizeof(*entry));
+        entry->name = xstrdup(dent->d_name);
+        entry->mtime = sb.st_mtime;
+
+        char *entry_path = concat_path_file(cache_dir, dent->d_name);
+        entry->size = entry_size(entry_path);
+        free(entry_path);
+
+        g_ptr_array_add(entries, entry);
+    }
+
+    closedir(dir);
+    return entries;
+}
+
+/* Returns 0 if the cache directory is a directory accessible only to us */
+static int check_cache_dir(const char *cache_dir)
+{
+    struct stat sb;
+    if (lstat(cache_dir, &sb) != 0)
+        return -errno;
+
+    if (!S_ISDIR(sb.st_mode) || sb.st_uid != geteuid() || (sb.st_mode & 077) != 0)
+    {
+        error_msg("Analysis cache '%s' must be a directory owned by uid %lu "
+                  "accessible only to its owner, not using it",
+                  cache_dir, (unsigned long)geteuid());
+        return -EPERM;
+    }
+
+    return 0;
+}
+
+int analysis_cache_get_stats(const char *cache_dir, struct analysis_cache_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    const int r = check_cache_dir(cache_dir);
+    if (r != 0)
+        return r;
+
+    const int dir_fd = open(cache_dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (dir_fd < 0)
+        return -errno;
+    char *content = read_entry_file(dir_fd, ANALYSIS_CACHE_STATS);
+    close(dir_fd);
+    if (content != NULL)
+        sscanf(content, "hits %llu misses %llu stores %llu evictions %llu",
+               &stats->hits, &stats->misses, &stats->stores, &stats->evictions);
+    free(content);
+
+    GPtrArray *entries = list_entries(cache_dir);
+    stats->entries = entries->len;
+    for (unsigned i = 0; i < entries->len; ++i)
+        stats->size += ((struct cache_entry *)g_ptr_array_index(entries, i))->size;
+    g_ptr_array_free(entries, TRUE);
+
+    return 0;
+}
+
+/*
+ * Lookup
+ */
+static int create_cache_dir(const char *cache_dir)
+{
+    if (mkdir(cache_dir, 0700) != 0 && errno != EEXIST)
+        return -errno;
+
+    return check_cache_dir(cache_dir);
+}
+
+int analysis_cache_lookup(const char *cache_dir, const char *key, struct dump_dir *dd)
+{
+    struct analysis_cache_stats delta = { 0 };
+
+    if (strchr(key, '/') != NULL || key[0] == '.')
+        return -EINVAL;
+
+    /* Misses of an empty cache are counted too */
+    const int created = create_cache_dir(cache_dir);
+    if (created != 0)
+        return created;
+
+    char *entry_path = concat_path_file(cache_dir, key);
+    const int entry_fd = open(entry_path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    char *manifest = entry_fd >= 0 ? read_entry_file(entry_fd, ANALYSIS_CACHE_MANIFEST) : NULL;
+
+    if (manifest == NULL)
+    {
+        log_info("Analysis cache miss: %s", key);
+        delta.misses = 1;
+        update_stats(cache_dir, &delta);
+        if (entry_fd >= 0)
+            close(entry_fd);
+        free(entry_path);
+        return 0;
+    }
+
+    /* Read all elements first, a half restored entry is worse than none */
+    GList *names = NULL;
+    GList *contents = NULL;
+    struct strbuf *host_specific = strbuf_new();
+    int r = 1;
+
+    char *saveptr = NULL;
+    for (char *line = strtok_r(manifest, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr))
+    {
+        char *state = strchr(line, ' ');
+        if (state == NULL)
+        {
+            r = -EINVAL;
+            break;
+        }
+        *state++ = '\0';
+
+        if (!is_cacheable_element_name(line))
+        {
+            r = -EINVAL;
+            break;
+        }
+
+        char *content = NULL;
+        if (strcmp(state, "present") == 0 || strcmp(state, "host") == 0)
+        {
+            content = read_entry_file(entry_fd, line);
+            if (content == NULL)
+            {
+                r = -ENOENT;
+                break;
+            }
+
+            if (strcmp(state, "host") == 0)
+                strbuf_append_strf(host_specific, " %s", line);
+        }
+        else if (strcmp(state, "absent") != 0)
+        {
+            r = -EINVAL;
+            break;
+        }
+
+        names = g_list_prepend(names, xstrdup(line));
+        contents = g_list_prepend(contents, content);
+    }
+
+    if (r < 0)
+    {
+        error_msg("Analysis cache entry '%s' is corrupted, removing it", entry_path);
+        remove_entry(entry_path);
+        delta.misses = 1;
+        r = 0;
+    }
+    else
+    {
+        log_info("Analysis cache hit: %s", key);
+        for (GList *n = names, *c = contents; n != NULL; n = n->next, c = c->next)
+        {
+            if (c->data != NULL)
+                dd_save_text(dd, n->data, c->data);
+            else
+                dd_delete_item(dd, n->data);
+        }
+
+        /* A line per restored entry, more analyzers can use the cache */
+        char *info = dd_load_text_ext(dd, FILENAME_ANALYSIS_CACHE,
+                                      DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+        char *new_info = xasprintf("%s%s%s\n", info ? info : "", key, host_specific->buf);
+        dd_save_text(dd, FILENAME_ANALYSIS_CACHE, new_info);
+        free(new_info);
+        free(info);
+
+        /* The least recently used entries are evicted first */
+        if (futimens(entry_fd, NULL) != 0)
+            perror_msg("Can't touch '%s'", entry_path);
+
+        delta.hits = 1;
+    }
+
+    update_stats(cache_dir, &delta);
+
+    strbuf_free(host_specific);
+    list_free_with_free(names);
+    list_free_with_free(contents);
+    free(manifest);
+    close(entry_fd);
+    free(entry_path);
+    return r;
+}
+
+/*
+ * Store
+ */
+static void evict_entries(const char *cache_dir, unsigned long long max_size,
+                          struct analysis_cache_stats *delta)
+{
+    GPtrArray *entries = list_entries(cache_dir);
+
+    unsigned long long size = 0;
+    for (unsigned i = 0; i < entries->len; ++i)
+        size += ((struct cache_entry *)g_ptr_array_index(entries, i))->size;
+
+    g_ptr_array_sort(entries, compare_entries_by_age);
+    for (unsigned i = 0; i < entries->len && size > max_size; ++i)
+    {
+        struct cache_entry *entry = g_ptr_array_index(entries, i);
+        char *entry_path = concat_path_file(cache_dir, entry->name);
+
+        log_info("Evicting analysis cache entry '%s'", entry->name);
+        if (remove_entry(entry_path) == 0)
+        {
+            size -= entry->size;
+            ++delta->evictions;
+        }
+
+        free(entry_path);
+    }
+
+    g_ptr_array_free(entries, TRUE);
+}
+
+static bool string_in_list(const char *str, const char *const *list)
+{
+    for (; list != NULL && *list != NULL; ++list)
+        if (strcmp(str, *list) == 0)
+            return true;
+
+    return false;
+}
+
+int analysis_cache_store(const char *cache_dir, const char *key, struct dump_dir *dd,
+                         const char *const *elements, const char *const *host_specific,
+                         unsigned long long max_size)
+{
+    if (strchr(key, '/') != NULL || key[0] == '.')
+        return -EINVAL;
+
+    const int created = create_cache_dir(cache_dir);
+    if (created != 0)
+    {
+        if (created != -EPERM)
+            error_msg("Can't create '%s': %s", cache_dir, strerror(-created));
+        return created;
+    }
+
+    char *entry_path = concat_path_file(cache_dir, key);
+    if (access(entry_path, F_OK) == 0)
+    {
+        log_debug("Analysis cache entry '%s' already exists", key);
+        free(entry_path);
+        return 0;
+    }
+
+    char *tmp_path = xasprintf("%s/"ANALYSIS_CACHE_TMP_PREFIX"XXXXXX", cache_dir);
+    if (mkdtemp(tmp_path) == NULL)
+    {
+        const int r = -errno;
+        perror_msg("Can't create temporary directory in '%s'", cache_dir);
+        free(tmp_path);
+        free(entry_path);
+        return r;
+    }
+
+    int r = 0;
+    struct strbuf *manifest = strbuf_new();
+    for (const char *const *name = elements; *name != NULL; ++name)
+    {
+        if (!is_cacheable_element_name(*name))
+        {
+            error_msg("Can't cache element '%s'", *name);
+            r = -EINVAL;
+            goto cleanup;
+        }
+
+        char *content = dd_load_text_ext(dd, *name, DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+        if (content == NULL)
+        {
+            strbuf_append_strf(manifest, "%s absent\n", *name);
+            continue;
+        }
+
+        const bool host = string_in_list(*name, host_specific);
+        if (host)
+        {
+            char *stripped = analysis_cache_strip_host_specific(content);
+            free(content);
+            content = stripped;
+        }
+
+        char *path = concat_path_file(tmp_path, *name);
+        const int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (fd < 0 || full_write_str(fd, content) != strlen(content))
+        {
+            r = -errno;
+            perror_msg("Can't write '%s'", path);
+        }
+        if (fd >= 0)
+            close(fd);
+        free(path);
+        free(content);
+
+        if (r != 0)
+            goto cleanup;
+
+        strbuf_append_strf(manifest, "%s %s\n", *name, host ? "host" : "present");
+    }
+
+    char *manifest_path = concat_path_file(tmp_path, ANALYSIS_CACHE_MANIFEST);
+    const int fd = open(manifest_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0 || full_write(fd, manifest->buf, manifest->len) != manifest->len)
+    {
+        r = -errno;
+        perror_msg("Can't write '%s'", manifest_path);
+    }
+    if (fd >= 0)
+        close(fd);
+    free(manifest_path);
+
+    if (r != 0)
+        goto cleanup;
+
+    if (rename(tmp_path, entry_path) != 0)
+    {
+        /* Somebody else stored the same analysis in the meantime */
+        if (errno != EEXIST && errno != ENOTEMPTY)
+        {
+            r = -errno;
+            perror_msg("Can't rename '%s' to '%s'", tmp_path, entry_path);
+        }
+        goto cleanup;
+    }
+
+    log_info("Stored analysis cache entry '%s'", key);
+
+    struct analysis_cache_stats delta = { .stores = 1 };
+    if (max_size != 0)
+        evict_entries(cache_dir, max_size, &delta);
+    update_stats(cache_dir, &delta);
+
+ cleanup:
+    if (access(tmp_path, F_OK) == 0)
+        remove_entry(tmp_path);
+    strbuf_free(manifest);
+    free(tmp_path);
+    free(entry_path);
+    return r;
+}
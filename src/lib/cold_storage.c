@@ -0,0 +1,441 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+
+#define COPY_BUFFER_SIZE (64 * 1024)
+
+/* Only elements no tool reads as text are compressed, so dd_load_text() and
+ * the reporters keep working on migrated problems. The reference of a delta
+ * core is the base other deltas are applied to, it stays as it is. */
+static const char *const compressible_elements[] = {
+    FILENAME_COREDUMP,
+    FILENAME_COREDUMP_DELTA,
+    FILENAME_VMCORE,
+};
+
+static bool is_compressible_element(const char *name)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(compressible_elements); ++i)
+        if (strcmp(name, compressible_elements[i]) == 0)
+            return true;
+
+    return false;
+}
+
+void cold_storage_throttle_init(struct abrt_cold_storage_throttle *throttle, unsigned rate_kib)
+{
+    throttle->rate = rate_kib * 1024ULL;
+    throttle->bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &throttle->start);
+}
+
+static void throttle_account(struct abrt_cold_storage_throttle *throttle, size_t len)
+{
+    throttle->bytes += len;
+    if (throttle->rate == 0)
+        return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const double elapsed = (now.tv_sec - throttle->start.tv_sec)
+                         + (now.tv_nsec - throttle->start.tv_nsec) / 1e9;
+    const double expected = (double)throttle->bytes / throttle->rate;
+    if (expected <= elapsed)
+        return;
+
+    const double delay = expected - elapsed;
+    struct timespec ts = {
+        .tv_sec = (time_t)delay,
+        .tv_nsec = (long)((delay - (time_t)delay) * 1e9),
+    };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        continue;
+}
+
+void cold_storage_remove_tree(const char *path)
+{
+    DIR *dir = opendir(path);
+    if (dir != NULL)
+    {
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+        {
+            if (dot_or_dotdot(dent->d_name))
+                continue;
+
+            char *full_path = concat_path_file(path, dent->d_name);
+            struct stat sb;
+            if (lstat(full_path, &sb) == 0 && S_ISDIR(sb.st_mode))
+                cold_storage_remove_tree(full_path);
+            else if (unlink(full_path) != 0)
+                perror_msg("Can't remove '%s'", full_path);
+            free(full_path);
+        }
+        closedir(dir);
+    }
+
+    if (rmdir(path) != 0 && errno != ENOENT)
+        perror_msg("Can't remove '%s'", path);
+}
+
+/* Runs xz with given arguments reading from in_fd or from the returned pipe
+ * if in_fd is -1 and writing to out_fd. Returns pid of xz.
+ */
+static pid_t spawn_xz(const char *mode_arg, int in_fd, int out_fd, int *pipe_fd)
+{
+    int pipefd[2] = { -1, -1 };
+    if (in_fd < 0)
+        xpipe(pipefd);
+
+    fflush(NULL); /* paranoia */
+    pid_t pid = xfork();
+    if (pid == 0)
+    {
+        if (in_fd < 0)
+        {
+            close(pipefd[1]);
+            xmove_fd(pipefd[0], STDIN_FILENO);
+        }
+        else
+            xmove_fd(in_fd, STDIN_FILENO);
+        xmove_fd(out_fd, STDOUT_FILENO);
+        execlp("xz", "xz", mode_arg, "-c", "-", (char *)NULL);
+        perror_msg_and_die(_("Can't execute '%s'"), "xz");
+    }
+
+    if (in_fd < 0)
+    {
+        close(pipefd[0]);
+        *pipe_fd = pipefd[1];
+    }
+
+    return pid;
+}
+
+static bool xz_succeeded(pid_t pid)
+{
+    int status;
+    if (safe_waitpid(pid, &status, 0) < 0)
+        return false;
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* Copies the file and compresses it on the way if compress is true.
+ * Returns the size of the new file or -1.
+ */
+static off_t copy_file(int src_fd, int dst_fd, bool compress, struct abrt_cold_storage_throttle *throttle)
+{
+    int out_fd = dst_fd;
+    pid_t xz_pid = 0;
+    if (compress)
+        xz_pid = spawn_xz("-3", -1, dst_fd, &out_fd);
+
+    bool ok = true;
+    char *buf = xmalloc(COPY_BUFFER_SIZE);
+    for (;;)
+    {
+        const ssize_t r = safe_read(src_fd, buf, COPY_BUFFER_SIZE);
+        if (r <= 0)
+        {
+            ok = (r == 0);
+            break;
+        }
+
+        throttle_account(throttle, r);
+
+        if (full_write(out_fd, buf, r) != r)
+        {
+            ok = false;
+            break;
+        }
+    }
+    free(buf);
+
+    if (compress)
+    {
+        close(out_fd);
+        ok = xz_succeeded(xz_pid) && ok;
+    }
+
+    struct stat sb;
+    if (!ok || fsync(dst_fd) != 0 || fstat(dst_fd, &sb) != 0)
+        return -1;
+
+    return sb.st_size;
+}
+
+/* Copies the regular file name from src_dir to dst_dir keeping its owner and
+ * mode and compresses it if it is a binary element not smaller than min_size
+ * and compression saves some space. Appends name to compressed if it was compressed.
+ * Returns 0 on success.
+ */
+static int migrate_file(const char *src_dir, const char *dst_dir, const char *name,
+                        const struct stat *sb, off_t min_size, struct strbuf *compressed,
+                        struct abrt_cold_storage_throttle *throttle,
+                        struct abrt_cold_storage_stats *stats)
+{
+    char *src_path = concat_path_file(src_dir, name);
+    const int src_fd = open(src_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (src_fd < 0)
+    {
+        perror_msg("Can't open '%s'", src_path);
+        free(src_path);
+        return -1;
+    }
+
+    /* Hard linked elements are shared with other problems which read them
+     * in the original form */
+    bool compress = compressed != NULL && sb->st_size >= min_size && sb->st_nlink == 1
+                    && is_compressible_element(name);
+    off_t stored = -1;
+    for (;;)
+    {
+        char *dst_name = xasprintf("%s%s", name, compress ? COLD_COMPRESSED_SUFFIX : "");
+        char *dst_path = concat_path_file(dst_dir, dst_name);
+        free(dst_name);
+
+        const int dst_fd = open(dst_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                                sb->st_mode & 07777);
+        if (dst_fd < 0 || fchown(dst_fd, sb->st_uid, sb->st_gid) != 0)
+        {
+            perror_msg("Can't create '%s'", dst_path);
+            if (dst_fd >= 0)
+                close(dst_fd);
+            free(dst_path);
+            break;
+        }
+
+        stored = copy_file(src_fd, dst_fd, compress, throttle);
+        close(dst_fd);
+
+        if (stored < 0)
+            error_msg("Can't copy '%s' to '%s'", src_path, dst_path);
+        else if (compress && stored >= sb->st_size)
+        {
+            /* Incompressible data */
+            log_debug("Storing '%s' uncompressed", src_path);
+            unlink(dst_path);
+            free(dst_path);
+            compress = false;
+            if (lseek(src_fd, 0, SEEK_SET) == 0)
+                continue;
+            perror_msg("Can't rewind '%s'", src_path);
+            stored = -1;
+            break;
+        }
+
+        free(dst_path);
+        break;
+    }
+
+    close(src_fd);
+    free(src_path);
+
+    if (stored < 0)
+        return -1;
+
+    if (compress)
+        strbuf_append_strf(compressed, "%s\n", name);
+
+    stats->original_bytes += sb->st_size;
+    stats->stored_bytes += stored;
+    return 0;
+}
+
+/* Files of the top directory (elements) are compressed, the time element is
+ * copied last, so incomplete copies are not valid problem directories.
+ */
+static int migrate_tree(const char *src_dir, const char *dst_dir, const struct stat *dir_sb,
+                        bool top, off_t min_size, struct abrt_cold_storage_throttle *throttle,
+                        struct abrt_cold_storage_stats *stats)
+{
+    if (mkdir(dst_dir, dir_sb->st_mode & 07777) != 0
+        || chown(dst_dir, dir_sb->st_uid, dir_sb->st_gid) != 0
+        || chmod(dst_dir, dir_sb->st_mode & 07777) != 0)
+    {
+        perror_msg("Can't create '%s'", dst_dir);
+        return -1;
+    }
+
+    DIR *dir = opendir(src_dir);
+    if (dir == NULL)
+    {
+        perror_msg("Can't open '%s'", src_dir);
+        return -1;
+    }
+
+    struct strbuf *compressed = top ? strbuf_new() : NULL;
+    struct stat time_sb;
+    bool has_time = false;
+    int r = 0;
+
+    struct dirent *dent;
+    while (r == 0 && (dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        struct stat sb;
+        if (fstatat(dirfd(dir), dent->d_name, &sb, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            perror_msg("Can't stat '%s/%s'", src_dir, dent->d_name);
+            r = -1;
+        }
+        else if (S_ISDIR(sb.st_mode))
+        {
+            char *src_path = concat_path_file(src_dir, dent->d_name);
+            char *dst_path = concat_path_file(dst_dir, dent->d_name);
+            r = migrate_tree(src_path, dst_path, &sb, /*top*/false, min_size, throttle, stats);
+            free(dst_path);
+            free(src_path);
+        }
+        else if (S_ISREG(sb.st_mode))
+        {
+            if (top && strcmp(dent->d_name, FILENAME_TIME) == 0)
+            {
+                time_sb = sb;
+                has_time = true;
+                continue;
+            }
+            r = migrate_file(src_dir, dst_dir, dent->d_name, &sb, min_size, compressed, throttle, stats);
+        }
+        else if (!top || !S_ISLNK(sb.st_mode) || strcmp(dent->d_name, ".lock") != 0)
+        {
+            error_msg("Can't migrate '%s/%s': not a regular file", src_dir, dent->d_name);
+            r = -1;
+        }
+    }
+    closedir(dir);
+
+    if (r == 0 && top && compressed->len > 0)
+    {
+        /* The list of compressed elements for abrt-cold-storage -x */
+        char *path = concat_path_file(dst_dir, FILENAME_COLD_COMPRESSED);
+        const int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                            has_time ? time_sb.st_mode & 07777 : 0640);
+        if (fd < 0
+            || (has_time && fchown(fd, time_sb.st_uid, time_sb.st_gid) != 0)
+            || full_write_str(fd, compressed->buf) < 0)
+        {
+            perror_msg("Can't save '%s'", path);
+            r = -1;
+        }
+        if (fd >= 0)
+            close(fd);
+        free(path);
+    }
+
+    if (r == 0 && top)
+    {
+        if (has_time)
+            r = migrate_file(src_dir, dst_dir, FILENAME_TIME, &time_sb, 0, NULL, throttle, stats);
+        else
+        {
+            error_msg("'%s' has no '%s'", src_dir, FILENAME_TIME);
+            r = -1;
+        }
+    }
+
+    if (compressed != NULL)
+        strbuf_free(compressed);
+
+    return r;
+}
+
+int cold_storage_copy_problem(const char *src_dir, const char *dst_dir, off_t min_size,
+                              struct abrt_cold_storage_throttle *throttle,
+                              struct abrt_cold_storage_stats *stats)
+{
+    struct stat sb;
+    if (stat(src_dir, &sb) != 0)
+    {
+        perror_msg("Can't stat '%s'", src_dir);
+        return -1;
+    }
+
+    return migrate_tree(src_dir, dst_dir, &sb, /*top*/true, min_size, throttle, stats);
+}
+
+int cold_storage_expand_problem(struct dump_dir *dd)
+{
+    char *list = dd_load_text_ext(dd, FILENAME_COLD_COMPRESSED, DD_FAIL_QUIETLY_ENOENT);
+    if (list == NULL)
+        return 0;
+
+    int r = 0;
+    for (char *name = strtok(list, "\n"); name != NULL; name = strtok(NULL, "\n"))
+    {
+        if (!str_is_correct_filename(name))
+            continue;
+
+        char *src_path = xasprintf("%s/%s"COLD_COMPRESSED_SUFFIX, dd->dd_dirname, name);
+        char *tmp_path = xasprintf("%s/.%s.tmp", dd->dd_dirname, name);
+        char *dst_path = concat_path_file(dd->dd_dirname, name);
+
+        /* Decompressed already */
+        if (dd_exist(dd, name))
+            goto next;
+
+        struct stat sb;
+        const int src_fd = open(src_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (src_fd < 0 || fstat(src_fd, &sb) != 0)
+        {
+            if (errno != ENOENT)
+            {
+                perror_msg("Can't open '%s'", src_path);
+                r = 1;
+            }
+            if (src_fd >= 0)
+                close(src_fd);
+            goto next;
+        }
+
+        const int tmp_fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                                sb.st_mode & 07777);
+        if (tmp_fd < 0)
+        {
+            perror_msg("Can't create '%s'", tmp_path);
+            close(src_fd);
+            r = 1;
+            goto next;
+        }
+        /* Keep the owner of the element if we are allowed to */
+        if (fchown(tmp_fd, sb.st_uid, sb.st_gid) != 0)
+            log_debug("Can't change owner of '%s': %s", tmp_path, strerror(errno));
+
+        log_notice("Decompressing '%s'", src_path);
+        const pid_t xz_pid = spawn_xz("-d", src_fd, tmp_fd, NULL);
+        close(src_fd);
+        close(tmp_fd);
+        if (!xz_succeeded(xz_pid) || rename(tmp_path, dst_path) != 0)
+        {
+            error_msg("Can't decompress '%s'", src_path);
+            unlink(tmp_path);
+            r = 1;
+        }
+
+ next:
+        free(dst_path);
+        free(tmp_path);
+        free(src_path);
+    }
+    free(list);
+
+    return r;
+}
@@ -0,0 +1,116 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/thread.h>
+#include <satyr/core/frame.h>
+#include "libabrt.h"
+
+/*
+ * Worker w of abrt-hook-ccpp unwinds the threads w, w + workers, ... and
+ * writes a '\0' terminated JSON core stacktrace per thread, an empty string
+ * for threads it could not unwind. A worker which died wrote only some of
+ * them.
+ */
+
+void core_backtrace_split_worker_output(const char *output, size_t len,
+                                        unsigned worker, unsigned workers,
+                                        const char **jsons, unsigned count)
+{
+    size_t pos = 0;
+    for (unsigned i = worker; i < count && pos < len; i += workers)
+    {
+        const size_t json_len = strnlen(output + pos, len - pos);
+        /* Cut short by the death of the worker */
+        if (pos + json_len == len)
+            break;
+
+        jsons[i] = output + pos;
+        pos += json_len + 1;
+    }
+}
+
+static void core_thread_limit_frames(struct sr_core_thread *thread, unsigned max_frames)
+{
+    struct sr_core_frame **frame = &thread->frames;
+    for (unsigned i = 0; *frame != NULL && i < max_frames; ++i)
+        frame = &(*frame)->next;
+
+    while (*frame != NULL)
+    {
+        struct sr_core_frame *next = (*frame)->next;
+        sr_core_frame_free(*frame);
+        *frame = next;
+    }
+}
+
+char *core_backtrace_join_threads(const char *const *jsons, const pid_t *tids,
+                                  unsigned count, unsigned max_frames)
+{
+    /* Keep the order of the threads, the crash thread is the first one */
+    struct sr_core_stacktrace *stacktrace = NULL;
+    struct sr_core_thread *last_thread = NULL;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const char *json = jsons[i];
+        if (json == NULL || json[0] == '\0')
+        {
+            if (i == 0)
+                break;
+            continue;
+        }
+
+        char *error_message = NULL;
+        struct sr_core_stacktrace *thread_stacktrace = sr_core_stacktrace_from_json_text(json, &error_message);
+        if (thread_stacktrace == NULL || thread_stacktrace->threads == NULL)
+        {
+            log_notice("Can't parse core backtrace of thread %d: %s", tids[i], error_message);
+            free(error_message);
+            sr_core_stacktrace_free(thread_stacktrace);
+            if (i == 0)
+                break;
+            continue;
+        }
+
+        struct sr_core_thread *thread = thread_stacktrace->threads;
+        core_thread_limit_frames(thread, max_frames);
+
+        if (i == 0)
+        {
+            stacktrace = thread_stacktrace;
+            stacktrace->crash_thread = thread;
+            stacktrace->only_crash_thread = false;
+            last_thread = thread;
+            continue;
+        }
+
+        thread_stacktrace->threads = thread->next;
+        thread_stacktrace->crash_thread = NULL;
+        thread->next = NULL;
+        sr_core_stacktrace_free(thread_stacktrace);
+
+        last_thread->next = thread;
+        last_thread = thread;
+    }
+
+    if (stacktrace == NULL)
+        return NULL;
+
+    char *json = sr_core_stacktrace_to_json(stacktrace);
+    sr_core_stacktrace_free(stacktrace);
+    return json;
+}
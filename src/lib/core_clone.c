@@ -0,0 +1,112 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include "libabrt.h"
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#ifndef FICLONERANGE
+struct file_clone_range
+{
+    int64_t src_fd;
+    uint64_t src_offset;
+    uint64_t src_length;
+    uint64_t dest_offset;
+};
+#define FICLONERANGE _IOW(0x94, 13, struct file_clone_range)
+#endif
+
+int clone_core_prefix(int src_fd, int dst_fd, off_t prefix_size, off_t size)
+{
+    if (prefix_size == size)
+    {
+        /* The whole source, it may be longer than the destination */
+        if (ioctl(dst_fd, FICLONE, src_fd) != 0)
+            return -1;
+    }
+    else
+    {
+        struct file_clone_range range = {
+            .src_fd = src_fd,
+            .src_offset = 0,
+            .src_length = prefix_size,
+            .dest_offset = 0,
+        };
+        if (ioctl(dst_fd, FICLONERANGE, &range) != 0)
+            return -1;
+    }
+
+    return ftruncate(dst_fd, size);
+}
+
+off_t copy_core_prefix(int src_fd, int dst_fd, off_t prefix_size, off_t size)
+{
+    /* Keeps the part written behind the prefix */
+    if (lseek(dst_fd, 0, SEEK_SET) != 0)
+        return -1;
+
+    advise_read_once(src_fd);
+    struct abrt_write_behind wb;
+    write_behind_init(&wb, dst_fd);
+
+    off_t copied = 0;
+#ifdef SYS_copy_file_range
+    /* In kernel copy, older kernels refuse to copy between file systems */
+    while (copied < prefix_size)
+    {
+        loff_t offset = copied;
+        const off_t chunk = MIN(prefix_size - copied, ABRT_WRITE_BEHIND_WINDOW);
+        const ssize_t r = syscall(SYS_copy_file_range, src_fd, &offset, dst_fd, NULL, (size_t)chunk, 0);
+        if (r <= 0)
+            break;
+
+        copied += r;
+        write_behind_wrote(&wb, r);
+    }
+#endif
+
+    if (copied < prefix_size && lseek(src_fd, copied, SEEK_SET) != copied)
+        copied = -1;
+
+    while (copied >= 0 && copied < prefix_size)
+    {
+        const off_t chunk = MIN(prefix_size - copied, ABRT_WRITE_BEHIND_WINDOW);
+        const off_t r = copyfd_size(src_fd, dst_fd, chunk, /*flags*/0);
+        if (r <= 0)
+        {
+            copied = -1;
+            break;
+        }
+
+        copied += r;
+        write_behind_wrote(&wb, r);
+    }
+
+    const int err = errno;
+    write_behind_finish(&wb);
+    drop_page_cache(src_fd);
+    errno = err;
+
+    /* A failed clone might have left more */
+    if (copied < 0 || ftruncate(dst_fd, size) != 0)
+        return -1;
+
+    return size;
+}
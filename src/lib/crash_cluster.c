@@ -0,0 +1,230 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/thread.h>
+#include <satyr/core/frame.h>
+#include "libabrt.h"
+
+/*
+ * The cluster registry has a line per cluster:
+ *
+ *   HASH DIRNAME
+ *
+ * where DIRNAME is the first problem of the cluster still present on the
+ * system (the leader).
+ */
+#define CRASH_CLUSTER_FILE VAR_STATE"/clusters"
+
+/* Number of frames of the faulting library forming the cluster key */
+#define CLUSTER_FRAME_COUNT 3
+
+/* Functions which only report a failure detected somewhere else. A crash in
+ * them belongs to the function which called them. */
+static const char *const reporting_functions[] = {
+    "raise",
+    "abort",
+    "__GI_raise",
+    "__GI_abort",
+    "__pthread_kill_implementation",
+    "__pthread_kill_internal",
+    "pthread_kill",
+    "__assert_fail",
+    "__assert_fail_base",
+    "__malloc_assert",
+    "__libc_message",
+    "__fortify_fail",
+    "__chk_fail",
+    "__stack_chk_fail",
+    "malloc_printerr",
+    "g_assertion_message",
+    "g_assertion_message_expr",
+    "g_log",
+    "g_logv",
+    "g_log_structured_array",
+    "_g_log_abort",
+    "qt_message_fatal",
+    "qFatal",
+    "__cxa_throw",
+    "__cxa_rethrow",
+    "std::terminate",
+    "__cxxabiv1::__terminate",
+    "__gnu_cxx::__verbose_terminate_handler",
+};
+
+static bool is_reporting_function(const char *function_name)
+{
+    if (function_name == NULL)
+        return false;
+
+    for (size_t i = 0; i < ARRAY_SIZE(reporting_functions); ++i)
+        if (strcmp(function_name, reporting_functions[i]) == 0)
+            return true;
+
+    return false;
+}
+
+char *crash_cluster_hash(const char *core_backtrace, const char *executable, char **module)
+{
+    if (module != NULL)
+        *module = NULL;
+
+    char *error_message = NULL;
+    struct sr_core_stacktrace *stacktrace = sr_core_stacktrace_from_json_text(core_backtrace, &error_message);
+    if (stacktrace == NULL)
+    {
+        log_notice("Can't parse core backtrace: %s", error_message);
+        free(error_message);
+        return NULL;
+    }
+
+    char *hash = NULL;
+    struct sr_core_thread *thread = sr_core_stacktrace_find_crash_thread(stacktrace);
+    struct sr_core_frame *frame = thread ? thread->frames : NULL;
+
+    while (frame != NULL && is_reporting_function(frame->function_name))
+        frame = frame->next;
+
+    if (frame == NULL || frame->build_id == NULL)
+    {
+        log_info("The faulting frame is not in a known binary");
+        goto finito;
+    }
+
+    /* Crashes in the executable are deduplicated by duphash */
+    if (frame->file_name != NULL && executable != NULL && strcmp(frame->file_name, executable) == 0)
+    {
+        log_info("The crash is not in a shared library");
+        goto finito;
+    }
+
+    struct strbuf *key = strbuf_new();
+    strbuf_append_str(key, frame->build_id);
+
+    const char *build_id = frame->build_id;
+    const char *file_name = frame->file_name;
+    for (unsigned i = 0;
+         i < CLUSTER_FRAME_COUNT && frame != NULL && frame->build_id != NULL
+            && strcmp(frame->build_id, build_id) == 0;
+         ++i, frame = frame->next)
+    {
+        /* Offsets are stable for the build-id */
+        if (frame->function_name != NULL)
+            strbuf_append_strf(key, "\n%s", frame->function_name);
+        else
+            strbuf_append_strf(key, "\n0x%"PRIx64, frame->build_id_offset);
+    }
+
+    log_debug("Cluster key: '%s'", key->buf);
+
+    char hash_str[SHA1_RESULT_LEN*2 + 1];
+    hash = xstrdup(str_to_sha1str(hash_str, key->buf));
+    strbuf_free(key);
+
+    if (module != NULL)
+        *module = xstrdup(file_name ? file_name : build_id);
+
+ finito:
+    sr_core_stacktrace_free(stacktrace);
+    return hash;
+}
+
+int crash_cluster_register(const char *hash, const char *dirname, char **leader)
+{
+    *leader = NULL;
+
+    if (dirname[0] != '/' || strchr(dirname, '\n') != NULL || strchr(hash, ' ') != NULL)
+        return -EINVAL;
+
+    const int fd = open(CRASH_CLUSTER_FILE, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        const int r = -errno;
+        perror_msg("Can't open '%s'", CRASH_CLUSTER_FILE);
+        return r;
+    }
+
+    int r = 0;
+    if (flock(fd, LOCK_EX) != 0)
+    {
+        r = -errno;
+        perror_msg("Can't lock '%s'", CRASH_CLUSTER_FILE);
+        close(fd);
+        return r;
+    }
+
+    char *content = xmalloc_read(fd, NULL);
+    if (content == NULL)
+    {
+        r = -EIO;
+        goto finito;
+    }
+
+    /* Lines of clusters whose leader is gone are dropped */
+    struct strbuf *rewritten = strbuf_new();
+    bool changed = false;
+    const size_t hash_len = strlen(hash);
+
+    char *line = content;
+    while (*line != '\0')
+    {
+        char *eol = strchrnul(line, '\n');
+        const char saved = *eol;
+        *eol = '\0';
+
+        char *line_dirname = strchr(line, ' ');
+        if (line_dirname == NULL || access(line_dirname + 1, F_OK) != 0)
+            changed = true;
+        else
+        {
+            ++line_dirname;
+            if (*leader == NULL && line_dirname - line - 1 == hash_len && strncmp(line, hash, hash_len) == 0)
+                *leader = xstrdup(line_dirname);
+
+            strbuf_append_strf(rewritten, "%s\n", line);
+        }
+
+        if (saved == '\0')
+            break;
+        line = eol + 1;
+    }
+
+    if (*leader == NULL)
+    {
+        strbuf_append_strf(rewritten, "%s %s\n", hash, dirname);
+        *leader = xstrdup(dirname);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0
+            || full_write(fd, rewritten->buf, rewritten->len) != rewritten->len)
+        {
+            r = -errno;
+            perror_msg("Can't write '%s'", CRASH_CLUSTER_FILE);
+        }
+    }
+
+    strbuf_free(rewritten);
+    free(content);
+
+ finito:
+    close(fd);
+    return r;
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+
+/* Returns the avg10 value of the "some" line of a PSI file or -1 if the
+ * kernel does not provide pressure stall information.
+ */
+static double read_pressure_avg10(const char *pressure_dir, const char *resource)
+{
+    char *psi_file = concat_path_file(pressure_dir, resource);
+    FILE *fp = fopen(psi_file, "r");
+    free(psi_file);
+    if (fp == NULL)
+        return -1;
+
+    double avg10 = -1;
+    if (fscanf(fp, "some avg10=%lf", &avg10) != 1)
+        avg10 = -1;
+
+    fclose(fp);
+    return avg10;
+}
+
+bool deferred_analysis_in_window(time_t now)
+{
+    if (g_settings_deferred_analysis_window_from < 0)
+        return true;
+
+    struct tm tm;
+    localtime_r(&now, &tm);
+    const int minute = tm.tm_hour * 60 + tm.tm_min;
+    const int from = g_settings_deferred_analysis_window_from;
+    const int to = g_settings_deferred_analysis_window_to;
+
+    /* The window can span midnight (e.g. 22:00-06:00) */
+    return from <= to ? (minute >= from && minute < to)
+                      : (minute >= from || minute < to);
+}
+
+bool system_is_idle_for_deferred_analysis(time_t now, const char *pressure_dir)
+{
+    if (!deferred_analysis_in_window(now))
+    {
+        log_debug("Deferred analysis: outside of the time window");
+        return false;
+    }
+
+    if (g_settings_deferred_analysis_max_load > 0)
+    {
+        double load;
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus < 1)
+            cpus = 1;
+
+        if (getloadavg(&load, 1) == 1
+            && load * 100 / cpus >= g_settings_deferred_analysis_max_load)
+        {
+            log_debug("Deferred analysis: load average %.2f is too high", load);
+            return false;
+        }
+    }
+
+    if (g_settings_deferred_analysis_max_pressure > 0)
+    {
+        static const char *const resources[] = { "cpu", "io", "memory", NULL };
+
+        for (const char *const *res = resources; *res != NULL; ++res)
+        {
+            const double avg10 = read_pressure_avg10(pressure_dir, *res);
+            if (avg10 >= g_settings_deferred_analysis_max_pressure)
+            {
+                log_debug("Deferred analysis: %s pressure avg10=%.2f is too high", *res, avg10);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,861 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <elf.h>
+#include <sys/mman.h>
+#include "libabrt.h"
+
+/*
+ * The reference directory holds for every key:
+ *
+ *   KEY.core  - a hard link to the coredump of the first problem
+ *   KEY.index - hash table of the non-zero blocks of KEY.core
+ *
+ * Problems with delta cores hold another hard link to KEY.core, so the
+ * reference lives as long as any problem using it. A reference whose link
+ * count dropped to one is unused and delta_core_collect_references() removes
+ * it. Links require the reference directory to be on the file system of the
+ * dump location, other problems get full cores.
+ *
+ * A delta is a header followed by records of consecutive parts of the core:
+ *
+ *   'Z' LENGTH         - zeros
+ *   'R' LENGTH OFFSET  - bytes of the reference at OFFSET
+ *   'L' LENGTH BYTES   - bytes stored in the delta
+ *
+ * Numbers are in the byte order of the host, deltas never leave it.
+ */
+#define DELTA_CORE_BLOCK_SIZE 4096
+#define DELTA_CORE_MAGIC      "ABRTCDL1"
+#define DELTA_CORE_INDEX_MAGIC "ABRTCIX2"
+#define DELTA_CORE_TMP_PREFIX ".tmp-"
+
+enum {
+    RECORD_ZERO      = 'Z',
+    RECORD_REFERENCE = 'R',
+    RECORD_LITERAL   = 'L',
+};
+
+/* Slots of an open addressing hash table, offset 0 is an empty slot */
+struct delta_core_index_entry
+{
+    uint64_t hash;
+    uint64_t offset; /* plus one */
+};
+
+struct delta_core_index_header
+{
+    char magic[8];
+    uint32_t block_size;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct delta_core_header
+{
+    char magic[8];
+    uint32_t block_size;
+    uint32_t reserved;
+};
+
+struct delta_core_record
+{
+    uint8_t type;
+    uint8_t reserved[7];
+    uint64_t length;
+    uint64_t offset; /* RECORD_REFERENCE only */
+};
+
+/* FNV-1a */
+static uint64_t hash_block(const unsigned char *block, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= block[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool is_zero_block(const unsigned char *block, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        if (block[i] != 0)
+            return false;
+    return true;
+}
+
+char *delta_core_build_id(int elf_fd)
+{
+    unsigned char ident[EI_NIDENT];
+    if (pread(elf_fd, ident, sizeof(ident), 0) != sizeof(ident)
+        || memcmp(ident, ELFMAG, SELFMAG) != 0)
+        return NULL;
+
+    /* Offsets and sizes of program headers of both classes */
+    uint64_t phoff;
+    unsigned phnum, phentsize;
+    if (ident[EI_CLASS] == ELFCLASS64)
+    {
+        Elf64_Ehdr ehdr;
+        if (pread(elf_fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr))
+            return NULL;
+        phoff = ehdr.e_phoff;
+        phnum = ehdr.e_phnum;
+        phentsize = ehdr.e_phentsize;
+    }
+    else if (ident[EI_CLASS] == ELFCLASS32)
+    {
+        Elf32_Ehdr ehdr;
+        if (pread(elf_fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr))
+            return NULL;
+        phoff = ehdr.e_phoff;
+        phnum = ehdr.e_phnum;
+        phentsize = ehdr.e_phentsize;
+    }
+    else
+        return NULL;
+
+    for (unsigned i = 0; i < phnum; ++i)
+    {
+        uint64_t note_offset, note_size;
+        if (ident[EI_CLASS] == ELFCLASS64)
+        {
+            Elf64_Phdr phdr;
+            if (pread(elf_fd, &phdr, sizeof(phdr), phoff + (uint64_t)i * phentsize) != sizeof(phdr))
+                return NULL;
+            if (phdr.p_type != PT_NOTE)
+                continue;
+            note_offset = phdr.p_offset;
+            note_size = phdr.p_filesz;
+        }
+        else
+        {
+            Elf32_Phdr phdr;
+            if (pread(elf_fd, &phdr, sizeof(phdr), phoff + (uint64_t)i * phentsize) != sizeof(phdr))
+                return NULL;
+            if (phdr.p_type != PT_NOTE)
+                continue;
+            note_offset = phdr.p_offset;
+            note_size = phdr.p_filesz;
+        }
+
+        /* Notes of both classes have 32-bit headers */
+        while (note_size >= sizeof(Elf32_Nhdr))
+        {
+            Elf32_Nhdr nhdr;
+            if (pread(elf_fd, &nhdr, sizeof(nhdr), note_offset) != sizeof(nhdr))
+                return NULL;
+
+            const uint64_t name_size = (nhdr.n_namesz + 3) & ~3ULL;
+            const uint64_t desc_size = (nhdr.n_descsz + 3) & ~3ULL;
+            const uint64_t total = sizeof(nhdr) + name_size + desc_size;
+            if (total > note_size)
+                break;
+
+            char name[4];
+            if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == sizeof(ELF_NOTE_GNU)
+                && nhdr.n_descsz > 0 && nhdr.n_descsz <= 64
+                && pread(elf_fd, name, sizeof(name), note_offset + sizeof(nhdr)) == sizeof(name)
+                && memcmp(name, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0)
+            {
+                unsigned char desc[64];
+                if (pread(elf_fd, desc, nhdr.n_descsz, note_offset + sizeof(nhdr) + name_size) != nhdr.n_descsz)
+                    return NULL;
+
+                char *build_id = xmalloc(nhdr.n_descsz * 2 + 1);
+                bin2hex(build_id, (const char *)desc, nhdr.n_descsz)[0] = '\0';
+                return build_id;
+            }
+
+            note_offset += total;
+            note_size -= total;
+        }
+    }
+
+    return NULL;
+}
+
+char *delta_core_key(uid_t uid, const char *build_id, const char *maps)
+{
+    struct strbuf *key = strbuf_new();
+    strbuf_append_strf(key, "%lu\n%s\n", (long unsigned)uid, build_id);
+
+    /* The layout is the sequence of mapped files and their permissions,
+     * addresses differ because of ASLR:
+     * 00400000-0040b000 r-xp 00000000 fd:01 1234 /usr/bin/foo
+     */
+    char *prev = NULL;
+    for (const char *line = maps; line && *line; )
+    {
+        const char *end = strchrnul(line, '\n');
+        char *copy = xstrndup(line, end - line);
+        char *fields[6] = { NULL };
+        char *saveptr = NULL;
+        char *p = copy;
+        for (unsigned i = 0; i < 6; ++i, p = NULL)
+            fields[i] = strtok_r(p, " \t", &saveptr);
+
+        if (fields[1] != NULL)
+        {
+            char *entry = xasprintf("%s %s", fields[1], fields[5] ? fields[5] : "");
+            if (prev == NULL || strcmp(prev, entry) != 0)
+            {
+                strbuf_append_strf(key, "%s\n", entry);
+                free(prev);
+                prev = entry;
+            }
+            else
+                free(entry);
+        }
+        free(copy);
+
+        line = *end ? end + 1 : end;
+    }
+    free(prev);
+
+    char hash_str[SHA1_RESULT_LEN*2 + 1];
+    char *hash = xstrdup(str_to_sha1str(hash_str, key->buf));
+    strbuf_free(key);
+    return hash;
+}
+
+char *delta_core_reference_dir(void)
+{
+    return xasprintf("%s-core-references", g_settings_dump_location);
+}
+
+static char *reference_path(const char *ref_dir, const char *key, const char *ext)
+{
+    return xasprintf("%s/%s%s", ref_dir, key, ext);
+}
+
+/* Builds the index of the non-zero blocks of the reference core. The table
+ * is mapped from the index file, the memory of the hook does not grow with
+ * the size of the core. */
+static int build_index(int core_fd, const char *index_path)
+{
+    struct stat st;
+    if (fstat(core_fd, &st) != 0)
+    {
+        perror_msg("Can't stat reference core");
+        return -1;
+    }
+
+    /* At most a half of the slots is used */
+    struct delta_core_index_header header = {
+        .block_size = DELTA_CORE_BLOCK_SIZE,
+        .count = 2 * (st.st_size / DELTA_CORE_BLOCK_SIZE) + 1,
+    };
+    memcpy(header.magic, DELTA_CORE_INDEX_MAGIC, sizeof(header.magic));
+    const size_t map_size = sizeof(header) + header.count * sizeof(struct delta_core_index_entry);
+
+    char *tmp_path = xasprintf("%s"DELTA_CORE_TMP_PREFIX"%lu", index_path, (long)getpid());
+    int retval = -1;
+    void *map = MAP_FAILED;
+    const int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't create '%s'", tmp_path);
+        goto cleanup;
+    }
+
+    if (ftruncate(fd, map_size) != 0
+        || (map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        perror_msg("Can't map '%s'", tmp_path);
+        goto unlink_tmp;
+    }
+    memcpy(map, &header, sizeof(header));
+    struct delta_core_index_entry *const slots =
+            (struct delta_core_index_entry *)((char *)map + sizeof(header));
+
+    advise_read_once(core_fd);
+    unsigned char block[DELTA_CORE_BLOCK_SIZE];
+    uint64_t offset = 0;
+    ssize_t r;
+    while ((r = pread(core_fd, block, sizeof(block), offset)) == sizeof(block))
+    {
+        if (!is_zero_block(block, sizeof(block)))
+        {
+            const uint64_t hash = hash_block(block, sizeof(block));
+            uint64_t slot = hash % header.count;
+            /* The first block of the same content is enough */
+            while (slots[slot].offset != 0 && slots[slot].hash != hash)
+                slot = (slot + 1) % header.count;
+            if (slots[slot].offset == 0)
+            {
+                slots[slot].hash = hash;
+                slots[slot].offset = offset + 1;
+            }
+        }
+        offset += sizeof(block);
+    }
+    drop_page_cache(core_fd);
+    if (r < 0)
+    {
+        perror_msg("Can't read reference core");
+        goto unlink_tmp;
+    }
+
+    if (msync(map, map_size, MS_SYNC) != 0)
+    {
+        perror_msg("Can't write '%s'", tmp_path);
+        goto unlink_tmp;
+    }
+
+    if (rename(tmp_path, index_path) != 0)
+    {
+        perror_msg("Can't rename '%s'", tmp_path);
+        goto unlink_tmp;
+    }
+    retval = 0;
+    goto cleanup;
+
+ unlink_tmp:
+    unlink(tmp_path);
+
+ cleanup:
+    if (map != MAP_FAILED)
+        munmap(map, map_size);
+    if (fd >= 0)
+    {
+        drop_page_cache(fd);
+        close(fd);
+    }
+    free(tmp_path);
+    return retval;
+}
+
+int delta_core_register_reference(const char *ref_dir, const char *key, const char *core_path)
+{
+    if (mkdir(ref_dir, 0700) != 0 && errno != EEXIST)
+    {
+        perror_msg("Can't create '%s'", ref_dir);
+        return -1;
+    }
+
+    char *ref_core = reference_path(ref_dir, key, ".core");
+    char *ref_index = reference_path(ref_dir, key, ".index");
+    char *tmp_core = xasprintf("%s"DELTA_CORE_TMP_PREFIX"%lu", ref_core, (long)getpid());
+    int retval = -1;
+
+    /* The index first, the reference is usable once the core is renamed */
+    const int core_fd = open(core_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (core_fd < 0)
+    {
+        perror_msg("Can't open '%s'", core_path);
+        goto cleanup;
+    }
+    const int r = build_index(core_fd, ref_index);
+    close(core_fd);
+    if (r != 0)
+        goto cleanup;
+
+    if (link(core_path, tmp_core) != 0)
+    {
+        /* EXDEV: the references are not on the file system of the dump
+         * location */
+        log_notice("Can't link '%s' to '%s': %s", core_path, tmp_core, strerror(errno));
+        unlink(ref_index);
+        goto cleanup;
+    }
+
+    if (rename(tmp_core, ref_core) != 0)
+    {
+        perror_msg("Can't rename '%s'", tmp_core);
+        unlink(tmp_core);
+        goto cleanup;
+    }
+
+    log_notice("Registered reference core '%s'", ref_core);
+    retval = 0;
+
+ cleanup:
+    free(tmp_core);
+    free(ref_index);
+    free(ref_core);
+    return retval;
+}
+
+struct delta_core_encoder
+{
+    FILE *out;
+    int ref_fd;
+    uint64_t ref_size;
+    const struct delta_core_index_entry *index;
+    uint64_t index_count;
+    struct delta_core_record pending;
+};
+
+static int flush_pending(struct delta_core_encoder *enc)
+{
+    if (enc->pending.length == 0)
+        return 0;
+
+    const int r = fwrite(&enc->pending, sizeof(enc->pending), 1, enc->out) == 1 ? 0 : -1;
+    memset(&enc->pending, 0, sizeof(enc->pending));
+    return r;
+}
+
+static int add_record(struct delta_core_encoder *enc, uint8_t type, uint64_t length, uint64_t offset)
+{
+    /* Merge consecutive zeros and consecutive parts of the reference */
+    if (enc->pending.length != 0 && enc->pending.type == type
+        && (type == RECORD_ZERO || enc->pending.offset + enc->pending.length == offset))
+    {
+        enc->pending.length += length;
+        return 0;
+    }
+
+    if (flush_pending(enc) != 0)
+        return -1;
+
+    enc->pending.type = type;
+    enc->pending.length = length;
+    enc->pending.offset = offset;
+    return 0;
+}
+
+static bool reference_matches(struct delta_core_encoder *enc, uint64_t offset,
+                              const unsigned char *block, size_t size)
+{
+    unsigned char ref_block[DELTA_CORE_BLOCK_SIZE];
+    return offset + size <= enc->ref_size
+        && pread(enc->ref_fd, ref_block, size, offset) == (ssize_t)size
+        && memcmp(ref_block, block, size) == 0;
+}
+
+/* Returns offset of the same block in the reference or -1 */
+static int64_t find_in_reference(struct delta_core_encoder *enc, uint64_t core_offset,
+                                 const unsigned char *block, size_t size)
+{
+    /* The continuation of the previous match and the same offset are the
+     * most likely ones */
+    if (enc->pending.type == RECORD_REFERENCE && enc->pending.length != 0)
+    {
+        const uint64_t next = enc->pending.offset + enc->pending.length;
+        if (reference_matches(enc, next, block, size))
+            return next;
+    }
+    if (reference_matches(enc, core_offset, block, size))
+        return core_offset;
+
+    /* Only full blocks are indexed */
+    if (size != DELTA_CORE_BLOCK_SIZE || enc->index_count == 0)
+        return -1;
+
+    const uint64_t hash = hash_block(block, size);
+    for (uint64_t slot = hash % enc->index_count;
+         enc->index[slot].offset != 0;
+         slot = (slot + 1) % enc->index_count)
+    {
+        if (enc->index[slot].hash == hash
+            && reference_matches(enc, enc->index[slot].offset - 1, block, size))
+            return enc->index[slot].offset - 1;
+    }
+
+    return -1;
+}
+
+ssize_t delta_core_encode(const char *ref_dir, const char *key, struct dump_dir *dd,
+                          int in_fd, size_t limit)
+{
+    char *ref_core = reference_path(ref_dir, key, ".core");
+    char *ref_index = reference_path(ref_dir, key, ".index");
+    char *problem_ref = concat_path_file(dd->dd_dirname, FILENAME_COREDUMP_REFERENCE);
+    char *delta_path = concat_path_file(dd->dd_dirname, FILENAME_COREDUMP_DELTA);
+    ssize_t retval = -ENOENT;
+    void *map = MAP_FAILED;
+    size_t map_size = 0;
+    int index_fd = -1;
+    struct delta_core_encoder enc = { .ref_fd = -1 };
+
+    index_fd = open(ref_index, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (index_fd < 0)
+        goto cleanup;
+
+    /* Holding a link of the reference keeps it alive */
+    if (linkat(AT_FDCWD, ref_core, dd->dd_fd, FILENAME_COREDUMP_REFERENCE, 0) != 0)
+    {
+        if (errno != ENOENT)
+            log_notice("Can't link '%s' to '%s': %s", ref_core, problem_ref, strerror(errno));
+        goto cleanup;
+    }
+
+    enc.ref_fd = openat(dd->dd_fd, FILENAME_COREDUMP_REFERENCE, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    struct stat st;
+    if (enc.ref_fd < 0 || fstat(enc.ref_fd, &st) != 0)
+    {
+        perror_msg("Can't open reference core '%s'", problem_ref);
+        goto unlink_reference;
+    }
+    enc.ref_size = st.st_size;
+
+    /* The index is mapped, the memory use of the hook does not depend on the
+     * size of the core */
+    struct delta_core_index_header header;
+    if (fstat(index_fd, &st) != 0
+        || pread(index_fd, &header, sizeof(header), 0) != sizeof(header)
+        || memcmp(header.magic, DELTA_CORE_INDEX_MAGIC, sizeof(header.magic)) != 0
+        || header.block_size != DELTA_CORE_BLOCK_SIZE
+        || (uint64_t)st.st_size != sizeof(header) + header.count * sizeof(struct delta_core_index_entry))
+    {
+        error_msg("Invalid reference index '%s'", ref_index);
+        goto unlink_reference;
+    }
+    if (header.count != 0)
+    {
+        map_size = st.st_size;
+        map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, index_fd, 0);
+        if (map == MAP_FAILED)
+        {
+            perror_msg("Can't map '%s'", ref_index);
+            goto unlink_reference;
+        }
+        enc.index = (const struct delta_core_index_entry *)((const char *)map + sizeof(header));
+        enc.index_count = header.count;
+    }
+
+    /* Owned by the owner of the problem like other elements */
+    const int delta_fd = dd_open_item(dd, FILENAME_COREDUMP_DELTA, O_RDWR);
+    enc.out = delta_fd < 0 ? NULL : fdopen(delta_fd, "w");
+    if (enc.out == NULL)
+    {
+        perror_msg("Can't create '%s'", delta_path);
+        if (delta_fd >= 0)
+            close(delta_fd);
+        goto unlink_reference;
+    }
+
+    /* The input is consumed from here on, errors are not recoverable */
+    retval = -EIO;
+
+    struct delta_core_header delta_header = { .block_size = DELTA_CORE_BLOCK_SIZE };
+    memcpy(delta_header.magic, DELTA_CORE_MAGIC, sizeof(delta_header.magic));
+    if (fwrite(&delta_header, sizeof(delta_header), 1, enc.out) != 1)
+        goto close_delta;
+
+    unsigned char block[DELTA_CORE_BLOCK_SIZE];
+    uint64_t core_size = 0;
+    uint64_t literal = 0;
+    while (core_size < limit)
+    {
+        const size_t want = MIN(sizeof(block), limit - core_size);
+        const ssize_t size = full_read(in_fd, block, want);
+        if (size < 0)
+        {
+            perror_msg("Can't read the core");
+            goto close_delta;
+        }
+        if (size == 0)
+            break;
+
+        int r;
+        int64_t ref_offset;
+        if (is_zero_block(block, size))
+            r = add_record(&enc, RECORD_ZERO, size, 0);
+        else if ((ref_offset = find_in_reference(&enc, core_size, block, size)) >= 0)
+            r = add_record(&enc, RECORD_REFERENCE, size, ref_offset);
+        else
+        {
+            r = flush_pending(&enc);
+            struct delta_core_record record = { .type = RECORD_LITERAL, .length = size };
+            if (r == 0 && (fwrite(&record, sizeof(record), 1, enc.out) != 1
+                           || fwrite(block, size, 1, enc.out) != 1))
+                r = -1;
+            literal += size;
+        }
+        if (r != 0)
+            goto close_delta;
+
+        core_size += size;
+        if ((size_t)size < want)
+            break;
+    }
+
+    if (flush_pending(&enc) != 0)
+        goto close_delta;
+
+    log_info("Delta core: %llu bytes, %llu bytes not in the reference",
+             (unsigned long long)core_size, (unsigned long long)literal);
+    retval = core_size;
+
+ close_delta:
+    if (fflush(enc.out) != 0 || fsync(fileno(enc.out)) != 0)
+        retval = -EIO;
+    fclose(enc.out);
+    if (retval < 0)
+    {
+        perror_msg("Can't write '%s'", delta_path);
+        unlinkat(dd->dd_fd, FILENAME_COREDUMP_DELTA, 0);
+    }
+
+ unlink_reference:
+    if (retval < 0)
+        unlinkat(dd->dd_fd, FILENAME_COREDUMP_REFERENCE, 0);
+
+ cleanup:
+    if (map != MAP_FAILED)
+        munmap(map, map_size);
+    if (enc.ref_fd >= 0)
+        close(enc.ref_fd);
+    if (index_fd >= 0)
+        close(index_fd);
+    free(delta_path);
+    free(problem_ref);
+    free(ref_index);
+    free(ref_core);
+    return retval;
+}
+
+static int copy_from_reference(int ref_fd, uint64_t offset, uint64_t length, struct abrt_write_behind *wb)
+{
+    char buf[64 * 1024];
+    while (length > 0)
+    {
+        const ssize_t r = pread(ref_fd, buf, MIN(sizeof(buf), length), offset);
+        if (r <= 0)
+            return -1;
+        if (full_write(wb->fd, buf, r) != r)
+            return -1;
+        write_behind_wrote(wb, r);
+        offset += r;
+        length -= r;
+    }
+    return 0;
+}
+
+static int copy_literal(FILE *in, uint64_t length, struct abrt_write_behind *wb)
+{
+    char buf[64 * 1024];
+    while (length > 0)
+    {
+        const size_t r = fread(buf, 1, MIN(sizeof(buf), length), in);
+        if (r == 0)
+            return -1;
+        if (full_write(wb->fd, buf, r) != (ssize_t)r)
+            return -1;
+        write_behind_wrote(wb, r);
+        length -= r;
+    }
+    return 0;
+}
+
+int delta_core_restore(const char *problem_dir, int out_fd)
+{
+    char *problem_ref = concat_path_file(problem_dir, FILENAME_COREDUMP_REFERENCE);
+    char *delta_path = concat_path_file(problem_dir, FILENAME_COREDUMP_DELTA);
+    int retval = -1;
+
+    FILE *in = fopen(delta_path, "r");
+    const int ref_fd = open(problem_ref, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (in == NULL || ref_fd < 0)
+    {
+        perror_msg("Can't open '%s'", in == NULL ? delta_path : problem_ref);
+        goto cleanup;
+    }
+
+    struct delta_core_header header;
+    if (fread(&header, sizeof(header), 1, in) != 1
+        || memcmp(header.magic, DELTA_CORE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        error_msg("'%s' is not a delta core", delta_path);
+        goto cleanup;
+    }
+
+    /* A restored core can be larger than the free memory */
+    advise_read_once(ref_fd);
+    struct abrt_write_behind wb;
+    write_behind_init(&wb, out_fd);
+
+    uint64_t core_size = 0;
+    struct delta_core_record record;
+    while (fread(&record, sizeof(record), 1, in) == 1)
+    {
+        int r = 0;
+        switch (record.type)
+        {
+            case RECORD_ZERO:
+                /* Leaves a hole, the size is set at the end */
+                r = lseek(out_fd, record.length, SEEK_CUR) < 0 ? -1 : 0;
+                write_behind_wrote(&wb, record.length);
+                break;
+            case RECORD_REFERENCE:
+                r = copy_from_reference(ref_fd, record.offset, record.length, &wb);
+                break;
+            case RECORD_LITERAL:
+                r = copy_literal(in, record.length, &wb);
+                break;
+            default:
+                error_msg("Invalid record in '%s'", delta_path);
+                goto cleanup;
+        }
+        if (r != 0)
+        {
+            perror_msg("Can't restore the core from '%s'", delta_path);
+            goto cleanup;
+        }
+        core_size += record.length;
+    }
+
+    if (ferror(in) || ftruncate(out_fd, core_size) != 0)
+    {
+        perror_msg("Can't restore the core from '%s'", delta_path);
+        goto cleanup;
+    }
+    write_behind_finish(&wb);
+    retval = 0;
+
+ cleanup:
+    if (ref_fd >= 0)
+        close(ref_fd);
+    if (in != NULL)
+        fclose(in);
+    free(delta_path);
+    free(problem_ref);
+    return retval;
+}
+
+unsigned delta_core_collect_references(const char *ref_dir)
+{
+    DIR *dir = opendir(ref_dir);
+    if (dir == NULL)
+        return 0;
+
+    unsigned removed = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        const char *ext = strrchr(dent->d_name, '.');
+        if (ext == NULL || strcmp(ext, ".core") != 0)
+            continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0
+            || !S_ISREG(st.st_mode) || st.st_nlink > 1)
+            continue;
+
+        /* Neither the first problem nor any other uses it */
+        log_info("Removing unused reference core '%s'", dent->d_name);
+        char *index_name = xasprintf("%.*s.index", (int)(ext - dent->d_name), dent->d_name);
+        unlinkat(dirfd(dir), index_name, 0);
+        unlinkat(dirfd(dir), dent->d_name, 0);
+        free(index_name);
+        ++removed;
+    }
+    closedir(dir);
+
+    return removed;
+}
+
+/* A core linked from the reference directory is shared by the problems
+ * linking it, each of them is charged its part */
+static double element_size(const char *name, const struct stat *st)
+{
+    if (st->st_nlink > 1
+        && (strcmp(name, FILENAME_COREDUMP) == 0 || strcmp(name, FILENAME_COREDUMP_REFERENCE) == 0))
+        return (double)st->st_size / (st->st_nlink - 1);
+    return st->st_size;
+}
+
+double problem_dir_size(const char *dirname)
+{
+    DIR *dir = opendir(dirname);
+    if (dir == NULL)
+        return 0;
+
+    double size = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        if (S_ISREG(st.st_mode))
+            size += element_size(dent->d_name, &st);
+        else if (S_ISDIR(st.st_mode))
+        {
+            char *path = concat_path_file(dirname, dent->d_name);
+            size += get_dirsize(path);
+            free(path);
+        }
+    }
+    closedir(dir);
+
+    return size;
+}
+
+double dump_location_size(const char *dirname, char **worst_dir, const char *excluded)
+{
+    if (worst_dir)
+        *worst_dir = NULL;
+
+    DIR *dir = opendir(dirname);
+    if (dir == NULL)
+        return 0;
+
+    const time_t cur_time = time(NULL);
+    double size = 0;
+    double max_weight = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        if (S_ISREG(st.st_mode))
+        {
+            size += st.st_size;
+            continue;
+        }
+        if (!S_ISDIR(st.st_mode))
+            continue;
+
+        char *path = concat_path_file(dirname, dent->d_name);
+        const double dir_size = problem_dir_size(path);
+        free(path);
+        size += dir_size;
+
+        if (worst_dir == NULL || (excluded != NULL && strcmp(excluded, dent->d_name) == 0))
+            continue;
+
+        /* The same weight as get_dirsize_find_largest_dir(): KiB * minutes */
+        double weight = dir_size / 1024;
+        const long age = (cur_time - st.st_mtime) / 60;
+        if (age > 1)
+            weight *= age;
+        if (weight > max_weight)
+        {
+            max_weight = weight;
+            free(*worst_dir);
+            *worst_dir = xstrdup(dent->d_name);
+        }
+    }
+    closedir(dir);
+
+    return size;
+}
@@ -68,7 +68,7 @@ void trim_problem_dirs(const char *dirname, double cap_size, const char *exclude
     {
         /* We exclude our own dir from candidates for deletion (3rd param): */
         char *worst_basename = NULL;
-        double cur_size = get_dirsize_find_largest_dir(dirname, &worst_basename, excluded_basename);
+        double cur_size = dump_location_size(dirname, &worst_basename, excluded_basename);
         if (cur_size <= cap_size || !worst_basename)
         {
             log_info("cur_size:%.0f cap_size:%.0f, no (more) trimming", cur_size, cap_size);
@@ -183,7 +183,6 @@ char *run_unstrip_n(const char *dump_dir_name, unsigned timeout_sec)
     args[2] = (char*)"-n";
     args[3] = NULL;
     pid_t child = fork_execv_on_steroids(flags, args, pipeout, /*env_vec:*/ NULL, /*dir:*/ NULL, /*uid(unused):*/ 0);
-    free(args[1]);
 
     /* Bugs in unstrip or corrupted coredumps can cause it to enter infinite loop.
      * Therefore we have a (largish) timeout, after which we kill the child.
@@ -229,6 +228,10 @@ char *run_unstrip_n(const char *dump_dir_name, unsigned timeout_sec)
     int status;
     safe_waitpid(child, &status, 0);
 
+    /* Don't let the core push out the working set of other processes */
+    drop_file_page_cache(args[1] + strlen("--core="));
+    free(args[1]);
+
     if (status != 0 || buf_out == NULL)
     {
         /* unstrip didnt exit with exit code 0, or we timed out */
@@ -406,6 +409,8 @@ char *get_backtrace(const char *dump_dir_name, unsigned timeout_sec, const char
         free(args[auto_load_base_index + 2]);
     }
 
+    drop_file_page_cache(args[core_cmd_index] + strlen("core-file "));
+
     free(args[debug_dir_cmd_index]);
     free(args[file_cmd_index]);
     free(args[core_cmd_index]);
@@ -528,18 +533,18 @@ void ensure_writable_dir_group(const char *dir, mode_t mode, const char *user, c
     ensure_writable_dir_uid_gid(dir, mode, pw->pw_uid, gr->gr_gid);
 }
 
-bool dir_is_in_dump_location(const char *dir_name)
+static bool dir_is_in_location(const char *dir_name, const char *location)
 {
-    unsigned len = strlen(g_settings_dump_location);
+    unsigned len = strlen(location);
 
-    /* The path must start with "g_settings_dump_location" */
-    if (strncmp(dir_name, g_settings_dump_location, len) != 0)
+    /* The path must start with "location" */
+    if (strncmp(dir_name, location, len) != 0)
     {
-        log_debug("Bad parent directory: '%s' not in '%s'", g_settings_dump_location, dir_name);
+        log_debug("Bad parent directory: '%s' not in '%s'", location, dir_name);
         return false;
     }
 
-    /* and must be a sub-directory of the g_settings_dump_location dir */
+    /* and must be a sub-directory of the location dir */
     const char *base_name = dir_name + len;
     while (*base_name && *base_name == '/')
         ++base_name;
@@ -561,6 +566,18 @@ bool dir_is_in_dump_location(const char *dir_name)
     return S_ISDIR(sb.st_mode);
 }
 
+bool dir_is_in_dump_location(const char *dir_name)
+{
+    return dir_is_in_location(dir_name, g_settings_dump_location);
+}
+
+bool dir_is_in_problem_storage(const char *dir_name)
+{
+    return dir_is_in_location(dir_name, g_settings_dump_location)
+        || (g_settings_cold_dump_location != NULL
+            && dir_is_in_location(dir_name, g_settings_cold_dump_location));
+}
+
 bool dir_has_correct_permissions(const char *dir_name, int flags)
 {
     struct stat statbuf;
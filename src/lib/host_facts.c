@@ -0,0 +1,193 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/utsname.h>
+#include "libabrt.h"
+
+#define HOST_FACTS_DIR VAR_STATE"/host-facts"
+#define HOST_FACTS_CURRENT "current"
+
+const char *const host_facts_elements[] = {
+    FILENAME_CPUINFO,
+    FILENAME_RUNLEVEL,
+    FILENAME_MACHINEID,
+    NULL
+};
+
+const char *host_facts_dir(void)
+{
+    const char *dir = getenv("ABRT_HOST_FACTS_DIR");
+    return dir != NULL ? dir : HOST_FACTS_DIR;
+}
+
+bool host_facts_is_element(const char *name)
+{
+    for (const char *const *elem = host_facts_elements; *elem != NULL; ++elem)
+        if (strcmp(*elem, name) == 0)
+            return true;
+
+    return false;
+}
+
+/* Generations are SHA1 hex strings, let's not trust the contents of problem
+ * directories */
+static bool is_valid_generation(const char *generation)
+{
+    const size_t len = strlen(generation);
+    return len == SHA1_RESULT_LEN * 2 && strspn(generation, "0123456789abcdef") == len;
+}
+
+char *host_facts_generation_dir(const char *generation)
+{
+    if (!is_valid_generation(generation))
+        return NULL;
+
+    return concat_path_file(host_facts_dir(), generation);
+}
+
+/* The facts are collected by spawning processes, the fingerprint is built
+ * only from cheaply available data which change together with the facts. */
+char *host_facts_fingerprint(void)
+{
+    struct utsname uts;
+    if (uname(&uts) != 0)
+        memset(&uts, 0, sizeof(uts));
+
+    char *boot_id = xmalloc_fopen_fgetline_fclose("/proc/sys/kernel/random/boot_id");
+    /* CPU hot-plug */
+    char *cpus = xmalloc_fopen_fgetline_fclose("/sys/devices/system/cpu/online");
+
+    struct stat os_release;
+    if (stat("/etc/os-release", &os_release) != 0)
+        memset(&os_release, 0, sizeof(os_release));
+
+    struct stat machine_id;
+    if (stat("/etc/machine-id", &machine_id) != 0)
+        memset(&machine_id, 0, sizeof(machine_id));
+
+    /* Runlevel changes are recorded in utmp */
+    struct stat utmp;
+    if (stat("/run/utmp", &utmp) != 0)
+        memset(&utmp, 0, sizeof(utmp));
+
+    char *fingerprint = xasprintf("%s|%s|%s|%s|%s|%lld.%lld|%lld|%lld",
+            boot_id ? boot_id : "", uts.nodename, uts.release, uts.machine,
+            cpus ? cpus : "",
+            (long long)os_release.st_mtime, (long long)os_release.st_size,
+            (long long)machine_id.st_mtime, (long long)utmp.st_mtime);
+
+    free(cpus);
+    free(boot_id);
+
+    return fingerprint;
+}
+
+char *host_facts_current_generation(void)
+{
+    char *current_path = concat_path_file(host_facts_dir(), HOST_FACTS_CURRENT);
+    char *current = xmalloc_open_read_close(current_path, /*maxsize:*/ NULL);
+    free(current_path);
+    if (current == NULL)
+        return NULL;
+
+    char *generation = NULL;
+    char *fingerprint = strchr(current, '\n');
+    if (fingerprint != NULL)
+    {
+        *fingerprint++ = '\0';
+        strchrnul(fingerprint, '\n')[0] = '\0';
+
+        char *actual = host_facts_fingerprint();
+        char *dir = host_facts_generation_dir(current);
+        if (dir != NULL && strcmp(fingerprint, actual) == 0 && access(dir, F_OK) == 0)
+            generation = xstrdup(current);
+        else
+            log_debug("Host facts snapshot '%s' is outdated", current);
+
+        free(dir);
+        free(actual);
+    }
+
+    free(current);
+    return generation;
+}
+
+int host_facts_set_current_generation(const char *generation, const char *fingerprint)
+{
+    char *current_path = concat_path_file(host_facts_dir(), HOST_FACTS_CURRENT);
+    char *tmp_path = xasprintf("%s.%lu", current_path, (unsigned long)getpid());
+    char *current = xasprintf("%s\n%s\n", generation, fingerprint);
+
+    int r = -1;
+    const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0)
+        perror_msg("Can't create '%s'", tmp_path);
+    else
+    {
+        const bool written = full_write_str(fd, current) >= 0;
+        close(fd);
+
+        if (written && rename(tmp_path, current_path) == 0)
+            r = 0;
+        else
+        {
+            perror_msg("Can't save '%s'", current_path);
+            unlink(tmp_path);
+        }
+    }
+
+    free(current);
+    free(tmp_path);
+    free(current_path);
+    return r;
+}
+
+char *host_facts_load(const char *generation, const char *name)
+{
+    if (!host_facts_is_element(name))
+        return NULL;
+
+    char *dir = host_facts_generation_dir(generation);
+    if (dir == NULL)
+    {
+        log_notice("Invalid host facts generation '%s'", generation);
+        return NULL;
+    }
+
+    char *path = concat_path_file(dir, name);
+    char *value = xmalloc_open_read_close(path, /*maxsize:*/ NULL);
+    free(path);
+    free(dir);
+
+    return value;
+}
+
+char *host_facts_load_from_dump_dir(struct dump_dir *dd, const char *name)
+{
+    if (!host_facts_is_element(name) || dd_exist(dd, name))
+        return NULL;
+
+    char *generation = dd_load_text_ext(dd, FILENAME_HOST_FACTS,
+            DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT);
+    if (generation == NULL)
+        return NULL;
+
+    char *value = host_facts_load(generation, name);
+    free(generation);
+
+    return value;
+}
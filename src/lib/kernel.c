@@ -321,6 +321,128 @@ next_line:
     free(lines_info);
 }
 
+/* Kernel escapes non-printable characters (including new lines of
+ * multi-line messages) in /dev/kmsg records as \xNN */
+static char *kmsg_unescape(const char *text, size_t len)
+{
+    char *result = xmalloc(len + 1);
+    char *dst = result;
+    const char *const end = text + len;
+
+    while (text < end)
+    {
+        if (text[0] == '\\' && end - text >= 4 && text[1] == 'x'
+         && isxdigit(text[2]) && isxdigit(text[3]))
+        {
+            const char hex[3] = { text[2], text[3], '\0' };
+            *dst++ = (char)strtoul(hex, NULL, 16);
+            text += 4;
+        }
+        else
+            *dst++ = *text++;
+    }
+    *dst = '\0';
+
+    return result;
+}
+
+static void kmsg_add_line(struct abrt_koops_line_info **lines_info, int *lines_info_size, char *line, int level)
+{
+    if ((*lines_info_size & 0xfff) == 0)
+        *lines_info = xrealloc(*lines_info, (*lines_info_size + 0x1000) * sizeof((*lines_info)[0]));
+
+    (*lines_info)[*lines_info_size].ptr = line;
+    (*lines_info)[*lines_info_size].level = level;
+    ++(*lines_info_size);
+}
+
+int koops_extract_oopses_from_kmsg(GList **oops_list, GList **oom_list, GList **stall_list,
+                                   const char *buffer, size_t buflen, unsigned long long *next_seq)
+{
+    int records = 0;
+    int lines_info_size = 0;
+    struct abrt_koops_line_info *lines_info = NULL;
+
+    const char *const end = buffer + buflen;
+    const char *c = buffer;
+    while (c < end)
+    {
+        const char *eol = memchr(c, '\n', end - c);
+        if (eol == NULL)
+            eol = end;
+
+        const char *const line = c;
+        c = eol + 1;
+
+        /* Dictionary (" KEY=VALUE") and empty lines */
+        if (line[0] == ' ' || line == eol)
+            continue;
+
+        const char *text = memchr(line, ';', eol - line);
+        unsigned prio;
+        unsigned long long seq;
+        char flag = '-';
+        if (text == NULL
+         || sscanf(line, "%u,%llu,%*u,%c", &prio, &seq, &flag) < 2)
+        {
+            log_debug("Malformed kmsg record: '%.*s'", (int)(eol - line), line);
+            continue;
+        }
+        ++text;
+
+        if (seq < *next_seq)
+            continue;
+
+        if (*next_seq != 0 && seq > *next_seq)
+            log_notice("Kernel log records %llu-%llu were lost", *next_seq, seq - 1);
+        *next_seq = seq + 1;
+        ++records;
+
+        /* Messages written to /dev/kmsg by user space have non-zero facility */
+        if ((prio >> 3) != 0)
+            continue;
+
+        const int level = prio & 7;
+        char *message = kmsg_unescape(text, eol - text);
+
+        /* Fragments of continuation lines on older kernels */
+        if (flag == '+' && lines_info_size > 0)
+        {
+            char *prev = lines_info[lines_info_size - 1].ptr;
+            lines_info[lines_info_size - 1].ptr = xasprintf("%s%s", prev, message);
+            free(prev);
+            free(message);
+            continue;
+        }
+
+        /* A single record can hold several lines */
+        char *msg_line = message;
+        char *nl;
+        while ((nl = strchr(msg_line, '\n')) != NULL)
+        {
+            kmsg_add_line(&lines_info, &lines_info_size, xstrndup(msg_line, nl - msg_line), level);
+            msg_line = nl + 1;
+        }
+        kmsg_add_line(&lines_info, &lines_info_size, xstrdup(msg_line), level);
+        free(message);
+    }
+
+    koops_extract_oopses_from_lines(oops_list, lines_info, lines_info_size);
+    if (oom_list != NULL)
+        koops_extract_oom_kills_from_lines(oom_list, lines_info, lines_info_size);
+    if (stall_list != NULL)
+    {
+        koops_extract_stalls_from_lines(stall_list, lines_info, lines_info_size);
+        koops_drop_stall_oopses(oops_list);
+    }
+
+    for (int i = 0; i < lines_info_size; ++i)
+        free(lines_info[i].ptr);
+    free(lines_info);
+
+    return records;
+}
+
 void koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_koops_line_info *lines_info, int lines_info_size)
 {
     /* Analyze lines */
@@ -518,6 +640,857 @@ void koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_koops_
         }
     }
 }
+
+/* The task table of a machine with thousands of processes is long */
+#define OOM_MAX_REPORT_LINES 16384
+
+#define OOM_END_MARKER "Killed process "
+
+void koops_extract_oom_kills_from_lines(GList **oom_list, const struct abrt_koops_line_info *lines_info, int lines_info_size)
+{
+    int oomstart = -1;
+    for (int i = 0; i < lines_info_size; ++i)
+    {
+        const char *curline = lines_info[i].ptr;
+        if (curline == NULL)
+            continue;
+
+        /* A report without the end is superseded by the next one */
+        if (strstr(curline, KOOPS_OOM_START_STRING))
+        {
+            if (oomstart >= 0)
+                log_debug("Dropped OOM report at line %d, no killed process", oomstart);
+
+            oomstart = i;
+            continue;
+        }
+
+        if (oomstart < 0)
+            continue;
+
+        if (i - oomstart > OOM_MAX_REPORT_LINES)
+        {
+            log_debug("Dropped OOM report at line %d, too long", oomstart);
+            oomstart = -1;
+            continue;
+        }
+
+        if (!strstr(curline, OOM_END_MARKER))
+            continue;
+
+        log_debug("Found OOM kill at lines %d-%d", oomstart, i);
+
+        struct strbuf *report = strbuf_new();
+        for (int q = oomstart; q <= i; ++q)
+        {
+            const char *line = lines_info[q].ptr;
+            if (line == NULL || line[0] == '\0')
+                continue;
+
+            while (*line == ' ')
+                ++line;
+            strbuf_append_strf(report, "%s\n", line);
+        }
+        *oom_list = g_list_append(*oom_list, strbuf_free_nobuf(report));
+
+        oomstart = -1;
+    }
+}
+
+/* Returns malloced value of KEY=VALUE item of the "oom-kill:" line */
+static char *oom_kill_line_value(const char *line, const char *key)
+{
+    const size_t key_len = strlen(key);
+    for (const char *item = strstr(line, "oom-kill:"); item != NULL; item = strchr(item, ','))
+    {
+        ++item; /* behind ':' or ',' */
+        if (strncmp(item, key, key_len) == 0 && item[key_len] == '=')
+        {
+            const char *value = item + key_len + 1;
+            return xstrndup(value, strcspn(value, ",\n"));
+        }
+    }
+
+    return NULL;
+}
+
+static bool oom_line_is_task(const char *line)
+{
+    /* "[  pid  ]   uid  tgid total_vm ..." or "[ 1234]  1000  1234 ..." */
+    return line[0] == '[' && strchr(line, ']') != NULL;
+}
+
+int koops_oom_parse(const char *report, struct abrt_koops_oom *oom)
+{
+    memset(oom, 0, sizeof(*oom));
+    oom->victim_uid = -1;
+
+    struct strbuf *trace = strbuf_new();
+    struct strbuf *meminfo = strbuf_new();
+    struct strbuf *tasks = strbuf_new();
+    bool memcg_oom = false;
+
+    enum { OOM_TRACE, OOM_MEMINFO, OOM_TASKS } section = OOM_TRACE;
+    for (const char *line = report; *line != '\0'; )
+    {
+        const char *end = strchrnul(line, '\n');
+        char *cur = xstrndup(line, end - line);
+        line = *end ? end + 1 : end;
+
+        if (section != OOM_TASKS
+         && (strncmp(cur, "Tasks state", strlen("Tasks state")) == 0
+          || strncmp(cur, "[ pid ]", strlen("[ pid ]")) == 0
+          || strncmp(cur, "[  pid  ]", strlen("[  pid  ]")) == 0))
+            section = OOM_TASKS;
+        else if (section == OOM_TRACE
+         && (strncmp(cur, "Mem-Info:", strlen("Mem-Info:")) == 0
+          || strncmp(cur, "memory: usage", strlen("memory: usage")) == 0))
+            section = OOM_MEMINFO;
+        else if (section == OOM_TASKS && !oom_line_is_task(cur))
+            section = OOM_TRACE;
+
+        if (strstr(cur, "Memory cgroup out of memory"))
+            memcg_oom = true;
+
+        if (strncmp(cur, "oom-kill:", strlen("oom-kill:")) == 0)
+        {
+            oom->constraint = oom_kill_line_value(cur, "constraint");
+            oom->memcg = oom_kill_line_value(cur, "oom_memcg");
+            oom->task_memcg = oom_kill_line_value(cur, "task_memcg");
+
+            char *uid = oom_kill_line_value(cur, "uid");
+            if (uid != NULL)
+                oom->victim_uid = strtol(uid, NULL, 10);
+            free(uid);
+        }
+
+        const char *killed = strstr(cur, OOM_END_MARKER);
+        if (killed != NULL && oom->victim == NULL)
+        {
+            char *comm_start = NULL;
+            oom->victim_pid = strtoul(killed + strlen(OOM_END_MARKER), &comm_start, 10);
+            if (comm_start != NULL && comm_start[0] == ' ' && comm_start[1] == '(')
+            {
+                /* Process names can contain ')' */
+                const char *comm_end = strstr(comm_start, ") ");
+                if (comm_end == NULL)
+                    comm_end = strrchr(comm_start, ')');
+                if (comm_end != NULL)
+                    oom->victim = xstrndup(comm_start + 2, comm_end - comm_start - 2);
+            }
+        }
+
+        struct strbuf *dst = section == OOM_TASKS ? tasks : section == OOM_MEMINFO ? meminfo : trace;
+        strbuf_append_strf(dst, "%s\n", cur);
+        free(cur);
+    }
+
+    oom->trace = strbuf_free_nobuf(trace);
+    oom->meminfo = meminfo->len ? strbuf_free_nobuf(meminfo) : (strbuf_free(meminfo), NULL);
+    oom->tasks = tasks->len ? strbuf_free_nobuf(tasks) : (strbuf_free(tasks), NULL);
+
+    /* Kernels older than 4.19 do not print the "oom-kill:" line */
+    if (oom->constraint == NULL)
+        oom->constraint = xstrdup(memcg_oom ? "CONSTRAINT_MEMCG" : "CONSTRAINT_NONE");
+    if (oom->memcg == NULL && !memcg_oom)
+        oom->memcg = xstrdup("/");
+
+    if (oom->victim == NULL)
+    {
+        koops_oom_free(oom);
+        return -1;
+    }
+
+    return 0;
+}
+
+void koops_oom_free(struct abrt_koops_oom *oom)
+{
+    free(oom->constraint);
+    free(oom->memcg);
+    free(oom->task_memcg);
+    free(oom->victim);
+    free(oom->trace);
+    free(oom->meminfo);
+    free(oom->tasks);
+    memset(oom, 0, sizeof(*oom));
+}
+
+char *koops_oom_cgroup_key(const struct abrt_koops_oom *oom)
+{
+    const char *cgroup = oom->task_memcg ? oom->task_memcg : oom->memcg;
+    if (cgroup == NULL)
+        return NULL;
+
+    /* Instances of the same unit have a common key */
+    char *unit = NULL;
+    for (const char *component = cgroup; *component != '\0'; )
+    {
+        const char *next = strchrnul(component, '/');
+        const size_t len = next - component;
+        if (len > strlen(".service") && strncmp(next - strlen(".service"), ".service", strlen(".service")) == 0)
+        {
+            free(unit);
+            unit = xstrndup(component, len);
+        }
+
+        component = *next ? next + 1 : next;
+    }
+
+    return unit ? unit : xstrdup(cgroup);
+}
+
+void koops_oom_hash_str(char result[SHA1_RESULT_LEN*2 + 1], const struct abrt_koops_oom *oom)
+{
+    char *cgroup = koops_oom_cgroup_key(oom);
+    char *hash_str = xasprintf("%s\n%s\n%s", cgroup ? cgroup : "", oom->victim, oom->constraint);
+    log_debug("Generating OOM duphash: '%s'", hash_str);
+
+    sha1_ctx_t sha1ctx;
+    char hash_bytes[SHA1_RESULT_LEN];
+    sha1_begin(&sha1ctx);
+    sha1_hash(&sha1ctx, hash_str, strlen(hash_str));
+    sha1_end(&sha1ctx, hash_bytes);
+    bin2hex(result, hash_bytes, SHA1_RESULT_LEN)[0] = '\0';
+
+    free(hash_str);
+    free(cgroup);
+}
+
+/* Lock dumps of machines with many blocked tasks are long */
+#define STALL_MAX_REPORT_LINES 16384
+
+/* Number of the innermost interesting frames of every stack in duphash */
+#define STALL_HASH_FRAMES 3
+
+static const char *const s_koops_stall_strings[] = {
+    " blocked for more than ",
+    "soft lockup - CPU#",
+    "detected stall",
+    "detected expedited stall",
+    NULL
+};
+
+/* Frames of the scheduler, sleeping locks, timer interrupts and stack dumping
+ * are the same in all stalls */
+static const char *const s_stall_skipped_frames[] = {
+    "__schedule",
+    "schedule",
+    "schedule_timeout",
+    "schedule_preempt_disabled",
+    "io_schedule",
+    "io_schedule_timeout",
+    "preempt_schedule_common",
+    "_cond_resched",
+    "__wait_for_common",
+    "wait_for_common",
+    "wait_for_completion",
+    "bit_wait",
+    "bit_wait_io",
+    "__wait_on_bit",
+    "__wait_on_bit_lock",
+    "out_of_line_wait_on_bit",
+    "out_of_line_wait_on_bit_lock",
+    "__mutex_lock",
+    "__mutex_lock_slowpath",
+    "mutex_lock",
+    "mutex_lock_nested",
+    "__down_read",
+    "__down_write",
+    "down_read",
+    "down_write",
+    "rwsem_down_read_slowpath",
+    "rwsem_down_write_slowpath",
+    "rwsem_down_read_failed",
+    "rwsem_down_write_failed",
+    "call_rwsem_down_read_failed",
+    "call_rwsem_down_write_failed",
+    "dump_stack",
+    "dump_stack_lvl",
+    "show_stack",
+    "dump_backtrace",
+    "nmi_cpu_backtrace",
+    "nmi_trigger_cpumask_backtrace",
+    "arch_trigger_cpumask_backtrace",
+    "rcu_dump_cpu_stacks",
+    "print_cpu_stall",
+    "check_cpu_stall",
+    "rcu_pending",
+    "rcu_sched_clock_irq",
+    "rcu_check_callbacks",
+    "update_process_times",
+    "tick_sched_handle",
+    "tick_sched_timer",
+    "__hrtimer_run_queues",
+    "hrtimer_interrupt",
+    "watchdog_timer_fn",
+    "local_apic_timer_interrupt",
+    "smp_apic_timer_interrupt",
+    "apic_timer_interrupt",
+    "__sysvec_apic_timer_interrupt",
+    "sysvec_apic_timer_interrupt",
+    "asm_sysvec_apic_timer_interrupt",
+    "irq_exit",
+    "irq_exit_rcu",
+    "__irq_exit_rcu",
+    NULL
+};
+
+/* Lines of the task and CPU dumps which are not call trace frames */
+static const char *const s_stall_continuation_prefixes[] = {
+    "Call Trace:",
+    "Backtrace:",
+    "Stack:",
+    "Code:",
+    "Modules linked in:",
+    "Hardware name:",
+    "Workqueue:",
+    "task:",
+    "Task dump for CPU",
+    "NMI backtrace for cpu",
+    "Sending NMI from CPU",
+    "Tainted:",
+    "Not tainted",
+    "rcu:",
+    "rcu_",
+    "(detected by",
+    "(t=",
+    "Showing all locks held",
+    "Showing busy workqueues",
+    "workqueue ",
+    "pwq ",
+    "in-flight:",
+    "pending:",
+    "delayed:",
+    "INFO: lockdep is turned off",
+    "irq event stamp:",
+    "hardirqs last",
+    "softirqs last",
+    "EIP is at",
+    "pc :",
+    "lr :",
+    "sp :",
+    "---[ end trace",
+    "====",
+    "<",  /* <IRQ>, </IRQ>, <NMI>, <TASK>, <EOI>, <<EOE>> */
+    "[<", /* [<ffffffff81234567>] function+0x1/0x2 */
+    "?",  /* unreliable frames */
+    "#",  /* lockdep: #0: ffff88003a1d7a68 (&sb->s_type->i_mutex_key) */
+    NULL
+};
+
+GList *koops_stall_strings_list(void)
+{
+    GList *strings = NULL;
+    for (const char *const *str = s_koops_stall_strings; *str; ++str)
+        strings = g_list_prepend(strings, (gpointer)*str);
+
+    return strings;
+}
+
+const char *koops_stall_kind_name(enum abrt_koops_stall_kind kind)
+{
+    switch (kind)
+    {
+        case ABRT_KOOPS_STALL_HUNG_TASK:
+            return "hung_task";
+        case ABRT_KOOPS_STALL_SOFT_LOCKUP:
+            return "soft_lockup";
+        case ABRT_KOOPS_STALL_RCU:
+            return "rcu_stall";
+    }
+
+    return "unknown";
+}
+
+static const char *stall_skip_blanks(const char *line)
+{
+    return line + strspn(line, " \t");
+}
+
+/* Returns kind of the stall started by the line or -1 */
+static int stall_line_kind(const char *line)
+{
+    if (strstr(line, "INFO: task ") && strstr(line, " blocked for more than "))
+        return ABRT_KOOPS_STALL_HUNG_TASK;
+
+    if (strstr(line, "soft lockup - CPU#"))
+        return ABRT_KOOPS_STALL_SOFT_LOCKUP;
+
+    if (strstr(line, "INFO: ")
+     && (strstr(line, "detected stall") || strstr(line, "detected expedited stall")))
+        return ABRT_KOOPS_STALL_RCU;
+
+    return -1;
+}
+
+/* "RAX: 0000000000000000 RBX: ...", "CPU: 3 PID: 456 Comm: ...", "CS:  0010 ..." */
+static bool stall_line_is_register(const char *line)
+{
+    const size_t name_len = strspn(line, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_");
+    if (name_len < 2 || name_len > 8 || line[name_len] != ':')
+        return false;
+
+    const char *value = stall_skip_blanks(line + name_len + 1);
+    return isdigit(value[0]) || strspn(value, "0123456789abcdef") >= 4;
+}
+
+static bool stall_line_continues(const char *line)
+{
+    if (line[0] == '\0')
+        return false;
+
+    for (const char *const *prefix = s_stall_continuation_prefixes; *prefix; ++prefix)
+        if (strncmp(line, *prefix, strlen(*prefix)) == 0)
+            return true;
+
+    /* call trace frame */
+    if (strstr(line, "+0x") && strstr(line, "/0x"))
+        return true;
+
+    if (stall_line_is_register(line))
+        return true;
+
+    /* lockdep: "2 locks held by kworker/0:1/12:" */
+    if (strstr(line, " lock held by ") || strstr(line, " locks held by "))
+        return true;
+
+    /* "hung_task_timeout_secs" disables this message. */
+    if (strstr(line, "hung_task_timeout_secs"))
+        return true;
+
+    /* raw stack dump of older kernels */
+    const size_t len = strlen(line);
+    if (len >= 8 && strspn(line, "0123456789abcdef ") == len)
+        return true;
+
+    /* task state of older kernels: "%-15.15s %c" */
+    if (len > 17 && line[15] == ' ' && strchr("RSDTtXZIPK", line[16]) && line[17] == ' ')
+        return true;
+
+    return false;
+}
+
+static void record_stall(GList **stall_list, const struct abrt_koops_line_info *lines_info, int stallstart, int stallend)
+{
+    log_debug("Found stall at lines %d-%d", stallstart, stallend);
+
+    struct strbuf *report = strbuf_new();
+    for (int q = stallstart; q <= stallend; ++q)
+    {
+        if (lines_info[q].ptr[0] != '\0')
+            strbuf_append_strf(report, "%s\n", lines_info[q].ptr);
+    }
+
+    *stall_list = g_list_append(*stall_list, strbuf_free_nobuf(report));
+}
+
+void koops_extract_stalls_from_lines(GList **stall_list, const struct abrt_koops_line_info *lines_info, int lines_info_size)
+{
+    int stallstart = -1;
+    int kind = -1;
+    for (int i = 0; i <= lines_info_size; ++i)
+    {
+        const char *curline = i < lines_info_size ? lines_info[i].ptr : NULL;
+        if (curline != NULL)
+            curline = stall_skip_blanks(curline);
+
+        const int line_kind = curline != NULL ? stall_line_kind(curline) : -1;
+
+        if (stallstart >= 0)
+        {
+            /* Stacks of several tasks or CPUs are dumped in a row */
+            if (curline != NULL
+             && i - stallstart < STALL_MAX_REPORT_LINES
+             && (line_kind == kind || (line_kind < 0 && stall_line_continues(curline))))
+                continue;
+
+            record_stall(stall_list, lines_info, stallstart, i - 1);
+            stallstart = -1;
+        }
+
+        if (line_kind >= 0)
+        {
+            stallstart = i;
+            kind = line_kind;
+        }
+    }
+}
+
+void koops_drop_stall_oopses(GList **oops_list)
+{
+    GList *iter = *oops_list;
+    while (iter != NULL)
+    {
+        GList *next = g_list_next(iter);
+
+        /* The first line of an extracted oops is the kernel version */
+        const char *first_line = strchr((const char *)iter->data, '\n');
+        if (first_line != NULL && stall_line_kind(stall_skip_blanks(first_line + 1)) >= 0)
+        {
+            log_debug("Dropped oops, it is a stall");
+            free(iter->data);
+            *oops_list = g_list_delete_link(*oops_list, iter);
+        }
+
+        iter = next;
+    }
+}
+
+/* Returns malloced name of the function unless it is not interesting */
+static char *stall_normalize_function(const char *function, size_t len)
+{
+    /* foo.isra.0, foo.constprop.0, foo.part.0, foo.cold */
+    const char *dot = memchr(function, '.', len);
+    if (dot != NULL)
+        len = dot - function;
+
+    if (len == 0)
+        return NULL;
+
+    for (const char *const *skipped = s_stall_skipped_frames; *skipped; ++skipped)
+        if (strlen(*skipped) == len && strncmp(function, *skipped, len) == 0)
+            return NULL;
+
+    return xstrndup(function, len);
+}
+
+/* "func+0x1/0x2 [module]", "[<ffffffff81234567>] func+0x1/0x2" or
+ * "[<c0014318>] (func) from [<c001457c>] (caller+0x24/0x2c)"
+ */
+static char *stall_frame_function(const char *line)
+{
+    if (strncmp(line, "[<", 2) == 0)
+    {
+        line = strstr(line, ">]");
+        if (line == NULL)
+            return NULL;
+        line = stall_skip_blanks(line + 2);
+    }
+
+    /* unreliable frames */
+    if (line[0] == '?')
+        return NULL;
+
+    if (line[0] == '(')
+    {
+        const char *end = strchr(++line, ')');
+        return end != NULL ? stall_normalize_function(line, strcspn(line, "+)")) : NULL;
+    }
+
+    const size_t len = strcspn(line, "+ \t");
+    if (line[len] != '+' || strncmp(line + len, "+0x", 3) != 0 || strstr(line + len, "/0x") == NULL)
+        return NULL;
+
+    return stall_normalize_function(line, len);
+}
+
+/* The function being executed: "RIP: 0010:func+0x1/0x2", "EIP is at func+0x1/0x2", "pc : func+0x1/0x2" */
+static char *stall_rip_function(const char *line)
+{
+    const char *function;
+    if (strncmp(line, "RIP: ", strlen("RIP: ")) == 0)
+    {
+        /* "RIP: 0010:[<ffffffff8132a1b5>]  [<ffffffff8132a1b5>] func+0x25/0x30" */
+        const char *addr = strstr(line, ">]");
+        if (addr != NULL)
+        {
+            for (const char *next; (next = strstr(addr + 2, ">]")) != NULL; )
+                addr = next;
+            function = addr + 2;
+        }
+        else
+        {
+            /* "RIP: 0010:func+0x12/0x30 [module]" */
+            function = strchr(line + strlen("RIP: "), ':');
+            if (function == NULL)
+                return NULL;
+            ++function;
+        }
+    }
+    else if (strncmp(line, "EIP is at ", strlen("EIP is at ")) == 0)
+        function = line + strlen("EIP is at ");
+    else if (strncmp(line, "pc : ", strlen("pc : ")) == 0)
+        function = line + strlen("pc : ");
+    else
+        return NULL;
+
+    return stall_frame_function(stall_skip_blanks(function));
+}
+
+static GList *stall_add_unique(GList *list, char *str)
+{
+    if (g_list_find_custom(list, str, (GCompareFunc)strcmp) != NULL)
+    {
+        free(str);
+        return list;
+    }
+
+    return g_list_append(list, str);
+}
+
+static gint stall_cpu_cmp(gconstpointer a, gconstpointer b)
+{
+    const unsigned l = GPOINTER_TO_UINT(a);
+    const unsigned r = GPOINTER_TO_UINT(b);
+    return l < r ? -1 : l > r;
+}
+
+static GList *stall_add_cpu(GList *cpus, unsigned cpu)
+{
+    if (g_list_find(cpus, GUINT_TO_POINTER(cpu)) != NULL)
+        return cpus;
+
+    return g_list_insert_sorted(cpus, GUINT_TO_POINTER(cpu), stall_cpu_cmp);
+}
+
+/* Returns malloced items separated by sep or NULL if the list is empty */
+static char *stall_join(GList *list, const char *sep)
+{
+    if (list == NULL)
+        return NULL;
+
+    struct strbuf *result = strbuf_new();
+    for (GList *iter = list; iter != NULL; iter = g_list_next(iter))
+        strbuf_append_strf(result, "%s%s", iter == list ? "" : sep, (const char *)iter->data);
+
+    return strbuf_free_nobuf(result);
+}
+
+struct stall_stack
+{
+    struct strbuf *frames;
+    unsigned frames_cnt;
+    bool rip_only; /* the stack has only the executed function so far */
+};
+
+static void stall_stack_finish(struct stall_stack *stack, GList **stacks, struct abrt_koops_stall *stall)
+{
+    if (stack->frames == NULL)
+        return;
+
+    if (stack->frames_cnt == 0)
+        strbuf_free(stack->frames);
+    else
+    {
+        char *frames = strbuf_free_nobuf(stack->frames);
+        if (stall->crash_function == NULL)
+            stall->crash_function = xstrndup(frames, strcspn(frames, " "));
+        *stacks = stall_add_unique(*stacks, frames);
+    }
+
+    memset(stack, 0, sizeof(*stack));
+}
+
+static void stall_stack_start(struct stall_stack *stack, GList **stacks, struct abrt_koops_stall *stall)
+{
+    stall_stack_finish(stack, stacks, stall);
+    stack->frames = strbuf_new();
+}
+
+static void stall_stack_add(struct stall_stack *stack, char *function)
+{
+    if (function == NULL)
+        return;
+
+    if (stack->frames != NULL && stack->frames_cnt < STALL_HASH_FRAMES)
+    {
+        strbuf_append_strf(stack->frames, "%s%s", stack->frames_cnt ? " " : "", function);
+        ++stack->frames_cnt;
+    }
+
+    free(function);
+}
+
+int koops_stall_parse(const char *report, struct abrt_koops_stall *stall)
+{
+    memset(stall, 0, sizeof(*stall));
+
+    char *first_line = xstrndup(report, strchrnul(report, '\n') - report);
+    const int kind = stall_line_kind(stall_skip_blanks(first_line));
+    free(first_line);
+
+    if (kind < 0)
+        return -1;
+
+    stall->kind = kind;
+
+    GList *cpus = NULL;
+    GList *tasks = NULL;
+    GList *stacks = NULL;
+    struct stall_stack stack = { 0 };
+    bool in_nmi = false;
+
+    for (const char *line = report; *line != '\0'; )
+    {
+        const char *end = strchrnul(line, '\n');
+        char *cur = xstrndup(line, end - line);
+        line = *end ? end + 1 : end;
+
+        const char *p = stall_skip_blanks(cur);
+        unsigned long value;
+        unsigned cpu;
+
+        if (stall->kernel == NULL)
+            stall->kernel = koops_extract_version(p);
+
+        if (stall_line_kind(p) == ABRT_KOOPS_STALL_HUNG_TASK)
+        {
+            /* INFO: task kworker/u8:2:123 blocked for more than 120 seconds. */
+            const char *task = strstr(p, "INFO: task ") + strlen("INFO: task ");
+            const char *blocked = strstr(task, " blocked for more than ");
+            tasks = stall_add_unique(tasks, xstrndup(task, blocked - task));
+            if (sscanf(blocked, " blocked for more than %lu", &value) == 1 && value > stall->duration)
+                stall->duration = value;
+        }
+        else if (stall_line_kind(p) == ABRT_KOOPS_STALL_SOFT_LOCKUP)
+        {
+            /* watchdog: BUG: soft lockup - CPU#3 stuck for 23s! [kworker/3:1:456] */
+            const int n = sscanf(strstr(p, "CPU#"), "CPU#%u stuck for %lu", &cpu, &value);
+            if (n >= 1)
+                cpus = stall_add_cpu(cpus, cpu);
+            if (n == 2 && value > stall->duration)
+                stall->duration = value;
+
+            const char *task = strrchr(p, '[');
+            const char *task_end = task != NULL ? strchr(task, ']') : NULL;
+            if (task_end != NULL)
+                tasks = stall_add_unique(tasks, xstrndup(task + 1, task_end - task - 1));
+        }
+        else if (kind == ABRT_KOOPS_STALL_RCU)
+        {
+            /* (t=5250 jiffies g=1234 q=56) or (detected by 1, t=60002 jiffies, g=1234, q=56) */
+            const char *t = strstr(p, "(t=");
+            if (t == NULL)
+                t = strstr(p, " t=");
+            if (t != NULL && sscanf(t + strlen(" t="), "%lu jiffies", &value) == 1 && value > stall->duration)
+                stall->duration = value;
+        }
+
+        if (sscanf(p, "NMI backtrace for cpu %u", &cpu) == 1)
+            cpus = stall_add_cpu(cpus, cpu);
+
+        /* rcu:     2-...!: (0 ticks this GP) idle=... */
+        if (kind == ABRT_KOOPS_STALL_RCU && (strstr(p, "ticks this GP") || strstr(p, "GPs behind")))
+        {
+            const char *c = p;
+            if (strncmp(c, "rcu:", strlen("rcu:")) == 0)
+                c = stall_skip_blanks(c + strlen("rcu:"));
+
+            char *c_end;
+            cpu = strtoul(c, &c_end, 10);
+            if (c_end != c && (*c_end == '-' || *c_end == ':'))
+                cpus = stall_add_cpu(cpus, cpu);
+        }
+
+        /* task:kworker/u8:2    state:D stack:    0 pid:  123 ppid:     2 flags:0x00004000 */
+        if (strncmp(p, "task:", strlen("task:")) == 0)
+        {
+            const char *name = p + strlen("task:");
+            const char *pid = strstr(name, " pid:");
+            if (pid != NULL)
+            {
+                pid = stall_skip_blanks(pid + strlen(" pid:"));
+                tasks = stall_add_unique(tasks, xasprintf("%.*s:%lu",
+                            (int)strcspn(name, " \t"), name, strtoul(pid, NULL, 10)));
+            }
+        }
+
+        /* Tasks running on stalled CPUs */
+        char comm[64];
+        if (kind == ABRT_KOOPS_STALL_RCU && sscanf(p, "CPU: %u PID: %lu Comm: %63s", &cpu, &value, comm) == 3)
+            tasks = stall_add_unique(tasks, xasprintf("%s:%lu", comm, value));
+
+        /* The NMI handler is not interesting */
+        if (strcmp(p, "<NMI>") == 0)
+            in_nmi = true;
+        else if (strcmp(p, "</NMI>") == 0 || strcmp(p, "<<EOE>>") == 0 || strcmp(p, "<EOE>") == 0)
+            in_nmi = false;
+        else if (in_nmi)
+            ;
+        else if (strncmp(p, "Call Trace:", strlen("Call Trace:")) == 0
+              || strncmp(p, "Backtrace:", strlen("Backtrace:")) == 0)
+        {
+            if (!stack.rip_only)
+                stall_stack_start(&stack, &stacks, stall);
+            stack.rip_only = false;
+        }
+        else
+        {
+            char *function = stall_rip_function(p);
+            if (function != NULL || strncmp(p, "RIP: ", strlen("RIP: ")) == 0)
+            {
+                stall_stack_start(&stack, &stacks, stall);
+                stack.rip_only = true;
+            }
+            else
+                function = stall_frame_function(p);
+
+            stall_stack_add(&stack, function);
+        }
+
+        free(cur);
+    }
+    stall_stack_finish(&stack, &stacks, stall);
+
+    struct strbuf *cpus_str = strbuf_new();
+    for (GList *iter = cpus; iter != NULL; iter = g_list_next(iter))
+        strbuf_append_strf(cpus_str, "%s%u", iter == cpus ? "" : ",", GPOINTER_TO_UINT(iter->data));
+    stall->cpus = cpus_str->len ? strbuf_free_nobuf(cpus_str) : (strbuf_free(cpus_str), NULL);
+    g_list_free(cpus);
+
+    stall->tasks = stall_join(tasks, "\n");
+    g_list_free_full(tasks, free);
+
+    /* The order in which the stacks are dumped is not important */
+    stacks = g_list_sort(stacks, (GCompareFunc)strcmp);
+    stall->stacks = stall_join(stacks, "\n");
+    g_list_free_full(stacks, free);
+
+    return 0;
+}
+
+void koops_stall_free(struct abrt_koops_stall *stall)
+{
+    free(stall->cpus);
+    free(stall->tasks);
+    free(stall->stacks);
+    free(stall->crash_function);
+    free(stall->kernel);
+    memset(stall, 0, sizeof(*stall));
+}
+
+void koops_stall_hash_str(char result[SHA1_RESULT_LEN*2 + 1], const struct abrt_koops_stall *stall)
+{
+    struct strbuf *hash_str = strbuf_new();
+    strbuf_append_strf(hash_str, "%s\n", koops_stall_kind_name(stall->kind));
+
+    if (stall->stacks != NULL)
+        strbuf_append_strf(hash_str, "%s", stall->stacks);
+    else if (stall->tasks != NULL)
+    {
+        /* Without stacks, the stalls are told apart by the names of the tasks */
+        for (const char *task = stall->tasks; *task != '\0'; )
+        {
+            const char *end = strchrnul(task, '\n');
+            const char *pid = memrchr(task, ':', end - task);
+            strbuf_append_strf(hash_str, "%.*s\n", (int)((pid ? pid : end) - task), task);
+            task = *end ? end + 1 : end;
+        }
+    }
+
+    log_debug("Generating stall duphash: '%s'", hash_str->buf);
+
+    sha1_ctx_t sha1ctx;
+    char hash_bytes[SHA1_RESULT_LEN];
+    sha1_begin(&sha1ctx);
+    sha1_hash(&sha1ctx, hash_str->buf, hash_str->len);
+    sha1_end(&sha1ctx, hash_bytes);
+    bin2hex(result, hash_bytes, SHA1_RESULT_LEN)[0] = '\0';
+
+    strbuf_free(hash_str);
+}
+
 int koops_hash_str_ext(char result[SHA1_RESULT_LEN*2 + 1], const char *oops_buf, int frame_count, int duphash_flags)
 {
     char *hash_str = NULL, *error = NULL;
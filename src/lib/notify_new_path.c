@@ -24,7 +24,7 @@ void notify_new_path(const char *path)
     notify_new_path_with_response(path, NULL);
 }
 
-int notify_new_path_with_response(const char *path, char **message)
+static int send_request_to_abrtd(const char *url, const char *path, char **message)
 {
     int retval;
     int fd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -48,7 +48,9 @@ int notify_new_path_with_response(const char *path, char **message)
         return retval;
     }
 
-    full_write_str(fd, "POST /creation_notification HTTP/1.1\r\n\r\n");
+    full_write_str(fd, "POST ");
+    full_write_str(fd, url);
+    full_write_str(fd, " HTTP/1.1\r\n\r\n");
     full_write_str(fd, path);
 
     /*
@@ -106,3 +108,25 @@ int notify_new_path_with_response(const char *path, char **message)
     /* If code is greater than INT_MAX, -EBADMSG is returned. */
     return (int)code;
 }
+
+int notify_new_path_with_response(const char *path, char **message)
+{
+    /* Lets abrtd resume the problem even if it is not running now */
+    pipeline_journal_append(path, ABRT_PIPELINE_CREATED, 0);
+
+    return send_request_to_abrtd("/creation_notification", path, message);
+}
+
+int promote_deferred_analysis(const char *path)
+{
+    char *message = NULL;
+    const int r = send_request_to_abrtd("/deferred_analysis", path, &message);
+    free(message);
+    return r;
+}
+
+int notify_problem_deleted(const char *path)
+{
+    /* Ignore results and don't wait for response -> NULL */
+    return send_request_to_abrtd("/problem_deleted", path, NULL);
+}
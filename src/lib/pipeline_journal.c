@@ -0,0 +1,324 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+#include "libabrt.h"
+
+/*
+ * The journal is an append-only file, one line per stage a problem reached:
+ *
+ *   STAGE STEP DIRNAME
+ *
+ * STEP is the number of finished post-create rules for the 'step' stage and
+ * 0 otherwise. Writers take an exclusive lock on the file, so abrtd can
+ * replace it by a compacted copy; a writer which got the lock of the
+ * replaced file opens the new one and tries again.
+ */
+#define PIPELINE_JOURNAL_FILE VAR_STATE"/pipeline"
+
+static const char *s_journal_file = PIPELINE_JOURNAL_FILE;
+
+static const char *const pipeline_stage_names[ABRT_PIPELINE_STAGE_COUNT] = {
+    [ABRT_PIPELINE_CREATED]     = "created",
+    [ABRT_PIPELINE_QUEUED]      = "queued",
+    [ABRT_PIPELINE_POST_CREATE] = "post-create",
+    [ABRT_PIPELINE_STEP]        = "step",
+    [ABRT_PIPELINE_DONE]        = "done",
+    [ABRT_PIPELINE_ANALYSIS]    = "analysis",
+    [ABRT_PIPELINE_ANALYZED]    = "analyzed",
+    [ABRT_PIPELINE_REMOVED]     = "removed",
+};
+
+const char *pipeline_stage_name(enum abrt_pipeline_stage stage)
+{
+    return stage < ABRT_PIPELINE_STAGE_COUNT ? pipeline_stage_names[stage] : NULL;
+}
+
+static int pipeline_stage_from_name(const char *name)
+{
+    for (int stage = 0; stage < ABRT_PIPELINE_STAGE_COUNT; ++stage)
+        if (strcmp(pipeline_stage_names[stage], name) == 0)
+            return stage;
+
+    return -1;
+}
+
+void pipeline_journal_set_file(const char *path)
+{
+    s_journal_file = path ? path : PIPELINE_JOURNAL_FILE;
+}
+
+void pipeline_entry_free(struct abrt_pipeline_entry *entry)
+{
+    if (entry == NULL)
+        return;
+
+    free(entry->dirname);
+    free(entry);
+}
+
+/* Returns locked fd of the current journal file or -1 */
+static int pipeline_journal_open_locked(int flags)
+{
+    for (int retries = 0; retries < 10; ++retries)
+    {
+        const int fd = open(s_journal_file, flags | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (fd < 0)
+            return -1;
+
+        if (flock(fd, LOCK_EX) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        /* The file might have been replaced while we were waiting */
+        struct stat fd_stat;
+        struct stat path_stat;
+        if (fstat(fd, &fd_stat) == 0 && stat(s_journal_file, &path_stat) == 0
+            && fd_stat.st_dev == path_stat.st_dev && fd_stat.st_ino == path_stat.st_ino)
+            return fd;
+
+        close(fd);
+    }
+
+    errno = EAGAIN;
+    return -1;
+}
+
+int pipeline_journal_append(const char *dirname, enum abrt_pipeline_stage stage, unsigned step)
+{
+    if (stage >= ABRT_PIPELINE_STAGE_COUNT || dirname[0] != '/' || strchr(dirname, '\n') != NULL)
+        return -EINVAL;
+
+    const int fd = pipeline_journal_open_locked(O_WRONLY | O_APPEND);
+    if (fd < 0)
+    {
+        const int r = -errno;
+        /* Only root processes are allowed to write the journal */
+        if (errno == EACCES || errno == ENOENT)
+            log_debug("Can't open '%s': %s", s_journal_file, strerror(errno));
+        else
+            perror_msg("Can't open '%s'", s_journal_file);
+        return r;
+    }
+
+    char *line = xasprintf("%s %u %s\n", pipeline_stage_names[stage], step, dirname);
+    int r = 0;
+    if (full_write_str(fd, line) < 0)
+    {
+        r = -errno;
+        perror_msg("Can't write to '%s'", s_journal_file);
+    }
+
+    free(line);
+    close(fd);
+    return r;
+}
+
+static void pipeline_journal_replay_line(GHashTable *entries, GList **order, char *line)
+{
+    char *step_str = strchr(line, ' ');
+    if (step_str == NULL)
+        goto bad_line;
+    *step_str++ = '\0';
+
+    char *dirname = strchr(step_str, ' ');
+    if (dirname == NULL)
+        goto bad_line;
+    *dirname++ = '\0';
+
+    const int stage = pipeline_stage_from_name(line);
+    char *end = NULL;
+    const unsigned long step = strtoul(step_str, &end, 10);
+    if (stage < 0 || end == step_str || *end != '\0' || dirname[0] != '/')
+        goto bad_line;
+
+    struct abrt_pipeline_entry *entry = g_hash_table_lookup(entries, dirname);
+    if (stage == ABRT_PIPELINE_REMOVED)
+    {
+        if (entry != NULL)
+        {
+            *order = g_list_remove(*order, entry);
+            g_hash_table_remove(entries, dirname);
+            pipeline_entry_free(entry);
+        }
+        return;
+    }
+
+    if (entry == NULL)
+    {
+        entry = xzalloc(sizeof(*entry));
+        entry->dirname = xstrdup(dirname);
+        entry->stage = ABRT_PIPELINE_CREATED;
+        g_hash_table_insert(entries, entry->dirname, entry);
+        *order = g_list_prepend(*order, entry);
+    }
+
+    switch (stage)
+    {
+        case ABRT_PIPELINE_ANALYSIS:
+            entry->analysis_pending = true;
+            break;
+        case ABRT_PIPELINE_ANALYZED:
+            entry->analysis_pending = false;
+            break;
+        case ABRT_PIPELINE_STEP:
+            entry->step = step;
+            entry->stage = stage;
+            break;
+        case ABRT_PIPELINE_CREATED:
+        case ABRT_PIPELINE_QUEUED:
+            /* Post-create starts from the beginning again */
+            entry->step = 0;
+            /* fall through */
+        default:
+            entry->stage = stage;
+            break;
+    }
+
+    return;
+
+ bad_line:
+    log_notice("Ignoring malformed line in '%s'", s_journal_file);
+}
+
+static bool pipeline_entry_finished(const struct abrt_pipeline_entry *entry)
+{
+    if (entry->stage == ABRT_PIPELINE_DONE && !entry->analysis_pending)
+        return true;
+
+    /* Deleted by user or by a tool not aware of the journal */
+    struct stat stat_buf;
+    return lstat(entry->dirname, &stat_buf) != 0 && errno == ENOENT;
+}
+
+/* Returns the list of unfinished entries in the order of their first record */
+static GList *pipeline_journal_replay(char *contents)
+{
+    GHashTable *entries = g_hash_table_new(g_str_hash, g_str_equal);
+    GList *order = NULL;
+
+    char *line = contents;
+    while (line[0] != '\0')
+    {
+        char *end = strchrnul(line, '\n');
+        const bool last = (*end == '\0');
+        *end = '\0';
+
+        if (line[0] != '\0')
+            pipeline_journal_replay_line(entries, &order, line);
+
+        if (last)
+            break;
+        line = end + 1;
+    }
+    g_hash_table_destroy(entries);
+
+    GList *unfinished = NULL;
+    for (GList *iter = order; iter != NULL; iter = g_list_next(iter))
+    {
+        struct abrt_pipeline_entry *entry = iter->data;
+        if (pipeline_entry_finished(entry))
+            pipeline_entry_free(entry);
+        else
+            unfinished = g_list_prepend(unfinished, entry);
+    }
+    g_list_free(order);
+
+    return unfinished;
+}
+
+static void pipeline_journal_append_entry(GString *contents, const struct abrt_pipeline_entry *entry)
+{
+    g_string_append_printf(contents, "%s %u %s\n",
+            pipeline_stage_names[entry->stage], entry->step, entry->dirname);
+
+    if (entry->analysis_pending)
+        g_string_append_printf(contents, "%s 0 %s\n",
+                pipeline_stage_names[ABRT_PIPELINE_ANALYSIS], entry->dirname);
+}
+
+int pipeline_journal_compact(off_t min_size, GList **unfinished)
+{
+    struct stat stat_buf;
+    const bool exists = stat(s_journal_file, &stat_buf) == 0;
+    if (exists && stat_buf.st_size <= min_size)
+        return 0;
+
+    const int fd = pipeline_journal_open_locked(O_RDONLY);
+    if (fd < 0)
+    {
+        const int r = -errno;
+        perror_msg("Can't open '%s'", s_journal_file);
+        return r;
+    }
+
+    int r = 0;
+    char *contents = xmalloc_read(fd, NULL);
+    if (contents == NULL)
+    {
+        r = -errno;
+        perror_msg("Can't read '%s'", s_journal_file);
+        goto unlock;
+    }
+
+    GList *entries = pipeline_journal_replay(contents);
+    free(contents);
+
+    GString *compacted = g_string_new(NULL);
+    for (GList *iter = entries; iter != NULL; iter = g_list_next(iter))
+        pipeline_journal_append_entry(compacted, iter->data);
+
+    char *tmp_path = xasprintf("%s.%lu", s_journal_file, (long)getpid());
+    const int tmp_fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (tmp_fd < 0)
+    {
+        r = -errno;
+        perror_msg("Can't create '%s'", tmp_path);
+    }
+    else
+    {
+        const bool written = full_write(tmp_fd, compacted->str, compacted->len) >= 0
+                             && fsync(tmp_fd) == 0;
+        close(tmp_fd);
+
+        if (!written || rename(tmp_path, s_journal_file) != 0)
+        {
+            r = -errno;
+            perror_msg("Can't compact '%s'", s_journal_file);
+            unlink(tmp_path);
+        }
+        else
+            log_debug("Compacted '%s' to %u problems", s_journal_file, g_list_length(entries));
+    }
+
+    free(tmp_path);
+    g_string_free(compacted, TRUE);
+
+    if (unfinished != NULL && r == 0)
+        *unfinished = entries;
+    else
+        g_list_free_full(entries, (GDestroyNotify)pipeline_entry_free);
+
+    if (r == 0 && !exists)
+        r = -ENOENT;
+
+ unlock:
+    close(fd);
+    return r;
+}
@@ -147,6 +147,8 @@ GList *get_problem_storages(void)
     GList *paths = NULL;
     load_abrt_conf();
     paths = g_list_append(paths, xstrdup(g_settings_dump_location));
+    if (g_settings_cold_dump_location != NULL)
+        paths = g_list_append(paths, xstrdup(g_settings_cold_dump_location));
     free_abrt_conf_data();
 
     return paths;
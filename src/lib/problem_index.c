@@ -0,0 +1,945 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <grp.h>
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/thread.h>
+#include <satyr/core/frame.h>
+#include "libabrt.h"
+
+/*
+ * The index maps terms to sorted arrays of document ids (postings). A term is
+ * a lower-cased token prefixed by the name of the field it was found in:
+ *
+ *   executable:firefox
+ *   backtrace:g_main_context_dispatch
+ *
+ * A document is a problem directory. Documents get a new id whenever they are
+ * (re)indexed, so appending to the postings keeps them sorted. Ids of removed
+ * documents are never reused.
+ *
+ * The index file is a forward index, one line per problem:
+ *
+ *   DIRNAME STAMP SIGNATURE OWNER GROUP MODE TERM TERM ...
+ *
+ * where the fields are separated by tabulators and the terms by spaces.
+ * STAMP is the newest modification time of the indexed elements in
+ * nanoseconds and SIGNATURE is computed from inode numbers and sizes of them,
+ * so it changes also when an element is added or removed or is rewritten
+ * within the timestamp granularity. Problems with the same stamp, signature
+ * and directory owner, group and mode are not re-read.
+ *
+ * The directory times cannot be used because dump_dir locking creates and
+ * removes the lock file in the directory on each dd_opendir(). For the same
+ * reason the index reads the elements directly instead of via dump_dir.
+ */
+#define PROBLEM_INDEX_FILE VAR_STATE"/problems-index"
+#define PROBLEM_INDEX_MAGIC "ABRT-PROBLEM-INDEX 1"
+
+#define INDEX_TOKEN_MIN_LEN 2
+#define INDEX_TOKEN_MAX_LEN 64
+/* Large elements (mainly backtraces of other than C/C++ problems) are indexed
+ * only partially, the interesting part is at the beginning anyway */
+#define INDEX_TEXT_MAX_SIZE (64 * 1024)
+/* core_backtrace must be parsed as whole */
+#define INDEX_CORE_BACKTRACE_MAX_SIZE (4 * 1024 * 1024)
+
+struct index_field
+{
+    const char *name;
+    const char *element;
+};
+
+static const struct index_field index_fields[] = {
+    { "reason",     FILENAME_REASON     },
+    { "executable", FILENAME_EXECUTABLE },
+    { "component",  FILENAME_COMPONENT  },
+    { "package",    FILENAME_PACKAGE    },
+    { "cmdline",    FILENAME_CMDLINE    },
+    /* Crash thread frames of core_backtrace or the text of backtrace */
+    { "backtrace",  FILENAME_BACKTRACE  },
+    { "cluster",    FILENAME_CLUSTER_HASH },
+};
+
+struct index_doc
+{
+    char *dirname;
+    unsigned id;
+    unsigned generation;
+
+    /* See problem_index_update() */
+    long long stamp;
+    unsigned long long signature;
+
+    /* Access rights, see dd_accessible_by_uid() */
+    uid_t owner;
+    gid_t group;
+    mode_t mode;
+
+    /* Keys of index->terms */
+    GPtrArray *terms;
+};
+
+struct abrt_problem_index
+{
+    GHashTable *docs;       /* dirname -> struct index_doc */
+    GPtrArray *by_id;       /* id -> struct index_doc or NULL */
+    GHashTable *terms;      /* term -> GArray of unsigned ids */
+    unsigned generation;
+    bool dirty;
+};
+
+static void index_doc_free(struct index_doc *doc)
+{
+    if (doc == NULL)
+        return;
+
+    g_ptr_array_free(doc->terms, TRUE);
+    free(doc->dirname);
+    free(doc);
+}
+
+static void postings_free(GArray *postings)
+{
+    g_array_free(postings, TRUE);
+}
+
+struct abrt_problem_index *problem_index_new(void)
+{
+    struct abrt_problem_index *index = xzalloc(sizeof(*index));
+    index->docs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                        NULL, (GDestroyNotify)index_doc_free);
+    index->by_id = g_ptr_array_new();
+    index->terms = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         free, (GDestroyNotify)postings_free);
+    return index;
+}
+
+void problem_index_free(struct abrt_problem_index *index)
+{
+    if (index == NULL)
+        return;
+
+    g_hash_table_destroy(index->docs);
+    g_ptr_array_free(index->by_id, TRUE);
+    g_hash_table_destroy(index->terms);
+    free(index);
+}
+
+unsigned problem_index_size(struct abrt_problem_index *index)
+{
+    return g_hash_table_size(index->docs);
+}
+
+static bool is_token_char(unsigned char c)
+{
+    /* Bytes of multi-byte UTF-8 characters are parts of words */
+    return isalnum(c) || c >= 0x80 || c == '_' || c == '.' || c == '-' || c == '+';
+}
+
+static bool is_token_separator(char c)
+{
+    return c == '.' || c == '-' || c == '+';
+}
+
+static unsigned emit_token(const char *start, const char *stop,
+                           void (*callback)(const char *token, void *args),
+                           void *args)
+{
+    const size_t len = stop - start;
+    if (len < INDEX_TOKEN_MIN_LEN || len > INDEX_TOKEN_MAX_LEN)
+        return 0;
+
+    char token[INDEX_TOKEN_MAX_LEN + 1];
+    for (size_t i = 0; i < len; ++i)
+        token[i] = tolower((unsigned char)start[i]);
+    token[len] = '\0';
+
+    callback(token, args);
+    return 1;
+}
+
+/* Calls the callback for each lower-cased token of the text. Tokens like
+ * 'libxul.so' or 'nvidia-drm' are passed also by parts, so 'libxul' and
+ * 'nvidia' match them. The token buffer is overwritten by the next call.
+ * Returns the number of tokens. */
+static unsigned for_each_token(const char *text, size_t size,
+                               void (*callback)(const char *token, void *args),
+                               void *args)
+{
+    unsigned count = 0;
+    const char *end = text + size;
+
+    while (text < end)
+    {
+        while (text < end && !is_token_char(*text))
+            ++text;
+
+        const char *start = text;
+        while (text < end && is_token_char(*text))
+            ++text;
+
+        /* Dots and dashes around words are punctuation */
+        const char *word_end = text;
+        while (start < word_end && (*start == '.' || *start == '-'))
+            ++start;
+        while (word_end > start && (word_end[-1] == '.' || word_end[-1] == '-'))
+            --word_end;
+
+        count += emit_token(start, word_end, callback, args);
+
+        const char *separator = start;
+        while (separator < word_end && !is_token_separator(*separator))
+            ++separator;
+
+        if (separator == word_end)
+            continue;
+
+        for (const char *part = start; part < word_end; )
+        {
+            const char *stop = part;
+            while (stop < word_end && !is_token_separator(*stop))
+                ++stop;
+
+            count += emit_token(part, stop, callback, args);
+            part = stop + 1;
+        }
+    }
+
+    return count;
+}
+
+struct add_term_args
+{
+    const char *field;
+    GHashTable *terms;
+};
+
+static void add_term(const char *token, void *args)
+{
+    struct add_term_args *a = args;
+    char *term = xasprintf("%s:%s", a->field, token);
+    if (g_hash_table_contains(a->terms, term))
+        free(term);
+    else
+        g_hash_table_add(a->terms, term);
+}
+
+/* Reads at most max_size bytes of the element, returns NULL if the element
+ * does not exist or is not a regular file */
+static char *load_text_prefix(int dir_fd, const char *name,
+                              size_t max_size, size_t *size)
+{
+    int fd = openat(dir_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if (sb.st_size < max_size)
+        max_size = sb.st_size;
+
+    char *text = xmalloc(max_size + 1);
+    const ssize_t r = full_read(fd, text, max_size);
+    close(fd);
+
+    if (r < 0)
+    {
+        free(text);
+        return NULL;
+    }
+
+    text[r] = '\0';
+    *size = r;
+    return text;
+}
+
+static void add_core_backtrace_terms(struct add_term_args *args, const char *json)
+{
+    char *error_message = NULL;
+    struct sr_core_stacktrace *stacktrace = sr_core_stacktrace_from_json_text(json, &error_message);
+    if (stacktrace == NULL)
+    {
+        log_debug("Can't parse core backtrace: %s", error_message);
+        free(error_message);
+        return;
+    }
+
+    struct sr_core_thread *thread = sr_core_stacktrace_find_crash_thread(stacktrace);
+    for (struct sr_core_frame *frame = thread ? thread->frames : NULL; frame != NULL; frame = frame->next)
+    {
+        if (frame->function_name != NULL)
+            for_each_token(frame->function_name, strlen(frame->function_name), add_term, args);
+
+        /* The module, e.g. /usr/lib64/libxul.so */
+        if (frame->file_name != NULL)
+            for_each_token(frame->file_name, strlen(frame->file_name), add_term, args);
+    }
+
+    sr_core_stacktrace_free(stacktrace);
+}
+
+static void add_field_terms(int dir_fd, const struct index_field *field,
+                            GHashTable *terms)
+{
+    struct add_term_args args = {
+        .field = field->name,
+        .terms = terms,
+    };
+
+    size_t size = 0;
+    if (strcmp(field->element, FILENAME_BACKTRACE) == 0)
+    {
+        /* Only the crash thread is interesting and core_backtrace is way
+         * smaller than a backtrace generated by gdb */
+        char *json = load_text_prefix(dir_fd, FILENAME_CORE_BACKTRACE,
+                                      INDEX_CORE_BACKTRACE_MAX_SIZE + 1, &size);
+        if (json != NULL && size <= INDEX_CORE_BACKTRACE_MAX_SIZE)
+        {
+            add_core_backtrace_terms(&args, json);
+            free(json);
+            return;
+        }
+        free(json);
+    }
+
+    char *text = load_text_prefix(dir_fd, field->element, INDEX_TEXT_MAX_SIZE, &size);
+    if (text == NULL)
+        return;
+
+    for_each_token(text, size, add_term, &args);
+    free(text);
+}
+
+/* Takes over the terms */
+static struct index_doc *index_add_doc(struct abrt_problem_index *index,
+                                       const char *dirname,
+                                       GPtrArray *terms)
+{
+    struct index_doc *doc = xzalloc(sizeof(*doc));
+    doc->dirname = xstrdup(dirname);
+    doc->id = index->by_id->len;
+    doc->generation = index->generation;
+    doc->terms = g_ptr_array_sized_new(terms->len);
+
+    for (unsigned i = 0; i < terms->len; ++i)
+    {
+        char *term = g_ptr_array_index(terms, i);
+        char *key = NULL;
+        GArray *postings = NULL;
+
+        if (g_hash_table_lookup_extended(index->terms, term, (gpointer *)&key, (gpointer *)&postings))
+            free(term);
+        else
+        {
+            key = term;
+            postings = g_array_new(FALSE, FALSE, sizeof(unsigned));
+            g_hash_table_insert(index->terms, key, postings);
+        }
+
+        g_array_append_val(postings, doc->id);
+        g_ptr_array_add(doc->terms, key);
+    }
+
+    g_ptr_array_free(terms, TRUE);
+
+    g_ptr_array_add(index->by_id, doc);
+    g_hash_table_insert(index->docs, doc->dirname, doc);
+    index->dirty = true;
+    return doc;
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+    const unsigned ia = *(const unsigned *)a;
+    const unsigned ib = *(const unsigned *)b;
+    return ia < ib ? -1 : ia > ib;
+}
+
+static void index_remove_doc(struct abrt_problem_index *index, struct index_doc *doc)
+{
+    for (unsigned i = 0; i < doc->terms->len; ++i)
+    {
+        const char *key = g_ptr_array_index(doc->terms, i);
+        GArray *postings = g_hash_table_lookup(index->terms, key);
+
+        unsigned *found = bsearch(&doc->id, postings->data, postings->len,
+                                  sizeof(unsigned), compare_ids);
+        if (found != NULL)
+            g_array_remove_index(postings, found - (unsigned *)postings->data);
+
+        /* Frees the key */
+        if (postings->len == 0)
+            g_hash_table_remove(index->terms, key);
+    }
+
+    g_ptr_array_index(index->by_id, doc->id) = NULL;
+    g_hash_table_remove(index->docs, doc->dirname);
+    index->dirty = true;
+}
+
+void problem_index_remove(struct abrt_problem_index *index, const char *dirname)
+{
+    struct index_doc *doc = g_hash_table_lookup(index->docs, dirname);
+    if (doc != NULL)
+        index_remove_doc(index, doc);
+}
+
+/* Computes the newest modification time of the indexed elements and returns
+ * their signature */
+static unsigned long long stat_elements(int dir_fd, long long *stamp)
+{
+    static const char *const elements[] = {
+        FILENAME_REASON,
+        FILENAME_EXECUTABLE,
+        FILENAME_COMPONENT,
+        FILENAME_PACKAGE,
+        FILENAME_CMDLINE,
+        FILENAME_BACKTRACE,
+        FILENAME_CORE_BACKTRACE,
+        FILENAME_CLUSTER_HASH,
+    };
+
+    unsigned long long signature = 0;
+    *stamp = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(elements); ++i)
+    {
+        struct stat sb;
+        if (fstatat(dir_fd, elements[i], &sb, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        const long long mtime = sb.st_mtim.tv_sec * 1000000000LL + sb.st_mtim.tv_nsec;
+        if (mtime > *stamp)
+            *stamp = mtime;
+
+        signature = signature * 31 + (i + 1);
+        signature = signature * 31 + sb.st_ino;
+        signature = signature * 31 + sb.st_size;
+    }
+
+    return signature;
+}
+
+int problem_index_update(struct abrt_problem_index *index, const char *dirname)
+{
+    struct index_doc *doc = g_hash_table_lookup(index->docs, dirname);
+
+    int dir_fd = open(dirname, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    struct stat sb;
+    if (dir_fd < 0 || fstat(dir_fd, &sb) != 0)
+    {
+        const int r = -errno;
+        if (dir_fd >= 0)
+            close(dir_fd);
+        if (doc != NULL)
+            index_remove_doc(index, doc);
+        return r;
+    }
+
+    long long stamp;
+    const unsigned long long signature = stat_elements(dir_fd, &stamp);
+
+    /* chown and chmod change access rights */
+    if (doc != NULL && doc->stamp == stamp && doc->signature == signature
+        && doc->owner == sb.st_uid && doc->group == sb.st_gid && doc->mode == sb.st_mode)
+    {
+        close(dir_fd);
+        doc->generation = index->generation;
+        return 0;
+    }
+
+    log_debug("Indexing '%s'", dirname);
+
+    GHashTable *term_set = g_hash_table_new(g_str_hash, g_str_equal);
+    for (size_t i = 0; i < ARRAY_SIZE(index_fields); ++i)
+        add_field_terms(dir_fd, index_fields + i, term_set);
+    close(dir_fd);
+
+    GPtrArray *terms = g_ptr_array_sized_new(g_hash_table_size(term_set));
+    GHashTableIter iter;
+    char *term;
+    g_hash_table_iter_init(&iter, term_set);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&term, NULL))
+        g_ptr_array_add(terms, term);
+    g_hash_table_destroy(term_set);
+
+    if (doc != NULL)
+        index_remove_doc(index, doc);
+
+    /* dd_get_owner() is the owner of the directory */
+    doc = index_add_doc(index, dirname, terms);
+    doc->stamp = stamp;
+    doc->signature = signature;
+    doc->owner = sb.st_uid;
+    doc->group = sb.st_gid;
+    doc->mode = sb.st_mode;
+    return 1;
+}
+
+void problem_index_begin_sync(struct abrt_problem_index *index)
+{
+    ++index->generation;
+}
+
+unsigned problem_index_end_sync(struct abrt_problem_index *index)
+{
+    unsigned removed = 0;
+    for (unsigned id = 0; id < index->by_id->len; ++id)
+    {
+        struct index_doc *doc = g_ptr_array_index(index->by_id, id);
+        if (doc != NULL && doc->generation != index->generation)
+        {
+            log_debug("Problem '%s' no longer exists", doc->dirname);
+            index_remove_doc(index, doc);
+            ++removed;
+        }
+    }
+
+    return removed;
+}
+
+int problem_index_load(struct abrt_problem_index *index, const char *path)
+{
+    if (path == NULL)
+        path = PROBLEM_INDEX_FILE;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        if (errno != ENOENT)
+            perror_msg("Can't open '%s'", path);
+        return -errno;
+    }
+
+    int retval = 0;
+    char *line = xmalloc_fgetline(fp);
+    if (line == NULL || strcmp(line, PROBLEM_INDEX_MAGIC) != 0)
+    {
+        log_notice("'%s' is not a problem index, ignoring it", path);
+        retval = -EINVAL;
+        goto finito;
+    }
+
+    unsigned loaded = 0;
+    while (free(line), (line = xmalloc_fgetline(fp)) != NULL)
+    {
+        char *fields[7];
+        char *saveptr = NULL;
+        char *field = strtok_r(line, "\t", &saveptr);
+        unsigned count = 0;
+        for (; field != NULL && count < ARRAY_SIZE(fields); field = strtok_r(NULL, "\t", &saveptr))
+            fields[count++] = field;
+
+        /* A problem without terms has an empty last field */
+        if (count == ARRAY_SIZE(fields) - 1)
+            fields[count++] = (char *)"";
+
+        if (count != ARRAY_SIZE(fields) || fields[0][0] != '/')
+        {
+            log_notice("Ignoring malformed line in '%s'", path);
+            continue;
+        }
+
+        GPtrArray *terms = g_ptr_array_new();
+        char *term_saveptr = NULL;
+        for (char *term = strtok_r(fields[6], " ", &term_saveptr);
+             term != NULL;
+             term = strtok_r(NULL, " ", &term_saveptr))
+        {
+            g_ptr_array_add(terms, xstrdup(term));
+        }
+
+        problem_index_remove(index, fields[0]);
+        struct index_doc *doc = index_add_doc(index, fields[0], terms);
+        doc->stamp = strtoll(fields[1], NULL, 10);
+        doc->signature = strtoull(fields[2], NULL, 10);
+        doc->owner = strtoul(fields[3], NULL, 10);
+        doc->group = strtoul(fields[4], NULL, 10);
+        doc->mode = strtoul(fields[5], NULL, 8);
+        ++loaded;
+    }
+
+    /* Nothing to write back */
+    index->dirty = false;
+    log_info("Loaded %u problems from '%s'", loaded, path);
+
+ finito:
+    free(line);
+    fclose(fp);
+    return retval;
+}
+
+int problem_index_save(struct abrt_problem_index *index, const char *path)
+{
+    if (!index->dirty)
+        return 0;
+
+    if (path == NULL)
+        path = PROBLEM_INDEX_FILE;
+
+    char *tmp_path = xasprintf("%s.new", path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (fp == NULL)
+    {
+        int r = -errno;
+        perror_msg("Can't create '%s'", tmp_path);
+        free(tmp_path);
+        return r;
+    }
+
+    fputs(PROBLEM_INDEX_MAGIC"\n", fp);
+    for (unsigned id = 0; id < index->by_id->len; ++id)
+    {
+        struct index_doc *doc = g_ptr_array_index(index->by_id, id);
+        if (doc == NULL || strpbrk(doc->dirname, "\t\n") != NULL)
+            continue;
+
+        fprintf(fp, "%s\t%lld\t%llu\t%lu\t%lu\t%o\t", doc->dirname,
+                doc->stamp, doc->signature,
+                (unsigned long)doc->owner, (unsigned long)doc->group,
+                (unsigned)doc->mode);
+
+        for (unsigned i = 0; i < doc->terms->len; ++i)
+            fprintf(fp, "%s%s", i ? " " : "", (char *)g_ptr_array_index(doc->terms, i));
+
+        fputc('\n', fp);
+    }
+
+    int r = 0;
+    if (ferror(fp) | fclose(fp))
+    {
+        r = -EIO;
+        error_msg("Can't write '%s'", tmp_path);
+        unlink(tmp_path);
+    }
+    else if (rename(tmp_path, path) != 0)
+    {
+        r = -errno;
+        perror_msg("Can't replace '%s'", path);
+        unlink(tmp_path);
+    }
+    else
+        index->dirty = false;
+
+    free(tmp_path);
+    return r;
+}
+
+/*
+ * Searching
+ */
+static const struct index_field *find_field(const char *name, size_t len)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(index_fields); ++i)
+        if (strncmp(index_fields[i].name, name, len) == 0 && index_fields[i].name[len] == '\0')
+            return index_fields + i;
+
+    return NULL;
+}
+
+static void append_postings(GArray *ids, GArray *postings)
+{
+    if (postings != NULL)
+        g_array_append_vals(ids, postings->data, postings->len);
+}
+
+/* Sorts the ids and removes duplicates */
+static void sort_ids(GArray *ids)
+{
+    if (ids->len == 0)
+        return;
+
+    g_array_sort(ids, compare_ids);
+
+    unsigned *data = (unsigned *)ids->data;
+    unsigned len = 1;
+    for (unsigned i = 1; i < ids->len; ++i)
+        if (data[i] != data[len - 1])
+            data[len++] = data[i];
+
+    g_array_set_size(ids, len);
+}
+
+/* Returns ids of documents containing the token in the field or in any field
+ * if field is NULL */
+static GArray *find_token(struct abrt_problem_index *index,
+                          const struct index_field *field,
+                          const char *token, bool prefix)
+{
+    GArray *ids = g_array_new(FALSE, FALSE, sizeof(unsigned));
+
+    if (prefix)
+    {
+        const size_t token_len = strlen(token);
+        const size_t field_len = field ? strlen(field->name) : 0;
+
+        GHashTableIter iter;
+        const char *term;
+        GArray *postings;
+        g_hash_table_iter_init(&iter, index->terms);
+        while (g_hash_table_iter_next(&iter, (gpointer *)&term, (gpointer *)&postings))
+        {
+            const char *value = strchr(term, ':') + 1;
+            if (field != NULL && (value - term - 1 != field_len || strncmp(term, field->name, field_len) != 0))
+                continue;
+
+            if (strncmp(value, token, token_len) == 0)
+                append_postings(ids, postings);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(index_fields); ++i)
+        {
+            if (field != NULL && field != index_fields + i)
+                continue;
+
+            char *term = xasprintf("%s:%s", index_fields[i].name, token);
+            append_postings(ids, g_hash_table_lookup(index->terms, term));
+            free(term);
+        }
+    }
+
+    /* A single posting list is already sorted and unique */
+    if (prefix || field == NULL)
+        sort_ids(ids);
+
+    return ids;
+}
+
+/* Leaves in result only the ids which are also in ids */
+static void intersect_ids(GArray *result, GArray *ids)
+{
+    unsigned *r = (unsigned *)result->data;
+    const unsigned *o = (const unsigned *)ids->data;
+    unsigned len = 0;
+    unsigned i = 0, j = 0;
+
+    while (i < result->len && j < ids->len)
+    {
+        if (r[i] < o[j])
+            ++i;
+        else if (r[i] > o[j])
+            ++j;
+        else
+        {
+            r[len++] = r[i];
+            ++i;
+            ++j;
+        }
+    }
+
+    g_array_set_size(result, len);
+}
+
+struct search_args
+{
+    struct abrt_problem_index *index;
+    const struct index_field *field;
+    bool prefix;
+    GArray *result;
+    bool first;
+};
+
+static void search_token(const char *token, void *args)
+{
+    struct search_args *a = args;
+
+    /* The tokenizer does not produce an empty result */
+    if (!a->first && a->result->len == 0)
+        return;
+
+    GArray *ids = find_token(a->index, a->field, token, a->prefix);
+    if (a->first)
+    {
+        g_array_append_vals(a->result, ids->data, ids->len);
+        a->first = false;
+    }
+    else
+        intersect_ids(a->result, ids);
+
+    g_array_free(ids, TRUE);
+}
+
+/* Caches groups of the caller, only members of the abrt group can see
+ * problems of other users */
+struct access_check
+{
+    uid_t uid;
+    gid_t *groups;
+    int group_count;
+};
+
+static void access_check_init(struct access_check *check, uid_t uid)
+{
+    check->uid = uid;
+    check->groups = NULL;
+    check->group_count = 0;
+
+    if (uid == 0)
+        return;
+
+    struct passwd *pw = getpwuid(uid);
+    if (pw == NULL)
+        return;
+
+    int count = 16;
+    check->groups = xmalloc(count * sizeof(gid_t));
+    if (getgrouplist(pw->pw_name, pw->pw_gid, check->groups, &count) < 0)
+    {
+        check->groups = xrealloc(check->groups, count * sizeof(gid_t));
+        if (getgrouplist(pw->pw_name, pw->pw_gid, check->groups, &count) < 0)
+            count = 0;
+    }
+    check->group_count = count;
+}
+
+static bool access_check_doc(struct access_check *check, struct index_doc *doc)
+{
+    if (check->uid == 0 || check->uid == doc->owner || (doc->mode & S_IROTH))
+        return true;
+
+    for (int i = 0; i < check->group_count; ++i)
+        if (check->groups[i] == doc->group)
+            return true;
+
+    return false;
+}
+
+int problem_index_search(struct abrt_problem_index *index, const char *query,
+                         uid_t caller_uid, GList **dirnames)
+{
+    *dirnames = NULL;
+
+    struct search_args args = {
+        .index = index,
+        .result = g_array_new(FALSE, FALSE, sizeof(unsigned)),
+        .first = true,
+    };
+
+    unsigned tokens = 0;
+    char *copy = xstrdup(query);
+    char *saveptr = NULL;
+    for (char *word = strtok_r(copy, " \t\n", &saveptr);
+         word != NULL;
+         word = strtok_r(NULL, " \t\n", &saveptr))
+    {
+        args.field = NULL;
+        char *colon = strchr(word, ':');
+        if (colon != NULL)
+        {
+            args.field = find_field(word, colon - word);
+            if (args.field == NULL)
+            {
+                log_notice("Unknown search field '%.*s'", (int)(colon - word), word);
+                free(copy);
+                g_array_free(args.result, TRUE);
+                return -EINVAL;
+            }
+            word = colon + 1;
+        }
+
+        /* Only the last token of the word is a prefix; 'libx*' is 'libx' but
+         * the tokenizer would remove the star anyway */
+        const size_t len = strlen(word);
+        args.prefix = len > 0 && word[len - 1] == '*';
+        if (args.prefix)
+        {
+            word[len - 1] = '\0';
+            char *last = word + len - 1;
+            while (last > word && is_token_char(last[-1]))
+                --last;
+
+            args.prefix = false;
+            tokens += for_each_token(word, last - word, search_token, &args);
+            args.prefix = true;
+            word = last;
+        }
+
+        tokens += for_each_token(word, strlen(word), search_token, &args);
+    }
+    free(copy);
+
+    if (tokens == 0)
+    {
+        g_array_free(args.result, TRUE);
+        return -EINVAL;
+    }
+
+    struct access_check check;
+    access_check_init(&check, caller_uid);
+
+    GList *result = NULL;
+    for (unsigned i = 0; i < args.result->len; ++i)
+    {
+        struct index_doc *doc = g_ptr_array_index(index->by_id,
+                                                  g_array_index(args.result, unsigned, i));
+        if (doc != NULL && access_check_doc(&check, doc))
+            result = g_list_prepend(result, xstrdup(doc->dirname));
+    }
+
+    free(check.groups);
+    g_array_free(args.result, TRUE);
+
+    *dirnames = g_list_reverse(result);
+    return 0;
+}
+
+GHashTable *problem_index_get_clusters(struct abrt_problem_index *index, uid_t caller_uid)
+{
+    static const char prefix[] = "cluster:";
+
+    GHashTable *clusters = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                 free, (GDestroyNotify)list_free_with_free);
+
+    struct access_check check;
+    access_check_init(&check, caller_uid);
+
+    GHashTableIter iter;
+    const char *term;
+    GArray *postings;
+    g_hash_table_iter_init(&iter, index->terms);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&term, (gpointer *)&postings))
+    {
+        if (postings->len < 2 || strncmp(term, prefix, sizeof(prefix) - 1) != 0)
+            continue;
+
+        GList *members = NULL;
+        for (unsigned i = 0; i < postings->len; ++i)
+        {
+            struct index_doc *doc = g_ptr_array_index(index->by_id,
+                                                      g_array_index(postings, unsigned, i));
+            if (doc != NULL && access_check_doc(&check, doc))
+                members = g_list_prepend(members, xstrdup(doc->dirname));
+        }
+
+        /* A single problem is not a cluster */
+        if (members != NULL && members->next != NULL)
+            g_hash_table_insert(clusters, xstrdup(term + sizeof(prefix) - 1),
+                                g_list_reverse(members));
+        else
+            list_free_with_free(members);
+    }
+
+    free(check.groups);
+    return clusters;
+}
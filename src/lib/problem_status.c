@@ -0,0 +1,416 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+#include "problem_api.h"
+
+/*
+ * abrtd keeps a status file per user in PROBLEM_STATUS_DIR, named by
+ * the uid and readable only by the user:
+ *
+ *   problems COUNT
+ *   unreported COUNT
+ *   latest TIME
+ *   times TIME,TIME,...
+ *
+ * where TIMEs are last occurrences of the unreported problems, the newest
+ * first ('-' if there are none). Problems without the uid element are in
+ * the world readable file 'public', the file of root has all problems.
+ * The login notification reads one or two small files instead of asking
+ * abrt-dbus about every problem.
+ */
+#define PROBLEM_STATUS_DIR VAR_RUN"/abrt/status"
+#define PROBLEM_STATUS_PUBLIC "public"
+
+/* Saving an element replaces its file. The directory itself changes with
+ * every lock, its time can't tell whether the problem changed. */
+struct status_stamp
+{
+    struct timespec newest; /* modification of the elements read */
+    unsigned present;       /* bit mask of existing elements */
+};
+
+static const char *const status_elements[] = {
+    FILENAME_UID,
+    FILENAME_LAST_OCCURRENCE,
+    FILENAME_REPORTED_TO,
+};
+
+static void get_status_stamp(int dir_fd, struct status_stamp *stamp)
+{
+    memset(stamp, 0, sizeof(*stamp));
+    for (unsigned i = 0; i < ARRAY_SIZE(status_elements); ++i)
+    {
+        struct stat st;
+        if (fstatat(dir_fd, status_elements[i], &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        stamp->present |= 1 << i;
+        if (st.st_mtim.tv_sec > stamp->newest.tv_sec
+            || (st.st_mtim.tv_sec == stamp->newest.tv_sec && st.st_mtim.tv_nsec > stamp->newest.tv_nsec))
+            stamp->newest = st.st_mtim;
+    }
+}
+
+static bool status_stamp_equal(const struct status_stamp *a, const struct status_stamp *b)
+{
+    return a->present == b->present
+        && a->newest.tv_sec == b->newest.tv_sec
+        && a->newest.tv_nsec == b->newest.tv_nsec;
+}
+
+struct status_problem
+{
+    bool has_uid;
+    uid_t uid;
+    time_t last_occurrence;
+    bool reported;
+    struct status_stamp stamp;
+    unsigned generation;    /* of the last refresh which saw it */
+};
+
+struct abrt_problem_status
+{
+    GHashTable *problems;   /* basename -> struct status_problem */
+    unsigned generation;
+};
+
+struct abrt_problem_status *problem_status_new(void)
+{
+    struct abrt_problem_status *status = xzalloc(sizeof(*status));
+    status->problems = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+    return status;
+}
+
+void problem_status_free(struct abrt_problem_status *status)
+{
+    if (status == NULL)
+        return;
+
+    g_hash_table_destroy(status->problems);
+    free(status);
+}
+
+static void add_status_problem(struct abrt_problem_status *status, struct dump_dir *dd)
+{
+    struct status_problem *problem = xzalloc(sizeof(*problem));
+
+    char *uid = dd_load_text_ext(dd, FILENAME_UID, DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT);
+    if (uid != NULL)
+    {
+        char *end;
+        errno = 0;
+        const unsigned long value = strtoul(uid, &end, 10);
+        problem->has_uid = errno == 0 && end != uid && *end == '\0';
+        problem->uid = (uid_t)value;
+        free(uid);
+    }
+
+    problem->last_occurrence = dd_get_last_occurrence(dd);
+    problem->reported = dd_exist(dd, FILENAME_REPORTED_TO);
+    problem->generation = status->generation;
+    get_status_stamp(dd->dd_fd, &problem->stamp);
+
+    const char *base = strrchr(dd->dd_dirname, '/');
+    g_hash_table_replace(status->problems, xstrdup(base ? base + 1 : dd->dd_dirname), problem);
+}
+
+static int add_status_problem_cb(struct dump_dir *dd, void *arg)
+{
+    add_status_problem(arg, dd);
+    return 0;
+}
+
+struct abrt_problem_status *problem_status_scan(const char *dump_location)
+{
+    struct abrt_problem_status *status = problem_status_new();
+    for_each_problem_in_dir(dump_location, /*all users*/(uid_t)-1, add_status_problem_cb, status);
+
+    log_debug("Status of %u problems in '%s'", g_hash_table_size(status->problems), dump_location);
+    return status;
+}
+
+void problem_status_update(struct abrt_problem_status *status, const char *dirname)
+{
+    struct dump_dir *dd = dd_opendir(dirname, DD_OPEN_READONLY | DD_FAIL_QUIETLY_ENOENT | DD_FAIL_QUIETLY_EACCES);
+    if (dd == NULL)
+    {
+        problem_status_remove(status, dirname);
+        return;
+    }
+
+    add_status_problem(status, dd);
+    dd_close(dd);
+}
+
+void problem_status_remove(struct abrt_problem_status *status, const char *dirname)
+{
+    const char *base = strrchr(dirname, '/');
+    g_hash_table_remove(status->problems, base ? base + 1 : dirname);
+}
+
+static gboolean status_problem_not_seen(gpointer key, gpointer value, gpointer generation)
+{
+    return ((struct status_problem *)value)->generation != GPOINTER_TO_UINT(generation);
+}
+
+unsigned problem_status_refresh(struct abrt_problem_status *status, const char *dump_location)
+{
+    DIR *dir = opendir(dump_location);
+    if (dir == NULL)
+    {
+        perror_msg("Can't open '%s'", dump_location);
+        return 0;
+    }
+
+    ++status->generation;
+    unsigned changed = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        const int problem_fd = openat(dirfd(dir), dent->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (problem_fd < 0)
+            continue;
+        struct status_stamp stamp;
+        get_status_stamp(problem_fd, &stamp);
+        close(problem_fd);
+
+        struct status_problem *problem = g_hash_table_lookup(status->problems, dent->d_name);
+        if (problem != NULL && status_stamp_equal(&problem->stamp, &stamp))
+        {
+            problem->generation = status->generation;
+            continue;
+        }
+
+        /* Directories which aren't problems are tried again every time */
+        char *dirname = concat_path_file(dump_location, dent->d_name);
+        problem_status_update(status, dirname);
+        free(dirname);
+        if (problem != NULL || g_hash_table_lookup(status->problems, dent->d_name) != NULL)
+            ++changed;
+    }
+    closedir(dir);
+
+    changed += g_hash_table_foreach_remove(status->problems, status_problem_not_seen,
+                                           GUINT_TO_POINTER(status->generation));
+
+    log_debug("Status of %u problems in '%s', %u changed", g_hash_table_size(status->problems),
+              dump_location, changed);
+    return changed;
+}
+
+struct status_totals
+{
+    unsigned problems;
+    time_t latest;
+    GArray *times;      /* of unreported problems */
+};
+
+static void status_totals_free(struct status_totals *totals)
+{
+    g_array_free(totals->times, TRUE);
+    free(totals);
+}
+
+static void status_totals_add(GHashTable *totals, const char *name, const struct status_problem *problem)
+{
+    struct status_totals *total = g_hash_table_lookup(totals, name);
+    if (total == NULL)
+    {
+        total = xzalloc(sizeof(*total));
+        total->times = g_array_new(FALSE, FALSE, sizeof(time_t));
+        g_hash_table_insert(totals, xstrdup(name), total);
+    }
+
+    ++total->problems;
+    if (problem->last_occurrence > total->latest)
+        total->latest = problem->last_occurrence;
+    if (!problem->reported)
+        g_array_append_val(total->times, problem->last_occurrence);
+}
+
+static gint time_cmp_newest_first(gconstpointer a, gconstpointer b)
+{
+    const time_t at = *(const time_t *)a;
+    const time_t bt = *(const time_t *)b;
+    return at > bt ? -1 : at < bt;
+}
+
+static int save_status_file(const char *dir, const char *name, const struct status_totals *total)
+{
+    g_array_sort(total->times, time_cmp_newest_first);
+
+    GString *contents = g_string_new(NULL);
+    g_string_append_printf(contents, "problems %u\nunreported %u\nlatest %lld\ntimes ",
+                           total->problems, total->times->len, (long long)total->latest);
+    for (unsigned i = 0; i < total->times->len; ++i)
+        g_string_append_printf(contents, "%s%lld", i ? "," : "", (long long)g_array_index(total->times, time_t, i));
+    g_string_append(contents, total->times->len ? "\n" : "-\n");
+
+    const bool public = strcmp(name, PROBLEM_STATUS_PUBLIC) == 0;
+    char *path = concat_path_file(dir, name);
+    char *tmp_path = xasprintf("%s.%lu", path, (unsigned long)getpid());
+
+    int r = -1;
+    const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+        perror_msg("Can't create '%s'", tmp_path);
+    else
+    {
+        /* The file of a user is readable only by the user */
+        const bool written = full_write(fd, contents->str, contents->len) >= 0
+                             && (public ? fchmod(fd, 0644) == 0
+                                        : (fchown(fd, (uid_t)strtoul(name, NULL, 10), (gid_t)-1) == 0
+                                           && fchmod(fd, 0400) == 0));
+        close(fd);
+
+        if (written && rename(tmp_path, path) == 0)
+            r = 0;
+        else
+        {
+            perror_msg("Can't save '%s'", path);
+            unlink(tmp_path);
+        }
+    }
+
+    free(tmp_path);
+    free(path);
+    g_string_free(contents, TRUE);
+    return r;
+}
+
+/* Other writers' temporary files are not status files */
+static bool is_status_file_name(const char *name)
+{
+    if (strcmp(name, PROBLEM_STATUS_PUBLIC) == 0)
+        return true;
+
+    return isdigit((unsigned char)name[0]) && name[strspn(name, "0123456789")] == '\0';
+}
+
+int problem_status_save(struct abrt_problem_status *status, const char *dir)
+{
+    if (dir == NULL)
+        dir = PROBLEM_STATUS_DIR;
+
+    GHashTable *totals = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)status_totals_free);
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, status->problems);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        const struct status_problem *problem = value;
+        char name[sizeof(long) * 3 + 2];
+        if (problem->has_uid)
+            sprintf(name, "%lu", (unsigned long)problem->uid);
+        else
+            strcpy(name, PROBLEM_STATUS_PUBLIC);
+
+        status_totals_add(totals, name, problem);
+        if (!problem->has_uid || problem->uid != 0)
+            status_totals_add(totals, "0", problem);
+    }
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        perror_msg("Can't create '%s'", dir);
+        g_hash_table_destroy(totals);
+        return -1;
+    }
+
+    int r = 0;
+    struct status_totals *total;
+    const char *name;
+    g_hash_table_iter_init(&iter, totals);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&name, (gpointer *)&total))
+        r |= save_status_file(dir, name, total);
+
+    /* Users without problems */
+    DIR *d = opendir(dir);
+    if (d != NULL)
+    {
+        struct dirent *dent;
+        while ((dent = readdir(d)) != NULL)
+        {
+            if (is_status_file_name(dent->d_name) && !g_hash_table_contains(totals, dent->d_name))
+                unlinkat(dirfd(d), dent->d_name, 0);
+        }
+        closedir(d);
+    }
+
+    g_hash_table_destroy(totals);
+    return r;
+}
+
+/* Adds the number of times in the file newer than since to *count */
+static int count_in_status_file(const char *dir, const char *name, time_t since, unsigned *count)
+{
+    char *path = concat_path_file(dir, name);
+    char *contents = xmalloc_open_read_close(path, /*maxsize:*/ NULL);
+    free(path);
+    if (contents == NULL)
+        return -ENOENT;
+
+    int r = -EINVAL;
+    char *times = strstr(contents, "\ntimes ");
+    if (times != NULL)
+    {
+        r = 0;
+        times += strlen("\ntimes ");
+        /* Newest first, stop at the first older one */
+        for (char *p = times; *p != '-' && *p != '\n' && *p != '\0'; )
+        {
+            char *end;
+            const long long t = strtoll(p, &end, 10);
+            if (end == p || t < since)
+                break;
+            ++*count;
+            p = (*end == ',') ? end + 1 : end;
+        }
+    }
+
+    free(contents);
+    return r;
+}
+
+int problem_status_count(const char *dir, uid_t uid, time_t since, unsigned *count)
+{
+    if (dir == NULL)
+        dir = PROBLEM_STATUS_DIR;
+
+    *count = 0;
+
+    char name[sizeof(long) * 3 + 2];
+    sprintf(name, "%lu", (unsigned long)uid);
+    int r = count_in_status_file(dir, name, since, count);
+    /* No file means no problems of the user if abrtd publishes the status */
+    if (r == -ENOENT && access(dir, F_OK) == 0)
+        r = 0;
+
+    if (r == 0 && uid != 0)
+    {
+        const int pr = count_in_status_file(dir, PROBLEM_STATUS_PUBLIC, since, count);
+        if (pr != 0 && pr != -ENOENT)
+            r = pr;
+    }
+
+    return r;
+}
@@ -0,0 +1,217 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <regex.h>
+#include <satyr/stacktrace.h>
+#include <satyr/python/stacktrace.h>
+#include <satyr/python/frame.h>
+#include "libabrt.h"
+
+/* Used if the configuration has no DuphashMessageMasks: quoted strings,
+ * paths, hexadecimal and decimal numbers. Keep in sync with python.conf. */
+static const char *const default_message_masks[] = {
+    "\"[^\"]*\"",
+    "'[^'[:space:]]*'",
+    "/[^[:space:]]*",
+    "0x[[:xdigit:]]+",
+    "[[:digit:]]+",
+    NULL
+};
+
+GList *python_duphash_parse_masks(const char *value)
+{
+    GList *masks = NULL;
+    struct strbuf *mask = strbuf_new();
+    unsigned brackets = 0;
+    unsigned braces = 0;
+
+    for (const char *p = value; ; ++p)
+    {
+        if (*p == '\0' || (*p == ',' && brackets == 0 && braces == 0))
+        {
+            char *trimmed = strtrim(xstrdup(mask->buf));
+            if (trimmed[0] != '\0')
+                masks = g_list_append(masks, trimmed);
+            else
+                free(trimmed);
+            strbuf_clear(mask);
+
+            if (*p == '\0')
+                break;
+            continue;
+        }
+
+        if (*p == '\\' && p[1] != '\0' && brackets == 0)
+        {
+            strbuf_append_char(mask, *p++);
+        }
+        else if (*p == '[' && brackets == 0)
+        {
+            brackets = 1;
+            /* ']' right after '[' or '[^' is a member of the list */
+            if (p[1] == '^')
+                strbuf_append_char(mask, *p++);
+            if (p[1] == ']')
+                strbuf_append_char(mask, *p++);
+        }
+        else if (*p == '[' && brackets > 0 && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+        {
+            /* [:class:], [.coll.] and [=equiv=] within a bracket expression */
+            ++brackets;
+        }
+        else if (*p == ']' && brackets > 0)
+            --brackets;
+        else if (*p == '{' && brackets == 0)
+            ++braces;
+        else if (*p == '}' && brackets == 0 && braces > 0)
+            --braces;
+
+        strbuf_append_char(mask, *p);
+    }
+
+    strbuf_free(mask);
+    return masks;
+}
+
+/* Replaces every part of the message matching the pattern by '*' */
+static char *mask_message(char *message, const char *pattern)
+{
+    regex_t re;
+    if (regcomp(&re, pattern, REG_EXTENDED) != 0)
+    {
+        error_msg("Invalid message mask '%s', ignoring it", pattern);
+        return message;
+    }
+
+    struct strbuf *masked = strbuf_new();
+    const char *p = message;
+    regmatch_t match;
+    int flags = 0;
+    while (*p != '\0' && regexec(&re, p, 1, &match, flags) == 0)
+    {
+        if (match.rm_eo == 0)
+        {   /* empty match, move on by one character */
+            strbuf_append_char(masked, *p++);
+        }
+        else
+        {
+            strbuf_append_strf(masked, "%.*s*", (int)match.rm_so, p);
+            p += match.rm_eo;
+        }
+        flags = REG_NOTBOL;
+    }
+    strbuf_append_str(masked, p);
+
+    regfree(&re);
+    free(message);
+    return strbuf_free_nobuf(masked);
+}
+
+char *python_duphash_mask_message(const char *message, const char *const *masks)
+{
+    if (masks == NULL)
+        masks = default_message_masks;
+
+    char *masked = xstrdup(message);
+    for (; *masks != NULL; ++masks)
+        masked = mask_message(masked, *masks);
+
+    return masked;
+}
+
+/* Paths of installed modules differ between interpreters and virtual
+ * environments, the part after site-packages identifies the module */
+static const char *normalize_file_name(const char *file_name)
+{
+    static const char *const prefixes[] = { "/site-packages/", "/dist-packages/", NULL };
+    for (const char *const *prefix = prefixes; *prefix != NULL; ++prefix)
+    {
+        const char *module = strstr(file_name, *prefix);
+        if (module != NULL)
+            return module + strlen(*prefix);
+    }
+    return file_name;
+}
+
+/* Returns malloced message of the exception from the first line of the
+ * backtrace or NULL:
+ * "example.py:1:<module>:ZeroDivisionError: integer division or modulo by zero"
+ */
+static char *get_exception_message(const char *backtrace, const char *exception_name)
+{
+    char *first_line = xstrndup(backtrace, strchrnul(backtrace, '\n') - backtrace);
+    char *needle = xasprintf(":%s:", exception_name);
+    const char *message = strstr(first_line, needle);
+    char *result = message != NULL ? xstrdup(skip_whitespace(message + strlen(needle))) : NULL;
+    free(needle);
+    free(first_line);
+
+    return result;
+}
+
+int python_duphash_str(char hash_str[SHA1_RESULT_LEN*2 + 1], const char *backtrace,
+                       bool include_message, const char *const *message_masks)
+{
+    char *error_message = NULL;
+    struct sr_python_stacktrace *stacktrace = (struct sr_python_stacktrace *)
+            sr_stacktrace_parse(SR_REPORT_PYTHON, backtrace, &error_message);
+    if (stacktrace == NULL || stacktrace->frames == NULL)
+    {
+        log_notice("Can't hash the frames of the Python backtrace: %s",
+                   error_message ? error_message : "no frames");
+        free(error_message);
+        sr_python_stacktrace_free(stacktrace);
+        return -1;
+    }
+
+    struct strbuf *hashed = strbuf_new();
+    strbuf_append_strf(hashed, "%s\n", stacktrace->exception_name ? stacktrace->exception_name : "");
+
+    for (struct sr_python_frame *frame = stacktrace->frames; frame != NULL; frame = frame->next)
+    {
+        const char *file_name = frame->file_name ? normalize_file_name(frame->file_name) : "";
+        const char *function_name = frame->function_name ? frame->function_name : "";
+        strbuf_append_strf(hashed, "%s%s%s:%u:%s%s%s\n",
+                           frame->special_file ? "<" : "", file_name, frame->special_file ? ">" : "",
+                           frame->file_line,
+                           frame->special_function ? "<" : "", function_name, frame->special_function ? ">" : "");
+    }
+
+    char *message = NULL;
+    if (include_message && stacktrace->exception_name != NULL)
+        message = get_exception_message(backtrace, stacktrace->exception_name);
+    if (message != NULL)
+    {
+        char *masked = python_duphash_mask_message(message, message_masks);
+        log_info("Masked exception message: '%s'", masked);
+        strbuf_append_str(hashed, masked);
+        free(masked);
+        free(message);
+    }
+
+    str_to_sha1str(hash_str, hashed->buf);
+    strbuf_free(hashed);
+    sr_python_stacktrace_free(stacktrace);
+    return 0;
+}
+
+void python_legacy_duphash_str(char hash_str[SHA1_RESULT_LEN*2 + 1], const char *backtrace)
+{
+    char *first_line = xstrndup(backtrace, strchrnul(backtrace, '\n') - backtrace);
+    str_to_sha1str(hash_str, first_line);
+    free(first_line);
+}
@@ -0,0 +1,641 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+#include "problem_api.h"
+
+/*
+ * The usage file is maintained by abrtd, one line per quota class key:
+ *
+ *   CLASS KEY SIZE COUNT TIME,TIME,...
+ *
+ * where TIMEs are the times abrtd admitted problems of the key in the last
+ * hour, including the problems deleted since then ('-' if there are none).
+ * The hooks only read the file, so checking a new problem costs a single
+ * read of a small file.
+ */
+#define QUOTA_USAGE_FILE VAR_RUN"/abrt/quota"
+
+#define QUOTA_RATE_PERIOD (60 * 60)
+
+static const char *quota_usage_file(void)
+{
+    const char *path = getenv("ABRT_QUOTA_USAGE_FILE");
+    return path != NULL ? path : QUOTA_USAGE_FILE;
+}
+
+static const char *const quota_class_names[ABRT_QUOTA_CLASS_COUNT] = {
+    [ABRT_QUOTA_UID]       = "uid",
+    [ABRT_QUOTA_CONTAINER] = "container",
+    [ABRT_QUOTA_TYPE]      = "type",
+};
+
+const char *quota_class_name(enum abrt_quota_class class)
+{
+    return class < ABRT_QUOTA_CLASS_COUNT ? quota_class_names[class] : NULL;
+}
+
+static int quota_class_from_name(const char *name)
+{
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        if (strcmp(quota_class_names[class], name) == 0)
+            return class;
+
+    return -1;
+}
+
+static bool quota_class_enabled(int class)
+{
+    const struct abrt_quota_limit *limit = &g_settings_quota[class];
+    return limit->size != 0 || limit->count != 0 || limit->rate != 0;
+}
+
+bool quota_enabled(void)
+{
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        if (quota_class_enabled(class))
+            return true;
+
+    return false;
+}
+
+/* Keys are stored in a whitespace separated file */
+static char *quota_normalize_key(const char *key)
+{
+    if (key == NULL || key[0] == '\0')
+        return NULL;
+
+    char *normalized = xstrdup(key);
+    for (char *c = normalized; *c != '\0'; ++c)
+        if (isspace(*c) || !isprint(*c))
+            *c = '_';
+
+    return normalized;
+}
+
+/* Returns the container ID if the cgroup path component belongs to a container */
+static char *container_id_from_component(const char *component, size_t len, const char *parent, size_t parent_len)
+{
+    static const char *const scope_prefixes[] = {
+        "docker-",
+        "libpod-",
+        "crio-",
+        "machine-",
+    };
+
+    const size_t scope_len = strlen(".scope");
+    if (len > scope_len && strncmp(component + len - scope_len, ".scope", scope_len) == 0)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(scope_prefixes); ++i)
+        {
+            const size_t prefix_len = strlen(scope_prefixes[i]);
+            if (len > prefix_len + scope_len && strncmp(component, scope_prefixes[i], prefix_len) == 0)
+                return xstrndup(component + prefix_len, len - prefix_len - scope_len);
+        }
+    }
+
+    /* cgroupfs driver: /docker/ID, /lxc/NAME */
+    if (parent != NULL && ((parent_len == strlen("docker") && strncmp(parent, "docker", parent_len) == 0)
+                        || (parent_len == strlen("lxc") && strncmp(parent, "lxc", parent_len) == 0)))
+        return xstrndup(component, len);
+
+    if (len > strlen("lxc.payload.") && strncmp(component, "lxc.payload.", strlen("lxc.payload.")) == 0)
+        return xstrndup(component + strlen("lxc.payload."), len - strlen("lxc.payload."));
+
+    return NULL;
+}
+
+char *quota_container_id(const char *cgroup)
+{
+    for (const char *line = cgroup; line != NULL && *line != '\0'; )
+    {
+        const char *end = strchrnul(line, '\n');
+
+        /* hierarchy-ID:controller-list:cgroup-path */
+        const char *path = memchr(line, ':', end - line);
+        if (path != NULL)
+            path = memchr(path + 1, ':', end - path - 1);
+
+        if (path != NULL)
+        {
+            const char *parent = NULL;
+            size_t parent_len = 0;
+            const char *component = path + 1;
+            while (component < end)
+            {
+                const char *next = memchr(component, '/', end - component);
+                if (next == NULL)
+                    next = end;
+
+                const size_t len = next - component;
+                if (len != 0)
+                {
+                    char *id = container_id_from_component(component, len, parent, parent_len);
+                    if (id != NULL)
+                    {
+                        char *key = quota_normalize_key(id);
+                        free(id);
+                        return key;
+                    }
+
+                    parent = component;
+                    parent_len = len;
+                }
+
+                component = next + 1;
+            }
+        }
+
+        line = *end ? end + 1 : NULL;
+    }
+
+    return NULL;
+}
+
+void quota_class_usage_free(struct abrt_quota_class_usage *usage)
+{
+    if (usage == NULL)
+        return;
+
+    free(usage->key);
+    free(usage);
+}
+
+/* Parses a line of the usage file, counts the admission times newer than 'since' */
+static struct abrt_quota_class_usage *parse_usage_line(char *line, time_t since)
+{
+    char *saveptr = NULL;
+    const char *class_name = strtok_r(line, " ", &saveptr);
+    const char *key = strtok_r(NULL, " ", &saveptr);
+    const char *size = strtok_r(NULL, " ", &saveptr);
+    const char *count = strtok_r(NULL, " ", &saveptr);
+    const char *times = strtok_r(NULL, " ", &saveptr);
+
+    if (times == NULL)
+        return NULL;
+
+    const int class = quota_class_from_name(class_name);
+    if (class < 0)
+        return NULL;
+
+    struct abrt_quota_class_usage *usage = xzalloc(sizeof(*usage));
+    usage->class = class;
+    usage->key = xstrdup(key);
+    usage->size = strtoull(size, NULL, 10);
+    usage->count = strtoul(count, NULL, 10);
+
+    for (const char *tm = times; *tm != '\0' && *tm != '-'; )
+    {
+        char *end;
+        const long long created = strtoll(tm, &end, 10);
+        if (end == tm)
+            break;
+
+        if (created >= since)
+            ++usage->recent;
+
+        tm = *end == ',' ? end + 1 : end;
+    }
+
+    return usage;
+}
+
+GList *quota_load_usage(void)
+{
+    char *contents = xmalloc_open_read_close(quota_usage_file(), /*maxsize:*/ NULL);
+    if (contents == NULL)
+        return NULL;
+
+    const time_t since = time(NULL) - QUOTA_RATE_PERIOD;
+
+    GList *result = NULL;
+    char *saveptr = NULL;
+    for (char *line = strtok_r(contents, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr))
+    {
+        struct abrt_quota_class_usage *usage = parse_usage_line(line, since);
+        if (usage != NULL)
+            result = g_list_prepend(result, usage);
+        else
+            log_notice("Malformed line in '%s'", quota_usage_file());
+    }
+
+    free(contents);
+    return g_list_reverse(result);
+}
+
+enum abrt_quota_verdict quota_check(const char *const keys[ABRT_QUOTA_CLASS_COUNT], char **exceeded)
+{
+    if (!quota_enabled())
+        return ABRT_QUOTA_OK;
+
+    char *normalized[ABRT_QUOTA_CLASS_COUNT];
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        normalized[class] = quota_normalize_key(keys[class]);
+
+    GList *usages = quota_load_usage();
+
+    char *reason = NULL;
+    for (GList *iter = usages; reason == NULL && iter != NULL; iter = g_list_next(iter))
+    {
+        const struct abrt_quota_class_usage *usage = iter->data;
+        if (normalized[usage->class] == NULL || strcmp(normalized[usage->class], usage->key) != 0)
+            continue;
+
+        const struct abrt_quota_limit *limit = &g_settings_quota[usage->class];
+        const char *const class_name = quota_class_names[usage->class];
+
+        /* abrtd keeps size and count at the limit by deleting the oldest
+         * problems, so these are exceeded only if problems come faster than
+         * abrtd processes them */
+        if (limit->size != 0 && usage->size > (unsigned long long)limit->size * (1024 * 1024))
+            reason = xasprintf("%s %s exceeds the size quota of %uMiB", class_name, usage->key, limit->size);
+        else if (limit->count != 0 && usage->count > limit->count)
+            reason = xasprintf("%s %s exceeds the quota of %u problems", class_name, usage->key, limit->count);
+        else if (limit->rate != 0 && usage->recent >= limit->rate)
+            reason = xasprintf("%s %s exceeds the quota of %u problems per hour", class_name, usage->key, limit->rate);
+    }
+
+    g_list_free_full(usages, (GDestroyNotify)quota_class_usage_free);
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        free(normalized[class]);
+
+    if (reason == NULL)
+        return ABRT_QUOTA_OK;
+
+    if (exceeded != NULL)
+        *exceeded = reason;
+    else
+        free(reason);
+
+    return g_settings_over_quota_reject ? ABRT_QUOTA_REJECT : ABRT_QUOTA_DEGRADE;
+}
+
+struct quota_problem
+{
+    char *basename;
+    char *keys[ABRT_QUOTA_CLASS_COUNT];
+    time_t created;
+    unsigned long long size;
+};
+
+/* Usage of a quota class key, kept up to date as problems come and go */
+struct quota_totals
+{
+    unsigned long long size;
+    unsigned count;
+    GArray *admissions;     /* of time_t, oldest first */
+};
+
+struct abrt_quota_usage
+{
+    GList *problems;    /* oldest first */
+    GHashTable *totals[ABRT_QUOTA_CLASS_COUNT];     /* key -> struct quota_totals */
+};
+
+static void quota_problem_free(struct quota_problem *problem)
+{
+    if (problem == NULL)
+        return;
+
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        free(problem->keys[class]);
+    free(problem->basename);
+    free(problem);
+}
+
+static void quota_totals_free(struct quota_totals *totals)
+{
+    g_array_free(totals->admissions, TRUE);
+    free(totals);
+}
+
+static struct quota_totals *get_quota_totals(struct abrt_quota_usage *usage, int class, const char *key)
+{
+    struct quota_totals *totals = g_hash_table_lookup(usage->totals[class], key);
+    if (totals == NULL)
+    {
+        totals = xzalloc(sizeof(*totals));
+        totals->admissions = g_array_new(FALSE, FALSE, sizeof(time_t));
+        g_hash_table_insert(usage->totals[class], xstrdup(key), totals);
+    }
+
+    return totals;
+}
+
+/* Adds (sign > 0) or subtracts the problem from the totals of its keys */
+static void account_quota_problem(struct abrt_quota_usage *usage, const struct quota_problem *problem, int sign)
+{
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+    {
+        if (problem->keys[class] == NULL)
+            continue;
+
+        struct quota_totals *totals = get_quota_totals(usage, class, problem->keys[class]);
+        if (sign > 0)
+        {
+            totals->size += problem->size;
+            ++totals->count;
+        }
+        else
+        {
+            totals->size -= MIN(totals->size, problem->size);
+            totals->count -= !!totals->count;
+        }
+    }
+}
+
+static gint quota_problem_cmp_created(gconstpointer a, gconstpointer b)
+{
+    const time_t at = ((const struct quota_problem *)a)->created;
+    const time_t bt = ((const struct quota_problem *)b)->created;
+    return at < bt ? -1 : at > bt;
+}
+
+static struct quota_problem *load_quota_problem(struct dump_dir *dd)
+{
+    const int flags = DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT;
+
+    struct quota_problem *problem = xzalloc(sizeof(*problem));
+    const char *base = strrchr(dd->dd_dirname, '/');
+    problem->basename = xstrdup(base ? base + 1 : dd->dd_dirname);
+    problem->created = dd_get_first_occurrence(dd);
+    problem->size = problem_dir_size(dd->dd_dirname);
+
+    char *value = dd_load_text_ext(dd, FILENAME_UID, flags);
+    problem->keys[ABRT_QUOTA_UID] = quota_normalize_key(value);
+    free(value);
+
+    value = dd_load_text_ext(dd, FILENAME_CGROUP, flags);
+    problem->keys[ABRT_QUOTA_CONTAINER] = value ? quota_container_id(value) : NULL;
+    free(value);
+
+    value = dd_load_text_ext(dd, FILENAME_TYPE, flags);
+    problem->keys[ABRT_QUOTA_TYPE] = quota_normalize_key(value);
+    free(value);
+
+    return problem;
+}
+
+static int add_quota_problem(struct dump_dir *dd, void *arg)
+{
+    struct abrt_quota_usage *usage = arg;
+
+    struct quota_problem *problem = load_quota_problem(dd);
+    account_quota_problem(usage, problem, +1);
+    usage->problems = g_list_prepend(usage->problems, problem);
+    return 0;
+}
+
+/* Admissions are not in the dump location, they survive abrtd restarts in
+ * the usage file */
+static void load_saved_admissions(struct abrt_quota_usage *usage)
+{
+    char *contents = xmalloc_open_read_close(quota_usage_file(), /*maxsize:*/ NULL);
+    if (contents == NULL)
+        return;
+
+    const time_t since = time(NULL) - QUOTA_RATE_PERIOD;
+
+    char *saveptr = NULL;
+    for (char *line = strtok_r(contents, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr))
+    {
+        char *field_saveptr = NULL;
+        const char *class_name = strtok_r(line, " ", &field_saveptr);
+        const char *key = strtok_r(NULL, " ", &field_saveptr);
+        strtok_r(NULL, " ", &field_saveptr);   /* size */
+        strtok_r(NULL, " ", &field_saveptr);   /* count */
+        const char *times = strtok_r(NULL, " ", &field_saveptr);
+
+        const int class = times ? quota_class_from_name(class_name) : -1;
+        if (class < 0)
+            continue;
+
+        struct quota_totals *totals = NULL;
+        for (const char *tm = times; *tm != '\0' && *tm != '-'; )
+        {
+            char *end;
+            const time_t admitted = (time_t)strtoll(tm, &end, 10);
+            if (end == tm)
+                break;
+
+            if (admitted >= since)
+            {
+                if (totals == NULL)
+                    totals = get_quota_totals(usage, class, key);
+                g_array_append_val(totals->admissions, admitted);
+            }
+
+            tm = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    free(contents);
+}
+
+struct abrt_quota_usage *quota_usage_scan(const char *dump_location)
+{
+    struct abrt_quota_usage *usage = xzalloc(sizeof(*usage));
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        usage->totals[class] = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)quota_totals_free);
+
+    load_saved_admissions(usage);
+    quota_usage_rescan(usage, dump_location);
+    return usage;
+}
+
+void quota_usage_rescan(struct abrt_quota_usage *usage, const char *dump_location)
+{
+    g_list_free_full(usage->problems, (GDestroyNotify)quota_problem_free);
+    usage->problems = NULL;
+
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+    {
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, usage->totals[class]);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+        {
+            struct quota_totals *totals = value;
+            totals->size = 0;
+            totals->count = 0;
+        }
+    }
+
+    for_each_problem_in_dir(dump_location, /*all users*/(uid_t)-1, add_quota_problem, usage);
+    usage->problems = g_list_sort(usage->problems, quota_problem_cmp_created);
+
+    log_debug("Quota usage of %u problems in '%s'", g_list_length(usage->problems), dump_location);
+}
+
+void quota_usage_free(struct abrt_quota_usage *usage)
+{
+    if (usage == NULL)
+        return;
+
+    g_list_free_full(usage->problems, (GDestroyNotify)quota_problem_free);
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        g_hash_table_destroy(usage->totals[class]);
+    free(usage);
+}
+
+static GList *find_quota_problem(struct abrt_quota_usage *usage, const char *basename)
+{
+    for (GList *iter = usage->problems; iter != NULL; iter = g_list_next(iter))
+        if (strcmp(((struct quota_problem *)iter->data)->basename, basename) == 0)
+            return iter;
+
+    return NULL;
+}
+
+static const struct quota_problem *quota_usage_reload(struct abrt_quota_usage *usage, const char *dirname)
+{
+    const char *base = strrchr(dirname, '/');
+    quota_usage_remove(usage, base ? base + 1 : dirname);
+
+    struct dump_dir *dd = dd_opendir(dirname, DD_OPEN_READONLY | DD_FAIL_QUIETLY_ENOENT | DD_FAIL_QUIETLY_EACCES);
+    if (dd == NULL)
+        return NULL;
+
+    struct quota_problem *problem = load_quota_problem(dd);
+    dd_close(dd);
+
+    account_quota_problem(usage, problem, +1);
+    usage->problems = g_list_insert_sorted(usage->problems, problem, quota_problem_cmp_created);
+    return problem;
+}
+
+void quota_usage_update(struct abrt_quota_usage *usage, const char *dirname)
+{
+    quota_usage_reload(usage, dirname);
+}
+
+void quota_usage_admit(struct abrt_quota_usage *usage, const char *dirname)
+{
+    const struct quota_problem *problem = quota_usage_reload(usage, dirname);
+    if (problem == NULL)
+        return;
+
+    const time_t now = time(NULL);
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+        if (problem->keys[class] != NULL)
+            g_array_append_val(get_quota_totals(usage, class, problem->keys[class])->admissions, now);
+}
+
+char *quota_usage_find_victim(struct abrt_quota_usage *usage, const char *basename, const char *busy)
+{
+    GList *item = find_quota_problem(usage, basename);
+    if (item == NULL)
+        return NULL;
+
+    const struct quota_problem *new_problem = item->data;
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+    {
+        const struct abrt_quota_limit *limit = &g_settings_quota[class];
+        const char *key = new_problem->keys[class];
+        if (key == NULL || (limit->size == 0 && limit->count == 0))
+            continue;
+
+        const struct quota_totals *totals = g_hash_table_lookup(usage->totals[class], key);
+        if (totals == NULL
+            || !((limit->size != 0 && totals->size > (unsigned long long)limit->size * (1024 * 1024))
+                 || (limit->count != 0 && totals->count > limit->count)))
+            continue;
+
+        for (GList *iter = usage->problems; iter != NULL; iter = g_list_next(iter))
+        {
+            const struct quota_problem *problem = iter->data;
+            if (problem == new_problem || problem->keys[class] == NULL || strcmp(problem->keys[class], key) != 0
+                || (busy != NULL && strcmp(problem->basename, busy) == 0))
+                continue;
+
+            log("%s %s has %u problems of %lluB, over quota", quota_class_names[class], key, totals->count, totals->size);
+            return xstrdup(problem->basename);
+        }
+    }
+
+    return NULL;
+}
+
+void quota_usage_remove(struct abrt_quota_usage *usage, const char *basename)
+{
+    GList *item = find_quota_problem(usage, basename);
+    if (item == NULL)
+        return;
+
+    account_quota_problem(usage, item->data, -1);
+    quota_problem_free(item->data);
+    usage->problems = g_list_delete_link(usage->problems, item);
+}
+
+int quota_usage_save(struct abrt_quota_usage *usage)
+{
+    const time_t since = time(NULL) - QUOTA_RATE_PERIOD;
+
+    GString *contents = g_string_new(NULL);
+    for (int class = 0; class < ABRT_QUOTA_CLASS_COUNT; ++class)
+    {
+        GHashTableIter iter;
+        const char *key;
+        struct quota_totals *totals;
+        g_hash_table_iter_init(&iter, usage->totals[class]);
+        while (g_hash_table_iter_next(&iter, (gpointer *)&key, (gpointer *)&totals))
+        {
+            unsigned expired = 0;
+            while (expired < totals->admissions->len && g_array_index(totals->admissions, time_t, expired) < since)
+                ++expired;
+            g_array_remove_range(totals->admissions, 0, expired);
+
+            if (totals->count == 0 && totals->admissions->len == 0)
+            {
+                g_hash_table_iter_remove(&iter);
+                continue;
+            }
+
+            if (!quota_class_enabled(class))
+                continue;
+
+            g_string_append_printf(contents, "%s %s %llu %u ", quota_class_names[class], key, totals->size, totals->count);
+            for (unsigned i = 0; i < totals->admissions->len; ++i)
+                g_string_append_printf(contents, "%s%lld", i ? "," : "", (long long)g_array_index(totals->admissions, time_t, i));
+            g_string_append(contents, totals->admissions->len ? "\n" : "-\n");
+        }
+    }
+
+    int r = -1;
+    const char *const usage_file = quota_usage_file();
+    char *tmp_path = xasprintf("%s.%lu", usage_file, (unsigned long)getpid());
+    const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+        perror_msg("Can't create '%s'", tmp_path);
+    else
+    {
+        const bool written = full_write(fd, contents->str, contents->len) >= 0;
+        close(fd);
+
+        if (written && rename(tmp_path, usage_file) == 0)
+            r = 0;
+        else
+        {
+            perror_msg("Can't save '%s'", usage_file);
+            unlink(tmp_path);
+        }
+    }
+
+    free(tmp_path);
+    g_string_free(contents, TRUE);
+    return r;
+}
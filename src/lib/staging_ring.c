@@ -0,0 +1,349 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+#include "libabrt.h"
+
+/*
+ * The ring is a directory of ordinary problem directories. The hook creates
+ * them with the '.new' suffix and renames them when they are complete, the
+ * same way it does in the dump location. The number of crashes removed to
+ * make room for newer ones is kept in the file 'dropped'. Changes of the
+ * ring are serialized by flock() on the file '.lock'.
+ */
+#define STAGING_RING_LOCK    ".lock"
+#define STAGING_RING_DROPPED "dropped"
+/* Incomplete crashes older than this were left by a killed hook */
+#define STAGING_RING_STALE_SECONDS (10 * 60)
+
+struct staged_crash
+{
+    char *name;
+    struct timespec mtime;
+    bool complete;
+};
+
+static void staged_crash_free(struct staged_crash *crash)
+{
+    free(crash->name);
+    free(crash);
+}
+
+static gint compare_staged_crashes(gconstpointer a, gconstpointer b)
+{
+    const struct staged_crash *ca = a;
+    const struct staged_crash *cb = b;
+    if (ca->mtime.tv_sec != cb->mtime.tv_sec)
+        return ca->mtime.tv_sec < cb->mtime.tv_sec ? -1 : 1;
+    if (ca->mtime.tv_nsec != cb->mtime.tv_nsec)
+        return ca->mtime.tv_nsec < cb->mtime.tv_nsec ? -1 : 1;
+    return strcmp(ca->name, cb->name);
+}
+
+/* Returns the staged crashes sorted from the oldest one */
+static GList *list_staged_crashes(int ring_fd)
+{
+    DIR *dir = fdopendir(dup(ring_fd));
+    if (dir == NULL)
+    {
+        perror_msg("Can't read the staging ring");
+        return NULL;
+    }
+
+    GList *crashes = NULL;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dent->d_name[0] == '.')
+            continue; /* ".", ".." and the lock */
+
+        struct stat st;
+        if (fstatat(ring_fd, dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode))
+            continue;
+
+        struct staged_crash *crash = xzalloc(sizeof(*crash));
+        crash->name = xstrdup(dent->d_name);
+        crash->mtime = st.st_mtim;
+        const char *ext = strrchr(dent->d_name, '.');
+        crash->complete = (ext == NULL || strcmp(ext, ".new") != 0);
+        crashes = g_list_prepend(crashes, crash);
+    }
+    closedir(dir);
+
+    return g_list_sort(crashes, compare_staged_crashes);
+}
+
+/* Removes all files in a flat directory and the directory itself */
+static void remove_flat_dir(int dir_fd, const char *name)
+{
+    const int fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    DIR *dir = fd < 0 ? NULL : fdopendir(fd);
+    if (dir != NULL)
+    {
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+            if (!dot_or_dotdot(dent->d_name))
+                unlinkat(dirfd(dir), dent->d_name, 0);
+        closedir(dir);
+    }
+    else if (fd >= 0)
+        close(fd);
+
+    if (unlinkat(dir_fd, name, AT_REMOVEDIR) != 0 && errno != ENOENT)
+        perror_msg("Can't remove '%s'", name);
+}
+
+/* Copies the files of the flat directory 'name' and gives them the owner
+ * and mode of the originals */
+static int copy_staged_files(int ring_fd, const char *name, int dst_fd)
+{
+    const int fd = openat(ring_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    DIR *dir = fd < 0 ? NULL : fdopendir(fd);
+    if (dir == NULL)
+    {
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    int r = 0;
+    struct dirent *dent;
+    while (r == 0 && (dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        const int src = openat(dirfd(dir), dent->d_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        struct stat st;
+        if (src < 0 || fstat(src, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            /* The hook saves only regular files */
+            if (src >= 0)
+                close(src);
+            continue;
+        }
+
+        const int dst = openat(dst_fd, dent->d_name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (dst < 0
+         || copyfd_eof(src, dst, COPYFD_SPARSE) < 0
+         || fchown(dst, st.st_uid, st.st_gid) != 0
+         || fchmod(dst, st.st_mode & 07777) != 0
+         || fsync(dst) != 0)
+        {
+            perror_msg("Can't copy '%s/%s'", name, dent->d_name);
+            r = -1;
+        }
+        if (dst >= 0)
+            close(dst);
+        close(src);
+    }
+    closedir(dir);
+    return r;
+}
+
+/*
+ * rename() can't move a staged crash to another file system. The copy is
+ * created as 'NAME.new' in the dump location, accessible only by root until
+ * it gets the owner and mode of the staged crash, and renamed when it is
+ * complete, the same way dd_create_skeleton() and dd_reset_ownership() make
+ * a problem visible only when it is finished.
+ */
+static int copy_staged_crash(int ring_fd, const char *name, const char *dump_location)
+{
+    struct stat st;
+    if (fstatat(ring_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode))
+        return -1;
+
+    const int dump_fd = open(dump_location, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (dump_fd < 0)
+        return -1;
+
+    char *tmp_name = xasprintf("%s.new", name);
+    /* Left by an interrupted import */
+    remove_flat_dir(dump_fd, tmp_name);
+
+    int r = -1;
+    const int tmp_fd = mkdirat(dump_fd, tmp_name, 0700) != 0 ? -1
+                     : openat(dump_fd, tmp_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (tmp_fd >= 0)
+    {
+        if (copy_staged_files(ring_fd, name, tmp_fd) == 0
+         && fchown(tmp_fd, st.st_uid, st.st_gid) == 0
+         && fchmod(tmp_fd, st.st_mode & 07777) == 0
+         && renameat(dump_fd, tmp_name, dump_fd, name) == 0)
+            r = 0;
+        close(tmp_fd);
+    }
+    if (r != 0)
+    {
+        const int err = errno;
+        remove_flat_dir(dump_fd, tmp_name);
+        errno = err;
+    }
+
+    free(tmp_name);
+    close(dump_fd);
+    return r;
+}
+
+static unsigned load_dropped(int ring_fd)
+{
+    const int fd = openat(ring_fd, STAGING_RING_DROPPED, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    char *text = xmalloc_read(fd, /*maxsz:*/ NULL);
+    close(fd);
+
+    const unsigned dropped = text ? strtoul(text, NULL, 10) : 0;
+    free(text);
+    return dropped;
+}
+
+static void save_dropped(int ring_fd, unsigned dropped)
+{
+    const int fd = openat(ring_fd, STAGING_RING_DROPPED,
+                          O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't save the number of dropped crashes");
+        return;
+    }
+
+    char buf[sizeof(unsigned) * 3 + 2];
+    sprintf(buf, "%u\n", dropped);
+    if (full_write_str(fd, buf) < 0)
+        perror_msg("Can't save the number of dropped crashes");
+    close(fd);
+}
+
+/* Opens and locks the ring, returns -1 on errors */
+static int lock_ring(const char *ring_dir, int *lock_fd)
+{
+    const int ring_fd = open(ring_dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (ring_fd < 0)
+    {
+        if (errno != ENOENT)
+            perror_msg("Can't open staging ring '%s'", ring_dir);
+        return -1;
+    }
+
+    *lock_fd = openat(ring_fd, STAGING_RING_LOCK, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (*lock_fd < 0 || flock(*lock_fd, LOCK_EX) != 0)
+    {
+        perror_msg("Can't lock staging ring '%s'", ring_dir);
+        if (*lock_fd >= 0)
+            close(*lock_fd);
+        close(ring_fd);
+        return -1;
+    }
+
+    return ring_fd;
+}
+
+static void unlock_ring(int ring_fd, int lock_fd)
+{
+    close(lock_fd);
+    close(ring_fd);
+}
+
+unsigned staging_ring_reserve(const char *ring_dir, unsigned slots)
+{
+    int lock_fd;
+    const int ring_fd = lock_ring(ring_dir, &lock_fd);
+    if (ring_fd < 0)
+        return 0;
+
+    GList *crashes = list_staged_crashes(ring_fd);
+    unsigned count = g_list_length(crashes);
+    unsigned removed = 0;
+
+    /* Crashes being saved by other hooks stay */
+    for (GList *iter = crashes; iter != NULL && count >= slots; iter = g_list_next(iter))
+    {
+        const struct staged_crash *crash = iter->data;
+        if (!crash->complete)
+            continue;
+
+        log_warning("Staging ring is full, dropping '%s'", crash->name);
+        remove_flat_dir(ring_fd, crash->name);
+        --count;
+        ++removed;
+    }
+
+    if (removed != 0)
+        save_dropped(ring_fd, load_dropped(ring_fd) + removed);
+
+    g_list_free_full(crashes, (GDestroyNotify)staged_crash_free);
+    unlock_ring(ring_fd, lock_fd);
+    return removed;
+}
+
+unsigned staging_ring_import(const char *ring_dir, const char *dump_location, GList **imported)
+{
+    int lock_fd;
+    const int ring_fd = lock_ring(ring_dir, &lock_fd);
+    if (ring_fd < 0)
+        return 0;
+
+    unsigned dropped = load_dropped(ring_fd);
+    GList *crashes = list_staged_crashes(ring_fd);
+    const time_t now = time(NULL);
+
+    for (GList *iter = crashes; iter != NULL; iter = g_list_next(iter))
+    {
+        const struct staged_crash *crash = iter->data;
+        if (!crash->complete)
+        {
+            /* A hook may be still saving it, it will be imported next time */
+            if (now - crash->mtime.tv_sec < STAGING_RING_STALE_SECONDS)
+                continue;
+
+            log_warning("Removing incomplete staged crash '%s'", crash->name);
+            remove_flat_dir(ring_fd, crash->name);
+            ++dropped;
+            continue;
+        }
+
+        char *staged = concat_path_file(ring_dir, crash->name);
+        char *problem_dir = concat_path_file(dump_location, crash->name);
+        if (rename(staged, problem_dir) != 0)
+        {
+            if (errno != EXDEV || copy_staged_crash(ring_fd, crash->name, dump_location) != 0)
+            {
+                perror_msg("Can't move '%s' to '%s'", staged, problem_dir);
+                free(problem_dir);
+                problem_dir = NULL;
+                ++dropped;
+            }
+            remove_flat_dir(ring_fd, crash->name);
+        }
+
+        if (problem_dir != NULL)
+        {
+            log_notice("Imported staged crash '%s'", problem_dir);
+            *imported = g_list_append(*imported, problem_dir);
+        }
+        free(staged);
+    }
+
+    unlinkat(ring_fd, STAGING_RING_DROPPED, 0);
+
+    g_list_free_full(crashes, (GDestroyNotify)staged_crash_free);
+    unlock_ring(ring_fd, lock_fd);
+    return dropped;
+}
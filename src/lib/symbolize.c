@@ -0,0 +1,71 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/un.h>
+#include "libabrt.h"
+
+char *symbolize_core_backtrace(const char *core_backtrace, unsigned timeout_sec)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror_msg("socket(AF_UNIX)");
+        return NULL;
+    }
+
+    struct sockaddr_un sunx;
+    memset(&sunx, 0, sizeof(sunx));
+    sunx.sun_family = AF_UNIX;
+    strcpy(sunx.sun_path, SYMBOLIZER_SOCKET_FILE);
+
+    if (connect(fd, (struct sockaddr *)&sunx, sizeof(sunx)))
+    {
+        /* The service is optional */
+        log_notice("Can't connect to '%s': %s", sunx.sun_path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    /* Loading of a large debuginfo can take a while but do not wait forever */
+    struct timeval timeout = { .tv_sec = timeout_sec };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char *response = NULL;
+    if (full_write_str(fd, core_backtrace) < 0)
+    {
+        perror_msg("Can't send the core backtrace to abrt-symbolizer");
+        goto finito;
+    }
+
+    shutdown(fd, SHUT_WR);
+
+    response = xmalloc_read(fd, NULL);
+    if (response == NULL)
+        log_notice("abrt-symbolizer response could not be received");
+    else if (response[0] == '\0')
+    {
+        /* The service closes the connection without a response on errors */
+        log_notice("abrt-symbolizer could not symbolize the core backtrace");
+        free(response);
+        response = NULL;
+    }
+
+ finito:
+    close(fd);
+    return response;
+}
@@ -0,0 +1,108 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+
+/*
+ * The writer keeps at most two windows of dirty or cached pages: the window
+ * being written and the window before it whose writeback was started. When
+ * the writer completes a window, the function only starts its writeback
+ * (SYNC_FILE_RANGE_WRITE), then waits for the writeback of the previous one
+ * (WAIT_BEFORE | WRITE | WAIT_AFTER) and drops its pages, so the kernel
+ * writes in the background and the page cache doesn't grow with the size of
+ * the file.
+ */
+
+void write_behind_init_window(struct abrt_write_behind *wb, int fd, off_t window)
+{
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0)
+        offset = 0;
+
+    wb->fd = fd;
+    wb->window = window;
+    wb->flushing = wb->unflushed = wb->written = offset;
+    wb->max_cached = 0;
+}
+
+void write_behind_init(struct abrt_write_behind *wb, int fd)
+{
+    write_behind_init_window(wb, fd, ABRT_WRITE_BEHIND_WINDOW);
+}
+
+static void flush_and_drop(struct abrt_write_behind *wb, off_t offset, off_t length)
+{
+    if (length == 0)
+        return;
+
+    if (sync_file_range(wb->fd, offset, length,
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0)
+        log_debug("sync_file_range(%d): %s", wb->fd, strerror(errno));
+
+    /* The kernel drops only whole pages of the range. The page shared with
+     * the window before was written with it. */
+    const off_t start = offset - offset % sysconf(_SC_PAGESIZE);
+    posix_fadvise(wb->fd, start, offset + length - start, POSIX_FADV_DONTNEED);
+}
+
+void write_behind_wrote(struct abrt_write_behind *wb, off_t size)
+{
+    wb->written += size;
+    if (wb->written - wb->flushing > wb->max_cached)
+        wb->max_cached = wb->written - wb->flushing;
+    if (wb->written - wb->unflushed < wb->window)
+        return;
+
+    /* Start the writeback of the window, don't wait */
+    if (sync_file_range(wb->fd, wb->unflushed, wb->written - wb->unflushed, SYNC_FILE_RANGE_WRITE) != 0)
+        log_debug("sync_file_range(%d): %s", wb->fd, strerror(errno));
+
+    flush_and_drop(wb, wb->flushing, wb->unflushed - wb->flushing);
+
+    wb->flushing = wb->unflushed;
+    wb->unflushed = wb->written;
+}
+
+void write_behind_finish(struct abrt_write_behind *wb)
+{
+    flush_and_drop(wb, wb->flushing, wb->written - wb->flushing);
+    wb->flushing = wb->unflushed = wb->written;
+
+    log_debug("Written up to offset %lld, at most %lld bytes were in the page cache",
+              (long long)wb->written, (long long)wb->max_cached);
+}
+
+void advise_read_once(int fd)
+{
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_NOREUSE);
+}
+
+void drop_page_cache(int fd)
+{
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+void drop_file_page_cache(const char *path)
+{
+    const int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    drop_page_cache(fd);
+    close(fd);
+}
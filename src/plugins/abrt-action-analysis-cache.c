@@ -0,0 +1,215 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/unwind.h>
+#include "libabrt.h"
+
+#define EXIT_MISS 1
+
+static void print_stats(const char *cache_dir)
+{
+    struct analysis_cache_stats stats;
+    const int r = analysis_cache_get_stats(cache_dir, &stats);
+    if (r != 0)
+        error_msg_and_die(_("Can't read the analysis cache '%s': %s"), cache_dir, strerror(-r));
+
+    const unsigned long long lookups = stats.hits + stats.misses;
+    printf(_("Location:  %s\n"), cache_dir);
+    printf(_("Entries:   %llu\n"), stats.entries);
+    printf(_("Size:      %llu KiB\n"), stats.size / 1024);
+    printf(_("Hits:      %llu\n"), stats.hits);
+    printf(_("Misses:    %llu\n"), stats.misses);
+    printf(_("Hit rate:  %.1f %%\n"), lookups ? 100.0 * stats.hits / lookups : 0.0);
+    printf(_("Stores:    %llu\n"), stats.stores);
+    printf(_("Evictions: %llu\n"), stats.evictions);
+}
+
+/* Converts GList of strings to a NULL terminated array, the strings are not
+ * copied */
+static const char **list_to_array(GList *list)
+{
+    const char **array = xzalloc((g_list_length(list) + 1) * sizeof(*array));
+    const char **p = array;
+    for (; list != NULL; list = g_list_next(list))
+        *p++ = list->data;
+    return array;
+}
+
+/* The key is derived from the core dump the analyzers read, not from
+ * 'core_backtrace' and 'build_ids' which abrt-server accepts from clients and
+ * which the owner of the problem can change */
+static char *problem_cache_key(struct dump_dir *dd, const char *analyzer_id)
+{
+    char *executable = dd_load_text_ext(dd, FILENAME_EXECUTABLE,
+                                        DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    char *coredump = concat_path_file(dd->dd_dirname, FILENAME_COREDUMP);
+
+    char *key = NULL;
+    if (executable != NULL && dd_exist(dd, FILENAME_COREDUMP))
+    {
+        char *error_message = NULL;
+        struct sr_core_stacktrace *stacktrace = sr_parse_coredump(coredump, executable, &error_message);
+        if (stacktrace == NULL)
+        {
+            log_notice("Can't unwind '%s': %s", coredump, error_message);
+            free(error_message);
+        }
+        else
+        {
+            char *core_backtrace = sr_core_stacktrace_to_json(stacktrace);
+            sr_core_stacktrace_free(stacktrace);
+            key = analysis_cache_key(analyzer_id, /*build_ids*/NULL, core_backtrace);
+            free(core_backtrace);
+        }
+    }
+
+    free(coredump);
+    free(executable);
+    return key;
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+    const char *analyzer = NULL;
+    GList *elements = NULL;
+    GList *host_specific = NULL;
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-d DIR] -a ANALYZER --lookup\n"
+        "or:\n"
+        "& [-v] [-d DIR] -a ANALYZER --store [-e ELEMENT]... [-H ELEMENT]...\n"
+        "or:\n"
+        "& --stats\n"
+        "\n"
+        "Restores results of ANALYZER of the same crash from the analysis cache\n"
+        "or stores them there. --lookup exits with 0 if the results were restored.\n"
+        "The cache is configured by AnalysisCacheLocation in abrt.conf"
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_a = 1 << 2,
+        OPT_l = 1 << 3,
+        OPT_s = 1 << 4,
+        OPT_e = 1 << 5,
+        OPT_H = 1 << 6,
+        OPT_S = 1 << 7,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_STRING('a', "analyzer", &analyzer, "ANALYZER", _("Name and version of the analyzer")),
+        OPT_BOOL(  'l', "lookup", NULL, _("Restore cached results")),
+        OPT_BOOL(  's', "store", NULL, _("Store results")),
+        OPT_LIST(  'e', NULL, &elements, "ELEMENT", _("Element created by the analyzer")),
+        OPT_LIST(  'H', NULL, &host_specific, "ELEMENT", _("gdb backtrace created by the analyzer, "
+                                                           "stored without data of the crashed process")),
+        OPT_BOOL(  'S', "stats", NULL, _("Print statistics of the cache")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    const unsigned modes = opts & (OPT_l | OPT_s | OPT_S);
+    if (modes == 0 || (modes & (modes - 1)) != 0 || (!(opts & OPT_S) && analyzer == NULL))
+        show_usage_and_die(program_usage_string, program_options);
+
+    export_abrt_envvars(0);
+
+    load_abrt_conf();
+    const char *cache_dir = g_settings_analysis_cache_location;
+    int retval = (opts & OPT_l) ? EXIT_MISS : 0;
+
+    if (cache_dir == NULL)
+    {
+        log_info("Analysis cache is not configured");
+        goto finito;
+    }
+
+    if (opts & OPT_S)
+    {
+        print_stats(cache_dir);
+        goto finito;
+    }
+
+    /* The cache is shared by problems of all users, results of other users'
+     * analyses must not be stored in it */
+    if (geteuid() != 0)
+    {
+        log_info("Not running as root, not using the analysis cache");
+        goto finito;
+    }
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+    if (!dd)
+    {
+        retval = 1;
+        goto finito;
+    }
+
+    /* Results of a different version of ABRT may differ */
+    char *analyzer_id = xasprintf("%s %s", analyzer, VERSION);
+
+    char *key = NULL;
+    /* All elements of uploaded problems come from the other host */
+    if (dd_exist(dd, FILENAME_REMOTE))
+        log_info("The problem was uploaded, not using the analysis cache");
+    else if ((key = problem_cache_key(dd, analyzer_id)) == NULL)
+        log_info("The problem has no usable core dump, not using the analysis cache");
+    else if (opts & OPT_l)
+    {
+        if (analysis_cache_lookup(cache_dir, key, dd) > 0)
+            retval = 0;
+    }
+    else
+    {
+        /* Host specific elements are cached too */
+        elements = g_list_concat(g_list_copy(host_specific), elements);
+
+        const char **element_array = list_to_array(elements);
+        const char **host_array = list_to_array(host_specific);
+
+        /* Failures of the cache must not break the analysis */
+        analysis_cache_store(cache_dir, key, dd, element_array, host_array,
+                             (unsigned long long)g_settings_analysis_cache_max_size * 1024 * 1024);
+
+        free(host_array);
+        free(element_array);
+    }
+
+    free(key);
+    free(analyzer_id);
+    dd_close(dd);
+
+ finito:
+    free_abrt_conf_data();
+    g_list_free(host_specific);
+    g_list_free(elements);
+    return retval;
+}
@@ -137,6 +137,33 @@ static char *build_ids_from_core_backtrace(const char *dump_dir_name)
     return strbuf_free_nobuf(strbuf);
 }
 
+/* Create crash_function element from core_backtrace */
+static void save_crash_function(struct dump_dir *dd)
+{
+    char *core_backtrace_json = dd_load_text_ext(dd, FILENAME_CORE_BACKTRACE,
+                                                 DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    if (!core_backtrace_json)
+        return;
+
+    struct sr_core_stacktrace *stacktrace = core_stacktrace_from_core_json(core_backtrace_json);
+    free(core_backtrace_json);
+
+    if (!stacktrace)
+        return;
+
+    struct sr_core_thread *thread = core_thread_from_core_stacktrace(stacktrace);
+    if (thread)
+    {
+        sr_normalize_core_thread(thread);
+
+        struct sr_core_frame *frame = thread->frames;
+        if (frame->function_name)
+            dd_save_text(dd, FILENAME_CRASH_FUNCTION, frame->function_name);
+    }
+
+    sr_core_stacktrace_free(stacktrace);
+}
+
 int main(int argc, char **argv)
 {
     /* I18n */
@@ -149,27 +176,46 @@ int main(int argc, char **argv)
     abrt_init(argv);
 
     const char *dump_dir_name = ".";
+    int keep_uuid = 0; /* must be _int_, OPT_BOOL expects that! */
 
     /* Can't keep these strings/structs static: _() doesn't support that */
     const char *program_usage_string = _(
-        "& [-v] -d DIR\n"
+        "& [-v] [-k] -d DIR\n"
         "\n"
         "Calculates and saves UUID of coredump in problem directory DIR"
     );
     enum {
         OPT_v = 1 << 0,
         OPT_d = 1 << 1,
+        OPT_k = 1 << 2,
     };
     /* Keep enum above and order of options below in sync! */
     struct options program_options[] = {
         OPT__VERBOSE(&g_verbose),
         OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_BOOL(  'k', "keep-uuid", &keep_uuid, _("Keep the existing UUID and crash_function")),
         OPT_END()
     };
     /*unsigned opts =*/ parse_opts(argc, argv, program_options, program_usage_string);
 
     export_abrt_envvars(0);
 
+    if (keep_uuid)
+    {
+        /* abrtd has already looked for duplicates using these elements */
+        struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+        if (!dd)
+            return 1;
+
+        const bool has_uuid = dd_exist(dd, FILENAME_UUID);
+        if (has_uuid && !dd_exist(dd, FILENAME_CRASH_FUNCTION))
+            save_crash_function(dd);
+
+        dd_close(dd);
+        if (has_uuid)
+            return 0;
+    }
+
     char *unstrip_n_output = NULL;
     char *coredump_path = xasprintf("%s/"FILENAME_COREDUMP, dump_dir_name);
     if (access(coredump_path, R_OK) == 0)
@@ -240,32 +286,7 @@ int main(int argc, char **argv)
 
     dd_save_text(dd, FILENAME_UUID, hash_str);
 
-    /* Create crash_function element from core_backtrace */
-    char *core_backtrace_json = dd_load_text_ext(dd, FILENAME_CORE_BACKTRACE,
-                                                 DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
-    if (core_backtrace_json)
-    {
-        struct sr_core_stacktrace *stacktrace = core_stacktrace_from_core_json(core_backtrace_json);
-        free(core_backtrace_json);
-
-        if (!stacktrace)
-            goto next;
-
-        struct sr_core_thread *thread = core_thread_from_core_stacktrace(stacktrace);
-
-        if (!thread)
-            goto next;
-
-        sr_normalize_core_thread(thread);
-
-        struct sr_core_frame *frame = thread->frames;
-        if (frame->function_name)
-            dd_save_text(dd, FILENAME_CRASH_FUNCTION, frame->function_name);
-
-next:
-        /* can be NULL */
-        sr_core_stacktrace_free(stacktrace);
-    }
+    save_crash_function(dd);
 
     dd_close(dd);
 
@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] -d DIR\n"
+        "\n"
+        "Saves hash of the shared library function the crash occurred in as\n"
+        FILENAME_CLUSTER_HASH" and the leader of the cluster of problems with the\n"
+        "same hash as "FILENAME_CLUSTER_LEADER
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_END()
+    };
+    /*unsigned opts =*/ parse_opts(argc, argv, program_options, program_usage_string);
+
+    export_abrt_envvars(0);
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+    if (!dd)
+        return 1;
+
+    char *core_backtrace = dd_load_text_ext(dd, FILENAME_CORE_BACKTRACE, DD_FAIL_QUIETLY_ENOENT);
+    char *executable = dd_load_text_ext(dd, FILENAME_EXECUTABLE, DD_FAIL_QUIETLY_ENOENT);
+    char *module = NULL;
+    char *leader = NULL;
+
+    char *hash = NULL;
+    if (core_backtrace != NULL && core_backtrace[0] != '\0')
+        hash = crash_cluster_hash(core_backtrace, executable, &module);
+
+    if (hash == NULL)
+    {
+        /* The problem is not a member of any cluster */
+        log_notice("Not clustering the problem");
+        dd_delete_item(dd, FILENAME_CLUSTER_HASH);
+        dd_delete_item(dd, FILENAME_CLUSTER_MODULE);
+        dd_delete_item(dd, FILENAME_CLUSTER_LEADER);
+        goto finito;
+    }
+
+    dd_save_text(dd, FILENAME_CLUSTER_HASH, hash);
+    dd_save_text(dd, FILENAME_CLUSTER_MODULE, module);
+
+    if (crash_cluster_register(hash, dd->dd_dirname, &leader) != 0)
+        goto finito;
+
+    if (strcmp(leader, dd->dd_dirname) == 0)
+    {
+        log_notice("The problem is the first of cluster %s", hash);
+        dd_delete_item(dd, FILENAME_CLUSTER_LEADER);
+    }
+    else
+    {
+        log_notice("The problem belongs to the cluster of '%s'", leader);
+        dd_save_text(dd, FILENAME_CLUSTER_LEADER, leader);
+    }
+
+ finito:
+    free(leader);
+    free(hash);
+    free(module);
+    free(executable);
+    free(core_backtrace);
+    dd_close(dd);
+    return 0;
+}
@@ -24,6 +24,17 @@
 #include <satyr/python/frame.h>
 #include <satyr/frame.h>
 
+/* Converts GList of strings to a NULL terminated array, the strings are not
+ * copied */
+static const char **list_to_array(GList *list)
+{
+    const char **array = xzalloc((g_list_length(list) + 1) * sizeof(*array));
+    const char **p = array;
+    for (; list != NULL; list = g_list_next(list))
+        *p++ = list->data;
+    return array;
+}
+
 int main(int argc, char **argv)
 {
     /* I18n */
@@ -62,10 +73,49 @@ int main(int argc, char **argv)
         return 1;
     char *bt = dd_load_text(dd, FILENAME_BACKTRACE);
 
+    char *type = dd_load_text(dd, FILENAME_TYPE);
+    const char *conf_file = strcmp(type, "Python3") == 0 ? "python3.conf" : "python.conf";
+    free(type);
+
+    map_string_t *settings = new_map_string();
+    log_notice("Loading settings from '%s'", conf_file);
+    load_abrt_plugin_conf_file(conf_file, settings);
+
+    int legacy_hash = 0;
+    try_get_map_string_item_as_bool(settings, "DuphashLegacy", &legacy_hash);
+    int include_message = 0;
+    try_get_map_string_item_as_bool(settings, "DuphashIncludeMessage", &include_message);
+
+    GList *message_mask_list = NULL;
+    const char **message_masks = NULL;
+    if (include_message)
+    {
+        const char *value = get_map_string_item_or_NULL(settings, "DuphashMessageMasks");
+        if (value)
+        {
+            message_mask_list = python_duphash_parse_masks(value);
+            message_masks = list_to_array(message_mask_list);
+        }
+    }
+
     /* save crash_function and exception_name into dumpdir */
     char *error_message = NULL;
     struct sr_stacktrace *stacktrace = sr_stacktrace_parse(SR_REPORT_PYTHON,
                                                            (const char *)bt, &error_message);
+
+    /* Hash 1st line of backtrace the way older versions did, it is kept for
+     * finding duplicates among the problems created by them */
+    /* "example.py:1:<module>:ZeroDivisionError: integer division or modulo by zero" */
+    char legacy_hash_str[SHA1_RESULT_LEN*2 + 1];
+    python_legacy_duphash_str(legacy_hash_str, bt);
+    const char *hash_str = legacy_hash_str;
+
+    /* The exception message often contains ids, paths or addresses, so hash
+     * the frames unless asked otherwise */
+    char frame_hash_str[SHA1_RESULT_LEN*2 + 1];
+    if (!legacy_hash && python_duphash_str(frame_hash_str, bt, include_message, message_masks) == 0)
+        hash_str = frame_hash_str;
+
     if (stacktrace)
     {
         struct sr_python_stacktrace *python_stacktrace = (struct sr_python_stacktrace *)stacktrace;
@@ -86,19 +136,17 @@ int main(int argc, char **argv)
         free(error_message);
     }
 
-    /* Hash 1st line of backtrace and save it as UUID and DUPHASH */
-    /* "example.py:1:<module>:ZeroDivisionError: integer division or modulo by zero" */
-
-    char *bt_end = strchrnul(bt, '\n');
-    *bt_end = '\0';
-    char hash_str[SHA1_RESULT_LEN*2 + 1];
-    str_to_sha1str(hash_str, bt);
-
     free(bt);
 
     dd_save_text(dd, FILENAME_UUID, hash_str);
     dd_save_text(dd, FILENAME_DUPHASH, hash_str);
+    if (hash_str != legacy_hash_str)
+        dd_save_text(dd, FILENAME_LEGACY_DUPHASH, legacy_hash_str);
     dd_close(dd);
 
+    free(message_masks);
+    list_free_with_free(message_mask_list);
+    free_map_string(settings);
+
     return 0;
 }
@@ -0,0 +1,113 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+
+#define FILENAME_COREDUMP_RESTORED FILENAME_COREDUMP".restored"
+
+static int restore_coredump(struct dump_dir *dd)
+{
+    if (dd_exist(dd, FILENAME_COREDUMP))
+    {
+        log_info("'%s' already exists", FILENAME_COREDUMP);
+        return 0;
+    }
+
+    /* Analyzers must never see a partial core */
+    const int core_fd = dd_open_item(dd, FILENAME_COREDUMP_RESTORED, O_RDWR);
+    if (core_fd < 0)
+    {
+        perror_msg("Can't create '%s' in '%s'", FILENAME_COREDUMP_RESTORED, dd->dd_dirname);
+        return 1;
+    }
+
+    int r = delta_core_restore(dd->dd_dirname, core_fd);
+    if (close(core_fd) != 0 && r == 0)
+    {
+        perror_msg("Can't write '%s'", FILENAME_COREDUMP_RESTORED);
+        r = -1;
+    }
+
+    char *restored = concat_path_file(dd->dd_dirname, FILENAME_COREDUMP_RESTORED);
+    char *coredump = concat_path_file(dd->dd_dirname, FILENAME_COREDUMP);
+    if (r == 0 && rename(restored, coredump) != 0)
+    {
+        perror_msg("Can't rename '%s' to '%s'", restored, coredump);
+        r = -1;
+    }
+    if (r != 0)
+        unlink(restored);
+    else
+        log_info("Restored '%s' from '%s'", coredump, FILENAME_COREDUMP_DELTA);
+
+    free(coredump);
+    free(restored);
+    return r == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-d DIR] [--drop]\n"
+        "\n"
+        "Restores the full coredump of a problem saved as a delta against\n"
+        "a reference core. With --drop removes the restored coredump again."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_D = 1 << 2,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_BOOL(  'D', "drop", NULL, _("Remove the restored coredump")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    export_abrt_envvars(0);
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+    if (!dd)
+        return 1;
+
+    int retval = 0;
+    if (!dd_exist(dd, FILENAME_COREDUMP_DELTA) || !dd_exist(dd, FILENAME_COREDUMP_REFERENCE))
+        log_info("The problem has no delta core");
+    else if (opts & OPT_D)
+        /* The delta is enough to restore it again */
+        dd_delete_item(dd, FILENAME_COREDUMP);
+    else
+        retval = restore_coredump(dd);
+
+    dd_close(dd);
+    return retval;
+}
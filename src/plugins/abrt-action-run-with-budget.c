@@ -0,0 +1,362 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/file.h>
+#include "libabrt.h"
+
+/* A line per step: NAME RUNS OVERRUNS SKIPS MAX_MS */
+#define STEP_STATS_FILE VAR_STATE"/step-budgets"
+
+/* Time given to the step to exit after SIGTERM */
+#define TERM_GRACE_MS 5000
+
+enum step_result
+{
+    STEP_FINISHED,
+    STEP_OVERRUN,
+    STEP_SKIPPED,
+};
+
+static long long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool is_valid_step_name(const char *name)
+{
+    if (name[0] == '\0')
+        return false;
+
+    for (const char *c = name; *c != '\0'; ++c)
+        if (!isalnum((unsigned char)*c) && *c != '_' && *c != '-' && *c != '.')
+            return false;
+
+    return true;
+}
+
+/* Returns milliseconds the step can run, 0 for unlimited and negative value
+ * if there is no time left */
+static long long step_limit_ms(unsigned budget)
+{
+    long long limit = budget * 1000LL;
+
+    const char *deadline_str = getenv(ABRT_POST_CREATE_DEADLINE_ENV);
+    if (deadline_str != NULL)
+    {
+        char *end;
+        errno = 0;
+        const long long deadline = strtoll(deadline_str, &end, 10);
+        if (errno || end == deadline_str || *end != '\0')
+            error_msg("Invalid %s: '%s'", ABRT_POST_CREATE_DEADLINE_ENV, deadline_str);
+        else
+        {
+            /* The remaining time of the post-create event */
+            const long long left = deadline * 1000 - monotonic_ms();
+            if (left <= 0)
+                return -1;
+            if (limit == 0 || left < limit)
+                limit = left;
+        }
+    }
+
+    return limit;
+}
+
+/* Waits for the child until the deadline (0 means none) or a termination
+ * signal. Returns true if the child exited. */
+static bool wait_child(pid_t pid, const sigset_t *signals, long long deadline_ms,
+                       int *status, int *term_signal)
+{
+    for (;;)
+    {
+        const pid_t r = waitpid(pid, status, WNOHANG);
+        if (r == pid)
+            return true;
+        if (r < 0 && errno != EINTR)
+        {
+            perror_msg("waitpid(%d)", (int)pid);
+            *status = W_EXITCODE(1, 0);
+            return true;
+        }
+
+        struct timespec timeout = { .tv_sec = 3600, .tv_nsec = 0 };
+        if (deadline_ms != 0)
+        {
+            const long long left = deadline_ms - monotonic_ms();
+            if (left <= 0)
+                return false;
+            timeout.tv_sec = left / 1000;
+            timeout.tv_nsec = (left % 1000) * 1000000;
+        }
+
+        const int sig = sigtimedwait(signals, NULL, &timeout);
+        if (sig == SIGTERM || sig == SIGINT)
+        {
+            *term_signal = sig;
+            return false;
+        }
+    }
+}
+
+/* Runs the step in its own process group, so all processes of the step can
+ * be killed. Returns exit status of the step or -1 if it was killed because
+ * it ran out of time. */
+static int run_step(char **argv, long long limit_ms, int *term_signal)
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+
+    sigset_t old_signals;
+    sigprocmask(SIG_BLOCK, &signals, &old_signals);
+    /* Ignored SIGCHLD would make the child reaped automatically */
+    signal(SIGCHLD, SIG_DFL);
+
+    const pid_t pid = fork();
+    if (pid < 0)
+        perror_msg_and_die("fork");
+
+    if (pid == 0)
+    {
+        sigprocmask(SIG_SETMASK, &old_signals, NULL);
+        setpgid(0, 0);
+        execvp(argv[0], argv);
+        perror_msg_and_die("Can't execute '%s'", argv[0]);
+    }
+
+    /* Both parent and child set the group to avoid races */
+    setpgid(pid, pid);
+
+    int status = 0;
+    const long long deadline_ms = limit_ms ? monotonic_ms() + limit_ms : 0;
+    if (wait_child(pid, &signals, deadline_ms, &status, term_signal))
+    {
+        sigprocmask(SIG_SETMASK, &old_signals, NULL);
+        return status;
+    }
+
+    log_info("Terminating '%s' (pid %d)", argv[0], (int)pid);
+    kill(-pid, SIGTERM);
+    if (!wait_child(pid, &signals, monotonic_ms() + TERM_GRACE_MS, &status, term_signal))
+    {
+        kill(-pid, SIGKILL);
+        safe_waitpid(pid, &status, 0);
+    }
+
+    sigprocmask(SIG_SETMASK, &old_signals, NULL);
+    return -1;
+}
+
+/* Remembers in the problem directory that the step did not finish, so the
+ * problem gets analysed in idle time */
+static void record_degraded_step(const char *dump_dir_name, const char *step,
+                                 enum step_result result, long long limit_ms)
+{
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+    if (dd == NULL)
+        return;
+
+    char *steps = dd_load_text_ext(dd, FILENAME_DEGRADED_STEPS,
+                                   DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    char *new_steps = xasprintf("%s%s %s %lld\n", steps ? steps : "", step,
+                                result == STEP_SKIPPED ? "skipped" : "overrun",
+                                limit_ms < 0 ? 0 : limit_ms / 1000);
+    dd_save_text(dd, FILENAME_DEGRADED_STEPS, new_steps);
+    free(new_steps);
+    free(steps);
+
+    dd_close(dd);
+}
+
+static void update_step_stats(const char *step, enum step_result result, long long elapsed_ms)
+{
+    const int fd = open(STEP_STATS_FILE, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        log_notice("Can't open '%s': %s", STEP_STATS_FILE, strerror(errno));
+        return;
+    }
+
+    if (flock(fd, LOCK_EX) != 0)
+    {
+        perror_msg("Can't lock '%s'", STEP_STATS_FILE);
+        close(fd);
+        return;
+    }
+
+    char *content = xmalloc_read(fd, NULL);
+    struct strbuf *rewritten = strbuf_new();
+    bool found = false;
+
+    char *saveptr = NULL;
+    for (char *line = content ? strtok_r(content, "\n", &saveptr) : NULL;
+         line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr))
+    {
+        char name[256];
+        unsigned long long runs, overruns, skips, max_ms;
+        if (sscanf(line, "%255s %llu %llu %llu %llu", name, &runs, &overruns, &skips, &max_ms) != 5)
+            continue;
+
+        if (strcmp(name, step) == 0)
+        {
+            found = true;
+            ++runs;
+            overruns += result == STEP_OVERRUN;
+            skips += result == STEP_SKIPPED;
+            if (elapsed_ms > max_ms)
+                max_ms = elapsed_ms;
+        }
+
+        strbuf_append_strf(rewritten, "%s %llu %llu %llu %llu\n", name, runs, overruns, skips, max_ms);
+    }
+
+    if (!found)
+        strbuf_append_strf(rewritten, "%s 1 %d %d %lld\n", step,
+                           result == STEP_OVERRUN, result == STEP_SKIPPED, elapsed_ms);
+
+    if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0
+        || full_write(fd, rewritten->buf, rewritten->len) != rewritten->len)
+        perror_msg("Can't write '%s'", STEP_STATS_FILE);
+
+    strbuf_free(rewritten);
+    free(content);
+    close(fd);
+}
+
+static int print_step_stats(void)
+{
+    char *content = xmalloc_open_read_close(STEP_STATS_FILE, NULL);
+    if (content == NULL)
+        return 1;
+
+    printf("%-24s %8s %8s %8s %10s\n", _("STEP"), _("RUNS"), _("OVERRUNS"), _("SKIPPED"), _("MAX [s]"));
+
+    char *saveptr = NULL;
+    for (char *line = strtok_r(content, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr))
+    {
+        char name[256];
+        unsigned long long runs, overruns, skips, max_ms;
+        if (sscanf(line, "%255s %llu %llu %llu %llu", name, &runs, &overruns, &skips, &max_ms) == 5)
+            printf("%-24s %8llu %8llu %8llu %10.1f\n", name, runs, overruns, skips, max_ms / 1000.0);
+    }
+
+    free(content);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+    const char *step = NULL;
+    int budget = 0;
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-d DIR] -n STEP [-b SEC] -- PROG [ARGS]...\n"
+        "or:\n"
+        "& --stats\n"
+        "\n"
+        "Runs PROG for at most SEC seconds and not after the deadline of the\n"
+        "post-create event. If PROG runs out of time, it is killed and the STEP\n"
+        "is recorded in "FILENAME_DEGRADED_STEPS", so the problem is analysed\n"
+        "again in idle time"
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_n = 1 << 2,
+        OPT_b = 1 << 3,
+        OPT_s = 1 << 4,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_STRING( 'd', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_STRING( 'n', "name", &step, "STEP", _("Name of the step")),
+        OPT_INTEGER('b', "budget", &budget, _("Seconds the step can run, 0 for no limit")),
+        OPT_BOOL(   's', "stats", NULL, _("Print statistics of steps")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+    argv += optind;
+
+    if (opts & OPT_s)
+        return print_step_stats();
+
+    if (step == NULL || !is_valid_step_name(step) || budget < 0 || argv[0] == NULL)
+        show_usage_and_die(program_usage_string, program_options);
+
+    export_abrt_envvars(0);
+
+    const long long limit_ms = step_limit_ms(budget);
+    const long long started_ms = monotonic_ms();
+
+    enum step_result result = STEP_FINISHED;
+    int term_signal = 0;
+    int status = 0;
+
+    if (limit_ms < 0)
+    {
+        log_warning("No time left for '%s', skipping it", step);
+        result = STEP_SKIPPED;
+    }
+    else
+    {
+        log_debug("Running '%s' for at most %lld ms", step, limit_ms);
+        status = run_step(argv, limit_ms, &term_signal);
+        if (status < 0 && term_signal == 0)
+        {
+            log_warning("'%s' ran out of its time budget (%lld s), killed", step, limit_ms / 1000);
+            result = STEP_OVERRUN;
+        }
+    }
+
+    if (term_signal != 0)
+    {
+        /* Terminated from outside, not a problem of the step */
+        log_notice("Terminated by signal %d", term_signal);
+        return 128 + term_signal;
+    }
+
+    update_step_stats(step, result, monotonic_ms() - started_ms);
+
+    if (result != STEP_FINISHED)
+    {
+        record_degraded_step(dump_dir_name, step, result, limit_ms);
+        /* A step cut short does not break the rest of the event */
+        return 0;
+    }
+
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2026  ABRT Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "libabrt.h"
+#include "abrt-journal.h"
+
+#define DEFAULT_OUTPUT_ELEMENT "var_log_messages"
+
+/* Kernel stores only first TASK_COMM_LEN - 1 characters of process names */
+#define JOURNAL_COMM_MAX_LEN 15
+
+/* The same as 'journalctl -n 99' in the former event scripts */
+#define DEFAULT_MAX_LINES 99
+
+/* The same as 'journalctl --since=-3m' */
+#define DEFAULT_WINDOW_SECONDS (3 * 60)
+
+/* A few long lines must not blow up the problem directory */
+#define DEFAULT_MAX_BYTES (64 * 1024)
+
+/*
+ * The user view contains log lines matching all requested fields, the
+ * system view ignores the _UID field and shows log lines of all users.
+ * Both views are filled in a single pass through the journal.
+ */
+struct excerpt_view
+{
+    const char *title;
+    GList *checks;  /* FIELD=VALUE matches checked for every entry */
+    unsigned max_lines;
+    size_t max_bytes;
+    size_t bytes;   /* of the lines including new line characters */
+    GQueue lines;
+};
+
+static void excerpt_view_add_line(struct excerpt_view *view, const char *line)
+{
+    /* A line longer than the whole view is cut */
+    char *copy = xstrndup(line, view->max_bytes - 1);
+    view->bytes += strlen(copy) + 1;
+    g_queue_push_tail(&view->lines, copy);
+
+    /* journalctl -n prints only the last N lines */
+    while (g_queue_get_length(&view->lines) > view->max_lines
+           || view->bytes > view->max_bytes)
+    {
+        char *oldest = g_queue_pop_head(&view->lines);
+        view->bytes -= strlen(oldest) + 1;
+        free(oldest);
+    }
+}
+
+static bool entry_matches(abrt_journal_t *journal, GList *checks)
+{
+    for (GList *iter = checks; iter != NULL; iter = g_list_next(iter))
+    {
+        const char *match = (const char *)iter->data;
+        const char *value = strchr(match, '=') + 1;
+        char *field = xstrndup(match, value - match - 1);
+
+        char *entry_value = abrt_journal_get_string_field(journal, field, NULL);
+        const bool r = entry_value != NULL && strcmp(entry_value, value) == 0;
+
+        free(entry_value);
+        free(field);
+
+        if (!r)
+            return false;
+    }
+
+    return true;
+}
+
+/* Finds the systemd unit in a copy of /proc/[pid]/cgroup */
+static char *cgroup_systemd_unit(const char *cgroup)
+{
+    for (const char *line = cgroup; line != NULL && *line != '\0'; )
+    {
+        const char *end = strchrnul(line, '\n');
+        const char *path = NULL;
+
+        /* cgroup v1 systemd hierarchy or cgroup v2 unified hierarchy */
+        const char *v1 = strstr(line, ":name=systemd:");
+        if (v1 != NULL && v1 < end)
+            path = v1 + strlen(":name=systemd:");
+        else if (prefixcmp(line, "0::") == 0)
+            path = line + strlen("0::");
+
+        if (path != NULL)
+        {
+            char *unit = NULL;
+            const char *component = path;
+            while (component < end)
+            {
+                const char *next = memchr(component, '/', end - component);
+                if (next == NULL)
+                    next = end;
+
+                const size_t len = next - component;
+                if (len > strlen(".service") && strncmp(next - strlen(".service"), ".service", strlen(".service")) == 0)
+                {
+                    free(unit);
+                    unit = xstrndup(component, len);
+                }
+
+                component = next + 1;
+            }
+
+            if (unit != NULL)
+                return unit;
+        }
+
+        line = *end ? end + 1 : NULL;
+    }
+
+    return NULL;
+}
+
+/* Derives the value of a journal field from the problem directory */
+static char *problem_field_value(struct dump_dir *dd, const char *field)
+{
+    const int flags = DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT;
+
+    if (strcmp(field, "_COMM") == 0)
+    {
+        char *executable = dd_load_text_ext(dd, FILENAME_EXECUTABLE, flags);
+        if (executable == NULL)
+            return NULL;
+
+        const char *base = strrchr(executable, '/');
+        char *comm = xstrndup(base ? base + 1 : executable, JOURNAL_COMM_MAX_LEN);
+        free(executable);
+        return comm;
+    }
+
+    if (strcmp(field, "_EXE") == 0)
+        return dd_load_text_ext(dd, FILENAME_EXECUTABLE, flags);
+
+    if (strcmp(field, "_UID") == 0)
+        return dd_load_text_ext(dd, FILENAME_UID, flags);
+
+    if (strcmp(field, "_PID") == 0)
+        return dd_load_text_ext(dd, FILENAME_PID, flags);
+
+    if (strcmp(field, "_SYSTEMD_UNIT") == 0)
+    {
+        char *cgroup = dd_load_text_ext(dd, FILENAME_CGROUP, flags);
+        if (cgroup == NULL)
+            return NULL;
+
+        char *unit = cgroup_systemd_unit(cgroup);
+        free(cgroup);
+        return unit;
+    }
+
+    error_msg_and_die(_("Can't derive the value of '%s' from the problem, use %s=VALUE"), field, field);
+}
+
+/*
+ * Converts the requested FIELD and FIELD=VALUE items to FIELD=VALUE matches
+ *
+ * Returns NULL if a value is not available
+ */
+static GList *build_matches(struct dump_dir *dd, GList *fields)
+{
+    GList *matches = NULL;
+    for (GList *iter = fields; iter != NULL; iter = g_list_next(iter))
+    {
+        const char *field = (const char *)iter->data;
+        if (strchr(field, '=') != NULL)
+        {
+            matches = g_list_append(matches, xstrdup(field));
+            continue;
+        }
+
+        char *value = problem_field_value(dd, field);
+        if (value == NULL || value[0] == '\0')
+        {
+            log_notice("Problem has no value for journal field '%s'", field);
+            free(value);
+            g_list_free_full(matches, free);
+            return NULL;
+        }
+
+        strchrnul(value, '\n')[0] = '\0';
+        matches = g_list_append(matches, xasprintf("%s=%s", field, value));
+        free(value);
+    }
+
+    return matches;
+}
+
+static int read_excerpt(const char *journal_dir, time_t crash_time, unsigned window,
+        GList *filter, struct excerpt_view *views, size_t views_cnt)
+{
+    abrt_journal_t *journal;
+    if (journal_dir != NULL)
+    {
+        if (abrt_journal_open_directory(&journal, journal_dir) != 0)
+        {
+            error_msg(_("Cannot initialize systemd-journal in directory '%s'"), journal_dir);
+            return -1;
+        }
+    }
+    else if (abrt_journal_new(&journal) != 0)
+    {
+        error_msg(_("Cannot open systemd-journal"));
+        return -1;
+    }
+
+    int r = abrt_journal_set_journal_filter(journal, filter);
+    if (r == 0)
+        r = abrt_journal_filter_current_boot(journal);
+    if (r == 0)
+        r = abrt_journal_seek_realtime(journal, (uint64_t)(crash_time - window) * 1000000);
+
+    /* Log lines written shortly after the crash are interesting too */
+    const uint64_t until = (uint64_t)(crash_time + window) * 1000000;
+
+    unsigned long entries = 0;
+    while (r == 0 && abrt_journal_next(journal) > 0)
+    {
+        uint64_t realtime;
+        if (abrt_journal_get_realtime(journal, &realtime) == 0 && realtime > until)
+            break;
+
+        ++entries;
+        char *line = NULL;
+        for (size_t i = 0; i < views_cnt; ++i)
+        {
+            if (!entry_matches(journal, views[i].checks))
+                continue;
+
+            if (line == NULL)
+                line = abrt_journal_get_short_log_line(journal);
+
+            if (line != NULL)
+                excerpt_view_add_line(&views[i], line);
+        }
+        free(line);
+    }
+
+    log_debug("Read %lu journal entries", entries);
+    abrt_journal_free(journal);
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-vS] [-d DIR] [-w SECONDS] [-n LINES] [-b BYTES] [-o ELEMENT] [-J PATH]\n"
+        "    -m FIELD[=VALUE]...\n"
+        "\n"
+        "Save log lines logged around the time of the problem\n"
+        "\n"
+        "Reads journal entries of the current boot logged at most SECONDS before and\n"
+        "after the problem and matching all FIELDs. FIELD without VALUE takes the value\n"
+        "from the problem directory (supported are _COMM, _EXE, _UID, _PID and\n"
+        "_SYSTEMD_UNIT).\n"
+        "\n"
+        "With -S, log lines of all users are saved too (the _UID match is ignored\n"
+        "for them). Do not use -S if you mind sharing data from the system logs with\n"
+        "unprivileged users."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_w = 1 << 2,
+        OPT_n = 1 << 3,
+        OPT_o = 1 << 4,
+        OPT_m = 1 << 5,
+        OPT_S = 1 << 6,
+        OPT_b = 1 << 7,
+        OPT_J = 1 << 8,
+    };
+
+    const char *dump_dir_name = ".";
+    int window = DEFAULT_WINDOW_SECONDS;
+    int max_lines = DEFAULT_MAX_LINES;
+    int max_bytes = DEFAULT_MAX_BYTES;
+    const char *journal_dir = NULL;
+    const char *output = DEFAULT_OUTPUT_ELEMENT;
+    GList *fields = NULL;
+
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR"    , _("Problem directory")),
+        OPT_INTEGER('w', NULL, &window      , _("Seconds before and after the problem (default 180)")),
+        OPT_INTEGER('n', NULL, &max_lines   , _("Save at most LINES last log lines per view (default 99)")),
+        OPT_STRING('o', NULL, &output       , "ELEMENT", _("Problem element to save the log lines to")),
+        OPT_LIST(  'm', NULL, &fields       , "FIELD[=VALUE]", _("Journal field to match")),
+        OPT_BOOL(  'S', NULL, NULL          , _("Save log lines of all users too")),
+        OPT_INTEGER('b', NULL, &max_bytes   , _("Save at most BYTES of the last log lines per view (default 65536)")),
+        OPT_STRING('J', NULL, &journal_dir  , "PATH", _("Read all journal files from directory at PATH")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    if (fields == NULL || window < 0 || max_lines <= 0 || max_bytes <= 1)
+        show_usage_and_die(program_usage_string, program_options);
+
+    export_abrt_envvars(0);
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /* for writing */0);
+    if (dd == NULL)
+        xfunc_die();
+
+    char *time_str = dd_load_text(dd, FILENAME_TIME);
+    const time_t crash_time = strtoll(time_str, NULL, 10);
+    free(time_str);
+
+    int r = 0;
+    GList *matches = build_matches(dd, fields);
+    if (matches == NULL)
+        goto finito;
+
+    struct excerpt_view views[2] = {
+        { .title = "User Logs", .max_lines = max_lines, .max_bytes = max_bytes, },
+        { .title = "System Logs", .max_lines = max_lines, .max_bytes = max_bytes, },
+    };
+    size_t views_cnt = 1;
+
+    /* The journal filter selects the entries of the widest view and only the
+     * remaining matches are checked for every entry */
+    GList *filter = matches;
+    if (opts & OPT_S)
+    {
+        views_cnt = 2;
+        filter = NULL;
+        for (GList *iter = matches; iter != NULL; iter = g_list_next(iter))
+        {
+            if (prefixcmp((const char *)iter->data, "_UID=") == 0)
+                views[0].checks = g_list_append(views[0].checks, iter->data);
+            else
+                filter = g_list_append(filter, iter->data);
+        }
+    }
+
+    r = read_excerpt(journal_dir, crash_time, window, filter, views, views_cnt) != 0;
+
+    GString *excerpt = g_string_new(NULL);
+    for (size_t i = 0; i < views_cnt; ++i)
+    {
+        if (g_queue_is_empty(&views[i].lines))
+            continue;
+
+        g_string_append_printf(excerpt, "%s:\n", views[i].title);
+        for (GList *iter = views[i].lines.head; iter != NULL; iter = g_list_next(iter))
+            g_string_append_printf(excerpt, "%s\n", (const char *)iter->data);
+
+        g_queue_foreach(&views[i].lines, (GFunc)free, NULL);
+        g_queue_clear(&views[i].lines);
+        g_list_free(views[i].checks);
+    }
+
+    if (excerpt->len != 0)
+        dd_save_text(dd, output, excerpt->str);
+    else
+        log_notice("No log lines found");
+
+    g_string_free(excerpt, TRUE);
+
+    if (filter != matches)
+        g_list_free(filter);
+    g_list_free_full(matches, free);
+
+finito:
+    dd_close(dd);
+    g_list_free(fields);
+
+    return r;
+}
@@ -0,0 +1,88 @@
+/*
+    Copyright (C) 2026  ABRT Team
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+    unsigned timeout_sec = 60;
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-t SEC] -d DIR\n"
+        "\n"
+        "Resolves function names and source lines of core_backtrace frames\n"
+        "by abrt-symbolizer and saves the result in "FILENAME_SYMBOLIZED_BACKTRACE"\n"
+        "\n"
+        "Does nothing if abrt-symbolizer is not running."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_t = 1 << 2,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_STRING( 'd', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_INTEGER('t', NULL, &timeout_sec  , _("Seconds to wait for abrt-symbolizer")),
+        OPT_END()
+    };
+    /*unsigned opts =*/ parse_opts(argc, argv, program_options, program_usage_string);
+
+    export_abrt_envvars(0);
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+    if (!dd)
+        return 1;
+
+    char *core_backtrace = dd_load_text_ext(dd, FILENAME_CORE_BACKTRACE, DD_FAIL_QUIETLY_ENOENT);
+    if (core_backtrace == NULL || core_backtrace[0] == '\0')
+    {
+        log_notice("No '%s' to symbolize", FILENAME_CORE_BACKTRACE);
+        goto finito;
+    }
+
+    /* Let user know what's going on */
+    log_notice(_("Symbolizing core_backtrace"));
+
+    char *backtrace = symbolize_core_backtrace(core_backtrace, timeout_sec);
+    if (backtrace == NULL)
+    {
+        /* gdb generates the backtrace later if it is needed */
+        log_notice("Core backtrace was not symbolized");
+        goto finito;
+    }
+
+    dd_save_text(dd, FILENAME_SYMBOLIZED_BACKTRACE, backtrace);
+    free(backtrace);
+
+ finito:
+    free(core_backtrace);
+    dd_close(dd);
+    return 0;
+}
@@ -22,12 +22,17 @@
 #define ABRT_JOURNAL_MAX_READ_LINES (1024 * 1024)
 
 #define ABRT_JOURNAL_KOOPS_ANALYZER "abrt-journal-koops"
+#define ABRT_JOURNAL_OOM_ANALYZER "abrt-journal-oom"
+#define ABRT_JOURNAL_STALL_ANALYZER "abrt-journal-stall"
+
+/* OOM reports logged within this many seconds get the memory state snapshot */
+#define OOM_LIVE_REPORT_AGE 60
 
 /*
  * Koops extractor
  */
 
-static GList* abrt_journal_extract_kernel_oops(abrt_journal_t *journal)
+static GList* abrt_journal_extract_kernel_oops(abrt_journal_t *journal, GList **oom_list, GList **stall_list)
 {
     size_t lines_info_count = 0;
     size_t lines_info_size = 32;
@@ -60,8 +65,12 @@ static GList* abrt_journal_extract_kernel_oops(abrt_journal_t *journal)
 
     GList *oops_list = NULL;
     koops_extract_oopses_from_lines(&oops_list, lines_info, lines_info_count);
+    koops_extract_oom_kills_from_lines(oom_list, lines_info, lines_info_count);
+    koops_extract_stalls_from_lines(stall_list, lines_info, lines_info_count);
+    koops_drop_stall_oopses(&oops_list);
 
-    log_debug("Extracted: %d oopses", g_list_length(oops_list));
+    log_debug("Extracted: %d oopses, %d OOM kills, %d stalls", g_list_length(oops_list),
+              g_list_length(*oom_list), g_list_length(*stall_list));
 
     for (size_t i = 0; i < lines_info_count; ++i)
         free(lines_info[i].ptr);
@@ -93,10 +102,25 @@ static void abrt_journal_watch_extract_kernel_oops(abrt_journal_watch_t *watch,
         return;
     }
 
-    GList *oopses = abrt_journal_extract_kernel_oops(journal);
+    /* Messages read after a restart or from other boots are not live */
+    int oom_flags = conf->oops_utils_flags;
+    uint64_t logged;
+    if (abrt_journal_get_realtime(journal, &logged) == 0
+        && logged / 1000000 + OOM_LIVE_REPORT_AGE >= (uint64_t)time(NULL))
+        oom_flags |= ABRT_OOPS_LIVE_REPORTS;
+
+    GList *oom_kills = NULL;
+    GList *stalls = NULL;
+    GList *oopses = abrt_journal_extract_kernel_oops(journal, &oom_kills, &stalls);
+    abrt_oom_process_list(oom_kills, conf->dump_location,
+                          ABRT_JOURNAL_OOM_ANALYZER, oom_flags);
+    abrt_stall_process_list(stalls, conf->dump_location,
+                            ABRT_JOURNAL_STALL_ANALYZER, conf->oops_utils_flags);
     abrt_oops_process_list(oopses, conf->dump_location,
                            ABRT_JOURNAL_KOOPS_ANALYZER, conf->oops_utils_flags);
 
+    g_list_free_full(oom_kills, (GDestroyNotify)free);
+    g_list_free_full(stalls, (GDestroyNotify)free);
     g_list_free_full(oopses, (GDestroyNotify)free);
 
     /* Skip stuff which appeared while processing oops as it is not necessary */
@@ -118,36 +142,10 @@ static void abrt_journal_watch_extract_kernel_oops(abrt_journal_watch_t *watch,
 
 static void watch_journald(abrt_journal_t *journal, const char *dump_location, int flags)
 {
-    GList *koops_strings = koops_suspicious_strings_list();
-
-    char *oops_string_filter_regex = abrt_oops_string_filter_regex();
-    if (oops_string_filter_regex)
-    {
-        regex_t filter_re;
-        if (regcomp(&filter_re, oops_string_filter_regex, REG_NOSUB) != 0)
-            perror_msg_and_die(_("Failed to compile regex"));
-
-        GList *iter = koops_strings;
-        while(iter != NULL)
-        {
-            GList *next = g_list_next(iter);
-
-            const int reti = regexec(&filter_re, (const char *)iter->data, 0, NULL, 0);
-            if (reti == 0)
-                koops_strings = g_list_delete_link(koops_strings, iter);
-            else if (reti != REG_NOMATCH)
-            {
-                char msgbuf[100];
-                regerror(reti, &filter_re, msgbuf, sizeof(msgbuf));
-                error_msg_and_die("Regex match failed: %s", msgbuf);
-            }
-
-            iter = next;
-        }
-
-        regfree(&filter_re);
-        free(oops_string_filter_regex);
-    }
+    GList *koops_strings = abrt_oops_suspicious_strings_filtered();
+    /* The rest of the OOM report is read in the callback */
+    koops_strings = g_list_append(koops_strings, (gpointer)KOOPS_OOM_START_STRING);
+    koops_strings = g_list_concat(koops_strings, koops_stall_strings_list());
 
     struct watch_journald_settings watch_conf = {
         .dump_location = dump_location,
@@ -312,9 +310,17 @@ int main(int argc, char *argv[])
          * to a next message.*/
         abrt_journal_next(journal);
 
-        GList *oopses = abrt_journal_extract_kernel_oops(journal);
-        const int errors = abrt_oops_process_list(oopses, dump_location,
-                                                  ABRT_JOURNAL_KOOPS_ANALYZER, oops_utils_flags);
+        GList *oom_kills = NULL;
+        GList *stalls = NULL;
+        GList *oopses = abrt_journal_extract_kernel_oops(journal, &oom_kills, &stalls);
+        int errors = abrt_oom_process_list(oom_kills, dump_location,
+                                           ABRT_JOURNAL_OOM_ANALYZER, oops_utils_flags);
+        errors += abrt_stall_process_list(stalls, dump_location,
+                                          ABRT_JOURNAL_STALL_ANALYZER, oops_utils_flags);
+        errors += abrt_oops_process_list(oopses, dump_location,
+                                         ABRT_JOURNAL_KOOPS_ANALYZER, oops_utils_flags);
+        g_list_free_full(oom_kills, (GDestroyNotify)free);
+        g_list_free_full(stalls, (GDestroyNotify)free);
         g_list_free_full(oopses, (GDestroyNotify)free);
 
         return errors;
@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2026  ABRT Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <poll.h>
+#include "libabrt.h"
+#include "oops-utils.h"
+
+#define ABRT_KMSG_WATCH_STATE_FILE VAR_STATE"/abrt-dump-kmsg-oops.state"
+
+#define ABRT_KMSG_DEVICE "/dev/kmsg"
+
+#define ABRT_KMSG_BOOT_ID_FILE "/proc/sys/kernel/random/boot_id"
+
+/* Limit number of buffered bytes */
+#define ABRT_KMSG_MAX_READ_SIZE (16 * 1024 * 1024)
+
+/* Bigger than the longest record the kernel returns (CONSOLE_EXT_LOG_MAX) */
+#define ABRT_KMSG_RECORD_SIZE (8 * 1024)
+
+#define ABRT_KMSG_KOOPS_ANALYZER "abrt-kmsg-koops"
+#define ABRT_KMSG_OOM_ANALYZER "abrt-kmsg-oom"
+#define ABRT_KMSG_STALL_ANALYZER "abrt-kmsg-stall"
+
+static volatile sig_atomic_t s_terminate;
+
+static void handle_term_signal(int signo)
+{
+    s_terminate = 1;
+}
+
+/*
+ * Reads all available records
+ *
+ * Every read(2) of /dev/kmsg returns a single record, regular files with
+ * recorded kmsg streams are simply read to the end.
+ *
+ * Returns -1 on error, otherwise 0
+ */
+static int read_kmsg_records(int fd, GString *buffer)
+{
+    while (buffer->len < ABRT_KMSG_MAX_READ_SIZE)
+    {
+        char record[ABRT_KMSG_RECORD_SIZE];
+        const ssize_t r = read(fd, record, sizeof(record));
+        if (r == 0)
+            break;
+
+        if (r < 0)
+        {
+            if (errno == EAGAIN)
+                break;
+
+            if (errno == EINTR)
+            {
+                if (s_terminate)
+                    break;
+                continue;
+            }
+
+            /* The record we wanted to read has been overwritten, the next
+             * read returns the oldest available record */
+            if (errno == EPIPE)
+            {
+                log_warning(_("Kernel log buffer overrun, some messages were lost"));
+                continue;
+            }
+
+            perror_msg(_("Cannot read kernel log"));
+            return -1;
+        }
+
+        g_string_append_len(buffer, record, r);
+    }
+
+    return 0;
+}
+
+static bool contains_any_string(const char *buffer, GList *strings)
+{
+    for (GList *iter = strings; iter != NULL; iter = g_list_next(iter))
+        if (strstr(buffer, (const char *)iter->data) != NULL)
+            return true;
+
+    return false;
+}
+
+/* The OOM report is complete once the killed process is logged */
+static bool contains_incomplete_oom_report(const char *buffer)
+{
+    const char *start = g_strrstr(buffer, KOOPS_OOM_START_STRING);
+    return start != NULL && strstr(start, "Killed process ") == NULL;
+}
+
+/*
+ * Kernel log position
+ *
+ * Sequence numbers start from 0 at every boot, hence the position is
+ * remembered together with the boot ID.
+ */
+static char *load_boot_id(void)
+{
+    char *boot_id = xmalloc_fopen_fgetline_fclose(ABRT_KMSG_BOOT_ID_FILE);
+    if (boot_id == NULL)
+        log_notice("Cannot read boot ID from "ABRT_KMSG_BOOT_ID_FILE);
+
+    return boot_id;
+}
+
+static unsigned long long restore_position(const char *state_file, const char *boot_id)
+{
+    unsigned long long next_seq = 0;
+
+    char *state = xmalloc_open_read_close(state_file, /*maxsize:*/ NULL);
+    if (state == NULL)
+    {
+        log_notice("No saved kernel log position");
+        return next_seq;
+    }
+
+    char saved_boot_id[64];
+    unsigned long long saved_seq;
+    if (sscanf(state, "%63s %llu", saved_boot_id, &saved_seq) != 2)
+        error_msg(_("Invalid kernel log position in '%s'"), state_file);
+    else if (boot_id == NULL || strcmp(saved_boot_id, boot_id) != 0)
+        log_notice("The saved kernel log position belongs to another boot");
+    else
+    {
+        log_debug("Restored kernel log position %llu", saved_seq);
+        next_seq = saved_seq;
+    }
+
+    free(state);
+    return next_seq;
+}
+
+static void save_position(const char *state_file, const char *boot_id, unsigned long long next_seq)
+{
+    if (boot_id == NULL)
+        return;
+
+    char *tmp_file = xasprintf("%s.tmp", state_file);
+    char *state = xasprintf("%s %llu\n", boot_id, next_seq);
+
+    const int fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+        perror_msg(_("Cannot save kernel log position to '%s'"), tmp_file);
+    else
+    {
+        const bool written = full_write_str(fd, state) >= 0;
+        close(fd);
+
+        if (!written || rename(tmp_file, state_file) != 0)
+        {
+            perror_msg(_("Cannot save kernel log position to '%s'"), state_file);
+            unlink(tmp_file);
+        }
+    }
+
+    free(state);
+    free(tmp_file);
+}
+
+static int process_records(GString *buffer, unsigned long long *next_seq,
+        const char *dump_location, int flags)
+{
+    GList *oopses = NULL;
+    GList *oom_kills = NULL;
+    GList *stalls = NULL;
+    const int records = koops_extract_oopses_from_kmsg(&oopses, &oom_kills, &stalls,
+                                                       buffer->str, buffer->len, next_seq);
+    log_debug("Processed %d kernel log records", records);
+
+    /* OOM kills first, the snapshot of memory state must be fresh */
+    int errors = abrt_oom_process_list(oom_kills, dump_location,
+                                       ABRT_KMSG_OOM_ANALYZER, flags);
+    g_list_free_full(oom_kills, (GDestroyNotify)free);
+
+    errors += abrt_stall_process_list(stalls, dump_location,
+                                      ABRT_KMSG_STALL_ANALYZER, flags);
+    g_list_free_full(stalls, (GDestroyNotify)free);
+
+    errors += abrt_oops_process_list(oopses, dump_location,
+                                     ABRT_KMSG_KOOPS_ANALYZER, flags);
+    g_list_free_full(oopses, (GDestroyNotify)free);
+    g_string_truncate(buffer, 0);
+
+    return errors;
+}
+
+static void watch_kmsg(int fd, const char *boot_id, unsigned long long next_seq,
+        const char *dump_location, int flags)
+{
+    GList *koops_strings = abrt_oops_suspicious_strings_filtered();
+    /* Stacks of all blocked tasks and stalled CPUs follow the first line */
+    koops_strings = g_list_concat(koops_strings, koops_stall_strings_list());
+
+    sigset_t mask;
+    sigset_t orig_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGHUP);
+    /* Block the signals to not miss them between the checks of s_terminate
+     * and ppoll() and to let abrt_oops_signaled_sleep() receive them */
+    sigprocmask(SIG_BLOCK, &mask, &orig_mask);
+    signal(SIGTERM, handle_term_signal);
+    signal(SIGINT, handle_term_signal);
+    signal(SIGHUP, handle_term_signal);
+
+    /* Records logged before the start are not live */
+    bool caught_up = false;
+    GString *buffer = g_string_sized_new(ABRT_KMSG_RECORD_SIZE);
+    while (!s_terminate)
+    {
+        if (read_kmsg_records(fd, buffer) != 0)
+            break;
+
+        if (buffer->len != 0)
+        {
+            /* Give kernel one second to finish the oops */
+            if (contains_any_string(buffer->str, koops_strings)
+                || contains_incomplete_oom_report(buffer->str))
+            {
+                if (abrt_oops_signaled_sleep(1) > 0)
+                    s_terminate = 1;
+                else if (read_kmsg_records(fd, buffer) != 0)
+                    break;
+            }
+
+            process_records(buffer, &next_seq, dump_location,
+                            caught_up ? flags | ABRT_OOPS_LIVE_REPORTS : flags);
+
+            /* In case of disaster, lets make sure we won't read the
+             * records again. */
+            save_position(ABRT_KMSG_WATCH_STATE_FILE, boot_id, next_seq);
+
+            if (g_abrt_oops_sleep_woke_up_on_signal > 0)
+                s_terminate = 1;
+
+            continue;
+        }
+
+        caught_up = true;
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (ppoll(&pfd, 1, NULL, &orig_mask) < 0 && errno != EINTR)
+        {
+            perror_msg(_("Cannot wait for kernel log records"));
+            break;
+        }
+    }
+
+    g_string_free(buffer, TRUE);
+    g_list_free(koops_strings);
+}
+
+int main(int argc, char *argv[])
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-vsoxtef] [-d DIR]/[-D] [FILE]\n"
+        "\n"
+        "Extract oops from kernel log records read from "ABRT_KMSG_DEVICE"\n"
+        "\n"
+        "FILE is a recorded stream of "ABRT_KMSG_DEVICE" records, e.g. an output of\n"
+        "'cat "ABRT_KMSG_DEVICE"'.\n"
+        "\n"
+        "-f follows "ABRT_KMSG_DEVICE" from the last seen record of the current boot,\n"
+        "the last seen record is saved in "ABRT_KMSG_WATCH_STATE_FILE"\n"
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_s = 1 << 1,
+        OPT_o = 1 << 2,
+        OPT_d = 1 << 3,
+        OPT_D = 1 << 4,
+        OPT_x = 1 << 5,
+        OPT_t = 1 << 6,
+        OPT_e = 1 << 7,
+        OPT_f = 1 << 8,
+    };
+
+    char *dump_location = NULL;
+
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_BOOL(  's', NULL, NULL, _("Log to syslog")),
+        OPT_BOOL(  'o', NULL, NULL, _("Print found oopses on standard output")),
+        /* oopses don't contain any sensitive info, and even
+         * the old koops app was showing the oopses to all users
+         */
+        OPT_STRING('d', NULL, &dump_location, "DIR", _("Create new problem directory in DIR for every oops found")),
+        OPT_BOOL(  'D', NULL, NULL, _("Same as -d DumpLocation, DumpLocation is specified in abrt.conf")),
+        OPT_BOOL(  'x', NULL, NULL, _("Make the problem directory world readable")),
+        OPT_BOOL(  't', NULL, NULL, _("Throttle problem directory creation to 1 per second")),
+        OPT_BOOL(  'e', NULL, NULL, _("Start reading kernel log from the end")),
+        OPT_BOOL(  'f', NULL, NULL, _("Follow kernel log from the last seen record (if available)")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    export_abrt_envvars(0);
+
+    msg_prefix = g_progname;
+    if ((opts & OPT_s) || getenv("ABRT_SYSLOG"))
+    {
+        logmode = LOGMODE_JOURNAL;
+    }
+
+    if (opts & OPT_D)
+    {
+        if (opts & OPT_d)
+            show_usage_and_die(program_usage_string, program_options);
+        load_abrt_conf();
+        dump_location = g_settings_dump_location;
+        g_settings_dump_location = NULL;
+        free_abrt_conf_data();
+    }
+
+    int oops_utils_flags = 0;
+    if ((opts & OPT_x))
+        oops_utils_flags |= ABRT_OOPS_WORLD_READABLE;
+
+    if ((opts & OPT_t))
+        oops_utils_flags |= ABRT_OOPS_THROTTLE_CREATION;
+
+    if ((opts & OPT_o))
+        oops_utils_flags |= ABRT_OOPS_PRINT_STDOUT;
+
+    argv += optind;
+    const char *const kmsg_file = argv[0] ? argv[0] : ABRT_KMSG_DEVICE;
+
+    if ((opts & OPT_f) && argv[0])
+        error_msg_and_die(_("Only "ABRT_KMSG_DEVICE" can be followed"));
+
+    const int fd = open(kmsg_file, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        perror_msg_and_die(_("Cannot open '%s'"), kmsg_file);
+
+    /* Seeking /dev/kmsg to the end skips all records currently in the buffer */
+    if ((opts & OPT_e) && lseek(fd, 0, SEEK_END) < 0)
+        perror_msg_and_die(_("Cannot seek to the end of kernel log"));
+
+    int errors = 0;
+    if ((opts & OPT_f))
+    {
+        char *boot_id = load_boot_id();
+        const unsigned long long next_seq = (opts & OPT_e) ? 0
+                : restore_position(ABRT_KMSG_WATCH_STATE_FILE, boot_id);
+
+        watch_kmsg(fd, boot_id, next_seq, dump_location, oops_utils_flags);
+
+        free(boot_id);
+    }
+    else
+    {
+        unsigned long long next_seq = 0;
+        GString *buffer = g_string_new(NULL);
+
+        if (read_kmsg_records(fd, buffer) != 0)
+            errors = 1;
+        else
+            errors = process_records(buffer, &next_seq, dump_location, oops_utils_flags);
+
+        g_string_free(buffer, TRUE);
+    }
+
+    close(fd);
+
+    return errors;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026  ABRT Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <grp.h>
+#include <pwd.h>
+#include "libabrt.h"
+#include "forward-utils.h"
+
+#define DEFAULT_INCOMING_LOCATION "/var/spool/abrt-forward/collector"
+/* KiB */
+#define DEFAULT_DEDUP_MIN_ELEMENT_SIZE 64
+
+/* The connection is served under this user when started as root */
+#define RECEIVER_USER "abrt-forward"
+
+static void drop_privileges(const struct passwd *pw)
+{
+    if (setgroups(0, NULL) != 0
+        || setresgid(pw->pw_gid, pw->pw_gid, pw->pw_gid) != 0
+        || setresuid(pw->pw_uid, pw->pw_uid, pw->pw_uid) != 0)
+        perror_msg_and_die("Can't switch to user '%s'", pw->pw_name);
+}
+
+/* The receiver writes only to 'incoming', it can check the rest */
+static void prepare_state_dir(const char *state_dir, const struct passwd *pw)
+{
+    if (g_mkdir_with_parents(state_dir, 0711) != 0)
+        perror_msg_and_die("Can't create '%s'", state_dir);
+    ensure_writable_dir_uid_gid(state_dir, 0711, 0, 0);
+
+    static const char *const root_subdirs[] = { "objects", "duphashes", "committed" };
+    for (unsigned i = 0; i < ARRAY_SIZE(root_subdirs); ++i)
+    {
+        char *path = concat_path_file(state_dir, root_subdirs[i]);
+        ensure_writable_dir_uid_gid(path, 0711, 0, 0);
+        free(path);
+    }
+
+    char *incoming = concat_path_file(state_dir, "incoming");
+    ensure_writable_dir_uid_gid(incoming, 0700, pw->pw_uid, pw->pw_gid);
+    free(incoming);
+}
+
+/* Serves the connection as RECEIVER_USER, the privileged part only commits
+ * the received problems */
+static int serve_unprivileged(struct abrt_forward_collector_conf *conf)
+{
+    struct passwd *pw = getpwnam(RECEIVER_USER);
+    if (pw == NULL)
+        error_msg_and_die("User '%s' does not exist, refusing to serve as root", RECEIVER_USER);
+
+    prepare_state_dir(conf->afcc_state_dir, pw);
+    abrt_forward_collector_cleanup(conf->afcc_state_dir);
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0)
+        perror_msg_and_die("socketpair");
+
+    const pid_t pid = xfork();
+    if (pid == 0)
+    {
+        close(sv[0]);
+        drop_privileges(pw);
+        conf->afcc_commit_fd = sv[1];
+        exit(abrt_forward_serve(STDIN_FILENO, STDOUT_FILENO, conf));
+    }
+    close(sv[1]);
+
+    /* Only the receiver talks to the client */
+    xmove_fd(xopen("/dev/null", O_RDWR), STDIN_FILENO);
+    xdup2(STDIN_FILENO, STDOUT_FILENO);
+
+    int r = abrt_forward_committer_serve(sv[0], pw->pw_uid, conf);
+    close(sv[0]);
+
+    int status;
+    if (safe_waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        r = 1;
+
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *program_usage_string = _(
+        "& [-vs] [-d DIR]/[-D] [-S STATE_DIR]\n"
+        "\n"
+        "Receives problems from abrt-forward on standard input and output\n"
+        "\n"
+        "The program is meant to be started by systemd socket activation or\n"
+        "over ssh. Received problems are stored in DIR and announced to abrtd."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_s = 1 << 1,
+        OPT_d = 1 << 2,
+        OPT_D = 1 << 3,
+        OPT_S = 1 << 4,
+    };
+
+    const char *dump_location = NULL;
+    const char *state_dir = NULL;
+
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_BOOL(  's', NULL, NULL, _("Log to syslog")),
+        OPT_STRING('d', NULL, &dump_location, "DIR", _("Create new problem directories in DIR")),
+        OPT_BOOL(  'D', NULL, NULL, _("Same as -d DumpLocation, DumpLocation is specified in abrt.conf")),
+        OPT_STRING('S', NULL, &state_dir, "STATE_DIR", _("Directory for partial transfers and shared data")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    export_abrt_envvars(0);
+
+    /* stdout is the connection, messages go to stderr */
+    if ((opts & OPT_s) || getenv("ABRT_SYSLOG"))
+        logmode = LOGMODE_JOURNAL;
+
+    load_abrt_conf();
+
+    if (opts & OPT_D)
+    {
+        if (opts & OPT_d)
+            show_usage_and_die(program_usage_string, program_options);
+        dump_location = g_settings_dump_location;
+    }
+
+    if (dump_location == NULL)
+        dump_location = g_settings_dump_location;
+
+    unsigned int dedup_min_size = DEFAULT_DEDUP_MIN_ELEMENT_SIZE;
+    GList *allowed_clients = NULL;
+    map_string_t *settings = new_map_string();
+    load_abrt_plugin_conf_file("Forward.conf", settings);
+    {
+        if (!state_dir)
+            state_dir = get_map_string_item_or_NULL(settings, "IncomingLocation");
+        if (!state_dir)
+            state_dir = DEFAULT_INCOMING_LOCATION;
+
+        const char *value = get_map_string_item_or_NULL(settings, "DedupMinElementSize");
+        if (value && !try_get_map_string_item_as_uint(settings, "DedupMinElementSize", &dedup_min_size))
+            log_warning("The DedupMinElementSize option in the Forward.conf file holds an invalid value");
+
+        value = get_map_string_item_or_NULL(settings, "AllowedClients");
+        if (value)
+            allowed_clients = parse_list(value);
+    }
+
+    if (!abrt_forward_client_allowed(STDIN_FILENO, allowed_clients))
+        return 1;
+
+    struct abrt_forward_collector_conf conf = {
+        .afcc_dump_location = dump_location,
+        .afcc_state_dir = state_dir,
+        .afcc_dedup_min_size = dedup_min_size * 1024UL,
+        .afcc_max_problem_size = g_settings_nMaxCrashReportsSize * 1024ULL * 1024ULL,
+        .afcc_commit_fd = -1,
+    };
+
+    signal(SIGPIPE, SIG_IGN);
+    int r;
+    if (geteuid() == 0)
+        r = serve_unprivileged(&conf);
+    else
+    {
+        abrt_forward_collector_cleanup(state_dir);
+        r = abrt_forward_serve(STDIN_FILENO, STDOUT_FILENO, &conf);
+    }
+
+    list_free_with_free(allowed_clients);
+    free_map_string(settings);
+    free_abrt_conf_data();
+
+    return r;
+}
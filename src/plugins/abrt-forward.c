@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2026  ABRT Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "libabrt.h"
+#include "forward-utils.h"
+
+#define DEFAULT_QUEUE_LOCATION "/var/spool/abrt-forward/queue"
+#define DEFAULT_MAX_QUEUE_SIZE 100
+
+/* Seconds between checks of an empty queue */
+#define QUEUE_POLL_INTERVAL 5
+/* Close the connection after the queue has been empty for this long */
+#define CONNECTION_IDLE_TIMEOUT 60
+#define MAX_RECONNECT_DELAY 600
+
+static volatile sig_atomic_t s_terminate;
+
+static void handle_term_signal(int signo)
+{
+    s_terminate = 1;
+}
+
+/* Returns 0 when the queue has been emptied */
+static int process_queue(abrt_forward_conn_t **conn, const char *collector, const char *queue_dir)
+{
+    GList *entries = abrt_forward_queue_list(queue_dir);
+    int r = 0;
+
+    for (GList *iter = entries; iter != NULL && !s_terminate; iter = g_list_next(iter))
+    {
+        const char *entry = iter->data;
+        char *dirname = abrt_forward_queue_entry_dirname(queue_dir, entry);
+        if (dirname == NULL)
+        {
+            abrt_forward_queue_remove(queue_dir, entry);
+            continue;
+        }
+
+        if (*conn == NULL && (*conn = abrt_forward_connect(collector)) == NULL)
+        {
+            free(dirname);
+            r = -1;
+            break;
+        }
+
+        char *problem_id = abrt_forward_problem_id(dirname);
+        struct abrt_forward_stats stats = { 0 };
+        const enum abrt_forward_result fr = abrt_forward_send_problem(*conn, dirname, problem_id, &stats);
+        log_info("'%s': sent %llu bytes, skipped %llu bytes", dirname, stats.afs_sent, stats.afs_skipped);
+        free(problem_id);
+        free(dirname);
+
+        if (fr == ABRT_FORWARD_CONN_ERROR)
+        {
+            /* The collector resumes from the received data next time */
+            abrt_forward_conn_free(*conn);
+            *conn = NULL;
+            r = -1;
+            break;
+        }
+
+        if (fr == ABRT_FORWARD_RETRY)
+        {
+            r = -1;
+            break;
+        }
+
+        /* Done or rejected */
+        abrt_forward_queue_remove(queue_dir, entry);
+    }
+
+    list_free_with_free(entries);
+    return r;
+}
+
+static void follow_queue(const char *collector, const char *queue_dir)
+{
+    signal(SIGTERM, handle_term_signal);
+    signal(SIGINT, handle_term_signal);
+
+    abrt_forward_conn_t *conn = NULL;
+    unsigned delay = QUEUE_POLL_INTERVAL;
+    unsigned idle = 0;
+
+    while (!s_terminate)
+    {
+        GList *entries = abrt_forward_queue_list(queue_dir);
+        const bool empty = entries == NULL;
+        list_free_with_free(entries);
+
+        if (empty)
+        {
+            idle += QUEUE_POLL_INTERVAL;
+            if (conn != NULL && idle >= CONNECTION_IDLE_TIMEOUT)
+            {
+                log_debug("Closing idle connection");
+                abrt_forward_conn_free(conn);
+                conn = NULL;
+            }
+            sleep(QUEUE_POLL_INTERVAL);
+            continue;
+        }
+
+        idle = 0;
+        if (process_queue(&conn, collector, queue_dir) == 0)
+        {
+            delay = QUEUE_POLL_INTERVAL;
+            continue;
+        }
+
+        /* Exponential back-off while the collector is unavailable */
+        log_info("Retrying in %u seconds", delay);
+        sleep(delay);
+        delay = MIN(delay * 2, MAX_RECONNECT_DELAY);
+    }
+
+    abrt_forward_conn_free(conn);
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *program_usage_string = _(
+        "& [-vs] [-c COLLECTOR] [-q QUEUE_DIR] [-f] [-e PROBLEM_DIR]\n"
+        "\n"
+        "Forwards problem directories to a collector running abrt-forward-server\n"
+        "\n"
+        "With -e, the problem directory is added to the outbound queue. Otherwise\n"
+        "the queued problems are sent to the collector. Data the collector already\n"
+        "has (e.g. core files of known problems) are not sent again and interrupted\n"
+        "transfers are resumed.\n"
+        "\n"
+        "COLLECTOR is either HOST[:PORT] or |COMMAND (e.g. '|ssh HOST abrt-forward-server')"
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_s = 1 << 1,
+        OPT_c = 1 << 2,
+        OPT_q = 1 << 3,
+        OPT_f = 1 << 4,
+        OPT_e = 1 << 5,
+    };
+
+    const char *collector = NULL;
+    const char *queue_dir = NULL;
+    const char *problem_dir = NULL;
+
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_BOOL(  's', NULL, NULL, _("Log to syslog")),
+        OPT_STRING('c', NULL, &collector, "COLLECTOR", _("Forward to COLLECTOR instead of the one from Forward.conf")),
+        OPT_STRING('q', NULL, &queue_dir, "DIR", _("Outbound queue directory")),
+        OPT_BOOL(  'f', NULL, NULL, _("Follow the queue and forward new problems as they come")),
+        OPT_STRING('e', NULL, &problem_dir, "PROBLEM_DIR", _("Add PROBLEM_DIR to the queue")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    export_abrt_envvars(0);
+
+    if ((opts & OPT_s) || getenv("ABRT_SYSLOG"))
+        logmode = LOGMODE_JOURNAL;
+
+    if ((opts & OPT_e) && (opts & OPT_f))
+        show_usage_and_die(program_usage_string, program_options);
+
+    unsigned int max_queue_size = DEFAULT_MAX_QUEUE_SIZE;
+    map_string_t *settings = new_map_string();
+    load_abrt_plugin_conf_file("Forward.conf", settings);
+    {
+        if (!collector)
+            collector = get_map_string_item_or_NULL(settings, "Collector");
+        if (!queue_dir)
+            queue_dir = get_map_string_item_or_NULL(settings, "QueueLocation");
+        if (!queue_dir)
+            queue_dir = DEFAULT_QUEUE_LOCATION;
+
+        const char *value = get_map_string_item_or_NULL(settings, "MaxQueueSize");
+        if (value && !try_get_map_string_item_as_uint(settings, "MaxQueueSize", &max_queue_size))
+            log_warning("The MaxQueueSize option in the Forward.conf file holds an invalid value");
+    }
+
+    if (collector == NULL || collector[0] == '\0')
+    {
+        /* Not configured is not an error, the tool can be used in events */
+        log_notice("No collector configured, nothing to do");
+        free_map_string(settings);
+        return EXIT_SUCCESS;
+    }
+
+    int r = EXIT_SUCCESS;
+    if (opts & OPT_e)
+    {
+        char *dirname = realpath(problem_dir, NULL);
+        if (dirname == NULL)
+            perror_msg_and_die("Can't access '%s'", problem_dir);
+
+        r = abrt_forward_queue_add(queue_dir, dirname, max_queue_size) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        free(dirname);
+    }
+    else
+    {
+        /* The collector may go away in the middle of a transfer */
+        signal(SIGPIPE, SIG_IGN);
+
+        if (opts & OPT_f)
+            follow_queue(collector, queue_dir);
+        else
+        {
+            abrt_forward_conn_t *conn = NULL;
+            r = process_queue(&conn, collector, queue_dir) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+            abrt_forward_conn_free(conn);
+        }
+    }
+
+    free_map_string(settings);
+    return r;
+}
@@ -263,6 +263,88 @@ int abrt_journal_next(abrt_journal_t *journal)
     return r;
 }
 
+int abrt_journal_seek_realtime(abrt_journal_t *journal, uint64_t usec)
+{
+    const int r = sd_journal_seek_realtime_usec(journal->j, usec);
+    if (r < 0)
+    {
+        log_notice("Failed to seek journal to realtime %llu: %s", (unsigned long long)usec, strerror(-r));
+        return r;
+    }
+
+    return 0;
+}
+
+int abrt_journal_get_realtime(abrt_journal_t *journal, uint64_t *usec)
+{
+    const int r = sd_journal_get_realtime_usec(journal->j, usec);
+    if (r < 0)
+        log_notice("Failed to get realtime of journal entry: %s", strerror(-r));
+
+    return r;
+}
+
+int abrt_journal_filter_current_boot(abrt_journal_t *journal)
+{
+    sd_id128_t boot_id;
+    int r = sd_id128_get_boot(&boot_id);
+    if (r < 0)
+    {
+        log_notice("Failed to get boot ID: %s", strerror(-r));
+        return r;
+    }
+
+    char match[sizeof("_BOOT_ID=") + 32];
+    strcpy(match, "_BOOT_ID=");
+    sd_id128_to_string(boot_id, match + strlen("_BOOT_ID="));
+
+    r = sd_journal_add_match(journal->j, match, strlen(match));
+    if (r < 0)
+    {
+        log_notice("Failed to set journal filter '%s': %s", match, strerror(-r));
+        return r;
+    }
+
+    log_debug("Using journal match: '%s'", match);
+    return 0;
+}
+
+/* The same format as 'journalctl -o short' */
+char *abrt_journal_get_short_log_line(abrt_journal_t *journal)
+{
+    char *message = abrt_journal_get_log_line(journal);
+    if (message == NULL)
+        return NULL;
+
+    char timestamp[sizeof("Jan 01 00:00:00")] = "";
+    uint64_t usec;
+    if (abrt_journal_get_realtime(journal, &usec) == 0)
+    {
+        const time_t t = usec / 1000000;
+        struct tm tm;
+        strftime(timestamp, sizeof(timestamp), "%b %d %H:%M:%S", localtime_r(&t, &tm));
+    }
+
+    char *hostname = abrt_journal_get_string_field(journal, "_HOSTNAME", NULL);
+    char *identifier = abrt_journal_get_string_field(journal, "SYSLOG_IDENTIFIER", NULL);
+    if (identifier == NULL)
+        identifier = abrt_journal_get_string_field(journal, "_COMM", NULL);
+    char *pid = abrt_journal_get_string_field(journal, "_PID", NULL);
+
+    char *line = xasprintf("%s %s %s%s%s%s: %s", timestamp,
+            hostname ? hostname : "localhost",
+            identifier ? identifier : "unknown",
+            pid ? "[" : "", pid ? pid : "", pid ? "]" : "",
+            message);
+
+    free(pid);
+    free(identifier);
+    free(hostname);
+    free(message);
+
+    return line;
+}
+
 int abrt_journal_save_current_position(abrt_journal_t *journal, const char *file_name)
 {
     char *crsr = NULL;
@@ -16,6 +16,7 @@
 #define _ABRT_JOURNAL_H_
 
 #include <glib.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -78,6 +79,21 @@ int abrt_journal_seek_tail(abrt_journal_t *journal);
 
 int abrt_journal_next(abrt_journal_t *journal);
 
+/* Seeks to the first entry at or after the realtime timestamp (CLOCK_REALTIME
+ * in microseconds), call abrt_journal_next() to read the entry.
+ */
+int abrt_journal_seek_realtime(abrt_journal_t *journal, uint64_t usec);
+
+int abrt_journal_get_realtime(abrt_journal_t *journal, uint64_t *usec);
+
+/* Adds a match for the entries of the current boot
+ */
+int abrt_journal_filter_current_boot(abrt_journal_t *journal);
+
+/* Returns the current entry formatted as 'journalctl -o short' does
+ */
+char *abrt_journal_get_short_log_line(abrt_journal_t *journal);
+
 int abrt_journal_save_current_position(abrt_journal_t *journal,
                                        const char *file_name);
 
@@ -0,0 +1,561 @@
+/*
+ * Copyright (C) 2026  ABRT Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <poll.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/un.h>
+#include <elfutils/libdwfl.h>
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/thread.h>
+#include <satyr/core/frame.h>
+#include "libabrt.h"
+
+#define CCPP_CONF "CCpp.conf"
+
+/* Only the socket is created as root */
+#define SYMBOLIZER_USER "abrt-symbolizer"
+
+#define DEFAULT_CACHE_SIZE 64
+/* Core backtraces are small, this is a lot */
+#define MAX_REQUEST_SIZE (4 * 1024 * 1024)
+/* Clients sending their requests at the same time */
+#define MAX_CLIENTS 16
+/* A user can't take all the places, post-create events run as root and are
+ * not limited */
+#define MAX_CLIENTS_PER_USER 4
+/* Seconds a client may take to send its request */
+#define REQUEST_TIMEOUT 5
+/* Seconds a client may take to receive the response */
+#define RESPONSE_TIMEOUT 1
+/* Post-create events, abrt-dbus and users running abrt-cli connect */
+#define SOCKET_PERMISSION 0666
+
+/* Symbol and line tables of a module, loaded once per build-id */
+struct symbolizer_module
+{
+    char *build_id;
+    Dwfl_Callbacks callbacks;
+    Dwfl *dwfl;
+    Dwfl_Module *module;    /* NULL if no ELF with the build-id was found */
+    GList *lru_link;
+};
+
+struct symbolizer
+{
+    char *debuginfo_path;   /* in the format of Dwfl_Callbacks */
+    GList *debuginfo_dirs;  /* DIR/usr/lib/debug */
+    GHashTable *modules;    /* build-id -> struct symbolizer_module */
+    GQueue lru;             /* most recently used first */
+    unsigned cache_size;
+};
+
+static void symbolizer_module_free(struct symbolizer_module *module)
+{
+    if (module->dwfl != NULL)
+        dwfl_end(module->dwfl);
+    free(module->build_id);
+    free(module);
+}
+
+static bool module_has_build_id(Dwfl_Module *module, const char *build_id)
+{
+    const unsigned char *bits = NULL;
+    GElf_Addr vaddr;
+    const int len = dwfl_module_build_id(module, &bits, &vaddr);
+    if (len <= 0 || strlen(build_id) != (size_t)len * 2)
+        return false;
+
+    char *hex = xmalloc(len * 2 + 1);
+    bin2hex(hex, (const char *)bits, len)[0] = '\0';
+    const bool matches = strcasecmp(hex, build_id) == 0;
+    free(hex);
+
+    return matches;
+}
+
+/* Tries the .build-id links of debuginfo packages and of the abrt debuginfo
+ * cache. File names in the request come from the client and are never opened. */
+static void symbolizer_module_load(struct symbolizer *symbolizer,
+                                   struct symbolizer_module *module)
+{
+    /* Dwfl refers to the callbacks until dwfl_end() */
+    module->callbacks.find_elf = dwfl_build_id_find_elf;
+    module->callbacks.find_debuginfo = dwfl_standard_find_debuginfo;
+    module->callbacks.section_address = dwfl_offline_section_address;
+    module->callbacks.debuginfo_path = &symbolizer->debuginfo_path;
+
+    /* The build-id is a part of the path */
+    if (strlen(module->build_id) < 3 || strspn(module->build_id, "0123456789abcdefABCDEF") != strlen(module->build_id))
+        return;
+
+    GList *candidates = NULL;
+    for (GList *iter = symbolizer->debuginfo_dirs; iter != NULL; iter = g_list_next(iter))
+    {
+        candidates = g_list_append(candidates, xasprintf("%s/.build-id/%.2s/%s.debug",
+                    (const char *)iter->data, module->build_id, module->build_id + 2));
+        candidates = g_list_append(candidates, xasprintf("%s/.build-id/%.2s/%s",
+                    (const char *)iter->data, module->build_id, module->build_id + 2));
+    }
+
+    for (GList *iter = candidates; iter != NULL && module->module == NULL; iter = g_list_next(iter))
+    {
+        const char *path = iter->data;
+        if (access(path, R_OK) != 0)
+            continue;
+
+        Dwfl *dwfl = dwfl_begin(&module->callbacks);
+        if (dwfl == NULL)
+            break;
+
+        dwfl_report_begin(dwfl);
+        Dwfl_Module *mod = dwfl_report_offline(dwfl, module->build_id, path, -1);
+        dwfl_report_end(dwfl, NULL, NULL);
+
+        if (mod != NULL && module_has_build_id(mod, module->build_id))
+        {
+            log_debug("Loaded '%s' for build-id %s", path, module->build_id);
+            module->dwfl = dwfl;
+            module->module = mod;
+        }
+        else
+            dwfl_end(dwfl);
+    }
+
+    list_free_with_free(candidates);
+}
+
+static struct symbolizer_module *symbolizer_get_module(struct symbolizer *symbolizer,
+                                                       const char *build_id)
+{
+    struct symbolizer_module *module = g_hash_table_lookup(symbolizer->modules, build_id);
+    if (module != NULL)
+    {
+        g_queue_unlink(&symbolizer->lru, module->lru_link);
+        g_queue_push_head_link(&symbolizer->lru, module->lru_link);
+        return module;
+    }
+
+    module = xzalloc(sizeof(*module));
+    module->build_id = xstrdup(build_id);
+    symbolizer_module_load(symbolizer, module);
+
+    /* Do not remember missing modules, the debuginfo may be installed later */
+    if (module->module == NULL)
+    {
+        symbolizer_module_free(module);
+        return NULL;
+    }
+
+    g_hash_table_insert(symbolizer->modules, module->build_id, module);
+    g_queue_push_head(&symbolizer->lru, module);
+    module->lru_link = g_queue_peek_head_link(&symbolizer->lru);
+
+    while (g_queue_get_length(&symbolizer->lru) > symbolizer->cache_size)
+    {
+        struct symbolizer_module *oldest = g_queue_pop_tail(&symbolizer->lru);
+        log_debug("Dropping build-id %s from cache", oldest->build_id);
+        g_hash_table_remove(symbolizer->modules, oldest->build_id);
+    }
+
+    return module;
+}
+
+static void symbolize_frame(struct symbolizer *symbolizer, struct strbuf *out,
+                            const struct sr_core_frame *frame, unsigned index)
+{
+    const char *function_name = frame->function_name;
+    const char *source_file = NULL;
+    int source_line = 0;
+
+    struct symbolizer_module *module = NULL;
+    if (frame->build_id != NULL)
+        module = symbolizer_get_module(symbolizer, frame->build_id);
+
+    if (module != NULL)
+    {
+        Dwarf_Addr start = 0;
+        dwfl_module_info(module->module, NULL, &start, NULL, NULL, NULL, NULL, NULL);
+        const Dwarf_Addr address = start + frame->build_id_offset;
+
+        if (function_name == NULL)
+            function_name = dwfl_module_addrname(module->module, address);
+
+        /* Outer frames hold return addresses which may belong to the next
+         * line already */
+        Dwfl_Line *line = dwfl_module_getsrc(module->module, index > 0 ? address - 1 : address);
+        if (line != NULL)
+            source_file = dwfl_lineinfo(line, NULL, &source_line, NULL, NULL, NULL);
+    }
+
+    strbuf_append_strf(out, "#%u 0x%llx %s", index,
+                       (unsigned long long)frame->build_id_offset,
+                       function_name ? function_name : "??");
+    if (source_file != NULL)
+        strbuf_append_strf(out, " at %s:%d", source_file, source_line);
+    strbuf_append_strf(out, " in %s\n",
+                       frame->file_name ? frame->file_name
+                                        : (frame->build_id ? frame->build_id : "??"));
+}
+
+/* Returns malloced human readable backtrace or NULL if the core backtrace
+ * cannot be parsed */
+static char *symbolize_core_stacktrace(struct symbolizer *symbolizer, const char *json)
+{
+    char *error_message = NULL;
+    struct sr_core_stacktrace *stacktrace = sr_core_stacktrace_from_json_text(json, &error_message);
+    if (stacktrace == NULL)
+    {
+        log_notice("Can't parse core backtrace: %s", error_message);
+        free(error_message);
+        return NULL;
+    }
+
+    struct sr_core_thread *crash_thread = sr_core_stacktrace_find_crash_thread(stacktrace);
+
+    struct strbuf *out = strbuf_new();
+    unsigned thread_index = 0;
+    for (struct sr_core_thread *thread = stacktrace->threads; thread != NULL; thread = thread->next)
+    {
+        strbuf_append_strf(out, "%sThread %u%s\n", thread_index ? "\n" : "", thread_index + 1,
+                           thread == crash_thread ? " (crash thread)" : "");
+
+        unsigned frame_index = 0;
+        for (struct sr_core_frame *frame = thread->frames; frame != NULL; frame = frame->next)
+            symbolize_frame(symbolizer, out, frame, frame_index++);
+
+        ++thread_index;
+    }
+
+    sr_core_stacktrace_free(stacktrace);
+    return strbuf_free_nobuf(out);
+}
+
+struct symbolizer_client
+{
+    int fd;
+    uid_t uid;
+    struct strbuf *request;
+    long long deadline_ms;
+};
+
+static long long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Reads what the client has sent so far. Returns 1 if the whole request was
+ * received, 0 if more is to come and -1 on errors. */
+static int client_read_request(struct symbolizer_client *client)
+{
+    char buf[4096];
+    const ssize_t len = safe_read(client->fd, buf, sizeof(buf) - 1);
+    if (len < 0 && errno == EAGAIN)
+        return 0;
+    if (len < 0)
+    {
+        perror_msg("read");
+        return -1;
+    }
+    if (len == 0)
+        return 1;
+
+    buf[len] = '\0';
+    if (strlen(buf) != (size_t)len || client->request->len + len > MAX_REQUEST_SIZE)
+    {
+        log_notice("Malformed request");
+        return -1;
+    }
+    strbuf_append_str(client->request, buf);
+    return 0;
+}
+
+/* The socket is non-blocking, a client not reading the response holds up
+ * the others for RESPONSE_TIMEOUT at most, not per write */
+static int client_write_response(struct symbolizer_client *client, const char *response)
+{
+    const long long deadline_ms = monotonic_ms() + RESPONSE_TIMEOUT * 1000;
+    size_t left = strlen(response);
+    while (left > 0)
+    {
+        const ssize_t written = write(client->fd, response, left);
+        if (written > 0)
+        {
+            response += written;
+            left -= written;
+            continue;
+        }
+
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0 && errno != EAGAIN)
+            return -1;
+
+        const long long now = monotonic_ms();
+        if (now >= deadline_ms)
+        {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+
+        struct pollfd pfd = { .fd = client->fd, .events = POLLOUT };
+        if (poll(&pfd, 1, deadline_ms - now) < 0 && errno != EINTR)
+            return -1;
+    }
+
+    return 0;
+}
+
+static void client_respond(struct symbolizer *symbolizer, struct symbolizer_client *client)
+{
+    char *backtrace = symbolize_core_stacktrace(symbolizer, client->request->buf);
+    if (backtrace == NULL)
+        return;
+
+    if (client_write_response(client, backtrace) < 0)
+        perror_msg("Can't send the response");
+    free(backtrace);
+}
+
+static unsigned count_user_clients(const struct symbolizer_client *clients, unsigned count, uid_t uid)
+{
+    unsigned user_clients = 0;
+    for (unsigned i = 0; i < count; ++i)
+        user_clients += clients[i].uid == uid;
+
+    return user_clients;
+}
+
+static void client_close(struct symbolizer_client *client)
+{
+    close(client->fd);
+    strbuf_free(client->request);
+}
+
+/* Receives requests of all connected clients at the same time, so a slow
+ * client delays nobody. Requests are symbolized one at a time as they are
+ * complete, the cached modules are shared. */
+static void serve_clients(struct symbolizer *symbolizer, int socketfd)
+{
+    struct symbolizer_client clients[MAX_CLIENTS];
+    unsigned count = 0;
+    struct pollfd pfds[MAX_CLIENTS + 1];
+
+    for (;;)
+    {
+        const long long now = monotonic_ms();
+        int timeout = -1;
+
+        /* Stop accepting when full, the clients wait in the backlog */
+        pfds[0].fd = count < MAX_CLIENTS ? socketfd : -1;
+        pfds[0].events = POLLIN;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            pfds[i + 1].fd = clients[i].fd;
+            pfds[i + 1].events = POLLIN;
+
+            const long long left = clients[i].deadline_ms > now ? clients[i].deadline_ms - now : 0;
+            if (timeout < 0 || left < timeout)
+                timeout = left;
+        }
+
+        if (poll(pfds, count + 1, timeout) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror_msg_and_die("poll");
+        }
+
+        /* Backwards, the last client takes the place of a closed one */
+        for (unsigned i = count; i-- > 0; )
+        {
+            int r = 0;
+            if (pfds[i + 1].revents != 0)
+                r = client_read_request(&clients[i]);
+            else if (clients[i].deadline_ms <= monotonic_ms())
+            {
+                log_notice("Client timed out");
+                r = -1;
+            }
+
+            if (r == 0)
+                continue;
+
+            if (r > 0)
+                client_respond(symbolizer, &clients[i]);
+
+            client_close(&clients[i]);
+            clients[i] = clients[--count];
+        }
+
+        if (pfds[0].revents != 0)
+        {
+            const int fd = accept4(socketfd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd < 0)
+            {
+                if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN)
+                    perror_msg("accept");
+                continue;
+            }
+
+            struct ucred cr;
+            socklen_t crlen = sizeof(cr);
+            if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cr, &crlen) != 0)
+            {
+                perror_msg("getsockopt(SO_PEERCRED)");
+                close(fd);
+                continue;
+            }
+
+            if (cr.uid != 0 && count_user_clients(clients, count, cr.uid) >= MAX_CLIENTS_PER_USER)
+            {
+                log_notice("Too many connections of uid %lu, refusing", (unsigned long)cr.uid);
+                close(fd);
+                continue;
+            }
+
+            clients[count].fd = fd;
+            clients[count].uid = cr.uid;
+            clients[count].request = strbuf_new();
+            clients[count].deadline_ms = monotonic_ms() + REQUEST_TIMEOUT * 1000;
+            ++count;
+        }
+    }
+}
+
+static int listen_on_socket(const char *path)
+{
+    struct sockaddr_un local;
+    if (strlen(path) >= sizeof(local.sun_path))
+        error_msg_and_die("Socket path '%s' is too long", path);
+
+    unlink(path); /* not caring about the result */
+
+    int socketfd = xsocket(AF_UNIX, SOCK_STREAM, 0);
+    close_on_exec_on(socketfd);
+
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+    strcpy(local.sun_path, path);
+    xbind(socketfd, (struct sockaddr*)&local, sizeof(local));
+    xlisten(socketfd, 16);
+
+    if (chmod(path, SOCKET_PERMISSION) != 0)
+        perror_msg_and_die("chmod '%s'", path);
+
+    return socketfd;
+}
+
+static void drop_privileges(void)
+{
+    if (getuid() != 0)
+        return;
+
+    struct passwd *pw = getpwnam(SYMBOLIZER_USER);
+    if (pw == NULL)
+        error_msg_and_die("User '%s' does not exist, refusing to run as root", SYMBOLIZER_USER);
+
+    if (setgroups(0, NULL) != 0
+        || setresgid(pw->pw_gid, pw->pw_gid, pw->pw_gid) != 0
+        || setresuid(pw->pw_uid, pw->pw_uid, pw->pw_uid) != 0)
+        perror_msg_and_die("Can't switch to user '%s'", pw->pw_name);
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    int cache_size = DEFAULT_CACHE_SIZE;
+    const char *i_opt = NULL;
+    const char *socket_path = SYMBOLIZER_SOCKET_FILE;
+
+    const char *program_usage_string = _(
+        "& [-vs] [-c NUM] [-i DIR1[:DIR2]...] [-S SOCKET]\n"
+        "\n"
+        "Symbolizes core backtraces sent to SOCKET ("SYMBOLIZER_SOCKET_FILE")\n"
+        "\n"
+        "Symbol and line tables are loaded once per build-id and kept in memory\n"
+        "for NUM most recently used build-ids."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_s = 1 << 1,
+        OPT_c = 1 << 2,
+        OPT_i = 1 << 3,
+        OPT_S = 1 << 4,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&g_verbose),
+        OPT_BOOL(   's', NULL, NULL       , _("Log to syslog")),
+        OPT_INTEGER('c', NULL, &cache_size, _("Number of cached build-ids")),
+        OPT_STRING( 'i', NULL, &i_opt     , "DIR1[:DIR2]...", _("Additional debuginfo directories")),
+        OPT_STRING( 'S', NULL, &socket_path, "SOCKET"        , _("Listen on SOCKET")),
+        OPT_END()
+    };
+    unsigned opts = parse_opts(argc, argv, program_options, program_usage_string);
+
+    export_abrt_envvars(0);
+
+    if (opts & OPT_s)
+        logmode = LOGMODE_JOURNAL;
+
+    if (cache_size <= 0)
+        show_usage_and_die(program_usage_string, program_options);
+
+    map_string_t *settings = new_map_string();
+    if (!load_abrt_plugin_conf_file(CCPP_CONF, settings))
+        error_msg("Can't load '%s'", CCPP_CONF);
+
+    const char *value = get_map_string_item_or_NULL(settings, "DebuginfoLocation");
+    char *debuginfo_location = xasprintf("%s%s%s", value ? value : LOCALSTATEDIR"/cache/abrt-di",
+                                         i_opt ? ":" : "", i_opt ? i_opt : "");
+    free_map_string(settings);
+
+    struct symbolizer symbolizer = {
+        .modules = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)symbolizer_module_free),
+        .cache_size = cache_size,
+    };
+    g_queue_init(&symbolizer.lru);
+
+    /* The same directories get_backtrace() passes to gdb */
+    symbolizer.debuginfo_dirs = g_list_append(NULL, xstrdup("/usr/lib/debug"));
+    struct strbuf *debuginfo_path = strbuf_new();
+    strbuf_append_str(debuginfo_path, "-:.debug:/usr/lib/debug");
+    for (char *dir = strtok(debuginfo_location, ":"); dir != NULL; dir = strtok(NULL, ":"))
+    {
+        symbolizer.debuginfo_dirs = g_list_append(symbolizer.debuginfo_dirs,
+                                                  xasprintf("%s/usr/lib/debug", dir));
+        strbuf_append_strf(debuginfo_path, ":%s/usr/lib/debug", dir);
+    }
+    symbolizer.debuginfo_path = strbuf_free_nobuf(debuginfo_path);
+    free(debuginfo_location);
+
+    signal(SIGPIPE, SIG_IGN);
+    const int socketfd = listen_on_socket(socket_path);
+    drop_privileges();
+    log_info("Accepting connections on '%s'", socket_path);
+
+    serve_clients(&symbolizer, socketfd);
+
+    return 0;
+}
@@ -0,0 +1,1687 @@
+/*
+ * Copyright (C) 2026  ABRT Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "forward-utils.h"
+
+#include <arpa/inet.h>
+#include <grp.h>
+#include <netdb.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+
+#define MAX_LINE_LENGTH 4096
+#define MAX_ELEMENT_NAME_LENGTH 64
+#define MAX_PROBLEM_ID_LENGTH 128
+#define DATA_CHUNK_SIZE (1024 * 1024)
+#define SHA256_HEX_LENGTH 64
+
+#define STATE_INCOMING "incoming"
+#define STATE_OBJECTS "objects"
+#define STATE_DUPHASHES "duphashes"
+#define STATE_COMMITTED "committed"
+#define STATE_COMMITTING "committing"
+#define MANIFEST_NAME ".manifest"
+
+/* Committed problem IDs are remembered for this long to answer SKIP to
+ * clients which did not receive OK */
+#define COMMITTED_EXPIRATION (30 * 24 * 60 * 60)
+
+/* Large elements of a duphash not received for this long are transferred
+ * again */
+#define DUPHASH_EXPIRATION (30 * 24 * 60 * 60)
+
+/* The state directory is cleaned up at most once in this period */
+#define CLEANUP_PERIOD (60 * 60)
+#define CLEANUP_STAMP_NAME ".cleanup"
+
+struct abrt_forward_conn
+{
+    int afc_in;
+    int afc_out;
+    pid_t afc_pid;
+    size_t afc_pos;
+    size_t afc_len;
+    char afc_buf[64 * 1024];
+};
+
+static abrt_forward_conn_t *conn_init(int in_fd, int out_fd)
+{
+    abrt_forward_conn_t *conn = xzalloc(sizeof(*conn));
+    conn->afc_in = in_fd;
+    conn->afc_out = out_fd;
+    conn->afc_pid = -1;
+    return conn;
+}
+
+static int conn_fill(abrt_forward_conn_t *conn)
+{
+    if (conn->afc_pos == conn->afc_len)
+        conn->afc_pos = conn->afc_len = 0;
+
+    if (conn->afc_len == sizeof(conn->afc_buf))
+    {
+        memmove(conn->afc_buf, conn->afc_buf + conn->afc_pos, conn->afc_len - conn->afc_pos);
+        conn->afc_len -= conn->afc_pos;
+        conn->afc_pos = 0;
+    }
+
+    const ssize_t r = safe_read(conn->afc_in, conn->afc_buf + conn->afc_len, sizeof(conn->afc_buf) - conn->afc_len);
+    if (r < 0)
+        perror_msg("Failed to read from the connection");
+    else
+        conn->afc_len += r;
+
+    return r;
+}
+
+/* Returns malloced line without the trailing new line or NULL on EOF */
+static char *conn_read_line(abrt_forward_conn_t *conn)
+{
+    for (;;)
+    {
+        char *start = conn->afc_buf + conn->afc_pos;
+        char *nl = memchr(start, '\n', conn->afc_len - conn->afc_pos);
+        if (nl != NULL)
+        {
+            char *line = xstrndup(start, nl - start);
+            conn->afc_pos += nl - start + 1;
+            log_debug("<- '%s'", line);
+            return line;
+        }
+
+        if (conn->afc_len - conn->afc_pos >= MAX_LINE_LENGTH)
+        {
+            error_msg("Too long line received");
+            return NULL;
+        }
+
+        if (conn_fill(conn) <= 0)
+            return NULL;
+    }
+}
+
+/* Copies exactly len bytes from the connection to fd */
+static int conn_read_to_fd(abrt_forward_conn_t *conn, int fd, off_t len)
+{
+    while (len > 0)
+    {
+        if (conn->afc_pos == conn->afc_len && conn_fill(conn) <= 0)
+        {
+            error_msg("Connection closed in the middle of data");
+            return -1;
+        }
+
+        size_t chunk = conn->afc_len - conn->afc_pos;
+        if ((off_t)chunk > len)
+            chunk = len;
+
+        if (full_write(fd, conn->afc_buf + conn->afc_pos, chunk) != (ssize_t)chunk)
+        {
+            perror_msg("Failed to save received data");
+            return -1;
+        }
+
+        conn->afc_pos += chunk;
+        len -= chunk;
+    }
+
+    return 0;
+}
+
+static int conn_printf(abrt_forward_conn_t *conn, const char *format, ...)
+{
+    va_list p;
+    va_start(p, format);
+    char *line = xvasprintf(format, p);
+    va_end(p);
+
+    log_debug("-> '%.*s'", (int)strlen(line) - 1, line);
+
+    const ssize_t len = strlen(line);
+    const ssize_t r = full_write(conn->afc_out, line, len);
+    free(line);
+
+    if (r != len)
+    {
+        perror_msg("Failed to write to the connection");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Copies len bytes from fd at offset to the connection */
+static int conn_write_from_fd(abrt_forward_conn_t *conn, int fd, off_t offset, off_t len)
+{
+    while (len > 0)
+    {
+        ssize_t r = sendfile(conn->afc_out, fd, &offset, len);
+        if (r < 0 && (errno == EINVAL || errno == ENOSYS))
+        {   /* Fall back to read/write */
+            char buf[64 * 1024];
+            r = pread(fd, buf, len < (off_t)sizeof(buf) ? len : (off_t)sizeof(buf), offset);
+            if (r > 0)
+            {
+                if (full_write(conn->afc_out, buf, r) != r)
+                {
+                    perror_msg("Failed to write to the connection");
+                    return -1;
+                }
+                offset += r;
+            }
+        }
+
+        if (r < 0)
+        {
+            perror_msg("Failed to send data");
+            return -1;
+        }
+
+        if (r == 0)
+        {
+            error_msg("File shrank while being sent");
+            return -1;
+        }
+
+        len -= r;
+    }
+
+    return 0;
+}
+
+void abrt_forward_conn_free(abrt_forward_conn_t *conn)
+{
+    if (conn == NULL)
+        return;
+
+    close(conn->afc_in);
+    if (conn->afc_out != conn->afc_in)
+        close(conn->afc_out);
+
+    if (conn->afc_pid > 0)
+        safe_waitpid(conn->afc_pid, NULL, 0);
+
+    free(conn);
+}
+
+/* Returns malloced hex digest or NULL */
+static char *sha256_fd(int fd)
+{
+    GChecksum *cs = g_checksum_new(G_CHECKSUM_SHA256);
+    char buf[64 * 1024];
+    off_t offset = 0;
+    ssize_t r;
+    while ((r = pread(fd, buf, sizeof(buf), offset)) > 0)
+    {
+        g_checksum_update(cs, (const guchar *)buf, r);
+        offset += r;
+    }
+
+    char *digest = NULL;
+    if (r < 0)
+        perror_msg("Failed to compute checksum");
+    else
+        digest = xstrdup(g_checksum_get_string(cs));
+
+    g_checksum_free(cs);
+    return digest;
+}
+
+static bool is_sha256(const char *str)
+{
+    return strlen(str) == SHA256_HEX_LENGTH
+        && strspn(str, "0123456789abcdef") == SHA256_HEX_LENGTH;
+}
+
+/* Duphashes are hex strings, but let's not trust the clients */
+static bool is_valid_duphash(const char *str)
+{
+    const size_t len = strlen(str);
+    return len > 0 && len <= SHA256_HEX_LENGTH
+        && strspn(str, "0123456789abcdefABCDEF") == len;
+}
+
+static bool is_valid_element_name(const char *name)
+{
+    return name[0] != '.'
+        && strlen(name) <= MAX_ELEMENT_NAME_LENGTH
+        && str_is_correct_filename(name);
+}
+
+static bool is_valid_problem_id(const char *id)
+{
+    return id[0] != '.'
+        && strlen(id) <= MAX_PROBLEM_ID_LENGTH
+        && str_is_correct_filename(id);
+}
+
+/*
+ * Collector
+ */
+
+enum element_state
+{
+    ELEMENT_NEED,      /* (the rest of) data must be received */
+    ELEMENT_HAVE,      /* completely received */
+    ELEMENT_OBJECT,    /* will be taken from the object store */
+    ELEMENT_SKIP,      /* large element of a known problem */
+};
+
+struct element
+{
+    char *name;
+    off_t size;
+    off_t offset;
+    char sha256[SHA256_HEX_LENGTH + 1];
+    enum element_state state;
+};
+
+static void element_free(struct element *el)
+{
+    if (el == NULL)
+        return;
+
+    free(el->name);
+    free(el);
+}
+
+static struct element *find_element(GList *elements, const char *name)
+{
+    for (GList *iter = elements; iter != NULL; iter = g_list_next(iter))
+    {
+        struct element *el = iter->data;
+        if (strcmp(el->name, name) == 0)
+            return el;
+    }
+
+    return NULL;
+}
+
+static struct element *parse_element_line(const char *line)
+{
+    char name[MAX_ELEMENT_NAME_LENGTH + 1];
+    char sha256[SHA256_HEX_LENGTH + 1];
+    long long size;
+    if (sscanf(line, "ELEMENT %64s %lld %64s", name, &size, sha256) != 3
+        || size < 0 || !is_valid_element_name(name) || !is_sha256(sha256))
+        return NULL;
+
+    struct element *el = xzalloc(sizeof(*el));
+    el->name = xstrdup(name);
+    el->size = size;
+    strcpy(el->sha256, sha256);
+    return el;
+}
+
+/* The manifest remembers sizes and checksums of elements of a partially
+ * received problem, so the received data can be re-used only if the
+ * element has not changed on the client. */
+static GHashTable *load_manifest(int staging_fd)
+{
+    GHashTable *manifest = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+
+    const int fd = openat(staging_fd, MANIFEST_NAME, O_RDONLY);
+    if (fd < 0)
+        return manifest;
+
+    FILE *fp = fdopen(fd, "r");
+    char *line;
+    while ((line = xmalloc_fgetline(fp)) != NULL)
+    {
+        char *space = strchr(line, ' ');
+        if (space != NULL)
+        {
+            *space = '\0';
+            g_hash_table_replace(manifest, xstrdup(line), xstrdup(space + 1));
+        }
+        free(line);
+    }
+    fclose(fp);
+
+    return manifest;
+}
+
+static int save_manifest(int staging_fd, GList *elements)
+{
+    const int fd = openat(staging_fd, MANIFEST_NAME".tmp", O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't create manifest");
+        return -1;
+    }
+
+    FILE *fp = fdopen(fd, "w");
+    for (GList *iter = elements; iter != NULL; iter = g_list_next(iter))
+    {
+        struct element *el = iter->data;
+        if (el->state == ELEMENT_NEED || el->state == ELEMENT_HAVE)
+            fprintf(fp, "%s %lld %s\n", el->name, (long long)el->size, el->sha256);
+    }
+
+    if (fclose(fp) != 0 || renameat(staging_fd, MANIFEST_NAME".tmp", staging_fd, MANIFEST_NAME) != 0)
+    {
+        perror_msg("Can't save manifest");
+        return -1;
+    }
+
+    return 0;
+}
+
+static bool state_file_exists(const char *state_dir, const char *subdir, const char *name)
+{
+    char *path = concat_path_file(state_dir, subdir);
+    char *file = concat_path_file(path, name);
+    const bool exists = access(file, F_OK) == 0;
+    free(file);
+    free(path);
+    return exists;
+}
+
+static void state_file_touch(const char *state_dir, const char *subdir, const char *name)
+{
+    char *path = concat_path_file(state_dir, subdir);
+    /* The unprivileged receiver checks the files */
+    g_mkdir_with_parents(path, 0711);
+    char *file = concat_path_file(path, name);
+    const int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        perror_msg("Can't create '%s'", file);
+    else
+        close(fd);
+    free(file);
+    free(path);
+}
+
+static char *object_path(const char *state_dir, const char *sha256)
+{
+    return xasprintf("%s/"STATE_OBJECTS"/%s", state_dir, sha256);
+}
+
+static bool object_exists(const char *state_dir, struct element *el)
+{
+    char *path = object_path(state_dir, el->sha256);
+    struct stat sb;
+    const bool exists = stat(path, &sb) == 0 && sb.st_size == el->size;
+    free(path);
+    return exists;
+}
+
+/* Decides what to do with all announced elements and prepares the staging
+ * directory for received data */
+static int plan_transfer(int staging_fd, GList *elements, bool known_duphash,
+        const struct abrt_forward_collector_conf *conf)
+{
+    GHashTable *manifest = load_manifest(staging_fd);
+
+    for (GList *iter = elements; iter != NULL; iter = g_list_next(iter))
+    {
+        struct element *el = iter->data;
+
+        if (el->size >= conf->afcc_dedup_min_size && object_exists(conf->afcc_state_dir, el))
+        {
+            el->state = ELEMENT_OBJECT;
+            continue;
+        }
+
+        if (known_duphash && el->size >= conf->afcc_dedup_min_size)
+        {
+            el->state = ELEMENT_SKIP;
+            continue;
+        }
+
+        char *expected = xasprintf("%lld %s", (long long)el->size, el->sha256);
+        const char *staged = g_hash_table_lookup(manifest, el->name);
+        const bool same = staged != NULL && strcmp(staged, expected) == 0;
+        free(expected);
+
+        struct stat sb;
+        if (same && fstatat(staging_fd, el->name, &sb, AT_SYMLINK_NOFOLLOW) == 0
+            && S_ISREG(sb.st_mode) && sb.st_size <= el->size)
+            el->offset = sb.st_size;
+        else
+            el->offset = 0;
+
+        const int fd = openat(staging_fd, el->name, O_WRONLY | O_CREAT | O_NOFOLLOW, 0600);
+        if (fd < 0 || ftruncate(fd, el->offset) != 0)
+        {
+            perror_msg("Can't prepare element '%s'", el->name);
+            if (fd >= 0)
+                close(fd);
+            g_hash_table_destroy(manifest);
+            return -1;
+        }
+        close(fd);
+
+        el->state = el->offset == el->size ? ELEMENT_HAVE : ELEMENT_NEED;
+    }
+
+    g_hash_table_destroy(manifest);
+    return save_manifest(staging_fd, elements);
+}
+
+static int receive_data(abrt_forward_conn_t *conn, int staging_fd, GList *elements, const char *line)
+{
+    char name[MAX_ELEMENT_NAME_LENGTH + 1];
+    long long offset;
+    long long length;
+    if (sscanf(line, "DATA %64s %lld %lld", name, &offset, &length) != 3 || length < 0)
+    {
+        error_msg("Malformed DATA line");
+        return -1;
+    }
+
+    struct element *el = find_element(elements, name);
+    if (el == NULL || el->state != ELEMENT_NEED || el->offset != offset || el->size - el->offset < length)
+    {
+        error_msg("Unexpected data of '%s'", name);
+        return -1;
+    }
+
+    const int fd = openat(staging_fd, el->name, O_WRONLY | O_APPEND | O_NOFOLLOW);
+    if (fd < 0)
+    {
+        perror_msg("Can't open '%s'", el->name);
+        return -1;
+    }
+
+    const int r = conn_read_to_fd(conn, fd, length);
+    close(fd);
+    if (r != 0)
+        return -1;
+
+    el->offset += length;
+    if (el->offset == el->size)
+        el->state = ELEMENT_HAVE;
+
+    return 0;
+}
+
+/* Removes all files in a flat directory and the directory itself */
+static void remove_staging(const char *staging)
+{
+    DIR *dir = opendir(staging);
+    if (dir != NULL)
+    {
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+            if (!dot_or_dotdot(dent->d_name))
+                unlinkat(dirfd(dir), dent->d_name, 0);
+        closedir(dir);
+    }
+
+    if (rmdir(staging) != 0 && errno != ENOENT)
+        perror_msg("Can't remove '%s'", staging);
+}
+
+/* Committed problems belong to root (or the user running the collector) and
+ * the abrt group */
+static void problem_owner(uid_t *uid, gid_t *gid)
+{
+    *uid = geteuid();
+    *gid = getegid();
+    if (*uid == 0)
+    {
+        struct group *gr = getgrnam("abrt");
+        if (gr != NULL)
+            *gid = gr->gr_gid;
+    }
+}
+
+static int save_text_at(int dir_fd, const char *name, const char *text)
+{
+    const int fd = openat(dir_fd, name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, DEFAULT_DUMP_DIR_MODE);
+    if (fd < 0)
+        return -1;
+
+    const ssize_t len = strlen(text);
+    const int r = full_write(fd, text, len) == len ? 0 : -1;
+    close(fd);
+    return r;
+}
+
+/* Removes everything but regular files of the announced elements */
+static int remove_unexpected_files(int dir_fd, GList *elements)
+{
+    const int fd = dup(dir_fd);
+    DIR *dir = fd < 0 ? NULL : fdopendir(fd);
+    if (dir == NULL)
+    {
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    int r = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (dot_or_dotdot(dent->d_name))
+            continue;
+
+        struct stat sb;
+        if (find_element(elements, dent->d_name) != NULL
+            && fstatat(dir_fd, dent->d_name, &sb, AT_SYMLINK_NOFOLLOW) == 0
+            && S_ISREG(sb.st_mode))
+            continue;
+
+        if (unlinkat(dir_fd, dent->d_name, 0) != 0)
+        {
+            perror_msg("Can't remove unexpected '%s'", dent->d_name);
+            r = -1;
+        }
+    }
+    closedir(dir);
+
+    return r;
+}
+
+/* Returns 0 if the object has the checksum its name claims */
+static int check_object(const char *object, const struct element *el)
+{
+    const int fd = open(object, O_RDONLY | O_NOFOLLOW);
+    if (fd < 0)
+        return -1;
+
+    struct stat sb;
+    char *digest = fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size == el->size ? sha256_fd(fd) : NULL;
+    close(fd);
+
+    const int r = digest != NULL && strcmp(digest, el->sha256) == 0 ? 0 : -1;
+    free(digest);
+    return r;
+}
+
+/* Checks a received element and hands it over to the problem owner */
+static int check_received_element(int dir_fd, const struct element *el,
+        uid_t receiver_uid, uid_t uid, gid_t gid)
+{
+    const int fd = openat(dir_fd, el->name, O_RDONLY | O_NOFOLLOW);
+    if (fd < 0)
+        return -1;
+
+    struct stat sb;
+    int r = -1;
+    /* Only a file created by the receiver is acceptable, not a link to
+     * somebody else's file */
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_nlink == 1
+        && (receiver_uid == (uid_t)-1 || sb.st_uid == receiver_uid))
+    {
+        char *digest = sha256_fd(fd);
+        if (digest != NULL && strcmp(digest, el->sha256) == 0
+            && fchown(fd, uid, gid) == 0 && fchmod(fd, DEFAULT_DUMP_DIR_MODE) == 0)
+            r = 0;
+        free(digest);
+    }
+    close(fd);
+
+    return r;
+}
+
+/* Moves the received problem to the dump location and returns the malloced
+ * response line for the client. The staging directory is taken away from
+ * the receiver first, so it can't change the data after they were checked.
+ * The received files must be owned by receiver_uid unless it is -1.
+ */
+static char *commit_problem(const char *problem_id, const char *duphash, GList *elements,
+        uid_t receiver_uid, const struct abrt_forward_collector_conf *conf)
+{
+    uid_t uid;
+    gid_t gid;
+    problem_owner(&uid, &gid);
+
+    char *staging = xasprintf("%s/"STATE_INCOMING"/%s", conf->afcc_state_dir, problem_id);
+    char *committing = xasprintf("%s/"STATE_COMMITTING"/%s", conf->afcc_state_dir, problem_id);
+    char *problem_dir = concat_path_file(conf->afcc_dump_location, problem_id);
+    char *objects = concat_path_file(conf->afcc_state_dir, STATE_OBJECTS);
+    char *response = NULL;
+    int dir_fd = -1;
+
+    char *parent = concat_path_file(conf->afcc_state_dir, STATE_COMMITTING);
+    g_mkdir_with_parents(parent, 0700);
+    free(parent);
+    g_mkdir_with_parents(objects, 0711);
+
+    /* A leftover of an interrupted commit */
+    remove_staging(committing);
+
+    struct stat sb;
+    if (rename(staging, committing) != 0
+        || (dir_fd = open(committing, O_RDONLY | O_DIRECTORY | O_NOFOLLOW)) < 0
+        || fstat(dir_fd, &sb) != 0
+        || (receiver_uid != (uid_t)-1 && sb.st_uid != receiver_uid)
+        /* The receiver can't write to the directory from now on */
+        || fchown(dir_fd, uid, gid) != 0
+        || fchmod(dir_fd, 0700) != 0)
+    {
+        perror_msg("Can't take over '%s'", staging);
+        response = xstrdup("RETRY Can't save the problem");
+        goto finito;
+    }
+
+    if (remove_unexpected_files(dir_fd, elements) != 0)
+    {
+        response = xstrdup("ERR Can't store the problem");
+        goto finito;
+    }
+
+    unsigned long long total_size = 0;
+    for (GList *iter = elements; iter != NULL; iter = g_list_next(iter))
+    {
+        struct element *el = iter->data;
+        char *object = object_path(conf->afcc_state_dir, el->sha256);
+
+        switch (el->state)
+        {
+            case ELEMENT_NEED:
+                response = xasprintf("ERR Element '%s' is incomplete", el->name);
+                break;
+
+            case ELEMENT_SKIP:
+                unlinkat(dir_fd, el->name, 0);
+                break;
+
+            case ELEMENT_OBJECT:
+                unlinkat(dir_fd, el->name, 0);
+                /* Objects are linked to problem directories whose elements
+                 * can be modified, don't trust the name */
+                if (check_object(object, el) != 0)
+                {
+                    log_notice("Stored '%s' does not match its checksum, dropping it", el->name);
+                    unlink(object);
+                    response = xasprintf("RETRY Can't use stored '%s'", el->name);
+                    break;
+                }
+
+                if (linkat(AT_FDCWD, object, dir_fd, el->name, 0) != 0)
+                {
+                    char *path = concat_path_file(committing, el->name);
+                    const int r = copy_file(object, path, DEFAULT_DUMP_DIR_MODE);
+                    free(path);
+                    if (r < 0)
+                        response = xasprintf("RETRY Can't use stored '%s'", el->name);
+                }
+                total_size += el->size;
+                break;
+
+            case ELEMENT_HAVE:
+                if (check_received_element(dir_fd, el, receiver_uid, uid, gid) != 0)
+                {
+                    response = xasprintf("RETRY Checksum of '%s' does not match", el->name);
+                    break;
+                }
+
+                if (el->size >= conf->afcc_dedup_min_size
+                    && linkat(dir_fd, el->name, AT_FDCWD, object, 0) != 0 && errno != EEXIST)
+                    log_info("Can't store '%s' as object: %s", el->name, strerror(errno));
+                total_size += el->size;
+                break;
+        }
+
+        free(object);
+        if (response != NULL)
+            goto finito;
+    }
+
+    if (conf->afcc_max_problem_size != 0 && total_size > conf->afcc_max_problem_size)
+    {
+        log_notice("Problem '%s' is too big (%llu bytes)", problem_id, total_size);
+        response = xstrdup("ERR The problem is too big");
+        goto finito;
+    }
+
+    /* Same as abrt-handle-upload does for uploaded problems */
+    save_text_at(dir_fd, FILENAME_REMOTE, "1");
+    IGNORE_RESULT(fchownat(dir_fd, FILENAME_REMOTE, uid, gid, AT_SYMLINK_NOFOLLOW));
+    if (renameat(dir_fd, FILENAME_COUNT, dir_fd, "remote_count") != 0 && errno != ENOENT)
+        perror_msg("Can't rename '%s'", FILENAME_COUNT);
+
+    if (fchmod(dir_fd, DEFAULT_DUMP_DIR_MODE | S_IXUSR | S_IXGRP) != 0)
+        perror_msg("Can't sanitize '%s'", committing);
+
+    if (rename(committing, problem_dir) != 0)
+    {
+        if (errno == EEXIST || errno == ENOTEMPTY)
+        {
+            log_notice("Problem '%s' has already been received", problem_dir);
+            state_file_touch(conf->afcc_state_dir, STATE_COMMITTED, problem_id);
+            response = xasprintf("OK %s", problem_dir);
+            goto finito;
+        }
+
+        if (errno != EXDEV || copy_file_recursive(committing, problem_dir) != 0)
+        {
+            perror_msg("Can't move '%s' to '%s'", committing, problem_dir);
+            response = xstrdup("RETRY Can't save the problem");
+            goto finito;
+        }
+    }
+
+    if (duphash != NULL)
+        state_file_touch(conf->afcc_state_dir, STATE_DUPHASHES, duphash);
+    state_file_touch(conf->afcc_state_dir, STATE_COMMITTED, problem_id);
+
+    log_notice("Received problem '%s'", problem_dir);
+    notify_new_path(problem_dir);
+
+    response = xasprintf("OK %s", problem_dir);
+
+finito:
+    if (dir_fd >= 0)
+        close(dir_fd);
+    /* Failed commits are received again from scratch */
+    remove_staging(committing);
+    free(objects);
+    free(problem_dir);
+    free(committing);
+    free(staging);
+    return response;
+}
+
+static const char *const element_state_names[] = {
+    [ELEMENT_NEED] = "NEED",
+    [ELEMENT_HAVE] = "HAVE",
+    [ELEMENT_OBJECT] = "OBJECT",
+    [ELEMENT_SKIP] = "SKIP",
+};
+
+/* Asks the privileged committer to commit the received problem, returns
+ * the malloced response line for the client */
+static char *request_commit(int commit_fd, const char *problem_id, const char *duphash, GList *elements)
+{
+    abrt_forward_conn_t *committer = conn_init(commit_fd, commit_fd);
+
+    char *response = NULL;
+    if (conn_printf(committer, "COMMIT %s %s\n", problem_id, duphash ? duphash : "-") != 0)
+        goto finito;
+
+    for (GList *iter = elements; iter != NULL; iter = g_list_next(iter))
+    {
+        struct element *el = iter->data;
+        if (conn_printf(committer, "ELEMENT %s %lld %s %s\n", el->name, (long long)el->size,
+                        el->sha256, element_state_names[el->state]) != 0)
+            goto finito;
+    }
+
+    if (conn_printf(committer, "END\n") == 0)
+        response = conn_read_line(committer);
+
+finito:
+    /* The caller owns the file descriptor */
+    free(committer);
+    return response ? response : xstrdup("RETRY Can't save the problem");
+}
+
+/* Returns -1 if the receiver must be stopped */
+static int serve_commit_request(abrt_forward_conn_t *receiver, const char *args, uid_t receiver_uid,
+        const struct abrt_forward_collector_conf *conf)
+{
+    char problem_id[MAX_PROBLEM_ID_LENGTH + 1];
+    char duphash[SHA256_HEX_LENGTH + 1];
+    if (sscanf(args, "%128s %64s", problem_id, duphash) != 2 || !is_valid_problem_id(problem_id)
+        || (strcmp(duphash, "-") != 0 && !is_valid_duphash(duphash)))
+    {
+        error_msg("Malformed commit request");
+        return -1;
+    }
+
+    int r = -1;
+    GList *elements = NULL;
+    char *line;
+    while ((line = conn_read_line(receiver)) != NULL && strcmp(line, "END") != 0)
+    {
+        char state[8];
+        struct element *el = parse_element_line(line);
+        if (el == NULL || find_element(elements, el->name) != NULL
+            || sscanf(line, "ELEMENT %*s %*s %*s %7s", state) != 1)
+        {
+            element_free(el);
+            error_msg("Malformed commit request");
+            goto cleanup;
+        }
+
+        el->state = ELEMENT_NEED;
+        for (unsigned i = 0; i < ARRAY_SIZE(element_state_names); ++i)
+            if (strcmp(state, element_state_names[i]) == 0)
+                el->state = i;
+
+        elements = g_list_prepend(elements, el);
+        free(line);
+    }
+
+    if (line == NULL)
+        goto cleanup;
+
+    char *response = commit_problem(problem_id, strcmp(duphash, "-") != 0 ? duphash : NULL,
+                                    elements, receiver_uid, conf);
+    r = conn_printf(receiver, "%s\n", response);
+    free(response);
+
+cleanup:
+    free(line);
+    g_list_free_full(elements, (GDestroyNotify)element_free);
+    return r;
+}
+
+int abrt_forward_committer_serve(int fd, uid_t receiver_uid, const struct abrt_forward_collector_conf *conf)
+{
+    abrt_forward_conn_t *receiver = conn_init(fd, fd);
+
+    int r = 0;
+    char *line;
+    while (r == 0 && (line = conn_read_line(receiver)) != NULL)
+    {
+        r = prefixcmp(line, "COMMIT ") == 0
+            ? serve_commit_request(receiver, line + strlen("COMMIT "), receiver_uid, conf)
+            : -1;
+        free(line);
+    }
+
+    /* The caller owns the file descriptor */
+    free(receiver);
+    return r == 0 ? 0 : 1;
+}
+
+/* Returns -1 if the connection must be closed */
+static int serve_problem(abrt_forward_conn_t *conn, const char *args,
+        const struct abrt_forward_collector_conf *conf)
+{
+    char problem_id[MAX_PROBLEM_ID_LENGTH + 1];
+    char duphash[SHA256_HEX_LENGTH + 1];
+    if (sscanf(args, "%128s %64s", problem_id, duphash) != 2 || !is_valid_problem_id(problem_id))
+    {
+        conn_printf(conn, "ERR Malformed PROBLEM line\n");
+        return -1;
+    }
+
+    const char *known = strcmp(duphash, "-") != 0 && is_valid_duphash(duphash) ? duphash : NULL;
+
+    int r = -1;
+    char *staging = NULL;
+    int staging_fd = -1;
+    GList *elements = NULL;
+    unsigned long long total_size = 0;
+    char *line;
+    while ((line = conn_read_line(conn)) != NULL && strcmp(line, "END") != 0)
+    {
+        struct element *el = parse_element_line(line);
+        if (el == NULL || find_element(elements, el->name) != NULL)
+        {
+            element_free(el);
+            conn_printf(conn, "ERR Malformed ELEMENT line\n");
+            goto cleanup;
+        }
+
+        total_size += el->size;
+        elements = g_list_prepend(elements, el);
+        free(line);
+    }
+
+    if (line == NULL)
+        goto cleanup;
+    free(line);
+    line = NULL;
+
+    if (state_file_exists(conf->afcc_state_dir, STATE_COMMITTED, problem_id))
+    {
+        r = conn_printf(conn, "SKIP\n");
+        goto cleanup;
+    }
+
+    if (conf->afcc_max_problem_size != 0 && total_size > conf->afcc_max_problem_size)
+    {
+        log_notice("Problem '%s' is too big (%llu bytes)", problem_id, total_size);
+        r = conn_printf(conn, "ERR The problem is too big\n");
+        goto cleanup;
+    }
+
+    const bool known_duphash = known && state_file_exists(conf->afcc_state_dir, STATE_DUPHASHES, known);
+
+    staging = xasprintf("%s/"STATE_INCOMING"/%s", conf->afcc_state_dir, problem_id);
+    if (g_mkdir_with_parents(staging, 0700) != 0
+        || (staging_fd = open(staging, O_RDONLY | O_DIRECTORY | O_NOFOLLOW)) < 0)
+    {
+        perror_msg("Can't create '%s'", staging);
+        conn_printf(conn, "ERR Can't store the problem\n");
+        goto cleanup;
+    }
+
+    if (plan_transfer(staging_fd, elements, known_duphash, conf) != 0)
+    {
+        conn_printf(conn, "ERR Can't store the problem\n");
+        goto cleanup;
+    }
+
+    for (GList *iter = elements; iter != NULL; iter = g_list_next(iter))
+    {
+        struct element *el = iter->data;
+        if (el->state == ELEMENT_NEED && conn_printf(conn, "NEED %s %lld\n", el->name, (long long)el->offset) != 0)
+            goto cleanup;
+    }
+
+    if (conn_printf(conn, "READY\n") != 0)
+        goto cleanup;
+
+    while ((line = conn_read_line(conn)) != NULL)
+    {
+        if (strcmp(line, "COMMIT") == 0)
+        {
+            close(staging_fd);
+            staging_fd = -1;
+
+            char *response = conf->afcc_commit_fd >= 0
+                    ? request_commit(conf->afcc_commit_fd, problem_id, known, elements)
+                    : commit_problem(problem_id, known, elements, (uid_t)-1, conf);
+            r = conn_printf(conn, "%s\n", response);
+            free(response);
+            break;
+        }
+
+        if (prefixcmp(line, "DATA ") != 0 || receive_data(conn, staging_fd, elements, line) != 0)
+        {
+            conn_printf(conn, "ERR Protocol error\n");
+            break;
+        }
+
+        free(line);
+    }
+
+cleanup:
+    free(line);
+    if (staging_fd >= 0)
+        close(staging_fd);
+    free(staging);
+    g_list_free_full(elements, (GDestroyNotify)element_free);
+    return r;
+}
+
+int abrt_forward_serve(int in_fd, int out_fd, const struct abrt_forward_collector_conf *conf)
+{
+    abrt_forward_conn_t *conn = conn_init(in_fd, out_fd);
+
+    int r = 1;
+    char *line = conn_read_line(conn);
+    if (line == NULL || strcmp(line, ABRT_FORWARD_PROTOCOL_HEADER) != 0)
+    {
+        error_msg("Unsupported client");
+        conn_printf(conn, "ERR Unsupported protocol\n");
+        goto finito;
+    }
+
+    if (conn_printf(conn, ABRT_FORWARD_PROTOCOL_HEADER"\n") != 0)
+        goto finito;
+
+    for (;;)
+    {
+        free(line);
+        line = conn_read_line(conn);
+        if (line == NULL || strcmp(line, "BYE") == 0)
+        {
+            r = 0;
+            break;
+        }
+
+        if (prefixcmp(line, "PROBLEM ") != 0)
+        {
+            conn_printf(conn, "ERR Unknown command\n");
+            break;
+        }
+
+        if (serve_problem(conn, line + strlen("PROBLEM "), conf) != 0)
+            break;
+    }
+
+finito:
+    free(line);
+    /* The caller owns the file descriptors */
+    free(conn);
+    return r;
+}
+
+/* Removes entries of the state subdirectory not modified for max_age seconds */
+static void expire_state_files(const char *state_dir, const char *subdir, time_t max_age)
+{
+    char *path = concat_path_file(state_dir, subdir);
+    DIR *dir = opendir(path);
+    if (dir != NULL)
+    {
+        const time_t now = time(NULL);
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+        {
+            struct stat sb;
+            if (dot_or_dotdot(dent->d_name)
+                || fstatat(dirfd(dir), dent->d_name, &sb, AT_SYMLINK_NOFOLLOW) != 0
+                || now - sb.st_mtime <= max_age)
+                continue;
+
+            if (S_ISDIR(sb.st_mode))
+            {
+                char *entry = concat_path_file(path, dent->d_name);
+                remove_staging(entry);
+                free(entry);
+            }
+            else
+                unlinkat(dirfd(dir), dent->d_name, 0);
+        }
+        closedir(dir);
+    }
+    free(path);
+}
+
+void abrt_forward_collector_cleanup(const char *state_dir)
+{
+    /* Every connection calls this, walk the state directory only once in
+     * a while */
+    char *stamp = concat_path_file(state_dir, CLEANUP_STAMP_NAME);
+    struct stat sb;
+    const bool recently = stat(stamp, &sb) == 0 && time(NULL) - sb.st_mtime < CLEANUP_PERIOD;
+    if (!recently)
+    {
+        const int fd = open(stamp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600);
+        if (fd >= 0)
+            close(fd);
+    }
+    free(stamp);
+
+    if (recently)
+        return;
+
+    char *objects = concat_path_file(state_dir, STATE_OBJECTS);
+    DIR *dir = opendir(objects);
+    if (dir != NULL)
+    {
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+        {
+            /* No problem directory links the object */
+            if (!dot_or_dotdot(dent->d_name)
+                && fstatat(dirfd(dir), dent->d_name, &sb, AT_SYMLINK_NOFOLLOW) == 0
+                && sb.st_nlink == 1)
+            {
+                log_info("Removing unused object '%s'", dent->d_name);
+                unlinkat(dirfd(dir), dent->d_name, 0);
+            }
+        }
+        closedir(dir);
+    }
+    free(objects);
+
+    expire_state_files(state_dir, STATE_COMMITTED, COMMITTED_EXPIRATION);
+    expire_state_files(state_dir, STATE_DUPHASHES, DUPHASH_EXPIRATION);
+    /* Leftovers of crashed collectors */
+    expire_state_files(state_dir, STATE_COMMITTING, CLEANUP_PERIOD);
+}
+
+/* Parses an IPv4 or IPv6 address, IPv4-mapped IPv6 addresses are returned
+ * as IPv4. Returns the address length in bytes or 0 on error. */
+static unsigned parse_address(const char *text, unsigned char address[16])
+{
+    if (inet_pton(AF_INET, text, address) == 1)
+        return 4;
+
+    if (inet_pton(AF_INET6, text, address) != 1)
+        return 0;
+
+    static const unsigned char v4_mapped[12] = { [10] = 0xff, [11] = 0xff };
+    if (memcmp(address, v4_mapped, sizeof(v4_mapped)) == 0)
+    {
+        memmove(address, address + sizeof(v4_mapped), 4);
+        return 4;
+    }
+
+    return 16;
+}
+
+/* Returns true if the address matches "ADDRESS" or "ADDRESS/PREFIX" */
+static bool address_matches(const unsigned char *address, unsigned len, const char *entry)
+{
+    char *network = xstrdup(entry);
+    char *slash = strchr(network, '/');
+    if (slash != NULL)
+        *slash = '\0';
+
+    unsigned char network_address[16];
+    const unsigned network_len = parse_address(network, network_address);
+
+    unsigned long prefix = network_len * 8;
+    if (slash != NULL)
+    {
+        char *end;
+        errno = 0;
+        prefix = strtoul(slash + 1, &end, 10);
+        if (errno != 0 || end == slash + 1 || *end != '\0')
+            prefix = ULONG_MAX;
+    }
+    free(network);
+
+    if (network_len == 0 || prefix > network_len * 8)
+    {
+        log_warning("Invalid client address '%s'", entry);
+        return false;
+    }
+
+    if (network_len != len)
+        return false;
+
+    const unsigned bytes = prefix / 8;
+    const unsigned bits = prefix % 8;
+    if (memcmp(address, network_address, bytes) != 0)
+        return false;
+
+    if (bits == 0)
+        return true;
+
+    const unsigned char mask = 0xff << (8 - bits);
+    return (address[bytes] & mask) == (network_address[bytes] & mask);
+}
+
+bool abrt_forward_address_allowed(const char *address, GList *allowed_clients)
+{
+    unsigned char parsed[16];
+    const unsigned len = parse_address(address, parsed);
+    if (len == 0)
+        return false;
+
+    /* Loopback, the socket listens there by default */
+    if (address_matches(parsed, len, len == 4 ? "127.0.0.0/8" : "::1"))
+        return true;
+
+    for (GList *iter = allowed_clients; iter != NULL; iter = g_list_next(iter))
+    {
+        if (address_matches(parsed, len, iter->data))
+            return true;
+    }
+
+    return false;
+}
+
+bool abrt_forward_client_allowed(int fd, GList *allowed_clients)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (getpeername(fd, (struct sockaddr *)&addr, &addr_len) != 0)
+    {
+        /* Not a socket, e.g. ssh authenticated the client */
+        if (errno == ENOTSOCK)
+            return true;
+
+        perror_msg("Can't get address of the client");
+        return false;
+    }
+
+    if (addr.ss_family == AF_UNIX)
+        return true;
+
+    char host[NI_MAXHOST];
+    const int r = getnameinfo((struct sockaddr *)&addr, addr_len, host, sizeof(host), NULL, 0, NI_NUMERICHOST);
+    if (r != 0)
+    {
+        error_msg("Can't get address of the client: %s", gai_strerror(r));
+        return false;
+    }
+
+    if (!abrt_forward_address_allowed(host, allowed_clients))
+    {
+        error_msg("Client '%s' is not allowed by AllowedClients", host);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Client
+ */
+
+static bool client_handshake(abrt_forward_conn_t *conn)
+{
+    if (conn_printf(conn, ABRT_FORWARD_PROTOCOL_HEADER"\n") != 0)
+        return false;
+
+    char *line = conn_read_line(conn);
+    const bool ok = line != NULL && strcmp(line, ABRT_FORWARD_PROTOCOL_HEADER) == 0;
+    if (!ok)
+        error_msg("The collector does not support the protocol: '%s'", line ? line : "");
+    free(line);
+
+    return ok;
+}
+
+abrt_forward_conn_t *abrt_forward_conn_new(int in_fd, int out_fd)
+{
+    abrt_forward_conn_t *conn = conn_init(in_fd, out_fd);
+    if (client_handshake(conn))
+        return conn;
+
+    abrt_forward_conn_free(conn);
+    return NULL;
+}
+
+static int connect_command(const char *command, pid_t *pid)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0)
+    {
+        perror_msg("socketpair");
+        return -1;
+    }
+
+    *pid = fork();
+    if (*pid < 0)
+    {
+        perror_msg("fork");
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    if (*pid == 0)
+    {
+        xdup2(sv[1], STDIN_FILENO);
+        xdup2(sv[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        perror_msg_and_die("Can't execute '%s'", command);
+    }
+
+    close(sv[1]);
+    return sv[0];
+}
+
+static int connect_host(const char *collector)
+{
+    char *host = xstrdup(collector);
+    const char *port = ABRT_FORWARD_DEFAULT_PORT;
+
+    /* [IPv6]:port, host:port or just host */
+    char *colon = strrchr(host, ':');
+    if (host[0] == '[')
+    {
+        char *bracket = strchr(host, ']');
+        if (bracket != NULL)
+        {
+            *bracket = '\0';
+            if (bracket[1] == ':')
+                port = bracket + 2;
+            memmove(host, host + 1, strlen(host));
+        }
+    }
+    else if (colon != NULL)
+    {
+        *colon = '\0';
+        port = colon + 1;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *result = NULL;
+    const int gai = getaddrinfo(host, port, &hints, &result);
+    if (gai != 0)
+    {
+        error_msg("Can't resolve '%s': %s", collector, gai_strerror(gai));
+        free(host);
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = result; ai != NULL; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0)
+        perror_msg("Can't connect to '%s'", collector);
+
+    freeaddrinfo(result);
+    free(host);
+    return fd;
+}
+
+abrt_forward_conn_t *abrt_forward_connect(const char *collector)
+{
+    pid_t pid = -1;
+    const int fd = collector[0] == '|' ? connect_command(collector + 1, &pid)
+                                       : connect_host(collector);
+    if (fd < 0)
+        return NULL;
+
+    abrt_forward_conn_t *conn = conn_init(fd, fd);
+    conn->afc_pid = pid;
+
+    if (client_handshake(conn))
+        return conn;
+
+    abrt_forward_conn_free(conn);
+    return NULL;
+}
+
+char *abrt_forward_problem_id(const char *dirname)
+{
+    struct utsname uts;
+    if (uname(&uts) != 0)
+        strcpy(uts.nodename, "localhost");
+
+    /* Keep the ID a valid file name */
+    for (char *c = uts.nodename; *c != '\0'; ++c)
+        if (!isalnum(*c) && *c != '.' && *c != '-' && *c != '_')
+            *c = '_';
+
+    char *id = xasprintf("%s-%s", strrchr(dirname, '/') ? strrchr(dirname, '/') + 1 : dirname, uts.nodename);
+    if (strlen(id) > MAX_PROBLEM_ID_LENGTH)
+        id[MAX_PROBLEM_ID_LENGTH] = '\0';
+
+    return id;
+}
+
+struct local_element
+{
+    struct element el;
+    int fd;
+};
+
+static void local_element_free(struct local_element *lel)
+{
+    if (lel == NULL)
+        return;
+
+    if (lel->fd >= 0)
+        close(lel->fd);
+    free(lel->el.name);
+    free(lel);
+}
+
+static GList *collect_local_elements(struct dump_dir *dd)
+{
+    GList *elements = NULL;
+
+    char *short_name;
+    dd_init_next_file(dd);
+    while (dd_get_next_file(dd, &short_name, NULL))
+    {
+        struct stat sb;
+        if (!is_valid_element_name(short_name)
+            || fstatat(dd->dd_fd, short_name, &sb, AT_SYMLINK_NOFOLLOW) != 0
+            || !S_ISREG(sb.st_mode))
+        {
+            free(short_name);
+            continue;
+        }
+
+        const int fd = openat(dd->dd_fd, short_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        char *digest = fd < 0 ? NULL : sha256_fd(fd);
+        if (digest == NULL)
+        {
+            log_notice("Not forwarding unreadable element '%s'", short_name);
+            if (fd >= 0)
+                close(fd);
+            free(short_name);
+            continue;
+        }
+
+        struct local_element *lel = xzalloc(sizeof(*lel));
+        lel->el.name = short_name;
+        lel->el.size = sb.st_size;
+        strcpy(lel->el.sha256, digest);
+        lel->fd = fd;
+        free(digest);
+
+        elements = g_list_prepend(elements, lel);
+    }
+
+    return elements;
+}
+
+static enum abrt_forward_result send_element_data(abrt_forward_conn_t *conn,
+        struct local_element *lel, off_t offset, struct abrt_forward_stats *stats)
+{
+    while (offset < lel->el.size)
+    {
+        off_t length = lel->el.size - offset;
+        if (length > DATA_CHUNK_SIZE)
+            length = DATA_CHUNK_SIZE;
+
+        if (conn_printf(conn, "DATA %s %lld %lld\n", lel->el.name, (long long)offset, (long long)length) != 0
+            || conn_write_from_fd(conn, lel->fd, offset, length) != 0)
+            return ABRT_FORWARD_CONN_ERROR;
+
+        offset += length;
+        if (stats)
+            stats->afs_sent += length;
+    }
+
+    return ABRT_FORWARD_DONE;
+}
+
+enum abrt_forward_result abrt_forward_send_problem(abrt_forward_conn_t *conn,
+        const char *dirname, const char *problem_id,
+        struct abrt_forward_stats *stats)
+{
+    struct dump_dir *dd = dd_opendir(dirname, DD_OPEN_READONLY | DD_FAIL_QUIETLY_ENOENT);
+    if (dd == NULL)
+        return ABRT_FORWARD_REJECTED;
+
+    char *duphash = dd_load_text_ext(dd, FILENAME_DUPHASH,
+            DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT);
+    GList *elements = collect_local_elements(dd);
+
+    enum abrt_forward_result r = ABRT_FORWARD_CONN_ERROR;
+    char *line = NULL;
+
+    if (conn_printf(conn, "PROBLEM %s %s\n", problem_id, duphash && duphash[0] ? duphash : "-") != 0)
+        goto finito;
+
+    unsigned long long total_size = 0;
+    for (GList *iter = elements; iter != NULL; iter = g_list_next(iter))
+    {
+        struct local_element *lel = iter->data;
+        total_size += lel->el.size;
+        if (conn_printf(conn, "ELEMENT %s %lld %s\n", lel->el.name, (long long)lel->el.size, lel->el.sha256) != 0)
+            goto finito;
+    }
+
+    if (conn_printf(conn, "END\n") != 0)
+        goto finito;
+
+    /* Read all NEED lines first, the collector is waiting for DATA only
+     * after READY */
+    GList *needed = NULL;
+    unsigned long long needed_size = 0;
+    while ((line = conn_read_line(conn)) != NULL && strcmp(line, "READY") != 0)
+    {
+        if (strcmp(line, "SKIP") == 0)
+        {
+            log_info("The collector already has '%s'", problem_id);
+            if (stats)
+                stats->afs_skipped += total_size;
+            r = ABRT_FORWARD_DONE;
+            goto finito;
+        }
+
+        if (prefixcmp(line, "ERR ") == 0)
+        {
+            error_msg("Collector refused '%s': %s", dirname, line + strlen("ERR "));
+            r = ABRT_FORWARD_REJECTED;
+            goto finito;
+        }
+
+        char name[MAX_ELEMENT_NAME_LENGTH + 1];
+        long long offset;
+        struct local_element *lel = NULL;
+        if (sscanf(line, "NEED %64s %lld", name, &offset) != 2
+            || (lel = (struct local_element *)find_element(elements, name)) == NULL
+            || offset < 0 || offset > lel->el.size)
+        {
+            error_msg("Unexpected response: '%s'", line);
+            g_list_free(needed);
+            goto finito;
+        }
+
+        lel->el.offset = offset;
+        needed_size += lel->el.size - offset;
+        needed = g_list_prepend(needed, lel);
+        free(line);
+    }
+
+    if (line == NULL)
+    {
+        g_list_free(needed);
+        goto finito;
+    }
+
+    if (stats)
+        stats->afs_skipped += total_size - needed_size;
+
+    enum abrt_forward_result sr = ABRT_FORWARD_DONE;
+    for (GList *iter = needed; iter != NULL && sr == ABRT_FORWARD_DONE; iter = g_list_next(iter))
+    {
+        struct local_element *lel = iter->data;
+        sr = send_element_data(conn, lel, lel->el.offset, stats);
+    }
+    g_list_free(needed);
+
+    if (sr != ABRT_FORWARD_DONE || conn_printf(conn, "COMMIT\n") != 0)
+        goto finito;
+
+    free(line);
+    line = conn_read_line(conn);
+    if (line == NULL)
+        goto finito;
+
+    if (prefixcmp(line, "OK ") == 0)
+    {
+        log_notice("Forwarded '%s' as '%s'", dirname, line + strlen("OK "));
+        r = ABRT_FORWARD_DONE;
+    }
+    else if (prefixcmp(line, "RETRY ") == 0)
+    {
+        log_warning("Collector will accept '%s' later: %s", dirname, line + strlen("RETRY "));
+        r = ABRT_FORWARD_RETRY;
+    }
+    else
+    {
+        error_msg("Collector refused '%s': %s", dirname, line);
+        r = ABRT_FORWARD_REJECTED;
+    }
+
+finito:
+    free(line);
+    g_list_free_full(elements, (GDestroyNotify)local_element_free);
+    free(duphash);
+    dd_close(dd);
+    return r;
+}
+
+/*
+ * Outbound queue
+ */
+
+static gint compare_entry_names(gconstpointer a, gconstpointer b)
+{
+    return strcmp(a, b);
+}
+
+GList *abrt_forward_queue_list(const char *queue_dir)
+{
+    GList *entries = NULL;
+    DIR *dir = opendir(queue_dir);
+    if (dir == NULL)
+        return NULL;
+
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+        if (dent->d_name[0] != '.')
+            entries = g_list_prepend(entries, xstrdup(dent->d_name));
+    closedir(dir);
+
+    return g_list_sort(entries, compare_entry_names);
+}
+
+int abrt_forward_queue_add(const char *queue_dir, const char *dirname, unsigned max_size)
+{
+    if (g_mkdir_with_parents(queue_dir, 0700) != 0)
+    {
+        perror_msg("Can't create '%s'", queue_dir);
+        return -1;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    const char *base = strrchr(dirname, '/') ? strrchr(dirname, '/') + 1 : dirname;
+    /* Names sort in the order of insertion */
+    char *entry = xasprintf("%s/%020llu.%09lu-%s", queue_dir,
+            (unsigned long long)ts.tv_sec, (unsigned long)ts.tv_nsec, base);
+    char *tmp = xasprintf("%s/.%s.tmp", queue_dir, base);
+
+    const int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    int r = -1;
+    if (fd >= 0)
+    {
+        const ssize_t len = strlen(dirname);
+        r = full_write(fd, dirname, len) == len ? 0 : -1;
+        r = close(fd) != 0 ? -1 : r;
+    }
+
+    if (r != 0 || rename(tmp, entry) != 0)
+    {
+        perror_msg("Can't add '%s' to queue", dirname);
+        unlink(tmp);
+        r = -1;
+    }
+    free(tmp);
+    free(entry);
+
+    if (r == 0 && max_size != 0)
+    {
+        GList *entries = abrt_forward_queue_list(queue_dir);
+        unsigned count = g_list_length(entries);
+        for (GList *iter = entries; iter != NULL && count > max_size; iter = g_list_next(iter), --count)
+        {
+            log_warning("Forwarding queue is full, dropping '%s'", (char *)iter->data);
+            abrt_forward_queue_remove(queue_dir, iter->data);
+        }
+        list_free_with_free(entries);
+    }
+
+    return r;
+}
+
+char *abrt_forward_queue_entry_dirname(const char *queue_dir, const char *entry)
+{
+    char *path = concat_path_file(queue_dir, entry);
+    char *dirname = xmalloc_open_read_close(path, /*maxsz:*/ NULL);
+    free(path);
+
+    if (dirname != NULL)
+        strchrnul(dirname, '\n')[0] = '\0';
+
+    return dirname;
+}
+
+void abrt_forward_queue_remove(const char *queue_dir, const char *entry)
+{
+    char *path = concat_path_file(queue_dir, entry);
+    if (unlink(path) != 0 && errno != ENOENT)
+        perror_msg("Can't remove '%s'", path);
+    free(path);
+}
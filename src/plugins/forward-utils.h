@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2026  ABRT Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef _ABRT_FORWARD_UTILS_H_
+#define _ABRT_FORWARD_UTILS_H_
+
+#include "libabrt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Problem forwarding protocol
+ *
+ * A client streams problem directories to a collector over a single
+ * persistent connection (TCP or stdin/stdout of a command, e.g. ssh).
+ * Every problem is announced with its duphash and checksums of all its
+ * elements first, so the collector requests only the data it does not
+ * have yet:
+ *
+ * C: ABRT-FORWARD 1
+ * S: ABRT-FORWARD 1
+ * C: PROBLEM <id> <duphash|->
+ * C: ELEMENT <name> <size> <sha256>    (for every element)
+ * C: END
+ * S: SKIP                              (<id> has already been committed)
+ *  or
+ * S: NEED <name> <offset>              (for every element to be sent)
+ * S: READY
+ * C: DATA <name> <offset> <length>     (followed by <length> bytes)
+ * C: COMMIT
+ * S: OK <directory> | RETRY <message> | ERR <message>
+ * ...
+ * C: BYE
+ *
+ * The collector keeps partially received problems in its state directory,
+ * so the offsets in NEED lines let the client resume interrupted transfers.
+ * Large elements are stored in a content addressed store and re-used for
+ * other problems with the same checksum. Large elements of problems whose
+ * duphash is already known to the collector are not transferred at all.
+ */
+#define ABRT_FORWARD_PROTOCOL_HEADER "ABRT-FORWARD 1"
+
+/* Default port of abrt-forward-server socket */
+#define ABRT_FORWARD_DEFAULT_PORT "4321"
+
+enum abrt_forward_result {
+    ABRT_FORWARD_CONN_ERROR = -1, /* Connection is broken, reconnect and try again */
+    ABRT_FORWARD_DONE       =  0, /* The collector has the problem */
+    ABRT_FORWARD_REJECTED   =  1, /* The problem cannot be forwarded */
+    ABRT_FORWARD_RETRY      =  2, /* Try to forward the problem later */
+};
+
+/*
+ * Collector
+ */
+struct abrt_forward_collector_conf
+{
+    const char *afcc_dump_location;         /* where committed problems go */
+    const char *afcc_state_dir;             /* partial transfers, object store */
+    unsigned long afcc_dedup_min_size;      /* elements of known duphashes
+                                               bigger than this are skipped
+                                               and stored as objects */
+    unsigned long long afcc_max_problem_size; /* 0 means unlimited */
+    int afcc_commit_fd;                     /* connection to the privileged
+                                               committer or -1 to commit
+                                               problems in-process */
+};
+
+/*
+ * Serves a single client connection
+ *
+ * @returns 0 if the client closed the connection gracefully, otherwise 1
+ */
+int abrt_forward_serve(int in_fd, int out_fd, const struct abrt_forward_collector_conf *conf);
+
+/*
+ * Commits problems received by an unprivileged abrt_forward_serve() whose
+ * afcc_commit_fd is the other end of fd
+ *
+ * The receiver can write only to STATE_DIR/incoming. The committer takes
+ * a received problem directory away from it, checks the data, hands them
+ * over to root and the abrt group and moves them to the dump location.
+ * Files of the received problems must be owned by receiver_uid.
+ *
+ * @returns 0 if the receiver closed the connection, otherwise 1
+ */
+int abrt_forward_committer_serve(int fd, uid_t receiver_uid, const struct abrt_forward_collector_conf *conf);
+
+/*
+ * Removes objects not referenced by any problem directory and forgets old
+ * committed problems and duphashes. Does nothing if it was run less than an
+ * hour ago.
+ */
+void abrt_forward_collector_cleanup(const char *state_dir);
+
+/*
+ * Returns true if the numeric address is a loopback address or matches one
+ * of "ADDRESS" or "ADDRESS/PREFIX" strings in the list
+ */
+bool abrt_forward_address_allowed(const char *address, GList *allowed_clients);
+
+/*
+ * Returns true if the client connected over fd may forward problems, i.e.
+ * fd is not an IP socket (a pipe from ssh) or the address of the peer is
+ * allowed by abrt_forward_address_allowed()
+ */
+bool abrt_forward_client_allowed(int fd, GList *allowed_clients);
+
+/*
+ * Client
+ */
+typedef struct abrt_forward_conn abrt_forward_conn_t;
+
+struct abrt_forward_stats
+{
+    unsigned long long afs_sent;    /* bytes transferred */
+    unsigned long long afs_skipped; /* bytes the collector did not need */
+};
+
+/*
+ * Starts a session over already connected file descriptors
+ *
+ * The file descriptors are owned by the returned connection.
+ */
+abrt_forward_conn_t *abrt_forward_conn_new(int in_fd, int out_fd);
+
+/*
+ * Connects to a collector
+ *
+ * @param collector Either "host[:port]" or "|command" where the command
+ * speaks the protocol on its stdin/stdout (e.g. "|ssh host abrt-forward-server")
+ */
+abrt_forward_conn_t *abrt_forward_connect(const char *collector);
+
+void abrt_forward_conn_free(abrt_forward_conn_t *conn);
+
+/*
+ * Returns malloced problem ID unique among all clients of a collector
+ */
+char *abrt_forward_problem_id(const char *dirname);
+
+enum abrt_forward_result abrt_forward_send_problem(abrt_forward_conn_t *conn,
+        const char *dirname, const char *problem_id,
+        struct abrt_forward_stats *stats);
+
+/*
+ * Outbound queue
+ *
+ * The queue is a directory of files holding paths to problem directories.
+ * The files are processed in the order of their names.
+ */
+
+/*
+ * Adds the problem directory to the queue, removes the oldest entries if the
+ * queue has more than max_size entries (0 means unlimited)
+ */
+int abrt_forward_queue_add(const char *queue_dir, const char *dirname, unsigned max_size);
+
+/*
+ * Returns sorted list of malloced entry names
+ */
+GList *abrt_forward_queue_list(const char *queue_dir);
+
+/*
+ * Returns malloced path to the problem directory or NULL
+ */
+char *abrt_forward_queue_entry_dirname(const char *queue_dir, const char *entry);
+
+void abrt_forward_queue_remove(const char *queue_dir, const char *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*_ABRT_FORWARD_UTILS_H_*/
@@ -19,6 +19,8 @@
 #include <satyr/frame.h>
 #include <satyr/normalize.h>
 
+#include <sys/utsname.h>
+
 #include "oops-utils.h"
 #include "libabrt.h"
 
@@ -149,6 +151,337 @@ unsigned abrt_oops_create_dump_dirs(GList *oops_list, const char *dump_location,
     return errors;
 }
 
+int abrt_oom_process_list(GList *oom_list, const char *dump_location, const char *analyzer, int flags)
+{
+    const int oom_cnt = g_list_length(oom_list);
+    if (oom_cnt == 0)
+        return 0;
+
+    log("Found OOM kills: %d", oom_cnt);
+    if ((flags & ABRT_OOPS_PRINT_STDOUT))
+    {
+        for (GList *iter = oom_list; iter != NULL; iter = g_list_next(iter))
+            printf("\n%s", (const char *)iter->data);
+    }
+
+    unsigned errors = 0;
+    if (dump_location != NULL)
+    {
+        errors = abrt_oom_create_dump_dirs(oom_list, dump_location, analyzer, flags);
+        if (errors)
+            log("%d errors while dumping OOM kills", errors);
+    }
+
+    return errors;
+}
+
+/* Memory state is read right after the detection, the victim's cgroup is
+ * often removed shortly after the kill. The state is meaningless for old
+ * reports, so only live reports get the snapshot. */
+struct oom_snapshot
+{
+    char *pressure;
+    char *memory_stat;
+    char *memory_events;
+};
+
+static char *read_cgroup_file(const char *cgroup, const char *name)
+{
+    /* unified hierarchy first, then the cgroup v1 memory controller */
+    static const char *const roots[] = {
+        "/sys/fs/cgroup",
+        "/sys/fs/cgroup/memory",
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(roots); ++i)
+    {
+        char *path = xasprintf("%s%s/%s", roots[i], strcmp(cgroup, "/") == 0 ? "" : cgroup, name);
+        char *value = xmalloc_open_read_close(path, /*maxsize:*/ NULL);
+        free(path);
+        if (value != NULL)
+            return value;
+    }
+
+    return NULL;
+}
+
+static void oom_snapshot_take(struct oom_snapshot *snapshot, const struct abrt_koops_oom *oom)
+{
+    snapshot->pressure = xmalloc_open_read_close("/proc/pressure/memory", /*maxsize:*/ NULL);
+
+    const char *cgroup = oom->task_memcg ? oom->task_memcg : oom->memcg;
+    snapshot->memory_stat = cgroup ? read_cgroup_file(cgroup, "memory.stat") : NULL;
+    snapshot->memory_events = cgroup ? read_cgroup_file(cgroup, "memory.events") : NULL;
+    /* cgroup v1 has OOM counters in memory.oom_control */
+    if (cgroup && snapshot->memory_events == NULL)
+        snapshot->memory_events = read_cgroup_file(cgroup, "memory.oom_control");
+}
+
+static void oom_snapshot_free(struct oom_snapshot *snapshot)
+{
+    free(snapshot->pressure);
+    free(snapshot->memory_stat);
+    free(snapshot->memory_events);
+}
+
+static void abrt_oom_save_data_in_dump_dir(struct dump_dir *dd, const struct abrt_koops_oom *oom,
+                                           const struct oom_snapshot *snapshot)
+{
+    dd_save_text(dd, FILENAME_BACKTRACE, oom->trace);
+    if (oom->meminfo)
+        dd_save_text(dd, "oom_meminfo", oom->meminfo);
+    if (oom->tasks)
+        dd_save_text(dd, "oom_tasks", oom->tasks);
+
+    dd_save_text(dd, "oom_constraint", oom->constraint);
+    if (oom->memcg)
+        dd_save_text(dd, "oom_cgroup", oom->memcg);
+    if (oom->task_memcg)
+        dd_save_text(dd, "oom_task_cgroup", oom->task_memcg);
+
+    char *victim = xasprintf("%lu (%s)", oom->victim_pid, oom->victim);
+    dd_save_text(dd, "oom_victim", victim);
+    free(victim);
+
+    if (oom->victim_uid >= 0)
+    {
+        char uid_str[sizeof(long) * 3 + 2];
+        sprintf(uid_str, "%ld", oom->victim_uid);
+        dd_save_text(dd, "oom_victim_uid", uid_str);
+    }
+
+    if (snapshot->pressure)
+        dd_save_text(dd, "pressure_memory", snapshot->pressure);
+    if (snapshot->memory_stat)
+        dd_save_text(dd, "memory_stat", snapshot->memory_stat);
+    if (snapshot->memory_events)
+        dd_save_text(dd, "memory_events", snapshot->memory_events);
+
+    char hash_str[SHA1_RESULT_LEN*2 + 1];
+    koops_oom_hash_str(hash_str, oom);
+    /* Repeated kills are counted by the duplicate detection of post-create */
+    dd_save_text(dd, FILENAME_UUID, hash_str);
+    dd_save_text(dd, FILENAME_DUPHASH, hash_str);
+
+    char *cgroup = koops_oom_cgroup_key(oom);
+    char *reason = strcmp(oom->constraint, "CONSTRAINT_MEMCG") == 0 && cgroup != NULL
+        ? xasprintf("Out of memory in cgroup %s: killed process %s", cgroup, oom->victim)
+        : xasprintf("Out of memory: killed process %s", oom->victim);
+    dd_save_text(dd, FILENAME_REASON, reason);
+    free(reason);
+    free(cgroup);
+}
+
+unsigned abrt_oom_create_dump_dirs(GList *oom_list, const char *dump_location, const char *analyzer, int flags)
+{
+    const unsigned oom_cnt = g_list_length(oom_list);
+    const unsigned count = oom_cnt > ABRT_OOPS_MAX_DUMPED_COUNT ? ABRT_OOPS_MAX_DUMPED_COUNT : oom_cnt;
+
+    log_notice("Saving %u OOM kills as problem dirs", count);
+
+    /* Snapshots of all reports first, the directories can wait */
+    struct abrt_koops_oom *ooms = xzalloc(count * sizeof(ooms[0]));
+    struct oom_snapshot *snapshots = xzalloc(count * sizeof(snapshots[0]));
+    bool *parsed = xzalloc(count * sizeof(parsed[0]));
+    GList *iter = oom_list;
+    for (unsigned i = 0; i < count; ++i, iter = g_list_next(iter))
+    {
+        parsed[i] = koops_oom_parse((const char *)iter->data, &ooms[i]) == 0;
+        if (parsed[i] && (flags & ABRT_OOPS_LIVE_REPORTS))
+            oom_snapshot_take(&snapshots[i], &ooms[i]);
+    }
+
+    struct utsname uts;
+    if (uname(&uts) != 0)
+        uts.release[0] = '\0';
+
+    time_t t = time(NULL);
+    const char *iso_date = iso_date_string(&t);
+
+    pid_t my_pid = getpid();
+    unsigned errors = 0;
+    for (unsigned idx = 0; idx < count; ++idx)
+    {
+        if (!parsed[idx])
+        {
+            error_msg("Can't parse OOM report");
+            ++errors;
+            continue;
+        }
+
+        char base[sizeof("oom-YYYY-MM-DD-hh:mm:ss-%lu-%lu") + 2 * sizeof(long)*3];
+        sprintf(base, "oom-%s-%lu-%lu", iso_date, (long)my_pid, (long)idx);
+        char *path = concat_path_file(dump_location, base);
+
+        struct dump_dir *dd = dd_create(path, /*fs owner*/0, DEFAULT_DUMP_DIR_MODE);
+        if (dd)
+        {
+            dd_create_basic_files(dd, /*no uid*/(uid_t)-1L, NULL);
+            abrt_oom_save_data_in_dump_dir(dd, &ooms[idx], &snapshots[idx]);
+            if (uts.release[0])
+                dd_save_text(dd, FILENAME_KERNEL, uts.release);
+            dd_save_text(dd, FILENAME_ABRT_VERSION, VERSION);
+            dd_save_text(dd, FILENAME_ANALYZER, analyzer);
+            dd_save_text(dd, FILENAME_TYPE, "OOM");
+            if ((flags & ABRT_OOPS_WORLD_READABLE))
+                dd_set_no_owner(dd);
+            dd_close(dd);
+            notify_new_path(path);
+        }
+        else
+            errors++;
+
+        free(path);
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (parsed[i])
+        {
+            koops_oom_free(&ooms[i]);
+            oom_snapshot_free(&snapshots[i]);
+        }
+    }
+    free(parsed);
+    free(snapshots);
+    free(ooms);
+
+    return errors;
+}
+
+int abrt_stall_process_list(GList *stall_list, const char *dump_location, const char *analyzer, int flags)
+{
+    const int stall_cnt = g_list_length(stall_list);
+    if (stall_cnt == 0)
+        return 0;
+
+    log("Found stalls: %d", stall_cnt);
+    if ((flags & ABRT_OOPS_PRINT_STDOUT))
+    {
+        for (GList *iter = stall_list; iter != NULL; iter = g_list_next(iter))
+            printf("\n%s", (const char *)iter->data);
+    }
+
+    unsigned errors = 0;
+    if (dump_location != NULL)
+    {
+        errors = abrt_stall_create_dump_dirs(stall_list, dump_location, analyzer, flags);
+        if (errors)
+            log("%d errors while dumping stalls", errors);
+    }
+
+    return errors;
+}
+
+static void abrt_stall_save_data_in_dump_dir(struct dump_dir *dd, const char *report,
+                                             const struct abrt_koops_stall *stall)
+{
+    dd_save_text(dd, FILENAME_BACKTRACE, report);
+    dd_save_text(dd, "stall_kind", koops_stall_kind_name(stall->kind));
+
+    const char *unit = stall->kind == ABRT_KOOPS_STALL_RCU ? "jiffies" : "seconds";
+    if (stall->duration != 0)
+    {
+        char *duration = xasprintf("%lu %s", stall->duration, unit);
+        dd_save_text(dd, "stall_duration", duration);
+        free(duration);
+    }
+
+    if (stall->cpus)
+        dd_save_text(dd, "stall_cpus", stall->cpus);
+    if (stall->tasks)
+        dd_save_text(dd, "stall_tasks", stall->tasks);
+    if (stall->stacks)
+        dd_save_text(dd, "stall_stacks", stall->stacks);
+    if (stall->crash_function)
+        dd_save_text(dd, FILENAME_CRASH_FUNCTION, stall->crash_function);
+
+    char hash_str[SHA1_RESULT_LEN*2 + 1];
+    koops_stall_hash_str(hash_str, stall);
+    /* Recurrences are counted by the duplicate detection of post-create */
+    dd_save_text(dd, FILENAME_UUID, hash_str);
+    dd_save_text(dd, FILENAME_DUPHASH, hash_str);
+
+    struct strbuf *reason = strbuf_new();
+    switch (stall->kind)
+    {
+        case ABRT_KOOPS_STALL_HUNG_TASK:
+            strbuf_append_str(reason, "Task blocked");
+            break;
+        case ABRT_KOOPS_STALL_SOFT_LOCKUP:
+            strbuf_append_strf(reason, "Soft lockup on CPU %s", stall->cpus ? stall->cpus : "?");
+            break;
+        case ABRT_KOOPS_STALL_RCU:
+            strbuf_append_strf(reason, "RCU stall on CPU %s", stall->cpus ? stall->cpus : "?");
+            break;
+    }
+    if (stall->duration != 0)
+        strbuf_append_strf(reason, " for %lu %s", stall->duration, unit);
+    if (stall->crash_function)
+        strbuf_append_strf(reason, " in %s", stall->crash_function);
+    dd_save_text(dd, FILENAME_REASON, reason->buf);
+    strbuf_free(reason);
+}
+
+unsigned abrt_stall_create_dump_dirs(GList *stall_list, const char *dump_location, const char *analyzer, int flags)
+{
+    const unsigned stall_cnt = g_list_length(stall_list);
+    const unsigned count = stall_cnt > ABRT_OOPS_MAX_DUMPED_COUNT ? ABRT_OOPS_MAX_DUMPED_COUNT : stall_cnt;
+
+    log_notice("Saving %u stalls as problem dirs", count);
+
+    struct utsname uts;
+    if (uname(&uts) != 0)
+        uts.release[0] = '\0';
+
+    time_t t = time(NULL);
+    const char *iso_date = iso_date_string(&t);
+
+    pid_t my_pid = getpid();
+    unsigned errors = 0;
+    GList *iter = stall_list;
+    for (unsigned idx = 0; idx < count; ++idx, iter = g_list_next(iter))
+    {
+        const char *report = (const char *)iter->data;
+        struct abrt_koops_stall stall;
+        if (koops_stall_parse(report, &stall) != 0)
+        {
+            error_msg("Can't parse stall report");
+            ++errors;
+            continue;
+        }
+
+        char base[sizeof("stall-YYYY-MM-DD-hh:mm:ss-%lu-%lu") + 2 * sizeof(long)*3];
+        sprintf(base, "stall-%s-%lu-%lu", iso_date, (long)my_pid, (long)idx);
+        char *path = concat_path_file(dump_location, base);
+
+        struct dump_dir *dd = dd_create(path, /*fs owner*/0, DEFAULT_DUMP_DIR_MODE);
+        if (dd)
+        {
+            dd_create_basic_files(dd, /*no uid*/(uid_t)-1L, NULL);
+            abrt_stall_save_data_in_dump_dir(dd, report, &stall);
+            if (stall.kernel)
+                dd_save_text(dd, FILENAME_KERNEL, stall.kernel);
+            else if (uts.release[0])
+                dd_save_text(dd, FILENAME_KERNEL, uts.release);
+            dd_save_text(dd, FILENAME_ABRT_VERSION, VERSION);
+            dd_save_text(dd, FILENAME_ANALYZER, analyzer);
+            dd_save_text(dd, FILENAME_TYPE, "Stall");
+            if ((flags & ABRT_OOPS_WORLD_READABLE))
+                dd_set_no_owner(dd);
+            dd_close(dd);
+            notify_new_path(path);
+        }
+        else
+            errors++;
+
+        free(path);
+        koops_stall_free(&stall);
+    }
+
+    return errors;
+}
+
 static char *abrt_oops_list_of_tainted_modules(const char *proc_modules)
 {
     struct strbuf *result = strbuf_new();
@@ -315,3 +648,39 @@ char *abrt_oops_string_filter_regex(void)
 
     return NULL;
 }
+
+GList *abrt_oops_suspicious_strings_filtered(void)
+{
+    GList *koops_strings = koops_suspicious_strings_list();
+
+    char *oops_string_filter_regex = abrt_oops_string_filter_regex();
+    if (oops_string_filter_regex)
+    {
+        regex_t filter_re;
+        if (regcomp(&filter_re, oops_string_filter_regex, REG_NOSUB) != 0)
+            perror_msg_and_die(_("Failed to compile regex"));
+
+        GList *iter = koops_strings;
+        while(iter != NULL)
+        {
+            GList *next = g_list_next(iter);
+
+            const int reti = regexec(&filter_re, (const char *)iter->data, 0, NULL, 0);
+            if (reti == 0)
+                koops_strings = g_list_delete_link(koops_strings, iter);
+            else if (reti != REG_NOMATCH)
+            {
+                char msgbuf[100];
+                regerror(reti, &filter_re, msgbuf, sizeof(msgbuf));
+                error_msg_and_die("Regex match failed: %s", msgbuf);
+            }
+
+            iter = next;
+        }
+
+        regfree(&filter_re);
+        free(oops_string_filter_regex);
+    }
+
+    return koops_strings;
+}
@@ -31,6 +31,9 @@ enum {
     ABRT_OOPS_THROTTLE_CREATION = 1 << 0,
     ABRT_OOPS_WORLD_READABLE    = 1 << 1,
     ABRT_OOPS_PRINT_STDOUT      = 1 << 2,
+    /* The reports have just been logged, so the current memory state
+     * belongs to them. Not set for replayed logs. */
+    ABRT_OOPS_LIVE_REPORTS      = 1 << 3,
 };
 
 int g_abrt_oops_sleep_woke_up_on_signal;
@@ -39,7 +42,17 @@ int abrt_oops_process_list(GList *oops_list, const char *dump_location, const ch
 unsigned abrt_oops_create_dump_dirs(GList *oops_list, const char *dump_location, const char *analyzer, int flags);
 void abrt_oops_save_data_in_dump_dir(struct dump_dir *dd, char *oops, const char *proc_modules);
 int abrt_oops_signaled_sleep(int seconds);
+/* Creates OOM problem directories from reports extracted by
+ * koops_extract_oom_kills_from_lines(), returns number of errors */
+int abrt_oom_process_list(GList *oom_list, const char *dump_location, const char *analyzer, int flags);
+unsigned abrt_oom_create_dump_dirs(GList *oom_list, const char *dump_location, const char *analyzer, int flags);
+/* Creates Stall problem directories from reports extracted by
+ * koops_extract_stalls_from_lines(), returns number of errors */
+int abrt_stall_process_list(GList *stall_list, const char *dump_location, const char *analyzer, int flags);
+unsigned abrt_stall_create_dump_dirs(GList *stall_list, const char *dump_location, const char *analyzer, int flags);
 char *abrt_oops_string_filter_regex(void);
+/* Returns list of static strings, free only the list */
+GList *abrt_oops_suspicious_strings_filtered(void);
 
 #ifdef __cplusplus
 }